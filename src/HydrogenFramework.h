@@ -17,4 +17,16 @@
 
 
 
-#include "math\h2_math.h"
\ No newline at end of file
+#include "math\h2_math.h"
+#include "math\h2_bezier.h"
+#include "core\h2_memory.h"
+#include "core\h2_allocator.h"
+#include "core\h2_spsc_ring.h"
+#include "core\h2_mpmc_queue.h"
+#include "core\h2_concurrent_vector.h"
+#include "core\h2_epoch.h"
+#include "core\h2_profiler.h"
+#include "core\h2_frame_telemetry.h"
+#include "core\h2_job_system.h"
+#include "core\h2_fiber_scheduler.h"
+#include "core\h2_frame_pipeline.h"
\ No newline at end of file
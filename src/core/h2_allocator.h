@@ -0,0 +1,608 @@
+#pragma once
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "SDL_atomic.h"
+#include "SDL_stdinc.h"
+#include "SDL_thread.h"
+
+#include "h2_memory.h"
+
+
+
+// Define H2_ALLOCATOR_TRACKING to count allocations and to list every
+// live allocator through 'getFirstAllocator()'.
+
+#define H2_ALLOCATOR_ALIGNMENT 16            // default, enough for SSE loads
+#define H2_THREAD_ARENA_SIZE (256*1024)      // bytes per thread
+
+
+
+
+namespace h2
+{
+	struct AllocatorStats
+	{
+		unsigned int capacity;
+		unsigned int used;
+		unsigned int peak;          // highest 'used' since construction
+		unsigned int nFailed;       // requests refused since the last reset
+		unsigned int nAllocations;  // since the last reset, only with H2_ALLOCATOR_TRACKING
+	};
+
+
+	// Base of all allocators below: name and statistics. With tracking
+	// on, allocators also link themselves into a global list for
+	// debug views.
+	class TrackedAllocator
+	{
+	public:
+
+		// Constructors
+
+		TrackedAllocator(const char* in_name) : name(in_name)
+		{
+			stats.capacity = stats.used = stats.peak = stats.nFailed = stats.nAllocations = 0;
+
+#ifdef H2_ALLOCATOR_TRACKING
+			SDL_AtomicLock(&listLock());
+			prev = 0;
+			next = listHead();
+			if (next != 0)
+			{
+				next->prev = this;
+			}
+			listHead() = this;
+			SDL_AtomicUnlock(&listLock());
+#endif
+		}
+
+
+		// Destructor
+
+		~TrackedAllocator()
+		{
+#ifdef H2_ALLOCATOR_TRACKING
+			SDL_AtomicLock(&listLock());
+			if (prev != 0)
+			{
+				prev->next = next;
+			} else
+			{
+				listHead() = next;
+			}
+			if (next != 0)
+			{
+				next->prev = prev;
+			}
+			SDL_AtomicUnlock(&listLock());
+#endif
+		}
+
+
+		// Methods
+
+		inline const char* getName() const { return name; }
+
+		inline const AllocatorStats& getStats() const { return stats; }
+
+		inline unsigned int getUsed() const { return stats.used; }
+
+		inline unsigned int getPeak() const { return stats.peak; }
+
+		inline unsigned int getCapacity() const { return stats.capacity; }
+
+		// Requests refused since the last reset.
+		inline unsigned int getFailed() const { return stats.nFailed; }
+
+#ifdef H2_ALLOCATOR_TRACKING
+		// Live allocators, not safe against concurrent construction.
+		static inline TrackedAllocator* getFirstAllocator() { return listHead(); }
+
+		inline TrackedAllocator* getNextAllocator() const { return next; }
+#endif
+
+	protected:
+
+		const char* name;
+
+		AllocatorStats stats;
+
+
+		inline void trackAllocation(unsigned int used)
+		{
+			stats.used = used;
+			stats.peak = used > stats.peak ? used : stats.peak;
+#ifdef H2_ALLOCATOR_TRACKING
+			stats.nAllocations++;
+#endif
+		}
+
+		inline void trackReset()
+		{
+			stats.used = 0;
+			stats.nFailed = 0;
+			stats.nAllocations = 0;
+		}
+
+	private:
+
+#ifdef H2_ALLOCATOR_TRACKING
+		TrackedAllocator* prev;
+		TrackedAllocator* next;
+
+		static inline TrackedAllocator*& listHead()
+		{
+			static TrackedAllocator* head = 0;
+			return head;
+		}
+
+		static inline SDL_SpinLock& listLock()
+		{
+			static SDL_SpinLock lock = 0;
+			return lock;
+		}
+#endif
+
+
+		TrackedAllocator(const TrackedAllocator&);
+		TrackedAllocator& operator = (const TrackedAllocator&);
+	};
+
+
+	inline Uint8* alignPointer(Uint8* p, unsigned int alignment)
+	{
+		return (Uint8*)(((size_t)p + alignment - 1) & ~(size_t)(alignment - 1));
+	}
+
+
+	// Bump allocator over one fixed block. Allocation is a pointer
+	// increment and never touches the heap; when the block is full it
+	// returns 0 and counts the failure. Memory is released all at once
+	// by 'reset()', or back to a marker, which makes it a stack
+	// allocator for nested temporaries. Destructors are never run.
+	class LinearAllocator : public TrackedAllocator
+	{
+	public:
+
+		typedef unsigned int Marker;
+
+
+		// Constructors
+
+		// The block is charged to 'tag' by the memory tracker.
+		LinearAllocator(unsigned int in_capacity, const char* in_name = "linear", MemoryTag tag = MEMORY_TAG_CORE) :
+			TrackedAllocator(in_name), buffer((Uint8*)H2_MALLOC(in_capacity, tag)), offset(0), owner(true)
+		{
+			stats.capacity = buffer != 0 ? in_capacity : 0;
+		}
+
+		// Over memory owned by the caller.
+		LinearAllocator(void* in_buffer, unsigned int in_capacity, const char* in_name = "linear") :
+			TrackedAllocator(in_name), buffer((Uint8*)in_buffer), offset(0), owner(false)
+		{
+			stats.capacity = in_capacity;
+		}
+
+
+		// Destructor
+
+		~LinearAllocator()
+		{
+			if (owner)
+			{
+				H2_FREE(buffer);
+			}
+		}
+
+
+		// Methods
+
+		// 'alignment' is a power of two.
+		inline void* allocate(unsigned int size, unsigned int alignment = H2_ALLOCATOR_ALIGNMENT)
+		{
+			Uint8* p = alignPointer(buffer + offset, alignment);
+			unsigned int start = (unsigned int)(p - buffer);
+
+			if (start + size > stats.capacity || start + size < start)
+			{
+				stats.nFailed++;
+				return 0;
+			}
+
+			offset = start + size;
+			trackAllocation(offset);
+
+			return p;
+		}
+
+		// Uninitialized array of 'n' T.
+		template <class T>
+		inline T* allocateArray(unsigned int n)
+		{
+			if (n > ~0u/(unsigned int)sizeof(T))
+			{
+				stats.nFailed++;
+				return 0;
+			}
+
+			return (T*)allocate(n*(unsigned int)sizeof(T), sizeof(T) >= H2_ALLOCATOR_ALIGNMENT ? H2_ALLOCATOR_ALIGNMENT : 8);
+		}
+
+		inline void reset()
+		{
+			offset = 0;
+			trackReset();
+		}
+
+		inline Marker getMarker() const
+		{
+			return offset;
+		}
+
+		// Releases everything allocated after 'marker' was taken.
+		inline void freeToMarker(Marker marker)
+		{
+			offset = marker < offset ? marker : offset;
+			stats.used = offset;
+		}
+
+		inline bool owns(const void* p) const
+		{
+			return (const Uint8*)p >= buffer && (const Uint8*)p < buffer + stats.capacity;
+		}
+
+	private:
+
+		Uint8* buffer;
+
+		unsigned int offset;
+
+		bool owner;
+	};
+
+
+	// Releases a LinearAllocator back to where it was when constructed.
+	class LinearAllocatorScope
+	{
+	public:
+
+		// Constructors
+
+		LinearAllocatorScope(LinearAllocator& in_allocator) : allocator(in_allocator), marker(in_allocator.getMarker()) {}
+
+
+		// Destructor
+
+		~LinearAllocatorScope()
+		{
+			allocator.freeToMarker(marker);
+		}
+
+	private:
+
+		LinearAllocator& allocator;
+
+		LinearAllocator::Marker marker;
+
+
+		LinearAllocatorScope(const LinearAllocatorScope&);
+		LinearAllocatorScope& operator = (const LinearAllocatorScope&);
+	};
+
+
+	// Two linear allocators used on alternate frames. Memory allocated
+	// during a frame stays valid through the next one, so it can be
+	// handed to a consumer running one frame behind, such as the render
+	// side of FramePipeline.
+	class DoubleFrameAllocator
+	{
+	public:
+
+		// Constructors
+
+		DoubleFrameAllocator(unsigned int capacityPerFrame, const char* name = "double frame", MemoryTag tag = MEMORY_TAG_CORE) : current(0)
+		{
+			frames[0] = H2_NEW(tag) LinearAllocator(capacityPerFrame, name, tag);
+			frames[1] = H2_NEW(tag) LinearAllocator(capacityPerFrame, name, tag);
+		}
+
+
+		// Destructor
+
+		~DoubleFrameAllocator()
+		{
+			H2_DELETE(frames[0]);
+			H2_DELETE(frames[1]);
+		}
+
+
+		// Methods
+
+		inline void* allocate(unsigned int size, unsigned int alignment = H2_ALLOCATOR_ALIGNMENT)
+		{
+			return frames[current]->allocate(size, alignment);
+		}
+
+		template <class T>
+		inline T* allocateArray(unsigned int n)
+		{
+			return frames[current]->allocateArray<T>(n);
+		}
+
+		// Called once per frame: the older frame's memory is released
+		// and becomes the current one.
+		inline void swap()
+		{
+			current ^= 1;
+			frames[current]->reset();
+		}
+
+		inline LinearAllocator& getCurrent() { return *frames[current]; }
+
+		inline LinearAllocator& getPrevious() { return *frames[current ^ 1]; }
+
+	private:
+
+		LinearAllocator* frames[2];
+
+		unsigned int current;
+
+
+		DoubleFrameAllocator(const DoubleFrameAllocator&);
+		DoubleFrameAllocator& operator = (const DoubleFrameAllocator&);
+	};
+
+
+	// Fixed number of equal blocks with an intrusive free list, O(1)
+	// allocate and free in any order. Blocks are aligned to
+	// H2_ALLOCATOR_ALIGNMENT. Not thread safe.
+	class PoolAllocator : public TrackedAllocator
+	{
+	public:
+
+		// Constructors
+
+		PoolAllocator(unsigned int in_blockSize, unsigned int in_nBlocks, const char* in_name = "pool", MemoryTag tag = MEMORY_TAG_CORE) :
+			TrackedAllocator(in_name), freeList(0), nFree(0)
+		{
+			blockSize = in_blockSize < sizeof(void*) ? (unsigned int)sizeof(void*) : in_blockSize;
+			blockSize = (blockSize + H2_ALLOCATOR_ALIGNMENT - 1) & ~(H2_ALLOCATOR_ALIGNMENT - 1);
+
+			memory = (Uint8*)H2_MALLOC(blockSize*in_nBlocks + H2_ALLOCATOR_ALIGNMENT, tag);
+			nBlocks = memory != 0 ? in_nBlocks : 0;
+			blocks = memory != 0 ? alignPointer(memory, H2_ALLOCATOR_ALIGNMENT) : 0;
+
+			stats.capacity = blockSize*nBlocks;
+			reset();
+		}
+
+
+		// Destructor
+
+		~PoolAllocator()
+		{
+			H2_FREE(memory);
+		}
+
+
+		// Methods
+
+		inline void* allocate()
+		{
+			if (freeList == 0)
+			{
+				stats.nFailed++;
+				return 0;
+			}
+
+			void* p = freeList;
+			freeList = *(void**)freeList;
+			nFree--;
+
+			trackAllocation((nBlocks - nFree)*blockSize);
+
+			return p;
+		}
+
+		// 'p' comes from this pool, 0 is ignored.
+		inline void deallocate(void* p)
+		{
+			if (p == 0)
+			{
+				return;
+			}
+
+			*(void**)p = freeList;
+			freeList = p;
+			nFree++;
+
+			stats.used = (nBlocks - nFree)*blockSize;
+		}
+
+		// Returns every block to the pool.
+		void reset()
+		{
+			freeList = 0;
+			for (unsigned int i = nBlocks; i > 0; i--)
+			{
+				void* p = blocks + (i - 1)*blockSize;
+				*(void**)p = freeList;
+				freeList = p;
+			}
+			nFree = nBlocks;
+
+			trackReset();
+		}
+
+		inline unsigned int getBlockSize() const { return blockSize; }
+
+		inline unsigned int getFreeCount() const { return nFree; }
+
+		inline bool owns(const void* p) const
+		{
+			return (const Uint8*)p >= blocks && (const Uint8*)p < blocks + blockSize*nBlocks;
+		}
+
+	private:
+
+		Uint8* memory;
+
+		Uint8* blocks;
+
+		void* freeList;
+
+		unsigned int blockSize, nBlocks, nFree;
+	};
+
+
+	// Typed PoolAllocator constructing and destroying objects in place.
+	template <class T>
+	class ObjectPool
+	{
+	public:
+
+		// Constructors
+
+		ObjectPool(unsigned int nObjects, const char* name = "object pool", MemoryTag tag = MEMORY_TAG_CORE) :
+			pool((unsigned int)sizeof(T), nObjects, name, tag) {}
+
+
+		// Methods
+
+		// 0 when the pool is exhausted.
+		inline T* create()
+		{
+			void* p = pool.allocate();
+			return p != 0 ? new (p) T() : 0;
+		}
+
+		inline void destroy(T* object)
+		{
+			if (object != 0)
+			{
+				object->~T();
+				pool.deallocate(object);
+			}
+		}
+
+		inline PoolAllocator& getPool() { return pool; }
+
+	private:
+
+		PoolAllocator pool;
+	};
+
+
+	// One LinearAllocator per thread, created on first use, so workers
+	// of a job system allocate per-frame data without locks or sharing.
+	// 'resetAll()' runs once per frame when no thread is allocating.
+	//
+	// With FiberScheduler a job may move to another thread across
+	// 'wait()', so the arena must be fetched again after a wait.
+	class ThreadArenas
+	{
+	public:
+
+		// Constructors
+
+		ThreadArenas(unsigned int in_arenaSize = H2_THREAD_ARENA_SIZE) : tls(SDL_TLSCreate()), arenaSize(in_arenaSize), lock(0) {}
+
+
+		// Destructor
+
+		~ThreadArenas()
+		{
+			// SDL 2.0 cannot free a TLS id but never hands it out again,
+			// so only this thread's slot could still be read, through
+			// 'get()' racing the destructor. Clear it anyway.
+			SDL_TLSSet(tls, 0, 0);
+
+			for (unsigned int i = 0; i < arenas.size(); i++)
+			{
+				H2_DELETE(arenas[i]);
+			}
+		}
+
+
+		// Methods
+
+		LinearAllocator& get()
+		{
+			LinearAllocator* arena = (LinearAllocator*)SDL_TLSGet(tls);
+
+			if (arena == 0)
+			{
+				arena = H2_NEW(MEMORY_TAG_CORE) LinearAllocator(arenaSize, "thread arena");
+				SDL_TLSSet(tls, arena, 0);
+
+				SDL_AtomicLock(&lock);
+				arenas.push_back(arena);
+				SDL_AtomicUnlock(&lock);
+			}
+
+			return *arena;
+		}
+
+		inline void* allocate(unsigned int size, unsigned int alignment = H2_ALLOCATOR_ALIGNMENT)
+		{
+			return get().allocate(size, alignment);
+		}
+
+		void resetAll()
+		{
+			SDL_AtomicLock(&lock);
+			for (unsigned int i = 0; i < arenas.size(); i++)
+			{
+				arenas[i]->reset();
+			}
+			SDL_AtomicUnlock(&lock);
+		}
+
+		// Bytes in use over all threads, 'outPeak' gets the sum of peaks.
+		unsigned int getUsed(unsigned int* outPeak = 0)
+		{
+			unsigned int used = 0, peak = 0;
+
+			SDL_AtomicLock(&lock);
+			for (unsigned int i = 0; i < arenas.size(); i++)
+			{
+				used += arenas[i]->getUsed();
+				peak += arenas[i]->getPeak();
+			}
+			SDL_AtomicUnlock(&lock);
+
+			if (outPeak != 0)
+			{
+				*outPeak = peak;
+			}
+
+			return used;
+		}
+
+		inline unsigned int getThreadCount()
+		{
+			SDL_AtomicLock(&lock);
+			unsigned int n = (unsigned int)arenas.size();
+			SDL_AtomicUnlock(&lock);
+
+			return n;
+		}
+
+	private:
+
+		SDL_TLSID tls;
+
+		unsigned int arenaSize;
+
+		TaggedVector<LinearAllocator*, MEMORY_TAG_CORE>::Type arenas;
+
+		SDL_SpinLock lock;
+
+
+		ThreadArenas(const ThreadArenas&);
+		ThreadArenas& operator = (const ThreadArenas&);
+	};
+}
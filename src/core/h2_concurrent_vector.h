@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstring>
+#include <new>
+
+#include "SDL_atomic.h"
+#include "SDL_stdinc.h"
+
+#include "h2_memory.h"
+
+
+
+#define H2_CONCURRENT_VECTOR_FIRST_BITS 4   // first segment holds 2^bits elements
+
+
+
+
+namespace h2
+{
+	// Append-only vector any number of threads push to at once, e.g.
+	// results gathered from jobs. Elements never move: storage grows by
+	// segments, each twice the size of the previous one, allocated by
+	// whichever pusher first needs it. 'push()' reserves an index with one
+	// atomic add and publishes the element once it is constructed, so a
+	// reader sees either nothing or the whole element.
+	//
+	// 'get()' may run concurrently with pushes. 'operator []', 'clear()'
+	// and destruction need all pushes finished, e.g. after the jobs that
+	// pushed were waited for.
+	template <class T, MemoryTag tag = MEMORY_TAG_CORE>
+	class ConcurrentVector
+	{
+	public:
+
+		// Constructors
+
+		ConcurrentVector()
+		{
+			SDL_AtomicSet(&reserved, 0);
+
+			for (unsigned int i = 0; i < maxSegments; i++)
+			{
+				segments[i] = 0;
+			}
+		}
+
+
+		// Destructor
+
+		~ConcurrentVector()
+		{
+			clear();
+
+			for (unsigned int i = 0; i < maxSegments; i++)
+			{
+				H2_FREE(segments[i]);
+			}
+		}
+
+
+		// Methods
+
+		// Any thread. Returns the element's index.
+		unsigned int push(const T& item)
+		{
+			unsigned int index = (unsigned int)SDL_AtomicAdd(&reserved, 1);
+
+			unsigned int segment, offset;
+			locate(index, &segment, &offset);
+
+			Uint8* block = getSegment(segment);
+			if (block == 0)
+			{
+				block = allocateSegment(segment);
+			}
+
+			new ((void*)(block + offset*sizeof(T))) T(item);
+
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&readyFlags(block, segment)[offset], 1);
+
+			return index;
+		}
+
+		// Any thread. Element 'index' or 0 while it is still being pushed.
+		const T* get(unsigned int index)
+		{
+			if (index >= (unsigned int)SDL_AtomicGet(&reserved))
+			{
+				return 0;
+			}
+
+			unsigned int segment, offset;
+			locate(index, &segment, &offset);
+
+			Uint8* block = getSegment(segment);
+			if (block == 0 || SDL_AtomicGet(&readyFlags(block, segment)[offset]) == 0)
+			{
+				return 0;
+			}
+
+			SDL_MemoryBarrierAcquire();
+			return (const T*)(block + offset*sizeof(T));
+		}
+
+		// Once all pushes returned.
+		inline T& operator [] (unsigned int index)
+		{
+			unsigned int segment, offset;
+			locate(index, &segment, &offset);
+
+			return ((T*)segments[segment])[offset];
+		}
+
+		// Indices handed out so far, elements still being pushed included.
+		inline unsigned int size()
+		{
+			return (unsigned int)SDL_AtomicGet(&reserved);
+		}
+
+		// Once all pushes returned. Segments are kept for reuse.
+		void clear()
+		{
+			unsigned int n = (unsigned int)SDL_AtomicGet(&reserved);
+
+			for (unsigned int i = 0; i < n; i++)
+			{
+				(*this)[i].~T();
+			}
+
+			for (unsigned int i = 0; i < maxSegments && segments[i] != 0; i++)
+			{
+				memset(readyFlags((Uint8*)segments[i], i), 0, segmentSize(i)*sizeof(SDL_atomic_t));
+			}
+
+			SDL_AtomicSet(&reserved, 0);
+		}
+
+	private:
+
+		enum
+		{
+			firstSize = 1 << H2_CONCURRENT_VECTOR_FIRST_BITS,
+			maxSegments = 32 - H2_CONCURRENT_VECTOR_FIRST_BITS
+		};
+
+		SDL_atomic_t reserved;
+
+		// segment 'i' holds 'firstSize << i' elements followed by as many
+		// ready flags, published with a CAS
+		void* segments[maxSegments];
+
+
+		ConcurrentVector(const ConcurrentVector&);
+		ConcurrentVector& operator = (const ConcurrentVector&);
+
+		static inline unsigned int segmentSize(unsigned int segment)
+		{
+			return (unsigned int)firstSize << segment;
+		}
+
+		static inline SDL_atomic_t* readyFlags(Uint8* block, unsigned int segment)
+		{
+			return (SDL_atomic_t*)(block + segmentSize(segment)*sizeof(T));
+		}
+
+		// Segment 'i' starts at index 'firstSize*(2^i - 1)'.
+		static inline void locate(unsigned int index, unsigned int* outSegment, unsigned int* outOffset)
+		{
+			unsigned int biased = (index >> H2_CONCURRENT_VECTOR_FIRST_BITS) + 1;
+			unsigned int segment = highestBit(biased);
+
+			*outSegment = segment;
+			*outOffset = index - (unsigned int)firstSize*((1u << segment) - 1);
+		}
+
+		static inline unsigned int highestBit(unsigned int x)
+		{
+#if defined(__GNUC__)
+			return 31 - (unsigned int)__builtin_clz(x);
+#else
+			unsigned int bit = 0;
+			while (x >>= 1)
+			{
+				bit++;
+			}
+			return bit;
+#endif
+		}
+
+		inline Uint8* getSegment(unsigned int segment)
+		{
+			return (Uint8*)SDL_AtomicGetPtr(&segments[segment]);
+		}
+
+		Uint8* allocateSegment(unsigned int segment)
+		{
+			unsigned int n = segmentSize(segment);
+
+			// element size times a power of two keeps the flags aligned
+			Uint8* block = (Uint8*)H2_MALLOC(n*(sizeof(T) + sizeof(SDL_atomic_t)), tag);
+			memset(readyFlags(block, segment), 0, n*sizeof(SDL_atomic_t));
+
+			if (!SDL_AtomicCASPtr(&segments[segment], (void*)0, (void*)block))
+			{
+				// another pusher was first
+				H2_FREE(block);
+				block = getSegment(segment);
+			}
+
+			return block;
+		}
+	};
+}
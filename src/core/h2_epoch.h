@@ -0,0 +1,324 @@
+#pragma once
+
+#include "SDL_atomic.h"
+
+#include "h2_memory.h"
+#include "h2_spsc_ring.h"
+
+
+
+#define H2_EPOCH_MAX_PARTICIPANTS 64
+#define H2_EPOCH_COLLECT_THRESHOLD 64   // retirements per participant between collects of 'retire()'
+
+
+
+
+namespace h2
+{
+	// Epoch based reclamation for lock-free structures whose readers
+	// follow pointers another thread may unlink and free.
+	//
+	// Threads join as participants and wrap every access to the shared
+	// structure in 'enter()' / 'leave()'. An unlinked object is passed to
+	// 'retire()' instead of being freed; it is tagged with the global
+	// epoch and freed once the epoch has advanced twice. The epoch only
+	// advances when every participant inside a critical section has seen
+	// the current one, so two advances mean no reader can still hold a
+	// pointer to the object. A participant stuck inside a critical
+	// section stops reclamation, never the readers or writers.
+	//
+	// Critical sections do not nest. Each participant is used by one
+	// thread at a time.
+	class EpochReclaimer
+	{
+	public:
+
+		typedef void (*Deleter)(void* p);
+
+
+		// Constructors
+
+		EpochReclaimer() : orphanLock(0)
+		{
+			SDL_AtomicSet(&globalEpoch, 0);
+
+			for (unsigned int i = 0; i < H2_EPOCH_MAX_PARTICIPANTS; i++)
+			{
+				SDL_AtomicSet(&participants[i].state, 0);
+				SDL_AtomicSet(&participants[i].used, 0);
+				participants[i].nSinceCollect = 0;
+			}
+		}
+
+
+		// Destructor
+
+		// No participant may be inside a critical section. Everything
+		// retired is freed.
+		~EpochReclaimer()
+		{
+			for (unsigned int i = 0; i < H2_EPOCH_MAX_PARTICIPANTS; i++)
+			{
+				freeAll(participants[i].retired);
+			}
+
+			freeAll(orphans);
+		}
+
+
+		// Methods
+
+		// Returns the participant index, or -1 when all are taken.
+		int join()
+		{
+			for (unsigned int i = 0; i < H2_EPOCH_MAX_PARTICIPANTS; i++)
+			{
+				if (SDL_AtomicGet(&participants[i].used) == 0 && SDL_AtomicCAS(&participants[i].used, 0, 1))
+				{
+					SDL_AtomicSet(&participants[i].state, 0);
+					return (int)i;
+				}
+			}
+
+			return -1;
+		}
+
+		// Outside a critical section. Objects not yet freed are handed
+		// over to whoever collects next.
+		void quit(int participant)
+		{
+			Participant& p = participants[participant];
+
+			collect(participant);
+
+			SDL_AtomicLock(&orphanLock);
+			orphans.insert(orphans.end(), p.retired.begin(), p.retired.end());
+			SDL_AtomicUnlock(&orphanLock);
+
+			p.retired.clear();
+
+			SDL_AtomicSet(&p.state, 0);
+			SDL_AtomicSet(&p.used, 0);
+		}
+
+		void enter(int participant)
+		{
+			SDL_atomic_t& state = participants[participant].state;
+
+			unsigned int epoch = (unsigned int)SDL_AtomicGet(&globalEpoch);
+
+			// only this thread writes 'state' so the CAS cannot fail; it is
+			// used as a full barrier, the slot must be seen active before
+			// any shared pointer is loaded
+			SDL_AtomicCAS(&state, SDL_AtomicGet(&state), (int)((epoch << 1) | 1));
+		}
+
+		void leave(int participant)
+		{
+			SDL_atomic_t& state = participants[participant].state;
+
+			// loads of the critical section complete before the slot is seen idle
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&state, SDL_AtomicGet(&state) & ~1);
+		}
+
+		// 'p' is already unreachable for new readers. 'deleter(p)' is
+		// called once no reader can hold it, on whichever thread collects.
+		void retire(int participant, void* p, Deleter deleter)
+		{
+			Retired r;
+			r.p = p;
+			r.deleter = deleter;
+			r.epoch = (unsigned int)SDL_AtomicGet(&globalEpoch);
+
+			Participant& self = participants[participant];
+			self.retired.push_back(r);
+
+			// not on every retirement past the threshold, a stalled reader
+			// would make each one walk the whole list
+			if (++self.nSinceCollect >= H2_EPOCH_COLLECT_THRESHOLD)
+			{
+				collect(participant);
+			}
+		}
+
+		// Object allocated with H2_NEW, released with H2_DELETE.
+		template <class T>
+		inline void retireObject(int participant, T* p)
+		{
+			retire(participant, p, deleteObject<T>);
+		}
+
+		// Tries to advance the epoch, then frees what this participant and
+		// participants that quit retired two epochs ago. Returns the number
+		// of objects freed.
+		unsigned int collect(int participant)
+		{
+			tryAdvance();
+
+			unsigned int epoch = (unsigned int)SDL_AtomicGet(&globalEpoch);
+
+			Participant& p = participants[participant];
+			p.nSinceCollect = 0;
+
+			// appended in epoch order, expired objects are a prefix
+			unsigned int nFreed = 0;
+			while (nFreed < p.retired.size() && epoch - p.retired[nFreed].epoch >= 2)
+			{
+				p.retired[nFreed].deleter(p.retired[nFreed].p);
+				nFreed++;
+			}
+			p.retired.erase(p.retired.begin(), p.retired.begin() + nFreed);
+
+			if (SDL_AtomicTryLock(&orphanLock))
+			{
+				nFreed += freeExpired(orphans, epoch);
+				SDL_AtomicUnlock(&orphanLock);
+			}
+
+			return nFreed;
+		}
+
+		// Advances the epoch when every active participant has seen it.
+		bool tryAdvance()
+		{
+			unsigned int epoch = (unsigned int)SDL_AtomicGet(&globalEpoch);
+
+			for (unsigned int i = 0; i < H2_EPOCH_MAX_PARTICIPANTS; i++)
+			{
+				if (SDL_AtomicGet(&participants[i].used) == 0)
+				{
+					continue;
+				}
+
+				unsigned int state = (unsigned int)SDL_AtomicGet(&participants[i].state);
+
+				if ((state & 1) != 0 && (state >> 1) != (epoch & (~0u >> 1)))
+				{
+					return false;
+				}
+			}
+
+			return SDL_AtomicCAS(&globalEpoch, (int)epoch, (int)(epoch + 1)) != SDL_FALSE;
+		}
+
+		inline unsigned int getEpoch()
+		{
+			return (unsigned int)SDL_AtomicGet(&globalEpoch);
+		}
+
+		// Retired and not yet freed, approximate for other participants.
+		inline unsigned int getRetiredCount(int participant) const
+		{
+			return (unsigned int)participants[participant].retired.size();
+		}
+
+	private:
+
+		struct Retired
+		{
+			void* p;
+			Deleter deleter;
+			unsigned int epoch;
+		};
+
+		typedef TaggedVector<Retired, MEMORY_TAG_CORE>::Type RetiredList;
+
+		// Each participant on its own cache lines, 'state' is read by
+		// every collecting thread.
+		struct Participant
+		{
+			SDL_atomic_t state;   // (epoch << 1) | inside critical section
+			SDL_atomic_t used;
+			char pad0[H2_CACHE_LINE_SIZE - 2*sizeof(SDL_atomic_t)];
+
+			RetiredList retired;
+			unsigned int nSinceCollect;
+			char pad1[H2_CACHE_LINE_SIZE];
+		};
+
+		SDL_atomic_t globalEpoch;
+		char pad0[H2_CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+
+		Participant participants[H2_EPOCH_MAX_PARTICIPANTS];
+
+		// retired by participants that quit
+		RetiredList orphans;
+		SDL_SpinLock orphanLock;
+
+
+		EpochReclaimer(const EpochReclaimer&);
+		EpochReclaimer& operator = (const EpochReclaimer&);
+
+		template <class T>
+		static void deleteObject(void* p)
+		{
+			H2_DELETE((T*)p);
+		}
+
+		// Orphans come from several lists, not in epoch order.
+		static unsigned int freeExpired(RetiredList& list, unsigned int epoch)
+		{
+			unsigned int kept = 0;
+
+			for (unsigned int i = 0; i < list.size(); i++)
+			{
+				if (epoch - list[i].epoch >= 2)
+				{
+					list[i].deleter(list[i].p);
+				} else
+				{
+					list[kept++] = list[i];
+				}
+			}
+
+			unsigned int nFreed = (unsigned int)list.size() - kept;
+			list.resize(kept);
+
+			return nFreed;
+		}
+
+		static void freeAll(RetiredList& list)
+		{
+			for (unsigned int i = 0; i < list.size(); i++)
+			{
+				list[i].deleter(list[i].p);
+			}
+
+			list.clear();
+		}
+	};
+
+
+	// Critical section of an EpochReclaimer participant for the
+	// enclosing scope.
+	class EpochGuard
+	{
+	public:
+
+		// Constructors
+
+		EpochGuard(EpochReclaimer& in_reclaimer, int in_participant) : reclaimer(in_reclaimer), participant(in_participant)
+		{
+			reclaimer.enter(participant);
+		}
+
+
+		// Destructor
+
+		~EpochGuard()
+		{
+			reclaimer.leave(participant);
+		}
+
+	private:
+
+		EpochReclaimer& reclaimer;
+
+		int participant;
+
+
+		EpochGuard(const EpochGuard&);
+		EpochGuard& operator = (const EpochGuard&);
+	};
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <stdlib.h>
+
+#include "h2_memory.h"
+
+
+
+// Windows fibers on Win32, ucontext elsewhere.
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	// min and max macros would break std::min and std::max in every
+	// file including the framework
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+	#define H2_FIBER_WIN32 1
+#else
+	#include <ucontext.h>
+	#if defined(__linux__)
+		#include <sched.h>
+	#endif
+	#define H2_FIBER_UCONTEXT 1
+#endif
+
+
+#define H2_FIBER_STACK_SIZE (64*1024)
+
+
+
+
+namespace h2
+{
+	typedef void (*FiberFunction)(void* data);
+
+
+	// Execution context with its own stack, switched to explicitly.
+	//
+	// A thread takes part in switching after 'convertThread()'; the
+	// fiber it gets stands for the thread's own stack. Fibers created
+	// with 'create()' start in 'function' on the first switch to them and
+	// must never return from it. A fiber may be resumed on a different
+	// thread than the one it was suspended on.
+	class Fiber
+	{
+	public:
+
+		// Constructors
+
+		Fiber() : function(0), data(0), converted(false)
+		{
+#ifdef H2_FIBER_WIN32
+			handle = 0;
+#else
+			stack = 0;
+#endif
+		}
+
+
+		// Destructor
+
+		~Fiber()
+		{
+			destroy();
+		}
+
+
+		// Methods
+
+		bool create(FiberFunction in_function, void* in_data, size_t stackSize = H2_FIBER_STACK_SIZE)
+		{
+			destroy();
+
+			function = in_function;
+			data = in_data;
+
+#ifdef H2_FIBER_WIN32
+			handle = CreateFiber(stackSize, fiberEntry, this);
+			return handle != 0;
+#else
+			stack = H2_MALLOC(stackSize, MEMORY_TAG_CORE);
+			if (stack == 0 || getcontext(&context) != 0)
+			{
+				H2_FREE(stack);
+				stack = 0;
+				return false;
+			}
+
+			context.uc_stack.ss_sp = stack;
+			context.uc_stack.ss_size = stackSize;
+			context.uc_link = 0;
+
+			// makecontext() only passes ints, the pointer goes in halves
+			size_t p = (size_t)this;
+			makecontext(&context, (void (*)())fiberEntry, 2, (int)(unsigned int)p, (int)(unsigned int)((p >> 16) >> 16));
+
+			return true;
+#endif
+		}
+
+		// Makes the calling thread's own stack a fiber.
+		bool convertThread()
+		{
+			destroy();
+
+#ifdef H2_FIBER_WIN32
+			handle = ConvertThreadToFiber(0);
+			if (handle == 0 && GetLastError() == ERROR_ALREADY_FIBER)
+			{
+				handle = GetCurrentFiber();
+				return true;
+			}
+
+			converted = handle != 0;
+			return converted;
+#else
+			// the context is saved by the first switch away
+			converted = true;
+			return true;
+#endif
+		}
+
+		// Undoes 'convertThread()', called on the same thread.
+		void revertThread()
+		{
+#ifdef H2_FIBER_WIN32
+			if (converted)
+			{
+				ConvertFiberToThread();
+			}
+			handle = 0;
+#endif
+			converted = false;
+		}
+
+		void destroy()
+		{
+#ifdef H2_FIBER_WIN32
+			if (handle != 0 && function != 0)
+			{
+				DeleteFiber(handle);
+			}
+			handle = 0;
+#else
+			H2_FREE(stack);
+			stack = 0;
+#endif
+			function = 0;
+			data = 0;
+		}
+
+		// Suspends 'from', which must be running on the calling thread,
+		// and continues 'to'.
+		static inline void switchTo(Fiber& from, Fiber& to)
+		{
+#ifdef H2_FIBER_WIN32
+			(void)from;
+			SwitchToFiber(to.handle);
+#else
+			swapcontext(&from.context, &to.context);
+#endif
+		}
+
+	private:
+
+		FiberFunction function;
+
+		void* data;
+
+		bool converted;
+
+#ifdef H2_FIBER_WIN32
+		void* handle;
+#else
+		ucontext_t context;
+		void* stack;
+#endif
+
+
+		Fiber(const Fiber&);
+		Fiber& operator = (const Fiber&);
+
+#ifdef H2_FIBER_WIN32
+		static VOID CALLBACK fiberEntry(PVOID p)
+		{
+			Fiber* self = (Fiber*)p;
+			self->function(self->data);
+		}
+#else
+		static void fiberEntry(int lo, int hi)
+		{
+			size_t p = (size_t)(unsigned int)lo | (((size_t)(unsigned int)hi << 16) << 16);
+
+			Fiber* self = (Fiber*)p;
+			self->function(self->data);
+		}
+#endif
+	};
+
+
+	// Restricts the calling thread to one CPU, false when unsupported.
+	inline bool pinCurrentThread(unsigned int cpu)
+	{
+#if defined(H2_FIBER_WIN32)
+		if (cpu >= sizeof(DWORD_PTR)*8)
+		{
+			return false;
+		}
+		return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__) && defined(CPU_SET)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+		(void)cpu;
+		return false;
+#endif
+	}
+}
@@ -0,0 +1,702 @@
+#pragma once
+
+#include "SDL_atomic.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
+#include "SDL_timer.h"
+
+#include "h2_fiber.h"
+#include "h2_job_system.h"
+#include "h2_profiler.h"
+
+
+
+#define H2_FIBER_POOL_SIZE 128   // fibers shared by all workers, bounds jobs waiting at once
+
+
+
+
+namespace h2
+{
+	// Statistics of one worker, written only by that worker.
+	struct FiberWorkerStats
+	{
+		unsigned int nExecuted;
+		unsigned int nStolen;
+		unsigned int nSleeps;
+		unsigned int nSwitches;
+		unsigned int nWaits;
+	};
+
+
+	// Job scheduler where waiting on a counter suspends the job rather
+	// than the worker thread.
+	//
+	// Jobs run on fibers taken from a fixed pool. A job that waits on an
+	// unfinished counter parks its fiber in a wait list and the worker
+	// goes on with other jobs; the fiber is resumed, on any worker, once
+	// the counter reaches zero. Resumable fibers are preferred over new
+	// jobs since they hold up the rest of their batch.
+	//
+	// Queues, counters and stealing are those of JobSystem. Worker
+	// threads are pinned to one CPU each. The thread calling 'start()'
+	// becomes worker 0 and runs jobs while it waits on a counter; it is
+	// not pinned, its affinity outlives the scheduler.
+	//
+	// The pool bounds the number of jobs started and not finished, so a
+	// dependency chain deeper than H2_FIBER_POOL_SIZE waiting jobs can
+	// starve. A fiber only runs jobs on its own stack of
+	// H2_FIBER_STACK_SIZE bytes.
+	class FiberScheduler
+	{
+	public:
+
+		// Constructors
+
+		FiberScheduler() : workers(0), nWorkers(0), slots(0), nFree(0), nWaiting(0), tls(0), wake(0)
+		{
+			SDL_AtomicSet(&running, 0);
+			SDL_AtomicSet(&nSleeping, 0);
+			SDL_AtomicSet(&nWaitingAtomic, 0);
+			SDL_AtomicSet(&nFreeAtomic, 0);
+			freeLock = 0;
+			waitLock = 0;
+		}
+
+
+		// Destructor
+
+		~FiberScheduler()
+		{
+			stop();
+		}
+
+
+		// Methods
+
+		// 'nThreads' includes the calling thread, 0 means one per CPU.
+		bool start(unsigned int nThreads = 0, bool pinThreads = true)
+		{
+			stop();
+
+			unsigned int nCpus = (unsigned int)SDL_GetCPUCount();
+
+			if (nThreads == 0)
+			{
+				nThreads = nCpus;
+			}
+			nThreads = nThreads < 1 ? 1 : (nThreads > H2_JOB_MAX_WORKERS ? H2_JOB_MAX_WORKERS : nThreads);
+
+			if (tls == 0)
+			{
+				tls = SDL_TLSCreate();
+			}
+
+			wake = SDL_CreateSemaphore(0);
+			if (tls == 0 || wake == 0)
+			{
+				return false;
+			}
+
+			slots = new FiberSlot[H2_FIBER_POOL_SIZE];
+			nFree = 0;
+			nWaiting = 0;
+
+			for (unsigned int i = 0; i < H2_FIBER_POOL_SIZE; i++)
+			{
+				slots[i].scheduler = this;
+				if (!slots[i].fiber.create(fiberMain, &slots[i]))
+				{
+					delete [] slots;
+					slots = 0;
+					return false;
+				}
+
+				freeSlots[nFree++] = &slots[i];
+			}
+			SDL_AtomicSet(&nFreeAtomic, (int)nFree);
+			SDL_AtomicSet(&nWaitingAtomic, 0);
+
+			workers = new Worker[nThreads];
+			nWorkers = nThreads;
+
+			for (unsigned int i = 0; i < nWorkers; i++)
+			{
+				workers[i].scheduler = this;
+				workers[i].index = i;
+				workers[i].cpu = pinThreads && nCpus > 0 && i > 0 ? (int)(i % nCpus) : -1;
+				workers[i].random = 0x9E3779B9u*(i + 1);
+			}
+
+			workers[0].threadFiber.convertThread();
+
+			SDL_TLSSet(tls, &workers[0], 0);
+			SDL_AtomicSet(&running, 1);
+
+			for (unsigned int i = 1; i < nWorkers; i++)
+			{
+				workers[i].thread = SDL_CreateThread(workerMain, "h2 fiber worker", &workers[i]);
+			}
+
+			return true;
+		}
+
+		// Called by the thread that started the scheduler, with no jobs
+		// pending or waiting.
+		void stop()
+		{
+			if (workers == 0)
+			{
+				return;
+			}
+
+			SDL_AtomicSet(&running, 0);
+
+			for (unsigned int i = 1; i < nWorkers; i++)
+			{
+				SDL_SemPost(wake);
+			}
+
+			for (unsigned int i = 1; i < nWorkers; i++)
+			{
+				if (workers[i].thread != 0)
+				{
+					SDL_WaitThread(workers[i].thread, 0);
+				}
+			}
+
+			workers[0].threadFiber.revertThread();
+			SDL_TLSSet(tls, 0, 0);
+
+			delete [] workers;
+			workers = 0;
+			nWorkers = 0;
+
+			delete [] slots;
+			slots = 0;
+			nFree = 0;
+			nWaiting = 0;
+
+			SDL_DestroySemaphore(wake);
+			wake = 0;
+		}
+
+		inline unsigned int getWorkerCount() const
+		{
+			return nWorkers;
+		}
+
+		// Index of the worker running the caller, -1 for other threads.
+		// May change across 'wait()' inside a job.
+		int getWorkerIndex() const
+		{
+			Worker* w = currentWorker();
+			return w != 0 ? (int)w->index : -1;
+		}
+
+		inline const FiberWorkerStats& getStats(unsigned int worker) const
+		{
+			return workers[worker].stats;
+		}
+
+		// Number of pooled fibers not running or waiting.
+		inline int getFreeFiberCount()
+		{
+			return SDL_AtomicGet(&nFreeAtomic);
+		}
+
+		void run(JobFunction function, void* data, JobCounter* counter = 0)
+		{
+			Job job;
+			job.function = function;
+			job.data = data;
+			job.counter = counter;
+			job.task = 0;
+
+			submit(job);
+		}
+
+		// Runs 'function' over ['0', 'count') in ranges of at most 'grain'
+		// items, returns when all are done. Inside a job the wait does not
+		// block the worker.
+		void parallelFor(unsigned int count, unsigned int grain, ParallelForFunction function, void* data)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+
+			ParallelForTask task;
+			task.function = function;
+			task.data = data;
+			task.grain = grain > 0 ? grain : 1;
+
+			if (currentWorker() == 0 || count <= task.grain)
+			{
+				function(0, count, data);
+				return;
+			}
+
+			JobCounter counter;
+
+			for (unsigned int begin = 0; begin < count; begin += task.grain)
+			{
+				Job job;
+				job.function = 0;
+				job.data = 0;
+				job.counter = &counter;
+				job.task = &task;
+				job.begin = begin;
+				job.end = count - begin > task.grain ? begin + task.grain : count;
+
+				submit(job);
+			}
+
+			wait(&counter);
+		}
+
+		// Returns once 'counter' reaches zero. Inside a job the fiber is
+		// parked and the worker runs other jobs meanwhile; on worker 0
+		// outside jobs the thread runs jobs itself; other threads poll.
+		void wait(JobCounter* counter)
+		{
+			if (counter->isDone())
+			{
+				SDL_MemoryBarrierAcquire();
+				return;
+			}
+
+			Worker* w = currentWorker();
+
+			if (w == 0)
+			{
+				while (!counter->isDone())
+				{
+					SDL_Delay(0);
+				}
+			} else if (w->current == 0)
+			{
+				schedule(w, counter);
+			} else
+			{
+				FiberSlot* self = w->current;
+				self->waitCounter = counter;
+
+				w->stats.nWaits++;
+				w->action = ACTION_WAIT;
+				w->actionSlot = self;
+
+				FiberSlot* next = takeReady();
+				if (next != 0)
+				{
+					switchTo(w, next);
+				} else
+				{
+					switchTo(w, 0);
+				}
+
+				finishSwitch();
+			}
+
+			// jobs of the batch may have written data read after the wait
+			SDL_MemoryBarrierAcquire();
+		}
+
+	private:
+
+		enum Action
+		{
+			ACTION_NONE,
+			ACTION_FREE,   // the previous fiber is done, back to the pool
+			ACTION_WAIT    // the previous fiber waits on its counter
+		};
+
+		struct FiberSlot
+		{
+			Fiber fiber;
+
+			FiberScheduler* scheduler;
+
+			// job handed over by the scheduler loop
+			Job job;
+			bool hasJob;
+
+			JobCounter* waitCounter;
+
+			FiberSlot() : scheduler(0), hasJob(false), waitCounter(0)
+			{
+			}
+		};
+
+		struct Worker
+		{
+			JobDeque deque;
+
+			Fiber threadFiber;
+
+			// fiber running on this worker, 0 for the thread fiber
+			FiberSlot* current;
+
+			// left by the fiber switched away from, done by the one switched to
+			Action action;
+			FiberSlot* actionSlot;
+
+			FiberScheduler* scheduler;
+			SDL_Thread* thread;
+			unsigned int index;
+			int cpu;
+			Uint32 random;
+
+			FiberWorkerStats stats;
+
+			char pad[H2_CACHE_LINE_SIZE];
+
+			Worker() : current(0), action(ACTION_NONE), actionSlot(0), scheduler(0), thread(0), index(0), cpu(-1), random(1)
+			{
+				stats.nExecuted = stats.nStolen = stats.nSleeps = stats.nSwitches = stats.nWaits = 0;
+			}
+		};
+
+		Worker* workers;
+
+		unsigned int nWorkers;
+
+		FiberSlot* slots;
+
+		FiberSlot* freeSlots[H2_FIBER_POOL_SIZE];
+		unsigned int nFree;
+		SDL_SpinLock freeLock;
+		SDL_atomic_t nFreeAtomic;
+
+		FiberSlot* waitingSlots[H2_FIBER_POOL_SIZE];
+		unsigned int nWaiting;
+		SDL_SpinLock waitLock;
+		SDL_atomic_t nWaitingAtomic;
+
+		SDL_TLSID tls;
+
+		SDL_sem* wake;
+
+		SDL_atomic_t running;
+
+		SDL_atomic_t nSleeping;
+
+
+		FiberScheduler(const FiberScheduler&);
+		FiberScheduler& operator = (const FiberScheduler&);
+
+		inline Worker* currentWorker() const
+		{
+			// read again after every switch, fibers move between threads
+			return workers != 0 ? (Worker*)SDL_TLSGet(tls) : 0;
+		}
+
+		// 'to' == 0 switches to the worker's thread fiber.
+		void switchTo(Worker* w, FiberSlot* to)
+		{
+			Fiber& from = w->current != 0 ? w->current->fiber : w->threadFiber;
+
+			w->current = to;
+			w->stats.nSwitches++;
+
+			Fiber::switchTo(from, to != 0 ? to->fiber : w->threadFiber);
+		}
+
+		// Called right after every switch returns. The fiber switched
+		// away from is suspended by now, so it can be handed to the pool
+		// or wait list without another thread resuming it too early.
+		void finishSwitch()
+		{
+			Worker* w = currentWorker();
+
+			if (w->action == ACTION_FREE)
+			{
+				SDL_AtomicLock(&freeLock);
+				freeSlots[nFree++] = w->actionSlot;
+				SDL_AtomicSet(&nFreeAtomic, (int)nFree);
+				SDL_AtomicUnlock(&freeLock);
+			} else if (w->action == ACTION_WAIT)
+			{
+				SDL_AtomicLock(&waitLock);
+				waitingSlots[nWaiting++] = w->actionSlot;
+				SDL_AtomicSet(&nWaitingAtomic, (int)nWaiting);
+				SDL_AtomicUnlock(&waitLock);
+			}
+
+			w->action = ACTION_NONE;
+			w->actionSlot = 0;
+		}
+
+		FiberSlot* takeFree()
+		{
+			if (SDL_AtomicGet(&nFreeAtomic) == 0)
+			{
+				return 0;
+			}
+
+			FiberSlot* slot = 0;
+
+			SDL_AtomicLock(&freeLock);
+			if (nFree > 0)
+			{
+				slot = freeSlots[--nFree];
+				SDL_AtomicSet(&nFreeAtomic, (int)nFree);
+			}
+			SDL_AtomicUnlock(&freeLock);
+
+			return slot;
+		}
+
+		// A waiting fiber whose counter reached zero, removed from the list.
+		FiberSlot* takeReady()
+		{
+			if (SDL_AtomicGet(&nWaitingAtomic) == 0)
+			{
+				return 0;
+			}
+
+			FiberSlot* slot = 0;
+
+			SDL_AtomicLock(&waitLock);
+			for (unsigned int i = 0; i < nWaiting; i++)
+			{
+				if (waitingSlots[i]->waitCounter->isDone())
+				{
+					slot = waitingSlots[i];
+					waitingSlots[i] = waitingSlots[--nWaiting];
+					SDL_AtomicSet(&nWaitingAtomic, (int)nWaiting);
+					break;
+				}
+			}
+			SDL_AtomicUnlock(&waitLock);
+
+			return slot;
+		}
+
+		void submit(const Job& job)
+		{
+			Worker* w = currentWorker();
+
+			if (job.counter != 0)
+			{
+				SDL_AtomicAdd(&job.counter->value, 1);
+			}
+
+			if (w == 0 || !w->deque.push(job))
+			{
+				// not a worker or deque full, running now keeps everything correct
+				execute(w, job);
+				return;
+			}
+
+			if (SDL_AtomicGet(&nSleeping) > 0)
+			{
+				SDL_SemPost(wake);
+			}
+		}
+
+		// 'w' is the worker at the start, the job may end on another one.
+		void execute(Worker* w, const Job& job)
+		{
+			if (job.task != 0)
+			{
+				job.task->function(job.begin, job.end, job.task->data);
+			} else
+			{
+				job.function(job.data);
+			}
+
+			w = currentWorker();
+			if (w != 0)
+			{
+				w->stats.nExecuted++;
+			}
+
+			if (job.counter != 0)
+			{
+				// publish the job's writes before the counter drops
+				SDL_MemoryBarrierRelease();
+
+				if (SDL_AtomicAdd(&job.counter->value, -1) == 1 && SDL_AtomicGet(&nWaitingAtomic) > 0 && SDL_AtomicGet(&nSleeping) > 0)
+				{
+					// a parked fiber became ready
+					SDL_SemPost(wake);
+				}
+			}
+		}
+
+		bool findJob(Worker* self, Job* outJob)
+		{
+			if (self->deque.pop(outJob))
+			{
+				return true;
+			}
+
+			if (nWorkers < 2)
+			{
+				return false;
+			}
+
+			self->random ^= self->random << 13;
+			self->random ^= self->random >> 17;
+			self->random ^= self->random << 5;
+
+			unsigned int start = self->random % nWorkers;
+
+			for (unsigned int i = 0; i < nWorkers; i++)
+			{
+				Worker& victim = workers[(start + i) % nWorkers];
+				if (&victim == self)
+				{
+					continue;
+				}
+
+				if (victim.deque.steal(outJob))
+				{
+					self->stats.nStolen++;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		// Runs jobs on a pooled fiber until there are none left.
+		void runJobs(FiberSlot* self)
+		{
+			for (;;)
+			{
+				if (self->hasJob)
+				{
+					self->hasJob = false;
+					execute(currentWorker(), self->job);
+					continue;
+				}
+
+				Worker* w = currentWorker();
+
+				FiberSlot* ready = takeReady();
+				if (ready != 0)
+				{
+					// done here, the parked fiber carries on and this one
+					// comes back from the pool with a job
+					w->action = ACTION_FREE;
+					w->actionSlot = self;
+					switchTo(w, ready);
+					finishSwitch();
+					continue;
+				}
+
+				Job job;
+				if (!findJob(w, &job))
+				{
+					return;
+				}
+
+				execute(w, job);
+			}
+		}
+
+		// Loop of a thread fiber: resumes ready fibers and hands new
+		// jobs to free ones. Runs until 'until' is done, or until stop
+		// when 'until' is 0.
+		void schedule(Worker* w, JobCounter* until)
+		{
+			unsigned int nIdle = 0;
+			bool hasJob = false;
+			Job job;
+
+			for (;;)
+			{
+				if (until != 0 ? until->isDone() : SDL_AtomicGet(&running) == 0)
+				{
+					break;
+				}
+
+				FiberSlot* next = takeReady();
+
+				if (next == 0 && (hasJob || (SDL_AtomicGet(&nFreeAtomic) > 0 && findJob(w, &job))))
+				{
+					// a job without a free fiber is kept until one comes back
+					hasJob = true;
+					next = takeFree();
+
+					if (next != 0)
+					{
+						next->job = job;
+						next->hasJob = true;
+						hasJob = false;
+					}
+				}
+
+				if (next != 0)
+				{
+					switchTo(w, next);
+					finishSwitch();
+					nIdle = 0;
+					continue;
+				}
+
+				if (++nIdle < H2_JOB_SPIN_COUNT || hasJob)
+				{
+					continue;
+				}
+
+				if (until != 0)
+				{
+					SDL_Delay(0);
+				} else
+				{
+					// a wakeup lost between the last steal and the sleep
+					// costs at most the timeout
+					SDL_AtomicAdd(&nSleeping, 1);
+					SDL_SemWaitTimeout(wake, 1);
+					SDL_AtomicAdd(&nSleeping, -1);
+
+					w->stats.nSleeps++;
+				}
+				nIdle = 0;
+			}
+		}
+
+		static void fiberMain(void* data)
+		{
+			FiberSlot* self = (FiberSlot*)data;
+			FiberScheduler* scheduler = self->scheduler;
+
+			for (;;)
+			{
+				scheduler->finishSwitch();
+				scheduler->runJobs(self);
+
+				// out of work, park in the pool and let the thread fiber decide
+				Worker* w = scheduler->currentWorker();
+				w->action = ACTION_FREE;
+				w->actionSlot = self;
+				scheduler->switchTo(w, 0);
+			}
+		}
+
+		static int SDLCALL workerMain(void* data)
+		{
+			Worker* self = (Worker*)data;
+			FiberScheduler* scheduler = self->scheduler;
+
+			if (self->cpu >= 0)
+			{
+				pinCurrentThread((unsigned int)self->cpu);
+			}
+
+			self->threadFiber.convertThread();
+			SDL_TLSSet(scheduler->tls, self, 0);
+			H2_PROFILE_THREAD("h2 fiber worker");
+
+			scheduler->schedule(self, 0);
+
+			self->threadFiber.revertThread();
+
+			return 0;
+		}
+	};
+}
@@ -0,0 +1,452 @@
+#pragma once
+
+#include "SDL_atomic.h"
+#include "SDL_mutex.h"
+#include "SDL_render.h"
+#include "SDL_thread.h"
+#include "SDL_timer.h"
+
+#include "h2_allocator.h"
+#include "h2_frame_telemetry.h"
+#include "h2_profiler.h"
+
+#include "../input/h2_input.h"
+#include "../input/h2_input_latency.h"
+#include "../video/h2_render_queue.h"
+
+
+
+#define H2_FRAME_PIPELINE_MAX_DEPTH 4
+#define H2_FRAME_PIPELINE_SMOOTHING 0.05f   // weight of the newest frame in averaged timings
+#define H2_FRAME_PIPELINE_RENDER_SCRATCH (256*1024)   // bytes of main thread frame memory
+
+
+
+
+namespace h2
+{
+	// Performance counter values of one frame's trip through the pipeline.
+	struct FrameTiming
+	{
+		Uint64 submitTime;    // input handed to the simulation
+		Uint64 simBegin;
+		Uint64 simEnd;
+		Uint64 renderBegin;
+		Uint64 presentBegin;  // SDL_RenderPresent called
+		Uint64 presentTime;   // SDL_RenderPresent returned
+	};
+
+
+	// Everything the simulation hands to rendering for one frame. The
+	// simulation thread owns a packet from 'simulate()' until it is
+	// ready, the main thread from then until it is presented.
+	struct FramePacket
+	{
+		Uint64 frameIndex;
+
+		// packet index in ['0', depth), for per-packet client buffers
+		unsigned int slot;
+
+		// input the frame was simulated with
+		InputSnapshot input;
+
+		// cleared before 'simulate()'
+		RenderQueue queue;
+
+		// set by 'simulate()' to end the loop once the frame is presented
+		bool quit;
+
+		FrameTiming timing;
+
+		FramePacket() : frameIndex(0), slot(0), quit(false)
+		{
+			timing.submitTime = timing.simBegin = timing.simEnd = timing.renderBegin = timing.presentBegin = timing.presentTime = 0;
+		}
+	};
+
+
+	// Timings averaged over recent frames, in milliseconds.
+	struct FramePipelineStats
+	{
+		Uint64 nFrames;        // frames presented
+
+		float simMs;           // simulate()
+		float renderMs;        // render() and present
+		float stallMs;         // main thread waiting for the simulation
+		float queueMs;         // input waiting for the simulation to pick it up
+		float latencyMs;       // input submitted to present
+		float latencyFrames;   // frames between submit and present
+	};
+
+
+	// Game code run by the pipeline.
+	class FramePipelineClient
+	{
+	public:
+
+		// Destructor
+
+		virtual ~FramePipelineClient() {}
+
+
+		// Methods
+
+		// Simulation thread. Advances the world by one frame using
+		// 'packet.input' and records the frame into 'packet.queue'.
+		// Whatever else rendering needs is copied into a per-slot
+		// buffer of the client, never read from live simulation state.
+		virtual void simulate(FramePacket& packet) = 0;
+
+		// Main thread. The default submits the recorded queue.
+		virtual void render(FramePacket& packet, SDL_Renderer* renderer)
+		{
+			packet.queue.submit(renderer);
+		}
+
+		// Simulation thread, around its lifetime. A job system used by
+		// 'simulate()' is started here so the thread becomes its worker 0.
+		virtual void beginSimulationThread() {}
+
+		virtual void endSimulationThread() {}
+	};
+
+
+	// Main loop overlapping the simulation of one frame with rendering
+	// of earlier ones.
+	//
+	// 'tick()' is called once per frame on the thread that owns the
+	// renderer. It hands the newest input to the simulation thread and
+	// then renders and presents the oldest simulated packet. With depth
+	// D there are D packets and a frame is presented D - 1 ticks after
+	// its input was submitted: depth 1 is the serial loop, depth 2
+	// simulates frame N + 1 while frame N renders, deeper pipelines
+	// absorb uneven frame times at the cost of one frame of latency each.
+	//
+	// Without a simulation thread ('threaded' false) simulation runs
+	// inside 'tick()' and the depth is 1, which keeps single-threaded
+	// debugging possible with the same client.
+	class FramePipeline
+	{
+	public:
+
+		// Constructors
+
+		FramePipeline() : client(0), tracker(0), telemetry(0), depth(1), threaded(false), nSubmitted(0), nPresented(0),
+						  simThread(0), toSim(0), fromSim(0), renderScratch(H2_FRAME_PIPELINE_RENDER_SCRATCH, "render scratch", MEMORY_TAG_VIDEO)
+		{
+			SDL_AtomicSet(&stopping, 0);
+
+			invFrequency = 1000.0/(double)SDL_GetPerformanceFrequency();
+
+			stats.nFrames = 0;
+			stats.simMs = stats.renderMs = stats.stallMs = stats.queueMs = stats.latencyMs = stats.latencyFrames = 0;
+
+			for (unsigned int i = 0; i < H2_FRAME_PIPELINE_MAX_DEPTH; i++)
+			{
+				packets[i].slot = i;
+			}
+		}
+
+
+		// Destructor
+
+		~FramePipeline()
+		{
+			stop();
+		}
+
+
+		// Methods
+
+		bool start(FramePipelineClient* in_client, unsigned int in_depth = 2, bool in_threaded = true)
+		{
+			stop();
+
+			client = in_client;
+			threaded = in_threaded;
+			depth = !threaded ? 1 : (in_depth < 1 ? 1 : (in_depth > H2_FRAME_PIPELINE_MAX_DEPTH ? H2_FRAME_PIPELINE_MAX_DEPTH : in_depth));
+
+			nSubmitted = 0;
+			nPresented = 0;
+			stats.nFrames = 0;
+
+			if (!threaded)
+			{
+				return true;
+			}
+
+			toSim = SDL_CreateSemaphore(0);
+			fromSim = SDL_CreateSemaphore(0);
+			if (toSim == 0 || fromSim == 0)
+			{
+				stop();
+				return false;
+			}
+
+			SDL_AtomicSet(&stopping, 0);
+			simThread = SDL_CreateThread(simulationMain, "h2 simulation", this);
+
+			if (simThread == 0)
+			{
+				stop();
+				return false;
+			}
+
+			return true;
+		}
+
+		// Waits for the frame being simulated, frames not yet presented are dropped.
+		void stop()
+		{
+			if (simThread != 0)
+			{
+				SDL_AtomicSet(&stopping, 1);
+				SDL_SemPost(toSim);
+				SDL_WaitThread(simThread, 0);
+				simThread = 0;
+			}
+
+			if (toSim != 0)
+			{
+				SDL_DestroySemaphore(toSim);
+				toSim = 0;
+			}
+
+			if (fromSim != 0)
+			{
+				SDL_DestroySemaphore(fromSim);
+				fromSim = 0;
+			}
+
+			client = 0;
+		}
+
+		// Submits 'input' for the next frame, then renders and presents the
+		// oldest simulated one. Returns false once a presented frame asked
+		// to quit. The first D - 1 ticks only fill the pipeline.
+		bool tick(const InputSnapshot& input, SDL_Renderer* renderer)
+		{
+			if (client == 0)
+			{
+				return false;
+			}
+
+			// the packet presented D ticks ago is free again
+			FramePacket& next = packets[nSubmitted % depth];
+			next.frameIndex = nSubmitted;
+			next.input = input;
+			next.quit = false;
+			next.timing.submitTime = SDL_GetPerformanceCounter();
+			nSubmitted++;
+
+			if (threaded)
+			{
+				SDL_SemPost(toSim);
+			} else
+			{
+				simulatePacket(next);
+			}
+
+			if (nSubmitted < depth)
+			{
+				return true;
+			}
+
+			FramePacket& packet = packets[nPresented % depth];
+
+			Uint64 waitBegin = SDL_GetPerformanceCounter();
+			if (threaded)
+			{
+				H2_PROFILE_SCOPE("wait for simulation");
+				SDL_SemWait(fromSim);
+			}
+
+			packet.timing.renderBegin = SDL_GetPerformanceCounter();
+
+			if (tracker != 0)
+			{
+				tracker->beginFrame(packet.input);
+			}
+
+			{
+				H2_PROFILE_SCOPE("render");
+
+				renderScratch.reset();
+				packet.queue.setScratchAllocator(&renderScratch);
+				client->render(packet, renderer);
+				packet.queue.setScratchAllocator(0);
+			}
+
+			packet.timing.presentBegin = SDL_GetPerformanceCounter();
+			{
+				H2_PROFILE_SCOPE("present");
+				SDL_RenderPresent(renderer);
+			}
+
+			packet.timing.presentTime = SDL_GetPerformanceCounter();
+
+			if (tracker != 0)
+			{
+				tracker->present(packet.timing.presentTime);
+			}
+
+			if (telemetry != 0)
+			{
+				const FrameTiming& t = packet.timing;
+
+				FrameTimes times;
+				times.simMs = toMs(t.simEnd - t.simBegin);
+				times.renderMs = toMs(t.presentBegin - t.renderBegin);
+				times.presentMs = toMs(t.presentTime - t.presentBegin);
+				times.stallMs = toMs(t.renderBegin - waitBegin);
+
+				telemetry->endFrame(times, t.presentTime);
+			}
+
+			accumulate(packet.timing, packet.timing.renderBegin - waitBegin);
+			nPresented++;
+
+			return !packet.quit;
+		}
+
+		// Input-to-present latency is then measured against the input the
+		// presented frame was simulated with, not the newest one.
+		inline void setLatencyTracker(InputLatencyTracker* in_tracker)
+		{
+			tracker = in_tracker;
+		}
+
+		// Every presented frame is recorded, see FrameTelemetry.
+		inline void setTelemetry(FrameTelemetry* in_telemetry)
+		{
+			telemetry = in_telemetry;
+		}
+
+		inline unsigned int getDepth() const
+		{
+			return depth;
+		}
+
+		inline bool isThreaded() const
+		{
+			return threaded;
+		}
+
+		inline const FramePipelineStats& getStats() const
+		{
+			return stats;
+		}
+
+		// Timings of the frame presented last.
+		inline const FrameTiming& getLastTiming() const
+		{
+			return packets[(nPresented + depth - 1) % depth].timing;
+		}
+
+		// Main thread frame memory, reset before every 'render()'. The
+		// packet's queue sorts out of it, the client may use the rest.
+		inline LinearAllocator& getRenderScratch()
+		{
+			return renderScratch;
+		}
+
+	private:
+
+		FramePipelineClient* client;
+
+		InputLatencyTracker* tracker;
+
+		FrameTelemetry* telemetry;
+
+		FramePacket packets[H2_FRAME_PIPELINE_MAX_DEPTH];
+
+		unsigned int depth;
+
+		bool threaded;
+
+		// written by the main thread only
+		Uint64 nSubmitted;
+		Uint64 nPresented;
+
+		SDL_Thread* simThread;
+
+		SDL_sem* toSim;     // one post per submitted packet
+
+		SDL_sem* fromSim;   // one post per simulated packet
+
+		SDL_atomic_t stopping;
+
+		double invFrequency;
+
+		FramePipelineStats stats;
+
+		LinearAllocator renderScratch;
+
+
+		FramePipeline(const FramePipeline&);
+		FramePipeline& operator = (const FramePipeline&);
+
+		void simulatePacket(FramePacket& packet)
+		{
+			H2_PROFILE_SCOPE("simulate");
+
+			packet.timing.simBegin = SDL_GetPerformanceCounter();
+
+			packet.queue.clear();
+			client->simulate(packet);
+
+			packet.timing.simEnd = SDL_GetPerformanceCounter();
+		}
+
+		void accumulate(const FrameTiming& t, Uint64 stall)
+		{
+			float a = stats.nFrames == 0 ? 1.0f : H2_FRAME_PIPELINE_SMOOTHING;
+
+			stats.simMs += a*(toMs(t.simEnd - t.simBegin) - stats.simMs);
+			stats.renderMs += a*(toMs(t.presentTime - t.renderBegin) - stats.renderMs);
+			stats.stallMs += a*(toMs(stall) - stats.stallMs);
+			stats.queueMs += a*(toMs(t.simBegin - t.submitTime) - stats.queueMs);
+			stats.latencyMs += a*(toMs(t.presentTime - t.submitTime) - stats.latencyMs);
+			stats.latencyFrames += a*((float)(nSubmitted - nPresented - 1) - stats.latencyFrames);
+
+			stats.nFrames++;
+		}
+
+		inline float toMs(Uint64 ticks) const
+		{
+			return (float)((double)ticks*invFrequency);
+		}
+
+		static int SDLCALL simulationMain(void* data)
+		{
+			FramePipeline* pipeline = (FramePipeline*)data;
+
+			H2_PROFILE_THREAD("h2 simulation");
+			pipeline->client->beginSimulationThread();
+
+			Uint64 index = 0;
+
+			for (;;)
+			{
+				SDL_SemWait(pipeline->toSim);
+
+				if (SDL_AtomicGet(&pipeline->stopping) != 0)
+				{
+					break;
+				}
+
+				// the semaphore orders the packet's input before its simulation
+				SDL_MemoryBarrierAcquire();
+				pipeline->simulatePacket(pipeline->packets[index % pipeline->depth]);
+				index++;
+
+				SDL_MemoryBarrierRelease();
+				SDL_SemPost(pipeline->fromSim);
+			}
+
+			pipeline->client->endSimulationThread();
+
+			return 0;
+		}
+	};
+}
@@ -0,0 +1,566 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "SDL_timer.h"
+
+#include "h2_memory.h"
+#include "h2_profiler.h"
+
+
+
+#define H2_TELEMETRY_HISTORY          1024    // frames kept for rolling percentiles and CSV
+#define H2_TELEMETRY_MAX_ZONES        8       // profiler zones recorded per frame
+#define H2_TELEMETRY_HITCHES          64      // hitch reports kept
+#define H2_TELEMETRY_HITCH_ZONES      8       // heaviest zones kept per hitch
+#define H2_TELEMETRY_MEDIAN_INTERVAL  32      // frames between refreshes of the rolling medians
+
+#define H2_TELEMETRY_HITCH_MS         33.3f   // default absolute hitch threshold
+#define H2_TELEMETRY_HITCH_RATIO      2.0f    // default hitch threshold relative to the median frame
+#define H2_TELEMETRY_SPIKE_ALLOCATIONS 256    // default absolute allocation spike threshold
+#define H2_TELEMETRY_SPIKE_RATIO      4.0f    // default spike threshold relative to the median allocations
+
+
+
+
+namespace h2
+{
+	// Values recorded for every frame, in milliseconds unless noted.
+	enum FrameChannel
+	{
+		FRAME_CHANNEL_FRAME,          // present to present, what the user sees
+		FRAME_CHANNEL_CPU,            // simulation and render work, waits excluded
+		FRAME_CHANNEL_SIMULATION,
+		FRAME_CHANNEL_RENDER,         // recording and submitting, without present
+		FRAME_CHANNEL_PRESENT,        // blocked in SDL_RenderPresent
+		FRAME_CHANNEL_STALL,          // main thread waiting for the simulation
+		FRAME_CHANNEL_ALLOCATIONS,    // count, 0 without H2_MEMORY_TRACKING
+		FRAME_CHANNEL_ZONE,           // first zone from 'addZone()'
+
+		FRAME_CHANNEL_COUNT = FRAME_CHANNEL_ZONE + H2_TELEMETRY_MAX_ZONES
+	};
+
+
+	// Times of one frame as measured by the main loop. Loops that
+	// don't have some of them leave them 0.
+	struct FrameTimes
+	{
+		float simMs;
+		float renderMs;
+		float presentMs;
+		float stallMs;
+	};
+
+
+	struct FrameSample
+	{
+		Uint64 frameIndex;
+		Uint64 presentTime;
+
+		unsigned int nAllocatedBytes;   // 0 without H2_MEMORY_TRACKING
+
+		float values[FRAME_CHANNEL_COUNT];
+	};
+
+
+	struct FrameChannelStats
+	{
+		unsigned int nFrames;   // frames in the window
+		float p50, p90, p99, max, mean;
+	};
+
+
+	// Zone of the profiler frame in which a hitch happened.
+	struct FrameHitchZone
+	{
+		const char* name;
+		const char* parent;     // 0 for zones at the top of their thread
+		unsigned int thread;
+
+		unsigned int nCalls;
+		float totalMs;
+		float selfMs;
+	};
+
+
+	enum FrameHitchReason
+	{
+		HITCH_FRAME_TIME   = 1 << 0,
+		HITCH_ALLOCATIONS  = 1 << 1   // allocation spike, like a collector pause in the making
+	};
+
+
+	struct FrameHitch
+	{
+		FrameSample frame;
+
+		unsigned int reasons;       // FrameHitchReason bits
+
+		float thresholdMs;          // frame time the hitch exceeded
+		float medianMs;             // rolling median frame time
+		float medianAllocations;    // rolling median allocations per frame
+
+		// heaviest by self time, heaviest first
+		unsigned int nZones;
+		FrameHitchZone zones[H2_TELEMETRY_HITCH_ZONES];
+	};
+
+
+	// Frame time telemetry and stutter detection.
+	//
+	// 'endFrame()' is called once per presented frame, FramePipeline does
+	// it when given the telemetry. Every frame is recorded into a ring
+	// of H2_TELEMETRY_HISTORY samples; percentiles over it are exact and
+	// computed on request, averages hide the single long frames that
+	// are felt as stutter.
+	//
+	// A frame is a hitch when it takes longer than both the absolute
+	// threshold and the ratio times the rolling median frame time, or
+	// when it allocates more than both the absolute spike threshold and
+	// the ratio times the median allocation count. The hitch is kept
+	// with the heaviest zones of the profiler frame it happened in and
+	// written to the log file, if one is set.
+	//
+	// With a profiler attached the telemetry ends and begins the
+	// profiler's frames at each 'endFrame()', they must not be ended
+	// elsewhere. Zones of a simulation thread running ahead appear in
+	// the frame that was presented while they ran.
+	class FrameTelemetry
+	{
+	public:
+
+		// Constructors
+
+		FrameTelemetry() : history(H2_TELEMETRY_HISTORY), hitches(H2_TELEMETRY_HITCHES), profiler(0), log(0),
+						   nZones(0), nSamples(0), next(0), nHitches(0), frameIndex(0), lastPresent(0),
+						   lastAllocations(0), lastBytes(0), medianMs(0), medianAllocations(0)
+		{
+			invFrequency = 1000.0/(double)SDL_GetPerformanceFrequency();
+
+			hitchMs = H2_TELEMETRY_HITCH_MS;
+			hitchRatio = H2_TELEMETRY_HITCH_RATIO;
+			spikeAllocations = H2_TELEMETRY_SPIKE_ALLOCATIONS;
+			spikeRatio = H2_TELEMETRY_SPIKE_RATIO;
+
+			for (unsigned int i = 0; i < H2_TELEMETRY_MAX_ZONES; i++)
+			{
+				zones[i] = 0;
+			}
+		}
+
+
+		// Methods
+
+		// Profiler frames then follow presented frames, zones are
+		// recorded and hitches report the zones they happened in.
+		inline void setProfiler(Profiler* in_profiler)
+		{
+			profiler = in_profiler;
+			if (profiler != 0)
+			{
+				profiler->beginFrame();
+			}
+		}
+
+		// Hitches are written to 'file' as they are detected, 0 disables.
+		inline void setLog(FILE* file)
+		{
+			log = file;
+		}
+
+		inline void setHitchThreshold(float ms, float ratio)
+		{
+			hitchMs = ms;
+			hitchRatio = ratio;
+		}
+
+		// Only used with H2_MEMORY_TRACKING.
+		inline void setSpikeThreshold(unsigned int nAllocations, float ratio)
+		{
+			spikeAllocations = nAllocations;
+			spikeRatio = ratio;
+		}
+
+		// Records the total time of zone 'name' per frame into channel
+		// FRAME_CHANNEL_ZONE + index. Returns the index, -1 when all are
+		// taken. 'name' must outlive the telemetry.
+		int addZone(const char* name)
+		{
+			if (nZones == H2_TELEMETRY_MAX_ZONES)
+			{
+				return -1;
+			}
+
+			zones[nZones] = name;
+			return (int)nZones++;
+		}
+
+		inline const char* getZoneName(unsigned int index) const
+		{
+			return index < nZones ? zones[index] : 0;
+		}
+
+		void endFrame(const FrameTimes& times)
+		{
+			endFrame(times, SDL_GetPerformanceCounter());
+		}
+
+		void endFrame(const FrameTimes& times, Uint64 presentTime)
+		{
+			if (profiler != 0)
+			{
+				profiler->endFrame();
+				profiler->beginFrame();
+			}
+
+			// the first frame has no previous present to measure from
+			if (lastPresent == 0)
+			{
+				FrameSample first;
+				countAllocations(first);
+
+				lastPresent = presentTime;
+				frameIndex++;
+				return;
+			}
+
+			FrameSample& s = history[next];
+			s.frameIndex = frameIndex;
+			s.presentTime = presentTime;
+
+			float* v = s.values;
+			v[FRAME_CHANNEL_FRAME] = toMs(presentTime - lastPresent);
+			v[FRAME_CHANNEL_CPU] = times.simMs + times.renderMs;
+			v[FRAME_CHANNEL_SIMULATION] = times.simMs;
+			v[FRAME_CHANNEL_RENDER] = times.renderMs;
+			v[FRAME_CHANNEL_PRESENT] = times.presentMs;
+			v[FRAME_CHANNEL_STALL] = times.stallMs;
+
+			countAllocations(s);
+
+			for (unsigned int i = 0; i < H2_TELEMETRY_MAX_ZONES; i++)
+			{
+				v[FRAME_CHANNEL_ZONE + i] = (i < nZones && profiler != 0) ? profiler->getZoneMs(zones[i]) : 0.0f;
+			}
+
+			next = (next + 1) % H2_TELEMETRY_HISTORY;
+			if (nSamples < H2_TELEMETRY_HISTORY)
+			{
+				nSamples++;
+			}
+
+			float threshold = hitchRatio*medianMs > hitchMs ? hitchRatio*medianMs : hitchMs;
+			float spikeThreshold = spikeRatio*medianAllocations > (float)spikeAllocations ? spikeRatio*medianAllocations : (float)spikeAllocations;
+
+			unsigned int reasons = (v[FRAME_CHANNEL_FRAME] > threshold ? HITCH_FRAME_TIME : 0) |
+								   (v[FRAME_CHANNEL_ALLOCATIONS] > spikeThreshold ? HITCH_ALLOCATIONS : 0);
+			if (reasons != 0)
+			{
+				recordHitch(s, reasons, threshold);
+			}
+
+			lastPresent = presentTime;
+			frameIndex++;
+
+			if (frameIndex % H2_TELEMETRY_MEDIAN_INTERVAL == 0)
+			{
+				medianMs = median(FRAME_CHANNEL_FRAME);
+				medianAllocations = median(FRAME_CHANNEL_ALLOCATIONS);
+			}
+		}
+
+		// Statistics of one channel over the rolling window.
+		FrameChannelStats getStats(unsigned int channel)
+		{
+			FrameChannelStats stats;
+			stats.nFrames = nSamples;
+			stats.p50 = stats.p90 = stats.p99 = stats.max = stats.mean = 0;
+
+			if (nSamples == 0 || channel >= FRAME_CHANNEL_COUNT)
+			{
+				return stats;
+			}
+
+			gather(channel);
+			std::sort(sorted.begin(), sorted.end());
+
+			double sum = 0;
+			for (unsigned int i = 0; i < nSamples; i++)
+			{
+				sum += sorted[i];
+			}
+
+			stats.p50 = sorted[(nSamples - 1)/2];
+			stats.p90 = sorted[(unsigned int)((nSamples - 1)*0.90f)];
+			stats.p99 = sorted[(unsigned int)((nSamples - 1)*0.99f)];
+			stats.max = sorted[nSamples - 1];
+			stats.mean = (float)(sum/nSamples);
+
+			return stats;
+		}
+
+		// Frames ended since start; the first one only starts the clock.
+		inline Uint64 getFrameCount() const
+		{
+			return frameIndex;
+		}
+
+		// Hitches and allocation spikes detected since start, the last
+		// H2_TELEMETRY_HITCHES are kept.
+		inline unsigned int getHitchCount() const
+		{
+			return nHitches;
+		}
+
+		// Kept hitch 'i', 0 is the newest.
+		inline const FrameHitch& getHitch(unsigned int i) const
+		{
+			return hitches[(nHitches - 1 - i) % H2_TELEMETRY_HITCHES];
+		}
+
+		void writeHitch(FILE* file, const FrameHitch& hitch) const
+		{
+			const float* v = hitch.frame.values;
+
+			fprintf(file, "%s at frame %llu: %.2f ms (threshold %.2f, median %.2f)\n",
+					(hitch.reasons & HITCH_FRAME_TIME) != 0 ? "hitch" : "allocation spike",
+					(unsigned long long)hitch.frame.frameIndex, v[FRAME_CHANNEL_FRAME], hitch.thresholdMs, hitch.medianMs);
+			fprintf(file, "  cpu %.2f  simulation %.2f  render %.2f  present %.2f  stall %.2f ms\n",
+					v[FRAME_CHANNEL_CPU], v[FRAME_CHANNEL_SIMULATION], v[FRAME_CHANNEL_RENDER],
+					v[FRAME_CHANNEL_PRESENT], v[FRAME_CHANNEL_STALL]);
+
+			if (MemoryTracker::isEnabled())
+			{
+				fprintf(file, "  allocations %.0f (median %.0f), %u bytes\n",
+						v[FRAME_CHANNEL_ALLOCATIONS], hitch.medianAllocations, hitch.frame.nAllocatedBytes);
+			}
+
+			ProfileRegistry& r = getProfileRegistry();
+
+			for (unsigned int i = 0; i < hitch.nZones; i++)
+			{
+				const FrameHitchZone& z = hitch.zones[i];
+				fprintf(file, "  %-24s %8.2f ms self %8.2f ms total %5u calls  [%s]%s%s\n", z.name, z.selfMs, z.totalMs,
+						z.nCalls, r.threads[z.thread]->name, z.parent != 0 ? " in " : "", z.parent != 0 ? z.parent : "");
+			}
+		}
+
+		// Percentiles of all channels and the hitch count.
+		void report(FILE* file)
+		{
+			static const char* names[FRAME_CHANNEL_ZONE] =
+			{
+				"frame", "cpu", "simulation", "render", "present", "stall", "allocations"
+			};
+
+			fprintf(file, "%u frames, %u hitches\n", nSamples, nHitches);
+			fprintf(file, "%-24s %9s %9s %9s %9s %9s\n", "", "p50", "p90", "p99", "max", "mean");
+
+			for (unsigned int i = 0; i < FRAME_CHANNEL_ZONE + nZones; i++)
+			{
+				FrameChannelStats stats = getStats(i);
+				fprintf(file, "%-24s %9.2f %9.2f %9.2f %9.2f %9.2f\n", i < FRAME_CHANNEL_ZONE ? names[i] : zones[i - FRAME_CHANNEL_ZONE],
+						stats.p50, stats.p90, stats.p99, stats.max, stats.mean);
+			}
+		}
+
+		// Writes rolling window, oldest frame first. Returns false if
+		// file could not be opened.
+		bool dumpCsv(const char* path) const
+		{
+			FILE* file = fopen(path, "w");
+
+			if (file == 0)
+			{
+				return false;
+			}
+
+			fprintf(file, "frame,present_ticks,frame_ms,cpu_ms,simulation_ms,render_ms,present_ms,stall_ms,allocations,allocated_bytes");
+			for (unsigned int i = 0; i < nZones; i++)
+			{
+				fprintf(file, ",%s_ms", zones[i]);
+			}
+			fprintf(file, "\n");
+
+			unsigned int first = (nSamples < H2_TELEMETRY_HISTORY) ? 0 : next;
+
+			for (unsigned int i = 0; i < nSamples; i++)
+			{
+				const FrameSample& s = history[(first + i) % H2_TELEMETRY_HISTORY];
+				const float* v = s.values;
+
+				fprintf(file, "%llu,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.0f,%u", (unsigned long long)s.frameIndex,
+						(unsigned long long)s.presentTime, v[FRAME_CHANNEL_FRAME], v[FRAME_CHANNEL_CPU],
+						v[FRAME_CHANNEL_SIMULATION], v[FRAME_CHANNEL_RENDER], v[FRAME_CHANNEL_PRESENT],
+						v[FRAME_CHANNEL_STALL], v[FRAME_CHANNEL_ALLOCATIONS], s.nAllocatedBytes);
+
+				for (unsigned int j = 0; j < nZones; j++)
+				{
+					fprintf(file, ",%.3f", v[FRAME_CHANNEL_ZONE + j]);
+				}
+				fprintf(file, "\n");
+			}
+
+			fclose(file);
+
+			return true;
+		}
+
+	private:
+
+		TaggedVector<FrameSample, MEMORY_TAG_CORE>::Type history;
+
+		TaggedVector<FrameHitch, MEMORY_TAG_CORE>::Type hitches;
+
+		TaggedVector<float, MEMORY_TAG_CORE>::Type sorted;
+
+		Profiler* profiler;
+
+		FILE* log;
+
+		const char* zones[H2_TELEMETRY_MAX_ZONES];
+		unsigned int nZones;
+
+		unsigned int nSamples, next;
+
+		unsigned int nHitches;
+
+		Uint64 frameIndex;
+
+		Uint64 lastPresent;
+
+		unsigned int lastAllocations, lastBytes;
+
+		float medianMs, medianAllocations;
+
+		float hitchMs, hitchRatio;
+
+		unsigned int spikeAllocations;
+		float spikeRatio;
+
+		double invFrequency;
+
+
+		FrameTelemetry(const FrameTelemetry&);
+		FrameTelemetry& operator = (const FrameTelemetry&);
+
+		// Allocations since the previous frame, over all tags.
+		void countAllocations(FrameSample& s)
+		{
+			s.values[FRAME_CHANNEL_ALLOCATIONS] = 0;
+			s.nAllocatedBytes = 0;
+
+			if (!MemoryTracker::isEnabled())
+			{
+				return;
+			}
+
+			unsigned int nAllocations = 0, nBytes = 0;
+			for (unsigned int i = 0; i < MEMORY_TAG_COUNT; i++)
+			{
+				MemoryTagStats stats = MemoryTracker::getStats((MemoryTag)i);
+				nAllocations += stats.nAllocations;
+				nBytes += stats.nBytes;
+			}
+
+			// the counters wrap, so do the differences
+			s.values[FRAME_CHANNEL_ALLOCATIONS] = (float)(nAllocations - lastAllocations);
+			s.nAllocatedBytes = nBytes - lastBytes;
+
+			lastAllocations = nAllocations;
+			lastBytes = nBytes;
+		}
+
+		void recordHitch(const FrameSample& s, unsigned int reasons, float threshold)
+		{
+			FrameHitch& hitch = hitches[nHitches % H2_TELEMETRY_HITCHES];
+			nHitches++;
+
+			hitch.frame = s;
+			hitch.reasons = reasons;
+			hitch.thresholdMs = threshold;
+			hitch.medianMs = medianMs;
+			hitch.medianAllocations = medianAllocations;
+			hitch.nZones = 0;
+
+			if (profiler != 0)
+			{
+				collectZones(hitch);
+			}
+
+			if (log != 0)
+			{
+				writeHitch(log, hitch);
+				fflush(log);
+			}
+		}
+
+		// Keeps the zones with the most self time, heaviest first.
+		void collectZones(FrameHitch& hitch)
+		{
+			const ProfileNodeList& nodes = profiler->getNodes();
+
+			for (unsigned int i = 0; i < nodes.size(); i++)
+			{
+				const ProfileNode& n = nodes[i];
+
+				unsigned int at = hitch.nZones;
+				while (at > 0 && hitch.zones[at - 1].selfMs < n.selfMs)
+				{
+					at--;
+				}
+
+				if (at == H2_TELEMETRY_HITCH_ZONES)
+				{
+					continue;
+				}
+
+				unsigned int last = hitch.nZones < H2_TELEMETRY_HITCH_ZONES ? hitch.nZones : H2_TELEMETRY_HITCH_ZONES - 1;
+				for (unsigned int j = last; j > at; j--)
+				{
+					hitch.zones[j] = hitch.zones[j - 1];
+				}
+
+				FrameHitchZone& z = hitch.zones[at];
+				z.name = n.name;
+				z.parent = n.parent >= 0 ? nodes[n.parent].name : 0;
+				z.thread = n.thread;
+				z.nCalls = n.nCalls;
+				z.totalMs = n.totalMs;
+				z.selfMs = n.selfMs;
+
+				if (hitch.nZones < H2_TELEMETRY_HITCH_ZONES)
+				{
+					hitch.nZones++;
+				}
+			}
+		}
+
+		void gather(unsigned int channel)
+		{
+			sorted.resize(nSamples);
+			for (unsigned int i = 0; i < nSamples; i++)
+			{
+				sorted[i] = history[i].values[channel];
+			}
+		}
+
+		float median(unsigned int channel)
+		{
+			gather(channel);
+
+			TaggedVector<float, MEMORY_TAG_CORE>::Type::iterator middle = sorted.begin() + (nSamples - 1)/2;
+			std::nth_element(sorted.begin(), middle, sorted.end());
+
+			return *middle;
+		}
+
+		inline float toMs(Uint64 ticks) const
+		{
+			return (float)(ticks*invFrequency);
+		}
+	};
+}
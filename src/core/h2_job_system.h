@@ -0,0 +1,636 @@
+#pragma once
+
+#include "SDL_atomic.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
+#include "SDL_timer.h"
+
+#include "h2_profiler.h"
+#include "h2_spsc_ring.h"
+
+
+
+#define H2_JOB_DEQUE_SIZE 4096   // jobs queued per worker, power of two
+#define H2_JOB_MAX_WORKERS 64
+#define H2_JOB_SPIN_COUNT 256    // failed steal rounds before an idle worker sleeps
+
+
+
+
+namespace h2
+{
+	typedef void (*JobFunction)(void* data);
+
+	// Range job body for parallelFor(), processes ['begin', 'end').
+	typedef void (*ParallelForFunction)(unsigned int begin, unsigned int end, void* data);
+
+
+	// Number of unfinished jobs of a batch. Jobs started with a counter
+	// increment it when queued and decrement it when done, so a counter
+	// expresses dependencies: whatever needs the batch waits on it.
+	class JobCounter
+	{
+	public:
+
+		// Constructors
+
+		JobCounter()
+		{
+			SDL_AtomicSet(&value, 0);
+		}
+
+
+		// Methods
+
+		inline bool isDone()
+		{
+			return SDL_AtomicGet(&value) == 0;
+		}
+
+		inline int getValue()
+		{
+			return SDL_AtomicGet(&value);
+		}
+
+	private:
+
+		SDL_atomic_t value;
+
+		friend class JobSystem;
+		friend class FiberScheduler;
+	};
+
+
+	struct ParallelForTask
+	{
+		ParallelForFunction function;
+		void* data;
+		unsigned int grain;
+	};
+
+
+	struct Job
+	{
+		JobFunction function;
+		void* data;
+		JobCounter* counter;
+
+		// parallel for range, 'task' is 0 for plain jobs
+		ParallelForTask* task;
+		unsigned int begin, end;
+	};
+
+
+	// Chase-Lev work-stealing deque of fixed size. The owning worker
+	// pushes and pops at the bottom without locks; other workers steal
+	// from the top with one CAS. Only the race for the last job is
+	// resolved with CAS on the owner side.
+	//
+	// Jobs are stored by value. A slot is written again only after its
+	// job was claimed, so a thief that wins the CAS has read an intact
+	// job and a thief that loses discards what it read.
+	class JobDeque
+	{
+	public:
+
+		// Constructors
+
+		JobDeque()
+		{
+			SDL_AtomicSet(&top, 0);
+			SDL_AtomicSet(&bottom, 0);
+		}
+
+
+		// Methods
+
+		// Owner only, false when full.
+		bool push(const Job& job)
+		{
+			int b = SDL_AtomicGet(&bottom);
+			int t = SDL_AtomicGet(&top);
+
+			if (b - t >= H2_JOB_DEQUE_SIZE)
+			{
+				return false;
+			}
+
+			items[b & (H2_JOB_DEQUE_SIZE - 1)] = job;
+
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&bottom, b + 1);
+
+			return true;
+		}
+
+		// Owner only, newest job first.
+		bool pop(Job* outJob)
+		{
+			// full barrier, the bottom store must be visible before top is read
+			int b = SDL_AtomicAdd(&bottom, -1) - 1;
+			int t = SDL_AtomicGet(&top);
+
+			if (b - t < 0)
+			{
+				SDL_AtomicSet(&bottom, t);
+				return false;
+			}
+
+			*outJob = items[b & (H2_JOB_DEQUE_SIZE - 1)];
+
+			if (b - t > 0)
+			{
+				return true;
+			}
+
+			// last job, thieves may be taking it
+			bool won = SDL_AtomicCAS(&top, t, t + 1) == SDL_TRUE;
+			SDL_AtomicSet(&bottom, t + 1);
+
+			return won;
+		}
+
+		// Any thread, oldest job first. False when empty or when another
+		// thread won the race.
+		bool steal(Job* outJob)
+		{
+			// full barrier, top is read before bottom; otherwise a pop
+			// taking the last job can be missed and the job run twice
+			int t = SDL_AtomicAdd(&top, 0);
+			int b = SDL_AtomicGet(&bottom);
+
+			if (b - t <= 0)
+			{
+				return false;
+			}
+
+			// the job is read after the bottom that published it
+			SDL_MemoryBarrierAcquire();
+			*outJob = items[t & (H2_JOB_DEQUE_SIZE - 1)];
+
+			return SDL_AtomicCAS(&top, t, t + 1) == SDL_TRUE;
+		}
+
+		inline int size()
+		{
+			int n = SDL_AtomicGet(&bottom) - SDL_AtomicGet(&top);
+			return n > 0 ? n : 0;
+		}
+
+	private:
+
+		// top and bottom are written by different threads
+		SDL_atomic_t top;
+		char padTop[H2_CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+
+		SDL_atomic_t bottom;
+		char padBottom[H2_CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+
+		Job items[H2_JOB_DEQUE_SIZE];
+	};
+
+
+	// Statistics of one worker, written only by that worker.
+	struct JobWorkerStats
+	{
+		unsigned int nExecuted;
+		unsigned int nStolen;
+		unsigned int nSleeps;
+	};
+
+
+	// Fixed pool of worker threads with work stealing.
+	//
+	// The thread calling 'start()' becomes worker 0 and takes part in
+	// the work whenever it waits on a counter. Each worker owns a deque:
+	// spawning a job never locks or allocates, and idle workers steal
+	// from random victims before sleeping. A job that does not fit a
+	// full deque runs immediately.
+	//
+	// Jobs may only be queued from worker threads (worker 0 or inside
+	// jobs); other threads run them inline.
+	class JobSystem
+	{
+	public:
+
+		// Constructors
+
+		JobSystem() : workers(0), nWorkers(0), tls(0), wake(0)
+		{
+			SDL_AtomicSet(&running, 0);
+			SDL_AtomicSet(&nSleeping, 0);
+		}
+
+
+		// Destructor
+
+		~JobSystem()
+		{
+			stop();
+		}
+
+
+		// Methods
+
+		// 'nThreads' includes the calling thread, 0 means one per CPU.
+		bool start(unsigned int nThreads = 0)
+		{
+			stop();
+
+			if (nThreads == 0)
+			{
+				nThreads = (unsigned int)SDL_GetCPUCount();
+			}
+			nThreads = nThreads < 1 ? 1 : (nThreads > H2_JOB_MAX_WORKERS ? H2_JOB_MAX_WORKERS : nThreads);
+
+			if (tls == 0)
+			{
+				tls = SDL_TLSCreate();
+			}
+
+			wake = SDL_CreateSemaphore(0);
+			if (tls == 0 || wake == 0)
+			{
+				return false;
+			}
+
+			workers = new Worker[nThreads];
+			nWorkers = nThreads;
+
+			for (unsigned int i = 0; i < nWorkers; i++)
+			{
+				workers[i].system = this;
+				workers[i].index = i;
+				workers[i].random = 0x9E3779B9u*(i + 1);
+			}
+
+			SDL_TLSSet(tls, &workers[0], 0);
+			SDL_AtomicSet(&running, 1);
+
+			for (unsigned int i = 1; i < nWorkers; i++)
+			{
+				workers[i].thread = SDL_CreateThread(workerMain, "h2 job worker", &workers[i]);
+			}
+
+			return true;
+		}
+
+		// Joins the worker threads. Jobs still queued then run on the
+		// calling thread, so every counter reaches zero and no waiter is
+		// left hanging.
+		void stop()
+		{
+			if (workers == 0)
+			{
+				return;
+			}
+
+			SDL_AtomicSet(&running, 0);
+
+			for (unsigned int i = 1; i < nWorkers; i++)
+			{
+				SDL_SemPost(wake);
+			}
+
+			for (unsigned int i = 1; i < nWorkers; i++)
+			{
+				if (workers[i].thread != 0)
+				{
+					SDL_WaitThread(workers[i].thread, 0);
+				}
+			}
+
+			drain();
+
+			SDL_TLSSet(tls, 0, 0);
+
+			delete [] workers;
+			workers = 0;
+			nWorkers = 0;
+
+			SDL_DestroySemaphore(wake);
+			wake = 0;
+		}
+
+		inline unsigned int getWorkerCount() const
+		{
+			return nWorkers;
+		}
+
+		// Index of the calling worker, -1 for other threads.
+		int getWorkerIndex() const
+		{
+			Worker* w = currentWorker();
+			return w != 0 ? (int)w->index : -1;
+		}
+
+		inline const JobWorkerStats& getStats(unsigned int worker) const
+		{
+			return workers[worker].stats;
+		}
+
+		void run(JobFunction function, void* data, JobCounter* counter = 0)
+		{
+			Worker* self = currentWorker();
+
+			if (self == 0)
+			{
+				// not a worker, nowhere to queue
+				function(data);
+				return;
+			}
+
+			Job job;
+			job.function = function;
+			job.data = data;
+			job.counter = counter;
+			job.task = 0;
+
+			submit(self, job);
+		}
+
+		// Runs 'function' over ['0', 'count') split into ranges of at most
+		// 'grain' items, returns when all are done. Ranges are split in
+		// halves, so idle workers steal big pieces first.
+		void parallelFor(unsigned int count, unsigned int grain, ParallelForFunction function, void* data)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+
+			ParallelForTask task;
+			task.function = function;
+			task.data = data;
+			task.grain = grain > 0 ? grain : 1;
+
+			Worker* self = currentWorker();
+
+			if (self == 0 || count <= task.grain)
+			{
+				function(0, count, data);
+				return;
+			}
+
+			JobCounter counter;
+
+			Job job;
+			job.function = 0;
+			job.data = 0;
+			job.counter = &counter;
+			job.task = &task;
+			job.begin = 0;
+			job.end = count;
+
+			SDL_AtomicAdd(&counter.value, 1);
+			execute(self, job);
+
+			wait(&counter);
+		}
+
+		// Executes other jobs until 'counter' reaches zero.
+		void wait(JobCounter* counter)
+		{
+			Worker* self = currentWorker();
+
+			Job job;
+
+			while (!counter->isDone())
+			{
+				if (self != 0 && findJob(self, &job))
+				{
+					execute(self, job);
+				} else
+				{
+					SDL_Delay(0);
+				}
+			}
+
+			// jobs of the batch may have written data read after the wait
+			SDL_MemoryBarrierAcquire();
+		}
+
+	private:
+
+		struct Worker
+		{
+			JobDeque deque;
+
+			JobSystem* system;
+			SDL_Thread* thread;
+			unsigned int index;
+			Uint32 random;
+
+			JobWorkerStats stats;
+
+			char pad[H2_CACHE_LINE_SIZE];
+
+			Worker() : system(0), thread(0), index(0), random(1)
+			{
+				stats.nExecuted = stats.nStolen = stats.nSleeps = 0;
+			}
+		};
+
+		Worker* workers;
+
+		unsigned int nWorkers;
+
+		SDL_TLSID tls;
+
+		SDL_sem* wake;
+
+		SDL_atomic_t running;
+
+		SDL_atomic_t nSleeping;
+
+
+		JobSystem(const JobSystem&);
+		JobSystem& operator = (const JobSystem&);
+
+		inline Worker* currentWorker() const
+		{
+			return workers != 0 ? (Worker*)SDL_TLSGet(tls) : 0;
+		}
+
+		void submit(Worker* self, const Job& job)
+		{
+			if (job.counter != 0)
+			{
+				SDL_AtomicAdd(&job.counter->value, 1);
+			}
+
+			if (!self->deque.push(job))
+			{
+				// deque full, running now keeps everything correct
+				execute(self, job);
+				return;
+			}
+
+			if (SDL_AtomicGet(&nSleeping) > 0)
+			{
+				SDL_SemPost(wake);
+			}
+		}
+
+		void execute(Worker* self, const Job& job)
+		{
+			if (job.task != 0)
+			{
+				runRange(self, job);
+			} else
+			{
+				job.function(job.data);
+			}
+
+			self->stats.nExecuted++;
+
+			if (job.counter != 0)
+			{
+				// publish the job's writes before the counter drops
+				SDL_MemoryBarrierRelease();
+				SDL_AtomicAdd(&job.counter->value, -1);
+			}
+		}
+
+		void runRange(Worker* self, const Job& job)
+		{
+			ParallelForTask* task = job.task;
+			unsigned int begin = job.begin;
+			unsigned int end = job.end;
+
+			// keep the left half, queue the right one for thieves
+			while (end - begin > task->grain)
+			{
+				unsigned int mid = begin + (end - begin)/2;
+
+				Job right;
+				right.function = 0;
+				right.data = 0;
+				right.counter = job.counter;
+				right.task = task;
+				right.begin = mid;
+				right.end = end;
+				submit(self, right);
+
+				end = mid;
+			}
+
+			task->function(begin, end, task->data);
+		}
+
+		// Only the calling thread is left. Jobs a drained job queues go
+		// to worker 0, so repeat until a pass finds nothing.
+		void drain()
+		{
+			Job job;
+			bool found = true;
+
+			while (found)
+			{
+				found = false;
+
+				for (unsigned int i = 0; i < nWorkers; i++)
+				{
+					while (workers[i].deque.steal(&job))
+					{
+						execute(&workers[0], job);
+						found = true;
+					}
+				}
+			}
+		}
+
+		bool findJob(Worker* self, Job* outJob)
+		{
+			if (self->deque.pop(outJob))
+			{
+				return true;
+			}
+
+			if (nWorkers < 2)
+			{
+				return false;
+			}
+
+			// xorshift victim choice spreads thieves over the pool
+			self->random ^= self->random << 13;
+			self->random ^= self->random >> 17;
+			self->random ^= self->random << 5;
+
+			unsigned int start = self->random % nWorkers;
+
+			for (unsigned int i = 0; i < nWorkers; i++)
+			{
+				Worker& victim = workers[(start + i) % nWorkers];
+				if (&victim == self)
+				{
+					continue;
+				}
+
+				if (victim.deque.steal(outJob))
+				{
+					self->stats.nStolen++;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		static int SDLCALL workerMain(void* data)
+		{
+			Worker* self = (Worker*)data;
+			JobSystem* system = self->system;
+
+			SDL_TLSSet(system->tls, self, 0);
+			H2_PROFILE_THREAD("h2 job worker");
+
+			unsigned int nIdle = 0;
+			Job job;
+
+			while (SDL_AtomicGet(&system->running) != 0)
+			{
+				if (system->findJob(self, &job))
+				{
+					system->execute(self, job);
+					nIdle = 0;
+					continue;
+				}
+
+				if (++nIdle < H2_JOB_SPIN_COUNT)
+				{
+					continue;
+				}
+
+				// a wakeup lost between the last steal and the sleep
+				// costs at most the timeout
+				SDL_AtomicAdd(&system->nSleeping, 1);
+				SDL_SemWaitTimeout(system->wake, 1);
+				SDL_AtomicAdd(&system->nSleeping, -1);
+
+				self->stats.nSleeps++;
+				nIdle = 0;
+			}
+
+			return 0;
+		}
+	};
+
+
+	// parallelFor() over a functor, 'f(begin, end)' for each range.
+	template <class F>
+	struct ParallelForAdapter
+	{
+		static void call(unsigned int begin, unsigned int end, void* data)
+		{
+			(*(F*)data)(begin, end);
+		}
+	};
+
+	template <class F>
+	inline void parallelFor(JobSystem& jobs, unsigned int count, unsigned int grain, F& f)
+	{
+		jobs.parallelFor(count, grain, ParallelForAdapter<F>::call, &f);
+	}
+}
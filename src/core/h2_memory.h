@@ -0,0 +1,569 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <new>
+#include <vector>
+
+#include "SDL_assert.h"
+#include "SDL_atomic.h"
+#include "SDL_stdinc.h"
+#include "SDL_timer.h"
+
+
+
+// Define H2_MEMORY_TRACKING to route H2_MALLOC, H2_FREE, H2_NEW and
+// H2_DELETE through MemoryTracker. Without it they are plain malloc,
+// free, new and delete and the tracker reports nothing. The switch must
+// be the same in every translation unit.
+
+#define H2_MEMORY_MAX_CALLSITES 1024   // power of two
+#define H2_MEMORY_HEADER_SIZE 16       // keeps malloc's 16 byte alignment
+#define H2_MEMORY_MAGIC 0x48324D4Du
+
+
+
+
+namespace h2
+{
+	enum MemoryTag
+	{
+		MEMORY_TAG_GENERAL,
+		MEMORY_TAG_CORE,
+		MEMORY_TAG_MATH,
+		MEMORY_TAG_PHYSICS,
+		MEMORY_TAG_VIDEO,
+		MEMORY_TAG_SOUND,
+		MEMORY_TAG_GUI,
+		MEMORY_TAG_INPUT,
+
+		MEMORY_TAG_COUNT
+	};
+
+
+	inline const char* getMemoryTagName(MemoryTag tag)
+	{
+		static const char* names[MEMORY_TAG_COUNT] = {"general", "core", "math", "physics", "video", "sound", "gui", "input"};
+		return (unsigned int)tag < MEMORY_TAG_COUNT ? names[tag] : "?";
+	}
+
+
+	struct MemoryTagStats
+	{
+		Uint64 liveBytes;
+		Uint64 peakBytes;
+		unsigned int nLive;          // allocations not yet freed
+
+		unsigned int nAllocations;   // since start, wraps
+		unsigned int nBytes;         // since start, wraps
+
+		float allocationsPerSecond;  // between the last two 'update()'
+		float bytesPerSecond;
+	};
+
+
+	struct MemoryCallsite
+	{
+		const char* file;
+		int line;
+		MemoryTag tag;
+
+		Uint64 liveBytes;
+		unsigned int nLive;
+		unsigned int nAllocations;
+		unsigned int nBytes;
+	};
+
+
+	// Process-wide allocation statistics per subsystem tag and per
+	// callsite. Counters are atomics, so tracked allocation is safe from
+	// any thread and costs a few interlocked adds. Each block carries a
+	// small header with its size, tag and callsite, which 'deallocate()'
+	// uses to undo the counts. Live and peak bytes are 64 bit so they do
+	// not wrap past 2 GB; SDL has no 64 bit atomic, so they sit behind a
+	// spin lock.
+	class MemoryTracker
+	{
+	public:
+
+		// Methods
+
+		static inline bool isEnabled()
+		{
+#ifdef H2_MEMORY_TRACKING
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		static void* allocate(size_t size, MemoryTag tag, const char* file, int line)
+		{
+			Uint8* block = (Uint8*)malloc(size + H2_MEMORY_HEADER_SIZE);
+			if (block == 0)
+			{
+				return 0;
+			}
+
+			return attach(block, size, tag, findCallsite(file, line, tag));
+		}
+
+		static void* reallocate(void* p, size_t size, MemoryTag tag, const char* file, int line)
+		{
+			if (p == 0)
+			{
+				return allocate(size, tag, file, line);
+			}
+
+			Header* h = detach(p);
+
+			Uint8* block = (Uint8*)realloc(h, size + H2_MEMORY_HEADER_SIZE);
+			if (block == 0)
+			{
+				// like realloc, the old block stays valid and the caller still owns it
+				attach((Uint8*)h, (size_t)h->size, (MemoryTag)h->tag, h->callsite);
+				return 0;
+			}
+
+			return attach(block, size, tag, findCallsite(file, line, tag));
+		}
+
+		static void deallocate(void* p)
+		{
+			if (p != 0)
+			{
+				free(detach(p));
+			}
+		}
+
+		// Called once per frame to refresh the allocation rates.
+		static void update()
+		{
+			State& s = state();
+
+			Uint64 now = SDL_GetPerformanceCounter();
+			double seconds = s.lastUpdate != 0 ? (double)(now - s.lastUpdate)/(double)SDL_GetPerformanceFrequency() : 0.0;
+
+			for (unsigned int i = 0; i < MEMORY_TAG_COUNT; i++)
+			{
+				TagCounters& c = s.tags[i];
+
+				unsigned int nAllocations = (unsigned int)SDL_AtomicGet(&c.nAllocations);
+				unsigned int nBytes = (unsigned int)SDL_AtomicGet(&c.nBytes);
+
+				if (seconds > 0.0)
+				{
+					c.allocationsPerSecond = (float)((nAllocations - c.lastAllocations)/seconds);
+					c.bytesPerSecond = (float)((nBytes - c.lastBytes)/seconds);
+				}
+
+				c.lastAllocations = nAllocations;
+				c.lastBytes = nBytes;
+			}
+
+			s.lastUpdate = now;
+		}
+
+		static MemoryTagStats getStats(MemoryTag tag)
+		{
+			TagCounters& c = state().tags[tag];
+
+			MemoryTagStats stats;
+			SDL_AtomicLock(&c.bytesLock);
+			stats.liveBytes = c.liveBytes;
+			stats.peakBytes = c.peakBytes;
+			SDL_AtomicUnlock(&c.bytesLock);
+			stats.nLive = (unsigned int)SDL_AtomicGet(&c.nLive);
+			stats.nAllocations = (unsigned int)SDL_AtomicGet(&c.nAllocations);
+			stats.nBytes = (unsigned int)SDL_AtomicGet(&c.nBytes);
+			stats.allocationsPerSecond = c.allocationsPerSecond;
+			stats.bytesPerSecond = c.bytesPerSecond;
+
+			return stats;
+		}
+
+		// Callsites of 'tag' (all for MEMORY_TAG_COUNT), most live bytes first.
+		static void getCallsites(std::vector<MemoryCallsite>& out, MemoryTag tag = MEMORY_TAG_COUNT)
+		{
+			State& s = state();
+			out.clear();
+
+			for (unsigned int i = 0; i < H2_MEMORY_MAX_CALLSITES; i++)
+			{
+				Callsite& c = s.callsites[i];
+				if (SDL_AtomicGet(&c.used) == 0 || (tag != MEMORY_TAG_COUNT && c.tag != tag))
+				{
+					continue;
+				}
+
+				MemoryCallsite site;
+				site.file = c.file;
+				site.line = c.line;
+				site.tag = c.tag;
+				SDL_AtomicLock(&c.bytesLock);
+				site.liveBytes = c.liveBytes;
+				SDL_AtomicUnlock(&c.bytesLock);
+				site.nLive = (unsigned int)SDL_AtomicGet(&c.nLive);
+				site.nAllocations = (unsigned int)SDL_AtomicGet(&c.nAllocations);
+				site.nBytes = (unsigned int)SDL_AtomicGet(&c.nBytes);
+				out.push_back(site);
+			}
+
+			std::sort(out.begin(), out.end(), CompareLiveBytes());
+		}
+
+		// Per-tag table and the 'nCallsites' biggest callsites.
+		static void report(FILE* file, unsigned int nCallsites = 16)
+		{
+			fprintf(file, "%-8s %12s %12s %8s %12s %12s\n", "tag", "live", "peak", "blocks", "allocs/s", "bytes/s");
+
+			for (unsigned int i = 0; i < MEMORY_TAG_COUNT; i++)
+			{
+				MemoryTagStats s = getStats((MemoryTag)i);
+				fprintf(file, "%-8s %12llu %12llu %8u %12.0f %12.0f\n", getMemoryTagName((MemoryTag)i),
+						(unsigned long long)s.liveBytes, (unsigned long long)s.peakBytes, s.nLive, s.allocationsPerSecond, s.bytesPerSecond);
+			}
+
+			std::vector<MemoryCallsite> sites;
+			getCallsites(sites);
+
+			for (unsigned int i = 0; i < sites.size() && i < nCallsites; i++)
+			{
+				fprintf(file, "%12llu %8u %10u  %s:%d (%s)\n", (unsigned long long)sites[i].liveBytes, sites[i].nLive, sites[i].nAllocations,
+						sites[i].file, sites[i].line, getMemoryTagName(sites[i].tag));
+			}
+		}
+
+	private:
+
+		struct Header
+		{
+			Uint64 size;
+			Uint16 tag;
+			Uint16 callsite;
+			Uint32 magic;
+		};
+
+		struct TagCounters
+		{
+			SDL_atomic_t nLive, nAllocations, nBytes;
+
+			SDL_SpinLock bytesLock;
+			Uint64 liveBytes, peakBytes;
+
+			// written by 'update()' only
+			unsigned int lastAllocations, lastBytes;
+			float allocationsPerSecond, bytesPerSecond;
+		};
+
+		struct Callsite
+		{
+			SDL_atomic_t used;   // set once 'file' and 'line' are written
+			const char* file;
+			int line;
+			MemoryTag tag;
+
+			SDL_atomic_t nLive, nAllocations, nBytes;
+
+			SDL_SpinLock bytesLock;
+			Uint64 liveBytes;
+		};
+
+		struct State
+		{
+			TagCounters tags[MEMORY_TAG_COUNT];
+
+			Callsite callsites[H2_MEMORY_MAX_CALLSITES];
+			SDL_SpinLock callsiteLock;
+
+			Uint64 lastUpdate;
+		};
+
+		struct CompareLiveBytes
+		{
+			inline bool operator () (const MemoryCallsite& a, const MemoryCallsite& b) const
+			{
+				return a.liveBytes > b.liveBytes;
+			}
+		};
+
+
+		static inline State& state()
+		{
+			// plain data, zeroed before any code runs, so first use from
+			// several threads is safe
+			static State s;
+			return s;
+		}
+
+		// Index of the callsite, the last slot collects overflow.
+		static unsigned int findCallsite(const char* file, int line, MemoryTag tag)
+		{
+			State& s = state();
+
+			unsigned int hash = ((unsigned int)(size_t)file*2654435761u) ^ ((unsigned int)line*40503u) ^ (unsigned int)tag;
+			const unsigned int mask = H2_MEMORY_MAX_CALLSITES - 1;
+
+			// lock-free hit, slots are never freed
+			for (unsigned int i = 0; i < 8; i++)
+			{
+				Callsite& c = s.callsites[(hash + i) & mask];
+				if (SDL_AtomicGet(&c.used) == 0)
+				{
+					break;
+				}
+
+				SDL_MemoryBarrierAcquire();
+				if (c.file == file && c.line == line && c.tag == tag)
+				{
+					return (hash + i) & mask;
+				}
+			}
+
+			SDL_AtomicLock(&s.callsiteLock);
+
+			unsigned int index = mask;
+			for (unsigned int i = 0; i < mask; i++)
+			{
+				unsigned int slot = (hash + i) & mask;
+				Callsite& c = s.callsites[slot];
+
+				if (SDL_AtomicGet(&c.used) == 0)
+				{
+					c.file = file;
+					c.line = line;
+					c.tag = tag;
+					SDL_MemoryBarrierRelease();
+					SDL_AtomicSet(&c.used, 1);
+
+					index = slot;
+					break;
+				}
+
+				if (c.file == file && c.line == line && c.tag == tag)
+				{
+					index = slot;
+					break;
+				}
+			}
+
+			SDL_AtomicUnlock(&s.callsiteLock);
+
+			return index;
+		}
+
+		static void* attach(Uint8* block, size_t size, MemoryTag tag, unsigned int callsite)
+		{
+			Header* h = (Header*)block;
+			h->size = (Uint64)size;
+			h->tag = (Uint16)tag;
+			h->callsite = (Uint16)callsite;
+			h->magic = H2_MEMORY_MAGIC;
+
+			State& s = state();
+			TagCounters& t = s.tags[tag];
+			Callsite& c = s.callsites[callsite];
+
+			SDL_AtomicLock(&t.bytesLock);
+			t.liveBytes += size;
+			t.peakBytes = t.liveBytes > t.peakBytes ? t.liveBytes : t.peakBytes;
+			SDL_AtomicUnlock(&t.bytesLock);
+
+			SDL_AtomicAdd(&t.nLive, 1);
+			SDL_AtomicAdd(&t.nAllocations, 1);
+			SDL_AtomicAdd(&t.nBytes, (int)size);
+
+			SDL_AtomicLock(&c.bytesLock);
+			c.liveBytes += size;
+			SDL_AtomicUnlock(&c.bytesLock);
+
+			SDL_AtomicAdd(&c.nLive, 1);
+			SDL_AtomicAdd(&c.nAllocations, 1);
+			SDL_AtomicAdd(&c.nBytes, (int)size);
+
+			return block + H2_MEMORY_HEADER_SIZE;
+		}
+
+		static Header* detach(void* p)
+		{
+			Header* h = (Header*)((Uint8*)p - H2_MEMORY_HEADER_SIZE);
+			SDL_assert(h->magic == H2_MEMORY_MAGIC);
+
+			State& s = state();
+			TagCounters& t = s.tags[h->tag];
+			Callsite& c = s.callsites[h->callsite];
+
+			SDL_AtomicLock(&t.bytesLock);
+			t.liveBytes -= h->size;
+			SDL_AtomicUnlock(&t.bytesLock);
+			SDL_AtomicAdd(&t.nLive, -1);
+
+			SDL_AtomicLock(&c.bytesLock);
+			c.liveBytes -= h->size;
+			SDL_AtomicUnlock(&c.bytesLock);
+			SDL_AtomicAdd(&c.nLive, -1);
+
+			h->magic = 0;
+
+			return h;
+		}
+	};
+
+
+	// Placement argument of H2_NEW.
+	struct MemoryPlacement
+	{
+		MemoryTag tag;
+		const char* file;
+		int line;
+
+		MemoryPlacement(MemoryTag in_tag, const char* in_file, int in_line) : tag(in_tag), file(in_file), line(in_line) {}
+	};
+
+
+	template <class T>
+	inline void deleteTracked(T* p)
+	{
+		if (p != 0)
+		{
+			p->~T();
+			MemoryTracker::deallocate(p);
+		}
+	}
+
+
+	// STL allocator charging a container's storage to 'tag'. Every
+	// container of one tag shares a callsite.
+	template <class T, MemoryTag tag>
+	class TaggedStlAllocator
+	{
+	public:
+
+		typedef T value_type;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef T& reference;
+		typedef const T& const_reference;
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+
+		template <class U>
+		struct rebind
+		{
+			typedef TaggedStlAllocator<U, tag> other;
+		};
+
+
+		// Constructors
+
+		TaggedStlAllocator() {}
+
+		template <class U>
+		TaggedStlAllocator(const TaggedStlAllocator<U, tag>&) {}
+
+
+		// Methods
+
+		inline pointer address(reference x) const { return &x; }
+
+		inline const_pointer address(const_reference x) const { return &x; }
+
+		inline pointer allocate(size_type n, const void* = 0)
+		{
+#ifdef H2_MEMORY_TRACKING
+			void* p = MemoryTracker::allocate(n*sizeof(T), tag, "stl container", 0);
+#else
+			void* p = malloc(n*sizeof(T));
+#endif
+			if (p == 0)
+			{
+				throw std::bad_alloc();
+			}
+			return (pointer)p;
+		}
+
+		inline void deallocate(pointer p, size_type)
+		{
+#ifdef H2_MEMORY_TRACKING
+			MemoryTracker::deallocate(p);
+#else
+			free(p);
+#endif
+		}
+
+		inline size_type max_size() const { return (size_type)-1/sizeof(T); }
+
+		inline void construct(pointer p, const T& value) { new ((void*)p) T(value); }
+
+		inline void destroy(pointer p) { p->~T(); }
+
+		inline bool operator == (const TaggedStlAllocator&) const { return true; }
+
+		inline bool operator != (const TaggedStlAllocator&) const { return false; }
+	};
+
+
+	// 'TaggedVector<T, tag>::Type' is a vector charged to 'tag'.
+	template <class T, MemoryTag tag>
+	struct TaggedVector
+	{
+		typedef std::vector<T, TaggedStlAllocator<T, tag> > Type;
+	};
+
+	// 'TaggedMap<K, V, tag>::Type' and 'TaggedMultimap<K, V, tag>::Type'
+	// are maps charged to 'tag'.
+	template <class K, class V, MemoryTag tag>
+	struct TaggedMap
+	{
+		typedef std::map<K, V, std::less<K>, TaggedStlAllocator<std::pair<const K, V>, tag> > Type;
+	};
+
+	template <class K, class V, MemoryTag tag>
+	struct TaggedMultimap
+	{
+		typedef std::multimap<K, V, std::less<K>, TaggedStlAllocator<std::pair<const K, V>, tag> > Type;
+	};
+}
+
+
+#ifdef H2_MEMORY_TRACKING
+
+	inline void* operator new (size_t size, const h2::MemoryPlacement& at)
+	{
+		void* p = h2::MemoryTracker::allocate(size, at.tag, at.file, at.line);
+		if (p == 0)
+		{
+			throw std::bad_alloc();
+		}
+		return p;
+	}
+
+	// only called when a constructor throws
+	inline void operator delete (void* p, const h2::MemoryPlacement&)
+	{
+		h2::MemoryTracker::deallocate(p);
+	}
+
+	#define H2_MALLOC(size, tag) h2::MemoryTracker::allocate((size), (tag), __FILE__, __LINE__)
+	#define H2_REALLOC(p, size, tag) h2::MemoryTracker::reallocate((p), (size), (tag), __FILE__, __LINE__)
+	#define H2_FREE(p) h2::MemoryTracker::deallocate(p)
+
+	// H2_NEW(tag) T(args), released with H2_DELETE through a pointer of
+	// the exact type. Not for arrays.
+	#define H2_NEW(tag) new (h2::MemoryPlacement((tag), __FILE__, __LINE__))
+	#define H2_DELETE(p) h2::deleteTracked(p)
+
+#else
+
+	#define H2_MALLOC(size, tag) ((void)(tag), malloc(size))
+	#define H2_REALLOC(p, size, tag) ((void)(tag), realloc((p), (size)))
+	#define H2_FREE(p) free(p)
+
+	#define H2_NEW(tag) new
+	#define H2_DELETE(p) delete (p)
+
+#endif
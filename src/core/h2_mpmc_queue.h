@@ -0,0 +1,159 @@
+#pragma once
+
+#include "SDL_atomic.h"
+
+#include "h2_spsc_ring.h"
+
+
+
+
+namespace h2
+{
+	// Bounded multi-producer/multi-consumer ring buffer.
+	// 'capacity' must be a power of two. Neither side ever blocks:
+	// 'push()' fails when full and 'pop()' fails when empty.
+	//
+	// Every cell carries a sequence number telling which lap of the ring
+	// it is ready for. A producer claims position 'pos' with one CAS on
+	// the enqueue index once the cell's sequence equals 'pos', writes the
+	// item and publishes it by setting the sequence to 'pos + 1'; a
+	// consumer claims the cell at that sequence the same way and hands it
+	// back to the next lap with 'pos + capacity'. Producers and consumers
+	// only contend among themselves, and a stalled thread holds up its
+	// own cell, never the whole queue.
+	template <class T, unsigned int capacity>
+	class MpmcQueue
+	{
+	public:
+
+		// Constructors
+
+		MpmcQueue()
+		{
+			for (unsigned int i = 0; i < capacity; i++)
+			{
+				SDL_AtomicSet(&cells[i].sequence, (int)i);
+			}
+
+			SDL_AtomicSet(&enqueuePos, 0);
+			SDL_AtomicSet(&dequeuePos, 0);
+		}
+
+
+		// Methods
+
+		// Any thread.
+		bool push(const T& item)
+		{
+			Cell* cell;
+			unsigned int pos = (unsigned int)SDL_AtomicGet(&enqueuePos);
+
+			for (;;)
+			{
+				cell = &cells[pos & mask];
+				int diff = (int)((unsigned int)SDL_AtomicGet(&cell->sequence) - pos);
+
+				if (diff == 0)
+				{
+					if (SDL_AtomicCAS(&enqueuePos, (int)pos, (int)(pos + 1)))
+					{
+						break;
+					}
+					pos = (unsigned int)SDL_AtomicGet(&enqueuePos);
+				} else if (diff < 0)
+				{
+					// cell still holds the item of the previous lap
+					return false;
+				} else
+				{
+					// another producer took 'pos'
+					pos = (unsigned int)SDL_AtomicGet(&enqueuePos);
+				}
+			}
+
+			cell->item = item;
+
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&cell->sequence, (int)(pos + 1));
+
+			return true;
+		}
+
+		// Any thread.
+		bool pop(T* outItem)
+		{
+			Cell* cell;
+			unsigned int pos = (unsigned int)SDL_AtomicGet(&dequeuePos);
+
+			for (;;)
+			{
+				cell = &cells[pos & mask];
+				int diff = (int)((unsigned int)SDL_AtomicGet(&cell->sequence) - (pos + 1));
+
+				if (diff == 0)
+				{
+					if (SDL_AtomicCAS(&dequeuePos, (int)pos, (int)(pos + 1)))
+					{
+						break;
+					}
+					pos = (unsigned int)SDL_AtomicGet(&dequeuePos);
+				} else if (diff < 0)
+				{
+					// not written yet in this lap
+					return false;
+				} else
+				{
+					pos = (unsigned int)SDL_AtomicGet(&dequeuePos);
+				}
+			}
+
+			SDL_MemoryBarrierAcquire();
+			*outItem = cell->item;
+
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&cell->sequence, (int)(pos + capacity));
+
+			return true;
+		}
+
+		// Approximate when called concurrently with push or pop.
+		unsigned int size()
+		{
+			int n = (int)((unsigned int)SDL_AtomicGet(&enqueuePos) - (unsigned int)SDL_AtomicGet(&dequeuePos));
+			return n < 0 ? 0 : (n > (int)capacity ? capacity : (unsigned int)n);
+		}
+
+		inline unsigned int getCapacity() const
+		{
+			return capacity;
+		}
+
+	private:
+
+		enum { mask = capacity - 1 };
+
+		struct Cell
+		{
+			SDL_atomic_t sequence;
+			T item;
+		};
+
+		// producers and consumers on separate cache lines, away from the cells
+		char pad0[H2_CACHE_LINE_SIZE];
+
+		SDL_atomic_t enqueuePos;
+		char pad1[H2_CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+
+		SDL_atomic_t dequeuePos;
+		char pad2[H2_CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+
+		Cell cells[capacity];
+
+
+		MpmcQueue(const MpmcQueue&);
+		MpmcQueue& operator = (const MpmcQueue&);
+
+		// compile-time check for power of two capacity
+		typedef char capacityIsPowerOfTwo[(capacity & (capacity - 1)) == 0 ? 1 : -1];
+	};
+}
@@ -0,0 +1,639 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "SDL_atomic.h"
+#include "SDL_thread.h"
+#include "SDL_timer.h"
+
+#include "h2_memory.h"
+#include "h2_spsc_ring.h"
+
+
+
+// Zones are compiled in unless H2_NO_PROFILER is defined. They record
+// only while a Profiler exists and is enabled, otherwise a zone costs
+// one atomic load.
+
+#define H2_PROFILER_MAX_THREADS 64
+#define H2_PROFILER_THREAD_EVENTS 16384   // per thread between two 'endFrame()', power of two
+#define H2_PROFILER_MAX_DEPTH 64
+#define H2_PROFILER_NAME_SIZE 32
+
+
+
+
+namespace h2
+{
+	// Completed zone. Times are SDL performance counter values.
+	struct ProfileEvent
+	{
+		const char* name;
+		Uint64 begin;
+		Uint64 end;
+		unsigned int thread;
+	};
+
+
+	// Zones of one thread, written by that thread only and drained by
+	// the thread running Profiler::endFrame(). Full buffers drop events.
+	struct ProfileThreadBuffer
+	{
+		SpscRing<ProfileEvent, H2_PROFILER_THREAD_EVENTS> events;
+
+		unsigned int index;
+
+		SDL_atomic_t nDropped;
+
+		char name[H2_PROFILER_NAME_SIZE];
+	};
+
+
+	// Process-wide registry of thread buffers. Plain data, so it is
+	// zeroed before any code runs and usable from any thread at any time.
+	struct ProfileRegistry
+	{
+		SDL_atomic_t enabled;
+
+		SDL_SpinLock lock;
+		SDL_TLSID tls;
+
+		ProfileThreadBuffer* threads[H2_PROFILER_MAX_THREADS];
+		SDL_atomic_t nThreads;
+	};
+
+
+	inline ProfileRegistry& getProfileRegistry()
+	{
+		static ProfileRegistry registry;
+		return registry;
+	}
+
+	// Buffer of the calling thread, created on first use. 0 when all
+	// H2_PROFILER_MAX_THREADS buffers are taken.
+	inline ProfileThreadBuffer* getProfileThreadBuffer()
+	{
+		ProfileRegistry& r = getProfileRegistry();
+
+		if (r.tls != 0)
+		{
+			ProfileThreadBuffer* buffer = (ProfileThreadBuffer*)SDL_TLSGet(r.tls);
+			if (buffer != 0)
+			{
+				return buffer;
+			}
+		}
+
+		SDL_AtomicLock(&r.lock);
+
+		if (r.tls == 0)
+		{
+			r.tls = SDL_TLSCreate();
+		}
+
+		int n = SDL_AtomicGet(&r.nThreads);
+		ProfileThreadBuffer* buffer = 0;
+
+		if (n < H2_PROFILER_MAX_THREADS)
+		{
+			buffer = H2_NEW(MEMORY_TAG_CORE) ProfileThreadBuffer();
+			buffer->index = (unsigned int)n;
+			SDL_AtomicSet(&buffer->nDropped, 0);
+			SDL_snprintf(buffer->name, H2_PROFILER_NAME_SIZE, "thread %d", n);
+
+			r.threads[n] = buffer;
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&r.nThreads, n + 1);
+
+			SDL_TLSSet(r.tls, buffer, 0);
+		}
+
+		SDL_AtomicUnlock(&r.lock);
+
+		return buffer;
+	}
+
+	// Names the calling thread in reports and traces. Ignored while no
+	// profiler is enabled, so threads only get a buffer when profiled;
+	// create the Profiler before starting threads to name them.
+	inline void setProfileThreadName(const char* name)
+	{
+		if (SDL_AtomicGet(&getProfileRegistry().enabled) == 0)
+		{
+			return;
+		}
+
+		ProfileThreadBuffer* buffer = getProfileThreadBuffer();
+		if (buffer != 0)
+		{
+			SDL_strlcpy(buffer->name, name, H2_PROFILER_NAME_SIZE);
+		}
+	}
+
+
+	// Times the enclosing scope, use through H2_PROFILE_SCOPE. 'name'
+	// must outlive the profiler, string literals are the usual choice.
+	//
+	// The zone is recorded on the thread it ends on, which differs from
+	// the one it began on only around FiberScheduler::wait().
+	class ProfileScope
+	{
+	public:
+
+		// Constructors
+
+		ProfileScope(const char* in_name) : name(in_name), active(SDL_AtomicGet(&getProfileRegistry().enabled) != 0), begin(0)
+		{
+			if (active)
+			{
+				begin = SDL_GetPerformanceCounter();
+			}
+		}
+
+
+		// Destructor
+
+		~ProfileScope()
+		{
+			if (!active)
+			{
+				return;
+			}
+
+			Uint64 end = SDL_GetPerformanceCounter();
+
+			ProfileThreadBuffer* buffer = getProfileThreadBuffer();
+			if (buffer == 0)
+			{
+				return;
+			}
+
+			ProfileEvent e;
+			e.name = name;
+			e.begin = begin;
+			e.end = end;
+			e.thread = buffer->index;
+
+			if (!buffer->events.push(e))
+			{
+				SDL_AtomicAdd(&buffer->nDropped, 1);
+			}
+		}
+
+	private:
+
+		const char* name;
+
+		bool active;
+
+		Uint64 begin;
+
+
+		ProfileScope(const ProfileScope&);
+		ProfileScope& operator = (const ProfileScope&);
+	};
+
+
+	// Zone totals of one frame, aggregated by call path per thread.
+	struct ProfileNode
+	{
+		const char* name;
+		unsigned int thread;
+		unsigned int depth;
+
+		int parent;         // -1 for zones at the top of their thread
+		int firstChild;
+		int nextSibling;
+
+		unsigned int nCalls;
+		float totalMs;
+		float selfMs;       // total minus time in child zones
+	};
+
+	typedef TaggedVector<ProfileNode, MEMORY_TAG_CORE>::Type ProfileNodeList;
+
+
+	// Collects zones of all threads once per frame.
+	//
+	// 'endFrame()' drains every thread buffer and builds the frame's
+	// hierarchy: zones are grouped by thread and call path, with call
+	// counts, total and self times. During a capture the raw zones are
+	// kept as well and can be written as Chrome trace JSON, which opens
+	// in chrome://tracing or Perfetto.
+	//
+	// Only one Profiler should exist; it enables recording while alive.
+	class Profiler
+	{
+	public:
+
+		// Constructors
+
+		Profiler() : frameIndex(0), frameBegin(0), frameEnd(0), capturing(false), maxCaptureEvents(0), nDropped(0)
+		{
+			invFrequency = 1.0/(double)SDL_GetPerformanceFrequency();
+			setEnabled(true);
+		}
+
+
+		// Destructor
+
+		~Profiler()
+		{
+			setEnabled(false);
+		}
+
+
+		// Methods
+
+		inline void setEnabled(bool enabled)
+		{
+			SDL_AtomicSet(&getProfileRegistry().enabled, enabled ? 1 : 0);
+		}
+
+		inline bool isEnabled() const
+		{
+			return SDL_AtomicGet(&getProfileRegistry().enabled) != 0;
+		}
+
+		inline void beginFrame()
+		{
+			frameBegin = SDL_GetPerformanceCounter();
+		}
+
+		void endFrame()
+		{
+			frameEnd = SDL_GetPerformanceCounter();
+
+			events.clear();
+			nodes.clear();
+			nDropped = 0;
+
+			ProfileRegistry& r = getProfileRegistry();
+			int nThreads = SDL_AtomicGet(&r.nThreads);
+			SDL_MemoryBarrierAcquire();
+
+			ProfileEvent e;
+			for (int i = 0; i < nThreads; i++)
+			{
+				ProfileThreadBuffer* buffer = r.threads[i];
+
+				while (buffer->events.pop(&e))
+				{
+					events.push_back(e);
+				}
+
+				nDropped += (unsigned int)SDL_AtomicGet(&buffer->nDropped);
+				SDL_AtomicSet(&buffer->nDropped, 0);
+			}
+
+			if (capturing)
+			{
+				// the frame marker counts against the limit as well
+				for (unsigned int i = 0; i < events.size() && captured.size() < maxCaptureEvents; i++)
+				{
+					captured.push_back(events[i]);
+				}
+
+				if (captured.size() < maxCaptureEvents)
+				{
+					ProfileEvent frame;
+					frame.name = 0;
+					frame.begin = frameBegin;
+					frame.end = frameEnd;
+					frame.thread = 0;
+					captured.push_back(frame);
+				}
+			}
+
+			buildNodes();
+			frameIndex++;
+		}
+
+		// Nodes of the last finished frame. Children follow 'firstChild'
+		// and 'nextSibling'; top zones have 'parent' -1.
+		inline const ProfileNodeList& getNodes() const
+		{
+			return nodes;
+		}
+
+		inline float getFrameMs() const
+		{
+			return toMs(frameEnd - frameBegin);
+		}
+
+		// Zones lost last frame to full thread buffers.
+		inline unsigned int getDropped() const
+		{
+			return nDropped;
+		}
+
+		// Total of all calls of 'name' in the last frame, over all threads.
+		float getZoneMs(const char* name) const
+		{
+			float ms = 0;
+			for (unsigned int i = 0; i < nodes.size(); i++)
+			{
+				if (nodes[i].name == name || strcmp(nodes[i].name, name) == 0)
+				{
+					ms += nodes[i].totalMs;
+				}
+			}
+			return ms;
+		}
+
+		// Starts keeping raw zones for 'writeChromeTrace()', at most
+		// 'maxEvents' of them.
+		void beginCapture(unsigned int maxEvents = 1 << 20)
+		{
+			captured.clear();
+			capturing = true;
+			maxCaptureEvents = maxEvents;
+		}
+
+		inline void endCapture()
+		{
+			capturing = false;
+		}
+
+		inline bool isCapturing() const
+		{
+			return capturing;
+		}
+
+		// Writes the capture as Chrome trace event JSON. Frames appear as
+		// zones named "frame" on their own row.
+		bool writeChromeTrace(const char* path) const
+		{
+			FILE* file = fopen(path, "w");
+			if (file == 0)
+			{
+				return false;
+			}
+
+			Uint64 origin = captured.empty() ? 0 : captured[0].begin;
+			for (unsigned int i = 0; i < captured.size(); i++)
+			{
+				origin = captured[i].begin < origin ? captured[i].begin : origin;
+			}
+
+			fprintf(file, "{\"traceEvents\":[\n");
+
+			ProfileRegistry& r = getProfileRegistry();
+			int nThreads = SDL_AtomicGet(&r.nThreads);
+
+			fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"frames\"}}", H2_PROFILER_MAX_THREADS);
+			for (int i = 0; i < nThreads; i++)
+			{
+				fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", i);
+				writeJsonString(file, r.threads[i]->name);
+				fprintf(file, "}}");
+			}
+
+			for (unsigned int i = 0; i < captured.size(); i++)
+			{
+				const ProfileEvent& e = captured[i];
+
+				fprintf(file, ",\n{\"name\":");
+				writeJsonString(file, e.name != 0 ? e.name : "frame");
+				fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+						e.name != 0 ? (int)e.thread : H2_PROFILER_MAX_THREADS, toUs(e.begin - origin), toUs(e.end - e.begin));
+			}
+
+			fprintf(file, "\n]}\n");
+
+			return fclose(file) == 0;
+		}
+
+		// Indented tree of the last frame.
+		void print(FILE* file) const
+		{
+			fprintf(file, "frame %u: %.3f ms\n", (unsigned int)frameIndex, getFrameMs());
+
+			ProfileRegistry& r = getProfileRegistry();
+
+			// nodes are grouped by thread
+			unsigned int thread = H2_PROFILER_MAX_THREADS;
+
+			for (unsigned int i = 0; i < nodes.size(); i++)
+			{
+				const ProfileNode& n = nodes[i];
+				if (n.parent < 0)
+				{
+					if (n.thread != thread)
+					{
+						thread = n.thread;
+						fprintf(file, "[%s]\n", r.threads[thread]->name);
+					}
+					printNode(file, (int)i);
+				}
+			}
+		}
+
+	private:
+
+		TaggedVector<ProfileEvent, MEMORY_TAG_CORE>::Type events;
+
+		TaggedVector<ProfileEvent, MEMORY_TAG_CORE>::Type captured;
+
+		ProfileNodeList nodes;
+
+		Uint64 frameIndex;
+
+		Uint64 frameBegin, frameEnd;
+
+		bool capturing;
+
+		unsigned int maxCaptureEvents;
+
+		unsigned int nDropped;
+
+		double invFrequency;
+
+
+		Profiler(const Profiler&);
+		Profiler& operator = (const Profiler&);
+
+		struct CompareEvents
+		{
+			inline bool operator () (const ProfileEvent& a, const ProfileEvent& b) const
+			{
+				if (a.thread != b.thread)
+				{
+					return a.thread < b.thread;
+				}
+				if (a.begin != b.begin)
+				{
+					return a.begin < b.begin;
+				}
+				// same start, the enclosing zone is the longer one
+				return a.end > b.end;
+			}
+		};
+
+		inline float toMs(Uint64 ticks) const
+		{
+			return (float)((double)ticks*invFrequency*1000.0);
+		}
+
+		inline double toUs(Uint64 ticks) const
+		{
+			return (double)ticks*invFrequency*1000000.0;
+		}
+
+		// Groups the drained zones by thread and call path. Nesting comes
+		// from time intervals: a zone is inside the last one still open
+		// when it begins. A zone whose parent is still running, or was
+		// drained in an earlier frame, becomes a top zone.
+		void buildNodes()
+		{
+			std::sort(events.begin(), events.end(), CompareEvents());
+
+			int open[H2_PROFILER_MAX_DEPTH];
+			Uint64 openEnd[H2_PROFILER_MAX_DEPTH];
+			unsigned int nOpen = 0;
+			unsigned int thread = (unsigned int)-1;
+
+			for (unsigned int i = 0; i < events.size(); i++)
+			{
+				const ProfileEvent& e = events[i];
+
+				if (e.thread != thread)
+				{
+					thread = e.thread;
+					nOpen = 0;
+				}
+
+				// close zones that ended before this one began
+				while (nOpen > 0 && openEnd[nOpen - 1] <= e.begin)
+				{
+					nOpen--;
+				}
+
+				int parent = nOpen > 0 ? open[nOpen - 1] : -1;
+				int node = findChild(parent, e.name, e.thread, nOpen);
+
+				ProfileNode& n = nodes[node];
+				n.nCalls++;
+				n.totalMs += toMs(e.end - e.begin);
+
+				if (nOpen < H2_PROFILER_MAX_DEPTH)
+				{
+					open[nOpen] = node;
+					openEnd[nOpen] = e.end;
+					nOpen++;
+				}
+			}
+
+			for (unsigned int i = 0; i < nodes.size(); i++)
+			{
+				float children = 0;
+				for (int c = nodes[i].firstChild; c >= 0; c = nodes[c].nextSibling)
+				{
+					children += nodes[c].totalMs;
+				}
+				nodes[i].selfMs = nodes[i].totalMs - children;
+			}
+		}
+
+		int findChild(int parent, const char* name, unsigned int thread, unsigned int depth)
+		{
+			int last = -1;
+			int first = parent >= 0 ? nodes[parent].firstChild : firstTopNode(thread);
+
+			for (int c = first; c >= 0; c = nodes[c].nextSibling)
+			{
+				if (nodes[c].thread == thread && (nodes[c].name == name || strcmp(nodes[c].name, name) == 0))
+				{
+					return c;
+				}
+				last = c;
+			}
+
+			ProfileNode n;
+			n.name = name;
+			n.thread = thread;
+			n.depth = depth;
+			n.parent = parent;
+			n.firstChild = -1;
+			n.nextSibling = -1;
+			n.nCalls = 0;
+			n.totalMs = 0;
+			n.selfMs = 0;
+
+			int index = (int)nodes.size();
+			nodes.push_back(n);
+
+			if (last >= 0)
+			{
+				nodes[last].nextSibling = index;
+			} else if (parent >= 0)
+			{
+				nodes[parent].firstChild = index;
+			}
+
+			return index;
+		}
+
+		// Top zones of a thread are siblings of the first one found here.
+		int firstTopNode(unsigned int thread) const
+		{
+			for (unsigned int i = 0; i < nodes.size(); i++)
+			{
+				if (nodes[i].parent < 0 && nodes[i].thread == thread)
+				{
+					return (int)i;
+				}
+			}
+			return -1;
+		}
+
+		void printNode(FILE* file, int index) const
+		{
+			const ProfileNode& n = nodes[index];
+
+			fprintf(file, "%*s%-*s %8.3f ms %8.3f self %6u calls\n", (int)(2*n.depth + 2), "",
+					(int)(32 - 2*n.depth > 8 ? 32 - 2*n.depth : 8), n.name, n.totalMs, n.selfMs, n.nCalls);
+
+			for (int c = n.firstChild; c >= 0; c = nodes[c].nextSibling)
+			{
+				printNode(file, c);
+			}
+		}
+
+		static void writeJsonString(FILE* file, const char* s)
+		{
+			fputc('"', file);
+			for (; *s != 0; s++)
+			{
+				if (*s == '"' || *s == '\\')
+				{
+					fputc('\\', file);
+					fputc(*s, file);
+				} else if ((unsigned char)*s < 0x20)
+				{
+					fprintf(file, "\\u%04x", (unsigned int)(unsigned char)*s);
+				} else
+				{
+					fputc(*s, file);
+				}
+			}
+			fputc('"', file);
+		}
+	};
+}
+
+
+#ifndef H2_NO_PROFILER
+	#define H2_PROFILE_CONCAT2(a, b) a##b
+	#define H2_PROFILE_CONCAT(a, b) H2_PROFILE_CONCAT2(a, b)
+
+	// Times the rest of the enclosing scope as zone 'name'.
+	#define H2_PROFILE_SCOPE(name) h2::ProfileScope H2_PROFILE_CONCAT(h2ProfileScope, __LINE__)(name)
+	#define H2_PROFILE_THREAD(name) h2::setProfileThreadName(name)
+#else
+	#define H2_PROFILE_SCOPE(name)
+	#define H2_PROFILE_THREAD(name)
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "SDL_atomic.h"
+
+
+
+#define H2_CACHE_LINE_SIZE 64
+
+
+
+
+namespace h2
+{
+	// Bounded single-producer/single-consumer ring buffer.
+	// 'capacity' must be a power of two. Neither side ever blocks:
+	// 'push()' fails when full and 'pop()' fails when empty.
+	// Each side keeps a copy of the other side's index and only reads
+	// the shared one when the copy says full or empty, so the index
+	// cache lines move between cores once per batch, not per item.
+	template <class T, unsigned int capacity>
+	class SpscRing
+	{
+	public:
+
+		// Constructors
+
+		SpscRing() : cachedTail(0), cachedHead(0)
+		{
+			SDL_AtomicSet(&head, 0);
+			SDL_AtomicSet(&tail, 0);
+		}
+
+
+		// Methods
+
+		// Producer side.
+		bool push(const T& item)
+		{
+			unsigned int t = (unsigned int)SDL_AtomicGet(&tail);
+
+			if (t - cachedHead >= capacity)
+			{
+				cachedHead = (unsigned int)SDL_AtomicGet(&head);
+				if (t - cachedHead >= capacity)
+				{
+					return false;
+				}
+			}
+
+			items[t & mask] = item;
+
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&tail, (int)(t + 1));
+
+			return true;
+		}
+
+		// Consumer side.
+		bool pop(T* outItem)
+		{
+			unsigned int h = (unsigned int)SDL_AtomicGet(&head);
+
+			if (h == cachedTail)
+			{
+				cachedTail = (unsigned int)SDL_AtomicGet(&tail);
+				if (h == cachedTail)
+				{
+					return false;
+				}
+			}
+
+			SDL_MemoryBarrierAcquire();
+			*outItem = items[h & mask];
+
+			SDL_AtomicSet(&head, (int)(h + 1));
+
+			return true;
+		}
+
+		// Consumer side, pointer to oldest item or 0 when empty.
+		// Item stays valid until 'drop()'.
+		const T* peek()
+		{
+			unsigned int h = (unsigned int)SDL_AtomicGet(&head);
+
+			if (h == cachedTail)
+			{
+				cachedTail = (unsigned int)SDL_AtomicGet(&tail);
+				if (h == cachedTail)
+				{
+					return 0;
+				}
+			}
+
+			SDL_MemoryBarrierAcquire();
+			return &items[h & mask];
+		}
+
+		// Consumer side, removes item returned by 'peek()'.
+		void drop()
+		{
+			SDL_AtomicAdd(&head, 1);
+		}
+
+		// Approximate when called concurrently with push or pop.
+		unsigned int size()
+		{
+			return (unsigned int)SDL_AtomicGet(&tail) - (unsigned int)SDL_AtomicGet(&head);
+		}
+
+		inline unsigned int getCapacity() const
+		{
+			return capacity;
+		}
+
+	private:
+
+		enum { mask = capacity - 1 };
+
+		// head and tail on separate cache lines to avoid false sharing,
+		// each next to the copy of the other index its owner keeps
+		SDL_atomic_t head;
+		unsigned int cachedTail;   // consumer side
+		char pad0[H2_CACHE_LINE_SIZE - sizeof(SDL_atomic_t) - sizeof(unsigned int)];
+
+		SDL_atomic_t tail;
+		unsigned int cachedHead;   // producer side
+		char pad1[H2_CACHE_LINE_SIZE - sizeof(SDL_atomic_t) - sizeof(unsigned int)];
+
+		T items[capacity];
+
+		// compile-time check for power of two capacity
+		typedef char capacityIsPowerOfTwo[(capacity & (capacity - 1)) == 0 ? 1 : -1];
+	};
+}
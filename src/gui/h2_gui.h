@@ -0,0 +1,293 @@
+#pragma once
+
+#include "SDL_mouse.h"
+#include "SDL_render.h"
+
+#include "../core/h2_profiler.h"
+#include "../input/h2_input.h"
+#include "../video/h2_batch2d.h"
+#include "h2_widget.h"
+
+
+
+
+namespace h2
+{
+	// Retained-mode GUI root.
+	//
+	// Per frame: 'update()' routes mouse input to widgets, 'layout()'
+	// measures and arranges only invalidated subtrees, 'render()'
+	// repaints only the dirty region. The GUI is kept in a render target
+	// texture, so unchanged pixels survive between frames, and the whole
+	// repaint goes through one Batch2D flush before the texture is
+	// composited over the scene with a single copy. Without render target
+	// support the GUI is repainted completely every frame.
+	//
+	// Inside the texture widget colors replace what is below them; alpha
+	// only matters when the texture is blended over the scene. Text needs
+	// a TextCache, which may be shared with other text drawing.
+	class Gui
+	{
+	public:
+
+		// Constructors
+
+		Gui() : root(new Widget()), target(0), targetRenderer(0), noTargets(false)
+		{
+			screen.x = screen.y = screen.w = screen.h = 0;
+			root->setLayout(GUI_LAYOUT_ABSOLUTE);
+			root->attach(&context);
+		}
+
+
+		// Destructor
+
+		~Gui()
+		{
+			delete root;
+
+			if (target != 0)
+			{
+				SDL_DestroyTexture(target);
+			}
+		}
+
+
+		// Methods
+
+		inline Widget* getRoot() const
+		{
+			return root;
+		}
+
+		void setSize(int width, int height)
+		{
+			if (width == screen.w && height == screen.h)
+			{
+				return;
+			}
+
+			screen.w = width;
+			screen.h = height;
+			root->setPreferredSize(width, height);
+
+			if (target != 0)
+			{
+				SDL_DestroyTexture(target);
+				target = 0;
+			}
+
+			invalidateAll();
+		}
+
+		inline void invalidateAll()
+		{
+			context.dirty.add(screen);
+		}
+
+		void setTextCache(TextCache* cache)
+		{
+			context.text = cache;
+			root->invalidateTree();
+			invalidateAll();
+		}
+
+		// Routes mouse state of the frame to widgets.
+		void update(const InputSnapshot& input)
+		{
+			H2_PROFILE_SCOPE("gui update");
+
+			int mx = input.mouse.x;
+			int my = input.mouse.y;
+
+			Widget* hit = root->hitTest(mx, my);
+
+			// hover follows the mouse unless a widget captured it
+			if (context.captured == 0 && hit != context.hovered)
+			{
+				setHovered(hit);
+			}
+
+			if (input.mouse.dx != 0 || input.mouse.dy != 0)
+			{
+				Widget* w = context.captured != 0 ? context.captured : context.hovered;
+				if (w != 0)
+				{
+					w->onMouseMove(mx, my);
+				}
+			}
+
+			if (input.mouse.pressed.get(SDL_BUTTON_LEFT) && context.hovered != 0 && context.captured == 0)
+			{
+				context.captured = context.hovered;
+				context.captured->onMouseDown(mx, my);
+			}
+
+			if (input.mouse.released.get(SDL_BUTTON_LEFT) && context.captured != 0)
+			{
+				Widget* w = context.captured;
+				context.captured = 0;
+				w->onMouseUp(mx, my, hit == w);
+
+				if (hit != context.hovered)
+				{
+					setHovered(hit);
+				}
+			}
+		}
+
+		// Incremental layout of invalidated subtrees.
+		void layout()
+		{
+			context.stats.nMeasured = 0;
+			context.stats.nArranged = 0;
+
+			root->measure();
+			root->arrange(screen);
+		}
+
+		// Repaints dirty region and draws GUI over the current target.
+		// Returns number of SDL draw calls for the repaint.
+		int render(SDL_Renderer* renderer)
+		{
+			H2_PROFILE_SCOPE("gui render");
+
+			GuiStats& stats = context.stats;
+			stats.nPainted = 0;
+			stats.nDirtyRects = context.dirty.getCount();
+			stats.dirtyArea = context.dirty.getArea();
+			stats.nDrawCalls = 0;
+
+			if (!ensureTarget(renderer))
+			{
+				// no persistent pixels, everything every frame
+				GuiPainter painter(batch);
+				painter.setText(&textBatch, context.text);
+				root->paintTree(painter, screen);
+				stats.nDrawCalls = batch.flush(renderer) + textBatch.flush(renderer);
+				context.dirty.clear();
+
+				return stats.nDrawCalls;
+			}
+
+			if (!context.dirty.isEmpty())
+			{
+				SDL_BlendMode blendMode;
+				SDL_GetRenderDrawBlendMode(renderer, &blendMode);
+				SDL_SetRenderTarget(renderer, target);
+				SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+				GuiPainter painter(batch);
+				painter.setText(&textBatch, context.text);
+
+				for (unsigned int i = 0; i < context.dirty.getCount(); i++)
+				{
+					SDL_Rect clip;
+					if (!intersectGuiRect(context.dirty.getRect(i), screen, &clip))
+					{
+						continue;
+					}
+
+					// clear to transparent, then widgets back to front
+					batch.setColor(0, 0, 0, 0);
+					batch.fillRect((float)clip.x, (float)clip.y, (float)clip.w, (float)clip.h);
+
+					painter.setClip(clip);
+					root->paintTree(painter, clip);
+				}
+
+				stats.nDrawCalls = batch.flush(renderer) + textBatch.flush(renderer);
+
+				SDL_SetRenderTarget(renderer, 0);
+				SDL_SetRenderDrawBlendMode(renderer, blendMode);
+
+				context.dirty.clear();
+			}
+
+			SDL_RenderCopy(renderer, target, 0, 0);
+
+			return stats.nDrawCalls;
+		}
+
+		inline const GuiStats& getStats() const
+		{
+			return context.stats;
+		}
+
+	private:
+
+		GuiContext context;
+
+		Widget* root;
+
+		SDL_Rect screen;
+
+		Batch2D batch;
+
+		TextBatch textBatch;
+
+		SDL_Texture* target;
+
+		SDL_Renderer* targetRenderer;
+
+		bool noTargets;
+
+
+		Gui(const Gui&);
+		Gui& operator = (const Gui&);
+
+		void setHovered(Widget* w)
+		{
+			if (context.hovered != 0)
+			{
+				context.hovered->onMouseLeave();
+			}
+
+			context.hovered = w;
+
+			if (w != 0)
+			{
+				w->onMouseEnter();
+			}
+		}
+
+		bool ensureTarget(SDL_Renderer* renderer)
+		{
+			if (target != 0 && targetRenderer == renderer)
+			{
+				return true;
+			}
+
+			if (noTargets || screen.w <= 0 || screen.h <= 0)
+			{
+				return false;
+			}
+
+			if (SDL_RenderTargetSupported(renderer) == SDL_FALSE)
+			{
+				noTargets = true;
+				return false;
+			}
+
+			if (target != 0)
+			{
+				SDL_DestroyTexture(target);
+			}
+
+			target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, screen.w, screen.h);
+			if (target == 0)
+			{
+				noTargets = true;
+				return false;
+			}
+
+			SDL_SetTextureBlendMode(target, SDL_BLENDMODE_BLEND);
+			targetRenderer = renderer;
+
+			// new texture content is undefined
+			invalidateAll();
+
+			return true;
+		}
+	};
+}
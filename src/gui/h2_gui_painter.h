@@ -0,0 +1,144 @@
+#pragma once
+
+#include "SDL_rect.h"
+
+#include "../video/h2_batch2d.h"
+#include "../video/h2_text.h"
+
+
+
+
+namespace h2
+{
+	// Intersection of two rects, false when empty.
+	inline bool intersectGuiRect(const SDL_Rect& a, const SDL_Rect& b, SDL_Rect* out)
+	{
+		int x0 = a.x > b.x ? a.x : b.x;
+		int y0 = a.y > b.y ? a.y : b.y;
+		int x1 = (a.x + a.w < b.x + b.w) ? a.x + a.w : b.x + b.w;
+		int y1 = (a.y + a.h < b.y + b.h) ? a.y + a.h : b.y + b.h;
+
+		if (x1 <= x0 || y1 <= y0)
+		{
+			return false;
+		}
+
+		out->x = x0;
+		out->y = y0;
+		out->w = x1 - x0;
+		out->h = y1 - y0;
+
+		return true;
+	}
+
+
+	// Smallest rect containing both.
+	inline SDL_Rect uniteGuiRect(const SDL_Rect& a, const SDL_Rect& b)
+	{
+		int x0 = a.x < b.x ? a.x : b.x;
+		int y0 = a.y < b.y ? a.y : b.y;
+		int x1 = (a.x + a.w > b.x + b.w) ? a.x + a.w : b.x + b.w;
+		int y1 = (a.y + a.h > b.y + b.h) ? a.y + a.h : b.y + b.h;
+
+		SDL_Rect r = {x0, y0, x1 - x0, y1 - y0};
+		return r;
+	}
+
+
+	// Draws widget geometry into a Batch2D, clipped in software to the
+	// rect being repainted. Everything is expressed as filled rects, so
+	// clipping is exact and a whole repaint stays in one batch without
+	// touching the renderer clip rect. Text goes to a TextBatch flushed
+	// after the rects, so it is always on top of them.
+	class GuiPainter
+	{
+	public:
+
+		// Constructors
+
+		GuiPainter(Batch2D& in_batch) : batch(in_batch), textBatch(0), textCache(0)
+		{
+			clip.x = clip.y = 0;
+			clip.w = clip.h = 0x3FFFFFFF;
+		}
+
+
+		// Methods
+
+		inline void setClip(const SDL_Rect& in_clip)
+		{
+			clip = in_clip;
+		}
+
+		inline const SDL_Rect& getClip() const
+		{
+			return clip;
+		}
+
+		inline Batch2D& getBatch()
+		{
+			return batch;
+		}
+
+		inline void setText(TextBatch* in_textBatch, TextCache* in_textCache)
+		{
+			textBatch = in_textBatch;
+			textCache = in_textCache;
+		}
+
+		// 'color' is packed with packRenderColor().
+		void fillRect(const SDL_Rect& rect, Uint32 color)
+		{
+			SDL_Rect r;
+			if ((color & 0xFF) == 0 || !intersectGuiRect(rect, clip, &r))
+			{
+				return;
+			}
+
+			batch.setColor((Uint8)(color >> 24), (Uint8)(color >> 16), (Uint8)(color >> 8), (Uint8)color);
+			batch.fillRect((float)r.x, (float)r.y, (float)r.w, (float)r.h);
+		}
+
+		// Rect outline 'thickness' pixels wide, inside 'rect'.
+		void drawFrame(const SDL_Rect& rect, Uint32 color, int thickness = 1)
+		{
+			if (rect.w <= 2*thickness || rect.h <= 2*thickness)
+			{
+				fillRect(rect, color);
+				return;
+			}
+
+			SDL_Rect top = {rect.x, rect.y, rect.w, thickness};
+			SDL_Rect bottom = {rect.x, rect.y + rect.h - thickness, rect.w, thickness};
+			SDL_Rect left = {rect.x, rect.y + thickness, thickness, rect.h - 2*thickness};
+			SDL_Rect right = {rect.x + rect.w - thickness, rect.y + thickness, thickness, rect.h - 2*thickness};
+
+			fillRect(top, color);
+			fillRect(bottom, color);
+			fillRect(left, color);
+			fillRect(right, color);
+		}
+
+		// Text box top-left at 'x', 'y'.
+		void drawText(const char* text, int x, int y, const TextStyle& style, Uint32 color)
+		{
+			if (textBatch != 0 && textCache != 0 && (color & 0xFF) != 0)
+			{
+				textBatch->draw(*textCache, text, x, y, style, color, &clip);
+			}
+		}
+
+	private:
+
+		Batch2D& batch;
+
+		TextBatch* textBatch;
+
+		TextCache* textCache;
+
+		SDL_Rect clip;
+
+
+		GuiPainter& operator = (const GuiPainter&);
+	};
+}
@@ -0,0 +1,851 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "SDL_rect.h"
+
+#include "../core/h2_memory.h"
+#include "h2_gui_painter.h"
+
+
+
+#define H2_GUI_MAX_DIRTY_RECTS 16   // more are collapsed into their bounds
+
+
+
+
+namespace h2
+{
+	class Widget;
+
+
+	enum GuiLayout
+	{
+		GUI_LAYOUT_ABSOLUTE,     // children at their own position and preferred size
+		GUI_LAYOUT_VERTICAL,     // stacked top to bottom, stretched horizontally
+		GUI_LAYOUT_HORIZONTAL    // stacked left to right, stretched vertically
+	};
+
+
+	typedef void (*GuiCallback)(Widget* sender, void* userdata);
+
+
+	// Screen regions that must be repainted. Overlapping rects are merged
+	// as they are added.
+	class GuiDirtyRegion
+	{
+	public:
+
+		// Methods
+
+		void add(SDL_Rect r)
+		{
+			if (r.w <= 0 || r.h <= 0)
+			{
+				return;
+			}
+
+			SDL_Rect common;
+			for (unsigned int i = 0; i < rects.size(); )
+			{
+				if (intersectGuiRect(r, rects[i], &common))
+				{
+					r = uniteGuiRect(r, rects[i]);
+					rects[i] = rects.back();
+					rects.pop_back();
+					i = 0;
+				} else
+				{
+					i++;
+				}
+			}
+
+			rects.push_back(r);
+
+			if (rects.size() > H2_GUI_MAX_DIRTY_RECTS)
+			{
+				SDL_Rect bounds = rects[0];
+				for (unsigned int i = 1; i < rects.size(); i++)
+				{
+					bounds = uniteGuiRect(bounds, rects[i]);
+				}
+				rects.clear();
+				rects.push_back(bounds);
+			}
+		}
+
+		inline void clear() { rects.clear(); }
+
+		inline bool isEmpty() const { return rects.empty(); }
+
+		inline unsigned int getCount() const { return (unsigned int)rects.size(); }
+
+		inline const SDL_Rect& getRect(unsigned int i) const { return rects[i]; }
+
+		unsigned int getArea() const
+		{
+			unsigned int area = 0;
+			for (unsigned int i = 0; i < rects.size(); i++)
+			{
+				area += rects[i].w*rects[i].h;
+			}
+			return area;
+		}
+
+	private:
+
+		TaggedVector<SDL_Rect, MEMORY_TAG_GUI>::Type rects;
+	};
+
+
+	// Work done by the last Gui update, for profiling.
+	struct GuiStats
+	{
+		unsigned int nMeasured;
+		unsigned int nArranged;
+		unsigned int nPainted;
+		unsigned int nDirtyRects;
+		unsigned int dirtyArea;
+		int nDrawCalls;
+	};
+
+
+	// State shared by all widgets of one Gui.
+	struct GuiContext
+	{
+		GuiDirtyRegion dirty;
+		GuiStats stats;
+
+		Widget* hovered;    // widget under the mouse
+		Widget* captured;   // widget holding the pressed mouse button
+
+		TextCache* text;    // 0 when the Gui has no text
+
+		GuiContext() : hovered(0), captured(0), text(0)
+		{
+			memset(&stats, 0, sizeof(stats));
+		}
+	};
+
+
+	// Node of the retained widget tree. Owns its children.
+	//
+	// Layout is cached: 'measure()' recomputes desired size only for
+	// widgets marked by 'invalidateLayout()' (which also marks the
+	// ancestors, whose size may depend on it), and 'arrange()' skips
+	// subtrees whose rect did not change and that hold no dirty widget.
+	// Any visual change calls 'invalidatePaint()', which hands the
+	// widget rect to the Gui as a dirty region.
+	class Widget
+	{
+	public:
+
+		// Constructors
+
+		Widget() : context(0), parent(0), layout(GUI_LAYOUT_VERTICAL), padding(0), spacing(0),
+				   background(0), border(0), visible(true), layoutDirty(true), subtreeDirty(true)
+		{
+			rect.x = rect.y = rect.w = rect.h = 0;
+			position.x = position.y = 0;
+			preferred.x = preferred.y = 0;
+			desired.x = desired.y = 0;
+		}
+
+
+		// Destructor
+
+		virtual ~Widget()
+		{
+			for (unsigned int i = 0; i < children.size(); i++)
+			{
+				delete children[i];
+			}
+		}
+
+
+		// Methods
+
+		// Takes ownership of 'child'.
+		void addChild(Widget* child)
+		{
+			child->parent = this;
+			child->attach(context);
+			children.push_back(child);
+			invalidateLayout();
+		}
+
+		// Detaches 'child' and gives ownership back to the caller.
+		Widget* removeChild(Widget* child)
+		{
+			WidgetList::iterator it = std::find(children.begin(), children.end(), child);
+			if (it == children.end())
+			{
+				return 0;
+			}
+
+			child->invalidatePaint();
+			children.erase(it);
+			child->parent = 0;
+			child->attach(0);
+			invalidateLayout();
+
+			return child;
+		}
+
+		inline unsigned int getChildCount() const { return (unsigned int)children.size(); }
+
+		inline Widget* getChild(unsigned int i) const { return children[i]; }
+
+		inline Widget* getParent() const { return parent; }
+
+		inline const SDL_Rect& getRect() const { return rect; }
+
+		inline bool isVisible() const { return visible; }
+
+		inline int getPadding() const { return padding; }
+
+		void setLayout(GuiLayout in_layout)
+		{
+			layout = in_layout;
+			invalidateLayout();
+		}
+
+		void setPadding(int in_padding)
+		{
+			padding = in_padding;
+			invalidateLayout();
+		}
+
+		void setSpacing(int in_spacing)
+		{
+			spacing = in_spacing;
+			invalidateLayout();
+		}
+
+		// 0 means size from content.
+		void setPreferredSize(int w, int h)
+		{
+			preferred.x = w;
+			preferred.y = h;
+			invalidateLayout();
+		}
+
+		// Offset inside parent with GUI_LAYOUT_ABSOLUTE.
+		void setPosition(int x, int y)
+		{
+			position.x = x;
+			position.y = y;
+			invalidateLayout();
+		}
+
+		void setVisible(bool in_visible)
+		{
+			if (visible != in_visible)
+			{
+				// the rect is repainted while the widget is visible: before
+				// hiding, after showing
+				if (visible)
+				{
+					invalidatePaint();
+					visible = false;
+				} else
+				{
+					visible = true;
+					invalidatePaint();
+				}
+				invalidateLayout();
+			}
+		}
+
+		// Colors are packed with packRenderColor(), alpha 0 draws nothing.
+		void setBackground(Uint32 color)
+		{
+			background = color;
+			invalidatePaint();
+		}
+
+		void setBorder(Uint32 color)
+		{
+			border = color;
+			invalidatePaint();
+		}
+
+		// Marks desired size stale up to the root. Stops at the first
+		// ancestor that is already dirty, its ancestors are too.
+		void invalidateLayout()
+		{
+			for (Widget* w = this; w != 0; w = w->parent)
+			{
+				if (w != this && w->layoutDirty)
+				{
+					break;
+				}
+				w->layoutDirty = true;
+				w->subtreeDirty = true;
+			}
+		}
+
+		inline void invalidatePaint()
+		{
+			if (context != 0 && visible)
+			{
+				context->dirty.add(rect);
+			}
+		}
+
+		// Desired size, recomputed only when layout is dirty.
+		const SDL_Point& measure()
+		{
+			if (!layoutDirty)
+			{
+				return desired;
+			}
+
+			if (context != 0)
+			{
+				context->stats.nMeasured++;
+			}
+
+			SDL_Point size = measureContent();
+			int mainSum = 0, crossMax = 0, nVisible = 0;
+
+			for (unsigned int i = 0; i < children.size(); i++)
+			{
+				Widget* child = children[i];
+				const SDL_Point& c = child->measure();
+
+				if (!child->visible)
+				{
+					continue;
+				}
+
+				if (layout == GUI_LAYOUT_VERTICAL)
+				{
+					mainSum += c.y;
+					crossMax = c.x > crossMax ? c.x : crossMax;
+				} else if (layout == GUI_LAYOUT_HORIZONTAL)
+				{
+					mainSum += c.x;
+					crossMax = c.y > crossMax ? c.y : crossMax;
+				} else
+				{
+					size.x = (child->position.x + c.x > size.x) ? child->position.x + c.x : size.x;
+					size.y = (child->position.y + c.y > size.y) ? child->position.y + c.y : size.y;
+				}
+				nVisible++;
+			}
+
+			if (nVisible > 1)
+			{
+				mainSum += spacing*(nVisible - 1);
+			}
+
+			if (layout == GUI_LAYOUT_VERTICAL)
+			{
+				size.x = crossMax > size.x ? crossMax : size.x;
+				size.y += mainSum;
+			} else if (layout == GUI_LAYOUT_HORIZONTAL)
+			{
+				size.x += mainSum;
+				size.y = crossMax > size.y ? crossMax : size.y;
+			}
+
+			desired.x = (preferred.x > 0) ? preferred.x : size.x + 2*padding;
+			desired.y = (preferred.y > 0) ? preferred.y : size.y + 2*padding;
+
+			layoutDirty = false;
+
+			return desired;
+		}
+
+		// Places widget and its children, skipping clean subtrees.
+		void arrange(const SDL_Rect& in_rect)
+		{
+			bool moved = (in_rect.x != rect.x || in_rect.y != rect.y || in_rect.w != rect.w || in_rect.h != rect.h);
+
+			if (!moved && !subtreeDirty)
+			{
+				return;
+			}
+
+			if (context != 0)
+			{
+				context->stats.nArranged++;
+			}
+
+			if (moved)
+			{
+				invalidatePaint();
+				rect = in_rect;
+				invalidatePaint();
+			}
+
+			int x = rect.x + padding;
+			int y = rect.y + padding;
+			int innerW = rect.w - 2*padding;
+			int innerH = rect.h - 2*padding;
+
+			for (unsigned int i = 0; i < children.size(); i++)
+			{
+				Widget* child = children[i];
+				if (!child->visible)
+				{
+					child->subtreeDirty = false;
+					continue;
+				}
+
+				const SDL_Point& c = child->measure();
+				SDL_Rect r;
+
+				if (layout == GUI_LAYOUT_VERTICAL)
+				{
+					r.x = x;
+					r.y = y;
+					r.w = innerW;
+					r.h = c.y;
+					y += c.y + spacing;
+				} else if (layout == GUI_LAYOUT_HORIZONTAL)
+				{
+					r.x = x;
+					r.y = y;
+					r.w = c.x;
+					r.h = innerH;
+					x += c.x + spacing;
+				} else
+				{
+					r.x = rect.x + child->position.x;
+					r.y = rect.y + child->position.y;
+					r.w = c.x;
+					r.h = c.y;
+				}
+
+				child->arrange(r);
+			}
+
+			subtreeDirty = false;
+		}
+
+		// Paints widgets intersecting 'clip', back to front.
+		void paintTree(GuiPainter& painter, const SDL_Rect& clip)
+		{
+			SDL_Rect common;
+			if (!visible || !intersectGuiRect(rect, clip, &common))
+			{
+				return;
+			}
+
+			if (context != 0)
+			{
+				context->stats.nPainted++;
+			}
+
+			paint(painter);
+
+			for (unsigned int i = 0; i < children.size(); i++)
+			{
+				children[i]->paintTree(painter, clip);
+			}
+		}
+
+		// Topmost visible widget under the point, or 0.
+		Widget* hitTest(int x, int y)
+		{
+			if (!visible || x < rect.x || y < rect.y || x >= rect.x + rect.w || y >= rect.y + rect.h)
+			{
+				return 0;
+			}
+
+			for (unsigned int i = (unsigned int)children.size(); i-- > 0; )
+			{
+				Widget* hit = children[i]->hitTest(x, y);
+				if (hit != 0)
+				{
+					return hit;
+				}
+			}
+
+			return this;
+		}
+
+		// Input, called by Gui for the widget under the mouse.
+		virtual void onMouseEnter() {}
+		virtual void onMouseLeave() {}
+		virtual void onMouseDown(int x, int y) { (void)x; (void)y; }
+		virtual void onMouseUp(int x, int y, bool inside) { (void)x; (void)y; (void)inside; }
+		virtual void onMouseMove(int x, int y) { (void)x; (void)y; }
+
+	protected:
+
+		GuiContext* context;
+
+		// Size of own content without children, e.g. text.
+		virtual SDL_Point measureContent()
+		{
+			SDL_Point p = {0, 0};
+			return p;
+		}
+
+		// Draws the widget itself; children are drawn after.
+		virtual void paint(GuiPainter& painter)
+		{
+			painter.fillRect(rect, background);
+			if ((border & 0xFF) != 0)
+			{
+				painter.drawFrame(rect, border);
+			}
+		}
+
+		// Called when the widget joins or leaves a Gui.
+		virtual void onAttach() {}
+
+	private:
+
+		typedef TaggedVector<Widget*, MEMORY_TAG_GUI>::Type WidgetList;
+
+		Widget* parent;
+
+		WidgetList children;
+
+		GuiLayout layout;
+
+		int padding, spacing;
+
+		Uint32 background, border;
+
+		bool visible;
+
+		bool layoutDirty;    // desired size must be measured again
+		bool subtreeDirty;   // this widget or a descendant needs arrange
+
+		SDL_Rect rect;
+		SDL_Point position;
+		SDL_Point preferred;
+		SDL_Point desired;
+
+
+		Widget(const Widget&);
+		Widget& operator = (const Widget&);
+
+		// Measures every widget again, e.g. when text metrics change.
+		void invalidateTree()
+		{
+			layoutDirty = true;
+			subtreeDirty = true;
+
+			for (unsigned int i = 0; i < children.size(); i++)
+			{
+				children[i]->invalidateTree();
+			}
+		}
+
+		void attach(GuiContext* in_context)
+		{
+			// detached widgets must not stay referenced by input routing
+			if (context != 0 && context != in_context)
+			{
+				if (context->hovered == this)
+				{
+					context->hovered = 0;
+				}
+				if (context->captured == this)
+				{
+					context->captured = 0;
+				}
+			}
+
+			context = in_context;
+			onAttach();
+
+			for (unsigned int i = 0; i < children.size(); i++)
+			{
+				children[i]->attach(in_context);
+			}
+		}
+
+		friend class Gui;
+	};
+
+
+	// Single line or wrapped text. Changing the text only relayouts the
+	// tree when its measured size changes.
+	class Label : public Widget
+	{
+	public:
+
+		// Constructors
+
+		Label(const char* in_text = "") : text(in_text), color(packRenderColor(220, 220, 220, 255))
+		{
+			textSize.x = textSize.y = 0;
+		}
+
+
+		// Methods
+
+		void setText(const char* in_text)
+		{
+			if (text == in_text)
+			{
+				return;
+			}
+
+			text = in_text;
+			invalidatePaint();
+
+			if (context != 0 && context->text != 0)
+			{
+				SDL_Point size = context->text->measure(text.c_str(), style);
+				if (size.x == textSize.x && size.y == textSize.y)
+				{
+					return;
+				}
+			}
+
+			invalidateLayout();
+		}
+
+		inline const std::string& getText() const { return text; }
+
+		void setStyle(const TextStyle& in_style)
+		{
+			style = in_style;
+			invalidatePaint();
+			invalidateLayout();
+		}
+
+		void setColor(Uint32 in_color)
+		{
+			color = in_color;
+			invalidatePaint();
+		}
+
+	protected:
+
+		virtual SDL_Point measureContent()
+		{
+			textSize.x = textSize.y = 0;
+			if (context != 0 && context->text != 0)
+			{
+				textSize = context->text->measure(text.c_str(), style);
+			}
+			return textSize;
+		}
+
+		virtual void paint(GuiPainter& painter)
+		{
+			Widget::paint(painter);
+
+			// text longer than the label must not spill onto its neighbours
+			SDL_Rect clip = painter.getClip();
+			SDL_Rect inside;
+			if (!intersectGuiRect(getRect(), clip, &inside))
+			{
+				return;
+			}
+
+			painter.setClip(inside);
+			painter.drawText(text.c_str(), getRect().x + getPadding(), getRect().y + getPadding(), style, color);
+			painter.setClip(clip);
+		}
+
+	private:
+
+		std::string text;
+
+		TextStyle style;
+
+		Uint32 color;
+
+		SDL_Point textSize;
+	};
+
+
+	// Push button with hover and pressed states and optional centered text.
+	class Button : public Widget
+	{
+	public:
+
+		// Constructors
+
+		Button() : callback(0), userdata(0), hovered(false), pressed(false),
+				   normalColor(packRenderColor(60, 60, 70, 255)),
+				   hoverColor(packRenderColor(80, 80, 95, 255)),
+				   pressedColor(packRenderColor(40, 40, 50, 255)),
+				   textColor(packRenderColor(230, 230, 230, 255))
+		{
+			textSize.x = textSize.y = 0;
+			setBorder(packRenderColor(120, 120, 140, 255));
+			setPadding(4);
+		}
+
+
+		// Methods
+
+		inline void setCallback(GuiCallback in_callback, void* in_userdata)
+		{
+			callback = in_callback;
+			userdata = in_userdata;
+		}
+
+		void setText(const char* in_text)
+		{
+			if (text != in_text)
+			{
+				text = in_text;
+				invalidatePaint();
+				invalidateLayout();
+			}
+		}
+
+		void setColors(Uint32 normal, Uint32 hover, Uint32 down)
+		{
+			normalColor = normal;
+			hoverColor = hover;
+			pressedColor = down;
+			invalidatePaint();
+		}
+
+		virtual void onMouseEnter()
+		{
+			hovered = true;
+			invalidatePaint();
+		}
+
+		virtual void onMouseLeave()
+		{
+			hovered = false;
+			invalidatePaint();
+		}
+
+		virtual void onMouseDown(int, int)
+		{
+			pressed = true;
+			invalidatePaint();
+		}
+
+		virtual void onMouseUp(int, int, bool inside)
+		{
+			pressed = false;
+			invalidatePaint();
+
+			if (inside && callback != 0)
+			{
+				callback(this, userdata);
+			}
+		}
+
+	protected:
+
+		virtual SDL_Point measureContent()
+		{
+			textSize.x = textSize.y = 0;
+			if (context != 0 && context->text != 0 && !text.empty())
+			{
+				textSize = context->text->measure(text.c_str(), style);
+			}
+			return textSize;
+		}
+
+		virtual void paint(GuiPainter& painter)
+		{
+			const SDL_Rect& r = getRect();
+
+			Uint32 color = pressed ? pressedColor : (hovered ? hoverColor : normalColor);
+			painter.fillRect(r, color);
+			Widget::paint(painter);
+
+			if (!text.empty())
+			{
+				painter.drawText(text.c_str(), r.x + (r.w - textSize.x)/2, r.y + (r.h - textSize.y)/2, style, textColor);
+			}
+		}
+
+	private:
+
+		GuiCallback callback;
+
+		void* userdata;
+
+		bool hovered, pressed;
+
+		Uint32 normalColor, hoverColor, pressedColor;
+
+		std::string text;
+
+		TextStyle style;
+
+		Uint32 textColor;
+
+		SDL_Point textSize;
+	};
+
+
+	// Horizontal bar filled to 'value' in [0, 1]. Changing the value only
+	// repaints, it never affects layout.
+	class ProgressBar : public Widget
+	{
+	public:
+
+		// Constructors
+
+		ProgressBar() : value(0.0f), fillColor(packRenderColor(70, 160, 90, 255))
+		{
+			setBackground(packRenderColor(30, 30, 35, 255));
+			setBorder(packRenderColor(90, 90, 100, 255));
+			setPreferredSize(0, 12);
+		}
+
+
+		// Methods
+
+		void setValue(float in_value)
+		{
+			in_value = in_value < 0.0f ? 0.0f : (in_value > 1.0f ? 1.0f : in_value);
+
+			// repaint only when the filled width changes
+			if (fillWidth(in_value) != fillWidth(value))
+			{
+				invalidatePaint();
+			}
+			value = in_value;
+		}
+
+		inline float getValue() const { return value; }
+
+		void setFillColor(Uint32 color)
+		{
+			fillColor = color;
+			invalidatePaint();
+		}
+
+	protected:
+
+		virtual void paint(GuiPainter& painter)
+		{
+			Widget::paint(painter);
+
+			SDL_Rect fill = getRect();
+			fill.x += 1;
+			fill.y += 1;
+			fill.h -= 2;
+			fill.w = fillWidth(value);
+
+			painter.fillRect(fill, fillColor);
+		}
+
+	private:
+
+		float value;
+
+		Uint32 fillColor;
+
+
+		inline int fillWidth(float v) const
+		{
+			return (int)((getRect().w - 2)*v);
+		}
+	};
+}
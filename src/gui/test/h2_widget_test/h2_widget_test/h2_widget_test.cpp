@@ -0,0 +1,72 @@
+// Checks of Gui dirty-rect repaint, drawn with SDL's software renderer
+// so no window is needed.
+//
+// Linux:
+//   g++ -O2 -I../../../../sdl/include h2_widget_test.cpp -o h2_widget_test -lSDL2
+
+#include <cstdio>
+
+#include "SDL_error.h"
+#include "SDL_render.h"
+#include "SDL_surface.h"
+
+#include "../../../h2_gui.h"
+#include "../../../../test/h2_test.h"
+
+
+
+#define TEST_WIDTH 200
+#define TEST_HEIGHT 200
+
+
+using namespace h2;
+
+
+static const GuiStats& frame(Gui& gui, SDL_Renderer* renderer)
+{
+	gui.layout();
+	gui.render(renderer);
+
+	return gui.getStats();
+}
+
+
+int main(int, char*[])
+{
+	SDL_Surface* surface = SDL_CreateRGBSurface(0, TEST_WIDTH, TEST_HEIGHT, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+	SDL_Renderer* renderer = surface != 0 ? SDL_CreateSoftwareRenderer(surface) : 0;
+	if (renderer == 0)
+	{
+		printf("no software renderer: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	{
+		Gui gui;
+		gui.setSize(TEST_WIDTH, TEST_HEIGHT);
+
+		Widget* panel = new Widget();
+		panel->setPosition(10, 10);
+		panel->setPreferredSize(50, 50);
+		panel->setBackground(packRenderColor(255, 0, 0, 255));
+		gui.getRoot()->addChild(panel);
+
+		frame(gui, renderer);
+		const GuiStats& idle = frame(gui, renderer);
+		check(idle.nDirtyRects == 0 && idle.nPainted == 0, "nothing repainted while idle");
+
+		panel->setVisible(false);
+		const GuiStats& hidden = frame(gui, renderer);
+		check(hidden.nDirtyRects == 1 && hidden.dirtyArea == 50*50, "hiding repaints the widget rect");
+
+		panel->setVisible(true);
+		const GuiStats& shown = frame(gui, renderer);
+		check(shown.nDirtyRects == 1 && shown.dirtyArea == 50*50 && shown.nPainted > 0,
+			  "showing at the same rect repaints it");
+	}
+
+	SDL_DestroyRenderer(renderer);
+	SDL_FreeSurface(surface);
+
+	return endChecks();
+}
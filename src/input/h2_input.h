@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstring>
+
+#include "SDL_stdinc.h"
+
+
+
+#define H2_INPUT_MAX_KEYS         512   // matches SDL_NUM_SCANCODES
+#define H2_INPUT_MAX_MOUSE_BUTTONS  8
+#define H2_INPUT_MAX_GAMEPADS       4
+#define H2_INPUT_MAX_PAD_AXES       8
+#define H2_INPUT_MAX_PAD_BUTTONS   16
+
+
+
+
+namespace h2
+{
+	// Bit set of keys or buttons currently held.
+	template <unsigned int nBits>
+	class InputBits
+	{
+	public:
+
+		// Constructors
+
+		InputBits()
+		{
+			clear();
+		}
+
+
+		// Methods
+
+		inline void clear()
+		{
+			memset(words, 0, sizeof(words));
+		}
+
+		inline void set(unsigned int bit, bool value)
+		{
+			if (bit >= nBits)
+			{
+				return;
+			}
+
+			if (value)
+			{
+				words[bit >> 5] |= (1u << (bit & 31));
+			} else
+			{
+				words[bit >> 5] &= ~(1u << (bit & 31));
+			}
+		}
+
+		inline bool get(unsigned int bit) const
+		{
+			return bit < nBits && (words[bit >> 5] & (1u << (bit & 31))) != 0;
+		}
+
+	private:
+
+		Uint32 words[(nBits + 31)/32];
+	};
+
+
+	struct KeyboardState
+	{
+		InputBits<H2_INPUT_MAX_KEYS> down;
+		InputBits<H2_INPUT_MAX_KEYS> pressed;    // went down during the frame
+		InputBits<H2_INPUT_MAX_KEYS> released;   // went up during the frame
+
+		inline bool isDown(unsigned int key) const { return down.get(key); }
+
+		inline bool isPressed(unsigned int key) const { return pressed.get(key); }
+
+		inline bool isReleased(unsigned int key) const { return released.get(key); }
+	};
+
+
+	struct MouseState
+	{
+		int x, y;
+		int dx, dy;           // motion accumulated during the frame
+		int wheelX, wheelY;   // wheel accumulated during the frame
+
+		InputBits<H2_INPUT_MAX_MOUSE_BUTTONS> down;
+		InputBits<H2_INPUT_MAX_MOUSE_BUTTONS> pressed;
+		InputBits<H2_INPUT_MAX_MOUSE_BUTTONS> released;
+
+		MouseState() : x(0), y(0), dx(0), dy(0), wheelX(0), wheelY(0) {}
+	};
+
+
+	struct GamepadState
+	{
+		bool connected;
+		Sint32 instanceId;
+
+		float axes[H2_INPUT_MAX_PAD_AXES];   // [-1, 1]
+
+		InputBits<H2_INPUT_MAX_PAD_BUTTONS> down;
+		InputBits<H2_INPUT_MAX_PAD_BUTTONS> pressed;
+		InputBits<H2_INPUT_MAX_PAD_BUTTONS> released;
+
+		GamepadState() : connected(false), instanceId(-1)
+		{
+			memset(axes, 0, sizeof(axes));
+		}
+	};
+
+
+	// Immutable view of all input devices for one frame. Timestamps are
+	// SDL performance counter values taken when the event was queued.
+	struct InputSnapshot
+	{
+		Uint64 frameIndex;
+
+		KeyboardState keyboard;
+		MouseState mouse;
+		GamepadState gamepads[H2_INPUT_MAX_GAMEPADS];
+
+		bool quit;
+
+		unsigned int nEvents;     // events consumed by this frame
+		unsigned int nDropped;    // events lost because ring was full
+
+		Uint64 oldestEventTime;   // 0 when frame has no events
+		Uint64 newestEventTime;
+
+		InputSnapshot() : frameIndex(0), quit(false), nEvents(0), nDropped(0), oldestEventTime(0), newestEventTime(0) {}
+
+		// Clears per-frame edges and accumulators, keeps held state.
+		void beginFrame(Uint64 index)
+		{
+			frameIndex = index;
+
+			keyboard.pressed.clear();
+			keyboard.released.clear();
+
+			mouse.dx = mouse.dy = 0;
+			mouse.wheelX = mouse.wheelY = 0;
+			mouse.pressed.clear();
+			mouse.released.clear();
+
+			for (unsigned int i = 0; i < H2_INPUT_MAX_GAMEPADS; i++)
+			{
+				gamepads[i].pressed.clear();
+				gamepads[i].released.clear();
+			}
+
+			nEvents = 0;
+			nDropped = 0;
+			oldestEventTime = 0;
+			newestEventTime = 0;
+		}
+	};
+}
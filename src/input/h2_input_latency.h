@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "SDL_timer.h"
+
+#include "../core/h2_memory.h"
+#include "h2_input.h"
+
+
+
+#define H2_LATENCY_HISTORY        4096   // frames kept for rolling percentiles and CSV
+#define H2_LATENCY_BUCKET_MS      0.25f
+#define H2_LATENCY_BUCKETS        800    // 0..200 ms, last bucket collects the rest
+
+
+
+
+namespace h2
+{
+	struct LatencySample
+	{
+		Uint64 frameIndex;
+		unsigned int nEvents;
+		Uint64 presentTime;
+		float oldestMs;   // oldest event of the frame to present
+		float newestMs;   // newest event of the frame to present
+	};
+
+
+	struct LatencyStats
+	{
+		unsigned int nFrames;   // frames with input in the window
+		float p50, p99, max, mean;
+	};
+
+
+	// Measures input-to-present latency.
+	//
+	// 'beginFrame()' tags the frame with the snapshot it consumes,
+	// 'present()' is called right after SDL_RenderPresent (or after a
+	// software backend finished presenting). Frames without input events
+	// are not recorded. Percentiles are exact over the last
+	// H2_LATENCY_HISTORY frames; the histogram covers the whole session.
+	class InputLatencyTracker
+	{
+	public:
+
+		// Constructors
+
+		InputLatencyTracker() : history(H2_LATENCY_HISTORY), nSamples(0), next(0),
+								frameIndex(0), nEvents(0), oldestTime(0), newestTime(0)
+		{
+			invFrequency = 1000.0/(double)SDL_GetPerformanceFrequency();
+			resetHistogram();
+		}
+
+
+		// Methods
+
+		void beginFrame(const InputSnapshot& snapshot)
+		{
+			frameIndex = snapshot.frameIndex;
+			nEvents = snapshot.nEvents;
+			oldestTime = snapshot.oldestEventTime;
+			newestTime = snapshot.newestEventTime;
+		}
+
+		void present()
+		{
+			present(SDL_GetPerformanceCounter());
+		}
+
+		void present(Uint64 presentTime)
+		{
+			if (nEvents == 0)
+			{
+				return;
+			}
+
+			LatencySample& s = history[next];
+			s.frameIndex = frameIndex;
+			s.nEvents = nEvents;
+			s.presentTime = presentTime;
+			s.oldestMs = toMs(presentTime - oldestTime);
+			s.newestMs = toMs(presentTime - newestTime);
+
+			next = (next + 1) % H2_LATENCY_HISTORY;
+			if (nSamples < H2_LATENCY_HISTORY)
+			{
+				nSamples++;
+			}
+
+			unsigned int bucket = (unsigned int)(s.oldestMs/H2_LATENCY_BUCKET_MS);
+			histogram[bucket < H2_LATENCY_BUCKETS ? bucket : H2_LATENCY_BUCKETS - 1]++;
+
+			nEvents = 0;
+		}
+
+		// Oldest-event latency statistics over the rolling window.
+		LatencyStats getStats()
+		{
+			LatencyStats stats;
+			stats.nFrames = nSamples;
+			stats.p50 = stats.p99 = stats.max = stats.mean = 0;
+
+			if (nSamples == 0)
+			{
+				return stats;
+			}
+
+			sorted.resize(nSamples);
+			double sum = 0;
+			for (unsigned int i = 0; i < nSamples; i++)
+			{
+				sorted[i] = history[i].oldestMs;
+				sum += sorted[i];
+			}
+
+			std::sort(sorted.begin(), sorted.end());
+
+			stats.p50 = sorted[(nSamples - 1)/2];
+			stats.p99 = sorted[(unsigned int)((nSamples - 1)*0.99f)];
+			stats.max = sorted[nSamples - 1];
+			stats.mean = (float)(sum/nSamples);
+
+			return stats;
+		}
+
+		// Session histogram, bucket i covers [i, i + 1)*H2_LATENCY_BUCKET_MS.
+		inline const unsigned int* getHistogram() const
+		{
+			return histogram;
+		}
+
+		void resetHistogram()
+		{
+			for (unsigned int i = 0; i < H2_LATENCY_BUCKETS; i++)
+			{
+				histogram[i] = 0;
+			}
+		}
+
+		// Writes rolling window, oldest frame first. Returns false if
+		// file could not be opened.
+		bool dumpCsv(const char* path) const
+		{
+			FILE* file = fopen(path, "w");
+
+			if (file == 0)
+			{
+				return false;
+			}
+
+			fprintf(file, "frame,events,present_ticks,oldest_ms,newest_ms\n");
+
+			unsigned int first = (nSamples < H2_LATENCY_HISTORY) ? 0 : next;
+
+			for (unsigned int i = 0; i < nSamples; i++)
+			{
+				const LatencySample& s = history[(first + i) % H2_LATENCY_HISTORY];
+				fprintf(file, "%llu,%u,%llu,%.3f,%.3f\n", (unsigned long long)s.frameIndex, s.nEvents,
+						(unsigned long long)s.presentTime, s.oldestMs, s.newestMs);
+			}
+
+			fclose(file);
+
+			return true;
+		}
+
+	private:
+
+		TaggedVector<LatencySample, MEMORY_TAG_INPUT>::Type history;
+
+		TaggedVector<float, MEMORY_TAG_INPUT>::Type sorted;
+
+		unsigned int histogram[H2_LATENCY_BUCKETS];
+
+		unsigned int nSamples, next;
+
+		double invFrequency;
+
+		Uint64 frameIndex;
+
+		unsigned int nEvents;
+
+		Uint64 oldestTime, newestTime;
+
+
+		inline float toMs(Uint64 ticks) const
+		{
+			return (float)(ticks*invFrequency);
+		}
+	};
+}
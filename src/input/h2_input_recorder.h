@@ -0,0 +1,424 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "SDL_events.h"
+
+#include "../core/h2_memory.h"
+
+
+
+#define H2_INPUT_LOG_VERSION 1
+
+
+
+
+namespace h2
+{
+	// Binary input log layout:
+	//
+	//   'H' '2' 'I' 'R' version
+	//   records: varint frame delta, u8 kind, kind-specific payload
+	//   last record is INPUT_LOG_END at the final recorded frame
+	//
+	// Integers are LEB128 varints, signed values are zigzag encoded.
+	// Only events that affect InputSnapshot are stored; window and
+	// other system events are skipped.
+	enum InputLogKind
+	{
+		INPUT_LOG_END,
+		INPUT_LOG_QUIT,
+		INPUT_LOG_KEY_DOWN,
+		INPUT_LOG_KEY_UP,
+		INPUT_LOG_MOUSE_MOTION,
+		INPUT_LOG_MOUSE_DOWN,
+		INPUT_LOG_MOUSE_UP,
+		INPUT_LOG_MOUSE_WHEEL,
+		INPUT_LOG_PAD_ADDED,     // 'which' is instance id, not device index
+		INPUT_LOG_PAD_REMOVED,
+		INPUT_LOG_PAD_AXIS,
+		INPUT_LOG_PAD_DOWN,
+		INPUT_LOG_PAD_UP
+	};
+
+
+	// Records events consumed by InputSDL with frame indices.
+	class InputRecorder
+	{
+	public:
+
+		// Constructors
+
+		InputRecorder() : lastFrame(0), recording(false) {}
+
+
+		// Methods
+
+		void begin(Uint64 frameIndex)
+		{
+			data.clear();
+			data.push_back('H');
+			data.push_back('2');
+			data.push_back('I');
+			data.push_back('R');
+			data.push_back(H2_INPUT_LOG_VERSION);
+
+			lastFrame = frameIndex;
+			recording = true;
+		}
+
+		inline bool isRecording() const { return recording; }
+
+		inline unsigned int size() const { return (unsigned int)data.size(); }
+
+		void record(Uint64 frameIndex, const SDL_Event& ev)
+		{
+			if (!recording)
+			{
+				return;
+			}
+
+			switch (ev.type)
+			{
+			case SDL_QUIT:
+				header(frameIndex, INPUT_LOG_QUIT);
+				break;
+
+			case SDL_KEYDOWN:
+			case SDL_KEYUP:
+				header(frameIndex, ev.type == SDL_KEYDOWN ? INPUT_LOG_KEY_DOWN : INPUT_LOG_KEY_UP);
+				putUint(ev.key.keysym.scancode);
+				data.push_back(ev.key.repeat);
+				break;
+
+			case SDL_MOUSEMOTION:
+				header(frameIndex, INPUT_LOG_MOUSE_MOTION);
+				putInt(ev.motion.x);
+				putInt(ev.motion.y);
+				putInt(ev.motion.xrel);
+				putInt(ev.motion.yrel);
+				break;
+
+			case SDL_MOUSEBUTTONDOWN:
+			case SDL_MOUSEBUTTONUP:
+				header(frameIndex, ev.type == SDL_MOUSEBUTTONDOWN ? INPUT_LOG_MOUSE_DOWN : INPUT_LOG_MOUSE_UP);
+				data.push_back(ev.button.button);
+				putInt(ev.button.x);
+				putInt(ev.button.y);
+				break;
+
+			case SDL_MOUSEWHEEL:
+				header(frameIndex, INPUT_LOG_MOUSE_WHEEL);
+				putInt(ev.wheel.x);
+				putInt(ev.wheel.y);
+				break;
+
+			case SDL_CONTROLLERDEVICEADDED:
+			case SDL_CONTROLLERDEVICEREMOVED:
+				header(frameIndex, ev.type == SDL_CONTROLLERDEVICEADDED ? INPUT_LOG_PAD_ADDED : INPUT_LOG_PAD_REMOVED);
+				putInt(ev.cdevice.which);
+				break;
+
+			case SDL_CONTROLLERAXISMOTION:
+				header(frameIndex, INPUT_LOG_PAD_AXIS);
+				putInt(ev.caxis.which);
+				data.push_back(ev.caxis.axis);
+				putInt(ev.caxis.value);
+				break;
+
+			case SDL_CONTROLLERBUTTONDOWN:
+			case SDL_CONTROLLERBUTTONUP:
+				header(frameIndex, ev.type == SDL_CONTROLLERBUTTONDOWN ? INPUT_LOG_PAD_DOWN : INPUT_LOG_PAD_UP);
+				putInt(ev.cbutton.which);
+				data.push_back(ev.cbutton.button);
+				break;
+			}
+		}
+
+		// Closes log at 'frameIndex', so replay lasts exactly as long as recording.
+		void end(Uint64 frameIndex)
+		{
+			if (!recording)
+			{
+				return;
+			}
+
+			header(frameIndex, INPUT_LOG_END);
+			recording = false;
+		}
+
+		bool save(const char* path) const
+		{
+			FILE* file = fopen(path, "wb");
+
+			if (file == 0)
+			{
+				return false;
+			}
+
+			size_t written = data.empty() ? 0 : fwrite(&data[0], 1, data.size(), file);
+			fclose(file);
+
+			return written == data.size();
+		}
+
+	private:
+
+		TaggedVector<Uint8, MEMORY_TAG_INPUT>::Type data;
+
+		Uint64 lastFrame;
+
+		bool recording;
+
+
+		void header(Uint64 frameIndex, InputLogKind kind)
+		{
+			putUint(frameIndex - lastFrame);
+			data.push_back((Uint8)kind);
+			lastFrame = frameIndex;
+		}
+
+		void putUint(Uint64 val)
+		{
+			while (val >= 0x80)
+			{
+				data.push_back((Uint8)(val | 0x80));
+				val >>= 7;
+			}
+			data.push_back((Uint8)val);
+		}
+
+		inline void putInt(Sint32 val)
+		{
+			putUint(((Uint32)val << 1) ^ (Uint32)(val >> 31));
+		}
+	};
+
+
+	// Replays log written by InputRecorder. Frame 0 of the log maps to
+	// the first frame 'next()' is called for.
+	class InputPlayer
+	{
+	public:
+
+		// Constructors
+
+		InputPlayer() : pos(0), nextFrame(0), startFrame(0), started(false), finished(true), corrupted(false) {}
+
+
+		// Methods
+
+		bool load(const char* path)
+		{
+			data.clear();
+			finished = true;
+			corrupted = false;
+
+			FILE* file = fopen(path, "rb");
+
+			if (file == 0)
+			{
+				return false;
+			}
+
+			Uint8 buffer[4096];
+			size_t n;
+			while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			{
+				data.insert(data.end(), buffer, buffer + n);
+			}
+			fclose(file);
+
+			if (data.size() < 5 || data[0] != 'H' || data[1] != '2' || data[2] != 'I' || data[3] != 'R' ||
+				data[4] != H2_INPUT_LOG_VERSION)
+			{
+				data.clear();
+				return false;
+			}
+
+			pos = 5;
+			nextFrame = readUint();
+			if (corrupted)
+			{
+				data.clear();
+				return false;
+			}
+
+			started = false;
+			finished = false;
+
+			return true;
+		}
+
+		// True after last recorded frame was replayed, or playback
+		// stopped at a corrupted record.
+		inline bool isFinished() const { return finished; }
+
+		// True when playback stopped because the log is truncated or
+		// holds an invalid record.
+		inline bool isCorrupted() const { return corrupted; }
+
+		// Returns next event recorded for 'frameIndex', false when frame
+		// has no more events. Frame indices must not decrease between calls.
+		bool next(Uint64 frameIndex, SDL_Event* outEvent)
+		{
+			if (finished)
+			{
+				return false;
+			}
+
+			if (!started)
+			{
+				startFrame = frameIndex;
+				started = true;
+			}
+
+			if (frameIndex - startFrame < nextFrame)
+			{
+				return false;
+			}
+
+			Uint8 kind = readByte();
+			if (corrupted)
+			{
+				return stopCorrupted();
+			}
+
+			SDL_Event& ev = *outEvent;
+			memset(&ev, 0, sizeof(ev));
+
+			switch (kind)
+			{
+			case INPUT_LOG_END:
+				finished = true;
+				return false;
+
+			case INPUT_LOG_QUIT:
+				ev.type = SDL_QUIT;
+				break;
+
+			case INPUT_LOG_KEY_DOWN:
+			case INPUT_LOG_KEY_UP:
+				ev.type = (kind == INPUT_LOG_KEY_DOWN) ? SDL_KEYDOWN : SDL_KEYUP;
+				ev.key.keysym.scancode = (SDL_Scancode)readUint();
+				ev.key.repeat = readByte();
+				break;
+
+			case INPUT_LOG_MOUSE_MOTION:
+				ev.type = SDL_MOUSEMOTION;
+				ev.motion.x = readInt();
+				ev.motion.y = readInt();
+				ev.motion.xrel = readInt();
+				ev.motion.yrel = readInt();
+				break;
+
+			case INPUT_LOG_MOUSE_DOWN:
+			case INPUT_LOG_MOUSE_UP:
+				ev.type = (kind == INPUT_LOG_MOUSE_DOWN) ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+				ev.button.button = readByte();
+				ev.button.x = readInt();
+				ev.button.y = readInt();
+				break;
+
+			case INPUT_LOG_MOUSE_WHEEL:
+				ev.type = SDL_MOUSEWHEEL;
+				ev.wheel.x = readInt();
+				ev.wheel.y = readInt();
+				break;
+
+			case INPUT_LOG_PAD_ADDED:
+			case INPUT_LOG_PAD_REMOVED:
+				ev.type = (kind == INPUT_LOG_PAD_ADDED) ? SDL_CONTROLLERDEVICEADDED : SDL_CONTROLLERDEVICEREMOVED;
+				ev.cdevice.which = readInt();
+				break;
+
+			case INPUT_LOG_PAD_AXIS:
+				ev.type = SDL_CONTROLLERAXISMOTION;
+				ev.caxis.which = readInt();
+				ev.caxis.axis = readByte();
+				ev.caxis.value = (Sint16)readInt();
+				break;
+
+			case INPUT_LOG_PAD_DOWN:
+			case INPUT_LOG_PAD_UP:
+				ev.type = (kind == INPUT_LOG_PAD_DOWN) ? SDL_CONTROLLERBUTTONDOWN : SDL_CONTROLLERBUTTONUP;
+				ev.cbutton.which = readInt();
+				ev.cbutton.button = readByte();
+				break;
+
+			default:
+				return stopCorrupted();
+			}
+
+			nextFrame += readUint();
+
+			// every read above flags a record cut short, the event is not
+			// returned half filled
+			if (corrupted)
+			{
+				return stopCorrupted();
+			}
+
+			return true;
+		}
+
+	private:
+
+		TaggedVector<Uint8, MEMORY_TAG_INPUT>::Type data;
+
+		unsigned int pos;
+
+		Uint64 nextFrame, startFrame;
+
+		bool started, finished, corrupted;
+
+
+		inline bool stopCorrupted()
+		{
+			corrupted = true;
+			finished = true;
+			return false;
+		}
+
+		// Reads past the end, or varints longer than 64 bits, set
+		// 'corrupted' and return 0.
+		Uint8 readByte()
+		{
+			if (pos >= data.size())
+			{
+				corrupted = true;
+				return 0;
+			}
+
+			return data[pos++];
+		}
+
+		Uint64 readUint()
+		{
+			Uint64 val = 0;
+			unsigned int shift = 0;
+
+			while (pos < data.size() && shift < 64)
+			{
+				Uint8 byte = data[pos++];
+				val |= (Uint64)(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0)
+				{
+					return val;
+				}
+				shift += 7;
+			}
+
+			corrupted = true;
+			return 0;
+		}
+
+		inline Sint32 readInt()
+		{
+			Uint32 val = (Uint32)readUint();
+			return (Sint32)(val >> 1) ^ -(Sint32)(val & 1);
+		}
+	};
+}
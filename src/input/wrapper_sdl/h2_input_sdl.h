@@ -0,0 +1,446 @@
+#pragma once
+
+#include "SDL.h"
+
+#include "../h2_input.h"
+#include "../h2_input_recorder.h"
+#include "../../core/h2_spsc_ring.h"
+
+
+
+#define H2_INPUT_RING_SIZE 1024
+
+
+
+
+namespace h2
+{
+	struct InputEvent
+	{
+		Uint64 time;   // SDL_GetPerformanceCounter() when SDL queued the event
+		SDL_Event event;
+	};
+
+
+	// SDL input wrapper.
+	//
+	// An SDL event filter copies every input event, with a high resolution
+	// timestamp, into a lock-free ring and drops it from SDL's own queue.
+	// Window and other events stay queued for the application to poll.
+	// Once per frame the render thread calls 'update()', which drains the
+	// ring and publishes a new InputSnapshot. Snapshots are double
+	// buffered, so the one returned stays valid and unchanged until the
+	// next 'update()' returns.
+	//
+	// Events are produced by whichever thread pumps SDL. Call 'pump()'
+	// from the main thread, or 'start(true)' to pump on a dedicated
+	// thread where the platform allows it (windows must be created on
+	// the pumping thread on Windows and macOS).
+	//
+	// With a recorder attached every consumed event is logged with its
+	// frame index. With a player attached live input is ignored (except
+	// SDL_QUIT, so the window can still be closed) and frames receive
+	// exactly the events recorded for them, gamepads included.
+	class InputSDL
+	{
+	public:
+
+		// Constructors
+
+		InputSDL() : pumpThread(0), producerLock(0), recorder(0), player(0), frameIndex(0), current(0), started(false)
+		{
+			SDL_AtomicSet(&running, 0);
+			SDL_AtomicSet(&dropped, 0);
+
+			for (unsigned int i = 0; i < H2_INPUT_MAX_GAMEPADS; i++)
+			{
+				controllers[i] = 0;
+			}
+		}
+
+
+		// Destructor
+
+		~InputSDL()
+		{
+			stop();
+		}
+
+
+		// Methods
+
+		void start(bool dedicatedPumpThread = false)
+		{
+			if (started)
+			{
+				return;
+			}
+
+			SDL_SetEventFilter(eventFilter, this);
+			started = true;
+
+			if (dedicatedPumpThread)
+			{
+				SDL_AtomicSet(&running, 1);
+				pumpThread = SDL_CreateThread(pumpThreadFunc, "h2_input", this);
+			}
+		}
+
+		void stop()
+		{
+			if (!started)
+			{
+				return;
+			}
+
+			if (pumpThread != 0)
+			{
+				SDL_AtomicSet(&running, 0);
+				SDL_WaitThread(pumpThread, 0);
+				pumpThread = 0;
+			}
+
+			SDL_SetEventFilter(0, 0);
+			started = false;
+
+			for (unsigned int i = 0; i < H2_INPUT_MAX_GAMEPADS; i++)
+			{
+				if (controllers[i] != 0)
+				{
+					SDL_GameControllerClose(controllers[i]);
+					controllers[i] = 0;
+				}
+			}
+		}
+
+		// Pumps OS events when no dedicated thread is used.
+		inline void pump()
+		{
+			SDL_PumpEvents();
+		}
+
+		// Drains queued events and publishes snapshot for the new frame.
+		const InputSnapshot& update()
+		{
+			InputSnapshot& next = snapshots[current ^ 1];
+
+			next = snapshots[current];
+			next.beginFrame(++frameIndex);
+
+			InputEvent e;
+			while (ring.pop(&e))
+			{
+				if (player == 0 || e.event.type == SDL_QUIT)
+				{
+					apply(next, e);
+				}
+			}
+
+			if (player != 0)
+			{
+				e.time = SDL_GetPerformanceCounter();
+				while (player->next(frameIndex, &e.event))
+				{
+					apply(next, e);
+				}
+			}
+
+			next.nDropped = (unsigned int)SDL_AtomicSet(&dropped, 0);
+
+			current ^= 1;
+
+			return next;
+		}
+
+		inline const InputSnapshot& getSnapshot() const
+		{
+			return snapshots[current];
+		}
+
+		inline const InputSnapshot& getPrevious() const
+		{
+			return snapshots[current ^ 1];
+		}
+
+		// Logs consumed events into 'in_recorder', 0 stops logging.
+		// Call 'InputRecorder::begin()' with the current frame index first.
+		inline void setRecorder(InputRecorder* in_recorder)
+		{
+			recorder = in_recorder;
+		}
+
+		// Feeds frames from 'in_player' instead of live input, 0 returns
+		// to live input.
+		inline void setPlayer(InputPlayer* in_player)
+		{
+			player = in_player;
+		}
+
+		inline InputPlayer* getPlayer() const
+		{
+			return player;
+		}
+
+	private:
+
+		SpscRing<InputEvent, H2_INPUT_RING_SIZE> ring;
+
+		SDL_Thread* pumpThread;
+
+		SDL_atomic_t running;
+
+		SDL_atomic_t dropped;
+
+		// Serializes producers in case SDL events are pushed from more
+		// than one thread. Consumer never takes it.
+		SDL_SpinLock producerLock;
+
+		InputSnapshot snapshots[2];
+
+		InputRecorder* recorder;
+
+		InputPlayer* player;
+
+		SDL_GameController* controllers[H2_INPUT_MAX_GAMEPADS];
+
+		Uint64 frameIndex;
+
+		unsigned int current;
+
+		bool started;
+
+
+		InputSDL(const InputSDL&);
+		InputSDL& operator = (const InputSDL&);
+
+		// Events the snapshot is built from, SDL_QUIT included.
+		static bool isInputEvent(Uint32 type)
+		{
+			switch (type)
+			{
+			case SDL_QUIT:
+			case SDL_KEYDOWN:
+			case SDL_KEYUP:
+			case SDL_MOUSEMOTION:
+			case SDL_MOUSEBUTTONDOWN:
+			case SDL_MOUSEBUTTONUP:
+			case SDL_MOUSEWHEEL:
+			case SDL_CONTROLLERDEVICEADDED:
+			case SDL_CONTROLLERDEVICEREMOVED:
+			case SDL_CONTROLLERAXISMOTION:
+			case SDL_CONTROLLERBUTTONDOWN:
+			case SDL_CONTROLLERBUTTONUP:
+				return true;
+			}
+
+			return false;
+		}
+
+		static int SDLCALL eventFilter(void* userdata, SDL_Event* event)
+		{
+			InputSDL* input = (InputSDL*)userdata;
+
+			// window and other events stay in SDL's queue for the application
+			if (!isInputEvent(event->type))
+			{
+				return 1;
+			}
+
+			InputEvent e;
+			e.time = SDL_GetPerformanceCounter();
+			e.event = *event;
+
+			SDL_AtomicLock(&input->producerLock);
+			if (!input->ring.push(e))
+			{
+				SDL_AtomicAdd(&input->dropped, 1);
+			}
+			SDL_AtomicUnlock(&input->producerLock);
+
+			// event is consumed, keep it out of SDL's queue
+			return 0;
+		}
+
+		static int SDLCALL pumpThreadFunc(void* data)
+		{
+			InputSDL* input = (InputSDL*)data;
+
+			while (SDL_AtomicGet(&input->running) != 0)
+			{
+				SDL_PumpEvents();
+				SDL_Delay(1);
+			}
+
+			return 0;
+		}
+
+		int findPad(const InputSnapshot& snap, SDL_JoystickID id) const
+		{
+			for (int i = 0; i < H2_INPUT_MAX_GAMEPADS; i++)
+			{
+				if (snap.gamepads[i].connected && snap.gamepads[i].instanceId == id)
+				{
+					return i;
+				}
+			}
+			return -1;
+		}
+
+		void apply(InputSnapshot& snap, const InputEvent& e)
+		{
+			const SDL_Event& ev = e.event;
+
+			if (snap.nEvents == 0)
+			{
+				snap.oldestEventTime = e.time;
+			}
+			snap.newestEventTime = e.time;
+			snap.nEvents++;
+
+			switch (ev.type)
+			{
+			case SDL_QUIT:
+				snap.quit = true;
+				break;
+
+			case SDL_KEYDOWN:
+				if (ev.key.repeat == 0)
+				{
+					snap.keyboard.down.set(ev.key.keysym.scancode, true);
+					snap.keyboard.pressed.set(ev.key.keysym.scancode, true);
+				}
+				break;
+
+			case SDL_KEYUP:
+				snap.keyboard.down.set(ev.key.keysym.scancode, false);
+				snap.keyboard.released.set(ev.key.keysym.scancode, true);
+				break;
+
+			case SDL_MOUSEMOTION:
+				snap.mouse.x = ev.motion.x;
+				snap.mouse.y = ev.motion.y;
+				snap.mouse.dx += ev.motion.xrel;
+				snap.mouse.dy += ev.motion.yrel;
+				break;
+
+			case SDL_MOUSEBUTTONDOWN:
+				snap.mouse.x = ev.button.x;
+				snap.mouse.y = ev.button.y;
+				snap.mouse.down.set(ev.button.button, true);
+				snap.mouse.pressed.set(ev.button.button, true);
+				break;
+
+			case SDL_MOUSEBUTTONUP:
+				snap.mouse.x = ev.button.x;
+				snap.mouse.y = ev.button.y;
+				snap.mouse.down.set(ev.button.button, false);
+				snap.mouse.released.set(ev.button.button, true);
+				break;
+
+			case SDL_MOUSEWHEEL:
+				snap.mouse.wheelX += ev.wheel.x;
+				snap.mouse.wheelY += ev.wheel.y;
+				break;
+
+			case SDL_CONTROLLERDEVICEADDED:
+				{
+					// log instance id, replay cannot rely on device indices
+					SDL_Event padEvent = ev;
+					padEvent.cdevice.which = openPad(snap, ev.cdevice.which);
+					if (recorder != 0 && padEvent.cdevice.which >= 0)
+					{
+						recorder->record(snap.frameIndex, padEvent);
+					}
+				}
+				return;
+
+			case SDL_CONTROLLERDEVICEREMOVED:
+				closePad(snap, ev.cdevice.which);
+				break;
+
+			case SDL_CONTROLLERAXISMOTION:
+				{
+					int pad = findPad(snap, ev.caxis.which);
+					if (pad >= 0 && ev.caxis.axis < H2_INPUT_MAX_PAD_AXES)
+					{
+						float value = ev.caxis.value/32767.0f;
+						snap.gamepads[pad].axes[ev.caxis.axis] = value < -1.0f ? -1.0f : value;
+					}
+				}
+				break;
+
+			case SDL_CONTROLLERBUTTONDOWN:
+			case SDL_CONTROLLERBUTTONUP:
+				{
+					int pad = findPad(snap, ev.cbutton.which);
+					if (pad >= 0)
+					{
+						bool isDown = (ev.type == SDL_CONTROLLERBUTTONDOWN);
+						snap.gamepads[pad].down.set(ev.cbutton.button, isDown);
+						if (isDown)
+						{
+							snap.gamepads[pad].pressed.set(ev.cbutton.button, true);
+						} else
+						{
+							snap.gamepads[pad].released.set(ev.cbutton.button, true);
+						}
+					}
+				}
+				break;
+			}
+
+			if (recorder != 0)
+			{
+				recorder->record(snap.frameIndex, ev);
+			}
+		}
+
+		// For SDL_CONTROLLERDEVICEADDED 'which' is device index, during
+		// replay it is recorded instance id and no device is opened.
+		// Returns instance id or -1.
+		Sint32 openPad(InputSnapshot& snap, int which)
+		{
+			for (int i = 0; i < H2_INPUT_MAX_GAMEPADS; i++)
+			{
+				if (controllers[i] == 0 && !snap.gamepads[i].connected)
+				{
+					Sint32 id = which;
+
+					if (player == 0)
+					{
+						controllers[i] = SDL_GameControllerOpen(which);
+						if (controllers[i] == 0)
+						{
+							return -1;
+						}
+						id = SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controllers[i]));
+					}
+
+					GamepadState& pad = snap.gamepads[i];
+					pad = GamepadState();
+					pad.connected = true;
+					pad.instanceId = id;
+					return id;
+				}
+			}
+			return -1;
+		}
+
+		// For SDL_CONTROLLERDEVICEREMOVED 'which' is instance id.
+		void closePad(InputSnapshot& snap, SDL_JoystickID id)
+		{
+			int i = findPad(snap, id);
+			if (i < 0)
+			{
+				return;
+			}
+
+			if (controllers[i] != 0)
+			{
+				SDL_GameControllerClose(controllers[i]);
+				controllers[i] = 0;
+			}
+			snap.gamepads[i] = GamepadState();
+		}
+	};
+}
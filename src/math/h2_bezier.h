@@ -0,0 +1,108 @@
+#pragma once
+
+#include "h2_math.h"
+
+
+
+namespace h2
+{
+	// Branches taken by 'projectPointToQuadraticBezier()', summed over
+	// the queries it was passed to.
+	struct BezierProjectionStats
+	{
+		unsigned int nQueries;
+		unsigned int nProjected;                       // queries that returned 1
+
+		unsigned int nCubicCases[CUBIC_CASE_COUNT];    // by branch of the cubic solver
+		unsigned int nRoots[4];                        // by number of real roots
+		unsigned int nRootsInRange[4];                 // by number of roots with 't' in [0, 1]
+
+
+		// Constructors
+
+		BezierProjectionStats()
+		{
+			reset();
+		}
+
+
+		// Methods
+
+		inline void reset()
+		{
+			memset(this, 0, sizeof(*this));
+		}
+	};
+
+
+	// Function finds point of quadratic bezier curve 'p0', 'p1', 'p2'
+	// closest to 'inPoint' among the points where 'inPoint - B(t)' is
+	// perpendicular to the curve, i.e. roots of the third degree equation
+	// d/dt |B(t) - inPoint|^2 = 0 with 't' in [0, 1]. Curve ends are not
+	// considered. Returns 1 and the point via '*outPoint', or 0 if there
+	// is no such point.
+	template <class T>
+	int projectPointToQuadraticBezier(const T& p0, const T& p1, const T& p2, const T& inPoint, T* outPoint,
+									  BezierProjectionStats* stats = 0)
+	{
+		T A, B;
+
+		A = p1 - p0;
+		B = p2 - 2.0f*p1 + p0;
+
+		float a, b, c, d;
+
+		a = h2::dot(B, B);
+		b = 3.0f*h2::dot(A, B);
+
+		T _M = p0 - inPoint;
+
+		c = 2.0f*h2::dot(A, A) + h2::dot(_M, B);
+		d = h2::dot(_M, A);
+
+		float roots[3];
+
+		CubicCase cubicCase;
+
+		int nRoots = h2::solveThirdDegreeEquation(a, b, c, d, roots, &cubicCase);
+
+		float curr_t, colsest_t = 0;
+		float currDistance, minDistance = 0;
+		int nProj = 0;
+
+		for (int i = 0; i < nRoots; i++)
+		{
+			curr_t = roots[i];
+
+			if (curr_t >= 0 && curr_t <= 1.0f)
+			{
+				currDistance = h2::distanance(inPoint, h2::quadraticBezier(p0, p1, p2, curr_t));
+
+				if (nProj == 0 || currDistance < minDistance)
+				{
+					minDistance = currDistance;
+					colsest_t = curr_t;
+				}
+				nProj++;
+			}
+		}
+
+		if (stats != 0)
+		{
+			stats->nQueries++;
+			stats->nProjected += nProj > 0 ? 1 : 0;
+			stats->nCubicCases[cubicCase]++;
+			stats->nRoots[nRoots]++;
+			stats->nRootsInRange[nProj]++;
+		}
+
+		if (nProj == 0)
+		{
+			return 0;
+		}
+
+		*outPoint = h2::quadraticBezier(p0, p1, p2, colsest_t);
+
+		return 1;
+	}
+}
@@ -1,4 +1,8 @@
+#pragma once
+
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 
 #include "h2_vector2.h"
 #include "h2_vector3.h"
@@ -31,6 +35,19 @@
 
 namespace h2
 {
+	// Branch taken by 'solveThirdDegreeEquation()'.
+	enum CubicCase
+	{
+		CUBIC_CASE_QUADRATIC,      // 'a' is zero, solved as second degree
+		CUBIC_CASE_TRIPLE_ROOT,
+		CUBIC_CASE_DOUBLE_ROOT,    // one single and one double solution
+		CUBIC_CASE_THREE_ROOTS,    // three real solutions, trigonometric
+		CUBIC_CASE_ONE_ROOT,       // one real solution, Cardano
+
+		CUBIC_CASE_COUNT
+	};
+
+
 	template <class T>
 	T abs(const T& val)
 	{
@@ -65,15 +82,16 @@ namespace h2
 	}
 
 
-	h2::Vector3f cross(h2::Vector3f inVecA, h2::Vector3f inVecB)
+	template <class T>
+	h2::Vector3<T> cross(const h2::Vector3<T>& inVecA, const h2::Vector3<T>& inVecB)
 	{
-		return h2::Vector3f(inVecA.y * inVecB.z - inVecA.z * inVecB.y,
+		return h2::Vector3<T>(inVecA.y * inVecB.z - inVecA.z * inVecB.y,
 							inVecA.z * inVecB.x - inVecA.x * inVecB.z,
 							inVecA.x * inVecB.y - inVecA.y * inVecB.x);
 	}
 
 
-	float degToRad(float deg)
+	inline float degToRad(float deg)
 	{
 		return deg*H2_PI/180.0f;
 	}
@@ -86,7 +104,7 @@ namespace h2
 	}
 
 
-	float distanance(const h2::Vector2f& pointA, const h2::Vector2f& pointB)
+	inline float distanance(const h2::Vector2f& pointA, const h2::Vector2f& pointB)
 	{
 		float BAx = pointB.x - pointA.x;
 		float BAy = pointB.y - pointA.y;
@@ -95,17 +113,18 @@ namespace h2
 	}
 
 
-	float distanance(const h2::Vector3f& pointA, const h2::Vector3f& pointB)
+	template <class T>
+	T distanance(const h2::Vector3<T>& pointA, const h2::Vector3<T>& pointB)
 	{
-		float BAx = pointB.x - pointA.x;
-		float BAy = pointB.y - pointA.y;
-		float BAz = pointB.z - pointA.z;
+		T BAx = pointB.x - pointA.x;
+		T BAy = pointB.y - pointA.y;
+		T BAz = pointB.z - pointA.z;
 
 		return sqrt(BAx*BAx + BAy*BAy + BAz*BAz);
 	}
 
 
-	float distanance(const h2::Vector4f& pointA, const h2::Vector4f& pointB)
+	inline float distanance(const h2::Vector4f& pointA, const h2::Vector4f& pointB)
 	{
 		float BAx = pointB.x - pointA.x;
 		float BAy = pointB.y - pointA.y;
@@ -150,13 +169,13 @@ namespace h2
 	}
 
 
-	float radToDeg(float rad)
+	inline float radToDeg(float rad)
 	{
 		return rad*180.0f/H2_PI;
 	}
 
 
-	float slerp(float start, float end, float t)
+	inline float slerp(float start, float end, float t)
 	{
 		float omega = acos(start*end);
 		return sin((1.0f - t)*omega)*start/sin(omega) + sin(t*omega)*end/sin(omega);
@@ -187,7 +206,7 @@ namespace h2
 	// ax^2 + bx + c = 0 and 
 	// returns number of solutions.
 	// Solutions returns via '*outResult' parameter.
-	int solveSecondDegreeEquation(float a, float b, float c, float* outResult)
+	inline int solveSecondDegreeEquation(float a, float b, float c, float* outResult)
 	{
 		if (a == 0) // if 'a' is zero then 1st degree equation
 		{
@@ -227,11 +246,16 @@ namespace h2
 	// Function finds solution of third degree equation (for x) 
 	// ax^3 + bx^2 + cx + d = 0 and 
 	// returns number of solutions.
-	// Solutions returns via '*outResult' parameter.
-	int solveThirdDegreeEquation(float a, float b, float c, float d, float* outResult)
+	// Solutions returns via '*outResult' parameter, the branch taken
+	// via '*outCase' if it is not null.
+	inline int solveThirdDegreeEquation(float a, float b, float c, float d, float* outResult, CubicCase* outCase = 0)
 	{
 		if (a == 0)
 		{
+			if (outCase != 0)
+			{
+				*outCase = CUBIC_CASE_QUADRATIC;
+			}
 			return h2::solveSecondDegreeEquation(b, c, d, outResult);
 
 		} else 
@@ -261,11 +285,19 @@ namespace h2
 			{
 				if (H2_IS_ZERO(q)) // one triple solution
 				{
+					if (outCase != 0)
+					{
+						*outCase = CUBIC_CASE_TRIPLE_ROOT;
+					}
 					outResult[0] = -offset;
 					return 1;
 
 				} else //one single and one double solution
 				{	
+					if (outCase != 0)
+					{
+						*outCase = CUBIC_CASE_DOUBLE_ROOT;
+					}
 					float u = H2_CUBIC_ROOT(-q);
 					outResult[0] = 2.0f*u - offset;
 					outResult[1] = -u - offset;
@@ -273,6 +305,10 @@ namespace h2
 				}
 			} else if (D < 0) // three real solutions
 			{
+				if (outCase != 0)
+				{
+					*outCase = CUBIC_CASE_THREE_ROOTS;
+				}
 				float phi = H2_THIRD*acos(-q/sqrt(-p*p*p));
 				float t = 2.0f * sqrt(-p);
 
@@ -283,6 +319,10 @@ namespace h2
 
 			} else // one real solution
 			{
+				if (outCase != 0)
+				{
+					*outCase = CUBIC_CASE_ONE_ROOT;
+				}
 				float sqrtD = sqrt(D);
 
 				float u =  H2_CUBIC_ROOT(sqrtD - q);
@@ -305,7 +345,7 @@ namespace h2
 } // end of namespace 'h2'
 
 
-int h2_math_test()
+inline int h2_math_test()
 {
 	return 0;
 }
@@ -323,17 +363,17 @@ namespace h2
 	template <class T>
 	T quadraticBezier(T p0, T p1, T p2, float t)
 	{
-		float T = 1.0f - t;
-		return T*T*p0 + 2.0f*t*T*p1 + t*t*p2;
+		float it = 1.0f - t;
+		return it*it*p0 + 2.0f*t*it*p1 + t*t*p2;
 	}
 
 
 	template <class T>
 	T cubicBezier(T p0, T p1, T p2, T p3, float t)
 	{
-		float T = 1.0f - t;
-		float TT = T*T;
+		float it = 1.0f - t;
+		float itit = it*it;
 		float tt = t*t;
-		return TT*T*p0 + 3.0f*t*TT*p1 + 3.0f*tt*T*p2 + tt*t*p3;
+		return itit*it*p0 + 3.0f*t*itit*p1 + 3.0f*tt*it*p2 + tt*t*p3;
 	}
 }
\ No newline at end of file
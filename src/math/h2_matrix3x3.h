@@ -7,7 +7,8 @@
 
 namespace h2
 {
-	class Matrix3x3f
+	template <class T>
+	class Matrix3x3
 	{
 	public:
 
@@ -17,38 +18,38 @@ namespace h2
 		{
 			struct
 			{
-				float _m00, _m01, _m02,
-					  _m10, _m11, _m12,
-					  _m20, _m21, _m22;
+				T _m00, _m01, _m02,
+				  _m10, _m11, _m12,
+				  _m20, _m21, _m22;
 			};
 
-			float m[3][3];
+			T m[3][3];
 
-			float mv[9];
+			T mv[9];
 		};
 
 
 		// Constructors
 
-		Matrix3x3f() : _m00(0), _m01(0), _m02(0),
-					   _m10(0), _m11(0), _m12(0),
-					   _m20(0), _m21(0), _m22(0) {}
+		Matrix3x3() : _m00(0), _m01(0), _m02(0),
+					  _m10(0), _m11(0), _m12(0),
+					  _m20(0), _m21(0), _m22(0) {}
 
-		Matrix3x3f(float in_m00, float in_m01, float in_m02,
-				   float in_m10, float in_m11, float in_m12,
-				   float in_m20, float in_m21, float in_m22) : _m00(in_m00), _m01(in_m01), _m02(in_m02),
-															   _m10(in_m10), _m11(in_m11), _m12(in_m12),
-															   _m20(in_m20), _m21(in_m21), _m22(in_m22) {}
+		Matrix3x3(T in_m00, T in_m01, T in_m02,
+				  T in_m10, T in_m11, T in_m12,
+				  T in_m20, T in_m21, T in_m22) : _m00(in_m00), _m01(in_m01), _m02(in_m02),
+												  _m10(in_m10), _m11(in_m11), _m12(in_m12),
+												  _m20(in_m20), _m21(in_m21), _m22(in_m22) {}
 
 		template <class MatType>
-		Matrix3x3f(MatType const &mat) : _m00(mat.m[0][0]), _m01(mat.m[0][1]), _m02(mat.m[0][2]),
-										 _m10(mat.m[1][0]), _m11(mat.m[1][1]), _m12(mat.m[1][2]),
-										 _m20(mat.m[2][0]), _m21(mat.m[2][1]), _m22(mat.m[2][2]) {}
+		Matrix3x3(MatType const &mat) : _m00((T)mat.m[0][0]), _m01((T)mat.m[0][1]), _m02((T)mat.m[0][2]),
+										_m10((T)mat.m[1][0]), _m11((T)mat.m[1][1]), _m12((T)mat.m[1][2]),
+										_m20((T)mat.m[2][0]), _m21((T)mat.m[2][1]), _m22((T)mat.m[2][2]) {}
 
 
 		// Copy
 
-		inline Matrix3x3f& operator = (const Matrix3x3f &mat)
+		inline Matrix3x3& operator = (const Matrix3x3 &mat)
 		{
 			_m00 = mat._m00;  _m01 = mat._m01;  _m02 = mat._m02;
 			_m10 = mat._m10;  _m11 = mat._m11;  _m12 = mat._m12;
@@ -56,7 +57,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& operator = (const Matrix2x2f &mat)
+		inline Matrix3x3& operator = (const Matrix2x2f &mat)
 		{
 			_m00 = mat._m00;  _m01 = mat._m01;
 			_m10 = mat._m10;  _m11 = mat._m11;
@@ -66,11 +67,11 @@ namespace h2
 
 		// Unary operators
 
-		inline Matrix3x3f operator + () const { return *this; }
+		inline Matrix3x3 operator + () const { return *this; }
 
-		inline Matrix3x3f operator - () const 
+		inline Matrix3x3 operator - () const 
 		{
-			return Matrix3x3f(-_m00, -_m01, -_m02,
+			return Matrix3x3(-_m00, -_m01, -_m02,
 							  -_m10, -_m11, -_m12,
 							  -_m20, -_m21, -_m22);
 		}
@@ -78,51 +79,51 @@ namespace h2
 
 		// Binary operators
 
-		inline Matrix3x3f operator + (const Matrix3x3f& mat) const
+		inline Matrix3x3 operator + (const Matrix3x3& mat) const
 		{
-			return Matrix3x3f(_m00 + mat._m00,  _m01 + mat._m01,  _m02 + mat._m02,
+			return Matrix3x3(_m00 + mat._m00,  _m01 + mat._m01,  _m02 + mat._m02,
 							  _m10 + mat._m10,  _m11 + mat._m11,  _m12 + mat._m12,
 							  _m20 + mat._m20,  _m21 + mat._m21,  _m22 + mat._m22);
 		}
 
-		inline Matrix3x3f operator - (const Matrix3x3f& mat) const
+		inline Matrix3x3 operator - (const Matrix3x3& mat) const
 		{
-			return Matrix3x3f(_m00 - mat._m00,  _m01 - mat._m01,  _m02 - mat._m02,
+			return Matrix3x3(_m00 - mat._m00,  _m01 - mat._m01,  _m02 - mat._m02,
 							  _m10 - mat._m10,  _m11 - mat._m11,  _m12 - mat._m12,
 							  _m20 - mat._m20,  _m21 - mat._m21,  _m22 - mat._m22);
 		}
 
-		inline Matrix3x3f operator * (float val) const
+		inline Matrix3x3 operator * (T val) const
 		{
-			return Matrix3x3f(_m00*val, _m01*val, _m02*val,
+			return Matrix3x3(_m00*val, _m01*val, _m02*val,
 							  _m10*val, _m11*val, _m12*val,
 							  _m20*val, _m21*val, _m22*val);
 		}
 
-		friend Matrix3x3f operator * (float val, const Matrix3x3f& mat)
+		friend Matrix3x3 operator * (T val, const Matrix3x3& mat)
 		{
-			return Matrix3x3f(mat._m00*val, mat._m01*val, mat._m02*val,
+			return Matrix3x3(mat._m00*val, mat._m01*val, mat._m02*val,
 							  mat._m10*val, mat._m11*val, mat._m12*val,
 							  mat._m20*val, mat._m21*val, mat._m22*val);
 		}
 
-		inline Vector3f operator * (const Vector3f& vec) const
+		inline Vector3<T> operator * (const Vector3<T>& vec) const
 		{
-			return Vector3f(_m00*vec.x + _m01*vec.y + _m02*vec.z,
+			return Vector3<T>(_m00*vec.x + _m01*vec.y + _m02*vec.z,
 							_m10*vec.x + _m11*vec.y + _m12*vec.z,
 							_m20*vec.x + _m21*vec.y + _m22*vec.z);
 		}
 
-		friend Vector3f operator * (const Vector3f& vec, const Matrix3x3f& mat)
+		friend Vector3<T> operator * (const Vector3<T>& vec, const Matrix3x3& mat)
 		{
-			return Vector3f(vec.x*mat._m00 + vec.y*mat._m10 + vec.z*mat._m20,
+			return Vector3<T>(vec.x*mat._m00 + vec.y*mat._m10 + vec.z*mat._m20,
 							vec.x*mat._m01 + vec.y*mat._m11 + vec.z*mat._m21,
 							vec.x*mat._m02 + vec.y*mat._m12 + vec.z*mat._m22);
 		}
 
-		inline Matrix3x3f operator * (const Matrix3x3f& mat) const
+		inline Matrix3x3 operator * (const Matrix3x3& mat) const
 		{
-			Matrix3x3f rMat;
+			Matrix3x3 rMat;
 
 			rMat._m00 = _m00*mat._m00 + _m01*mat._m10 + _m02*mat._m20;
 			rMat._m01 = _m00*mat._m01 + _m01*mat._m11 + _m02*mat._m21;
@@ -137,10 +138,10 @@ namespace h2
 			return rMat;
 		}
 
-		inline Matrix3x3f operator / (float val) const
+		inline Matrix3x3 operator / (T val) const
 		{
-			float invVal = 1.0f/val;
-			return Matrix3x3f(_m00*invVal, _m01*invVal, _m02*invVal,
+			T invVal = (T)1/val;
+			return Matrix3x3(_m00*invVal, _m01*invVal, _m02*invVal,
 							  _m10*invVal, _m11*invVal, _m12*invVal,
 							  _m20*invVal, _m21*invVal, _m22*invVal);
 		}
@@ -148,7 +149,7 @@ namespace h2
 
 		// Assigment operators
 
-		inline Matrix3x3f& operator += (const Matrix3x3f& mat)
+		inline Matrix3x3& operator += (const Matrix3x3& mat)
 		{
 			_m00 += mat._m00;  _m01 += mat._m01;  _m02 += mat._m02;
 			_m10 += mat._m10;  _m11 += mat._m11;  _m12 += mat._m12;
@@ -156,7 +157,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& operator -= (const Matrix3x3f& mat)
+		inline Matrix3x3& operator -= (const Matrix3x3& mat)
 		{
 			_m00 -= mat._m00;  _m01 -= mat._m01;  _m02 -= mat._m02;
 			_m10 -= mat._m10;  _m11 -= mat._m11;  _m12 -= mat._m12;
@@ -164,7 +165,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& operator *= (float val)
+		inline Matrix3x3& operator *= (T val)
 		{
 			_m00 *= val;  _m01 *= val;  _m02 *= val;
 			_m10 *= val;  _m11 *= val;  _m12 *= val;
@@ -172,7 +173,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& operator *= (const Matrix3x3f& mat)
+		inline Matrix3x3& operator *= (const Matrix3x3& mat)
 		{
 			_m00 = _m00*mat._m00 + _m01*mat._m10 + _m02*mat._m20;
 			_m01 = _m00*mat._m01 + _m01*mat._m11 + _m02*mat._m21;
@@ -186,9 +187,9 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& operator /= (float val)
+		inline Matrix3x3& operator /= (T val)
 		{
-			float invVal = 1.0f/val;
+			T invVal = (T)1/val;
 			_m00 *= invVal;  _m01 *= invVal;  _m02 *= invVal;
 			_m10 *= invVal;  _m11 *= invVal;  _m12 *= invVal;
 			_m20 *= invVal;  _m21 *= invVal;  _m22 *= invVal;
@@ -198,7 +199,7 @@ namespace h2
 
 		// Methods
 
-		inline Matrix3x3f& setZero()
+		inline Matrix3x3& setZero()
 		{
 			_m00 = 0;  _m01 = 0;  _m02 = 0;
 			_m10 = 0;  _m11 = 0;  _m12 = 0;
@@ -206,7 +207,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& setIdentity()
+		inline Matrix3x3& setIdentity()
 		{
 			_m00 = 1.0f;  _m01 = 0;     _m02 = 0;
 			_m10 = 0;     _m11 = 1.0f;  _m12 = 0;
@@ -214,21 +215,21 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f transpose() const
+		inline Matrix3x3 transpose() const
 		{
-			return Matrix3x3f(_m00, _m10, _m20,
+			return Matrix3x3(_m00, _m10, _m20,
 							  _m01, _m11, _m21,
 							  _m02, _m12, _m22);
 		}
 
-		inline float determinant() const
+		inline T determinant() const
 		{
 			return _m00*(_m11*_m22 - _m12*_m21) - 
-				   _m01*(_m01*_m22 - _m02*_m21) + 
-				   _m02*(_m01*_m12 - _m02*_m11);
+				   _m01*(_m10*_m22 - _m12*_m20) + 
+				   _m02*(_m10*_m21 - _m11*_m20);
 		}
 
-		inline Matrix3x3f& setRow(unsigned int row, float valA, float valB, float valC)
+		inline Matrix3x3& setRow(unsigned int row, T valA, T valB, T valC)
 		{
 			m[row][0] = valA;
 			m[row][1] = valB;
@@ -236,7 +237,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& setRow(unsigned int row, const Vector2f& vec, float val)
+		inline Matrix3x3& setRow(unsigned int row, const Vector2f& vec, T val)
 		{
 			m[row][0] = vec.x;
 			m[row][1] = vec.y;
@@ -244,7 +245,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& setRow(unsigned int row, float val, const Vector2f& vec)
+		inline Matrix3x3& setRow(unsigned int row, T val, const Vector2f& vec)
 		{
 			m[row][0] = val;
 			m[row][1] = vec.x;
@@ -252,7 +253,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& setRow(unsigned int row, const Vector3f& vec)
+		inline Matrix3x3& setRow(unsigned int row, const Vector3<T>& vec)
 		{
 			m[row][0] = vec.x;
 			m[row][1] = vec.y;
@@ -260,7 +261,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& setColumn(unsigned int column, float valA, float valB, float valC)
+		inline Matrix3x3& setColumn(unsigned int column, T valA, T valB, T valC)
 		{
 			m[0][column] = valA;
 			m[1][column] = valB;
@@ -268,7 +269,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& setColumn(unsigned int column, const Vector2f& vec, float val)
+		inline Matrix3x3& setColumn(unsigned int column, const Vector2f& vec, T val)
 		{
 			m[0][column] = vec.x;
 			m[1][column] = vec.y;
@@ -276,7 +277,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& setColumn(unsigned int column, float val, const Vector2f& vec)
+		inline Matrix3x3& setColumn(unsigned int column, T val, const Vector2f& vec)
 		{
 			m[0][column] = val;
 			m[1][column] = vec.x;
@@ -284,7 +285,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix3x3f& setColumn(unsigned int column, const Vector3f& vec)
+		inline Matrix3x3& setColumn(unsigned int column, const Vector3<T>& vec)
 		{
 			m[0][column] = vec.x;
 			m[1][column] = vec.y;
@@ -292,4 +293,8 @@ namespace h2
 			return *this;
 		}
 	};
+
+
+	typedef Matrix3x3<float>  Matrix3x3f;
+	typedef Matrix3x3<double> Matrix3x3d;
 }
\ No newline at end of file
@@ -7,7 +7,8 @@
 
 namespace h2
 {
-	class Matrix4x4f
+	template <class T>
+	class Matrix4x4
 	{
 	public:
 
@@ -17,54 +18,54 @@ namespace h2
 		{
 			struct
 			{
-				float _m00, _m01, _m02, _m03,
-					  _m10, _m11, _m12, _m13,
-					  _m20, _m21, _m22, _m23,
-					  _m30, _m31, _m32, _m33;
+				T _m00, _m01, _m02, _m03,
+				  _m10, _m11, _m12, _m13,
+				  _m20, _m21, _m22, _m23,
+				  _m30, _m31, _m32, _m33;
 			};
 
-			float m[4][4];
+			T m[4][4];
 
-			float mv[16];
+			T mv[16];
 		};
 
 
 		// Constructors
 
-		Matrix4x4f() : _m00(0), _m01(0), _m02(0), _m03(0),
-					   _m10(0), _m11(0), _m12(0), _m13(0),
-					   _m20(0), _m21(0), _m22(0), _m23(0),
-					   _m30(0), _m31(0), _m32(0), _m33(0) {}
+		Matrix4x4() : _m00(0), _m01(0), _m02(0), _m03(0),
+					  _m10(0), _m11(0), _m12(0), _m13(0),
+					  _m20(0), _m21(0), _m22(0), _m23(0),
+					  _m30(0), _m31(0), _m32(0), _m33(0) {}
 
-		Matrix4x4f(float in_m00, float in_m01, float in_m02, float in_m03,
-				   float in_m10, float in_m11, float in_m12, float in_m13,
-				   float in_m20, float in_m21, float in_m22, float in_m23,
-				   float in_m30, float in_m31, float in_m32, float in_m33) : 
+		Matrix4x4(T in_m00, T in_m01, T in_m02, T in_m03,
+				  T in_m10, T in_m11, T in_m12, T in_m13,
+				  T in_m20, T in_m21, T in_m22, T in_m23,
+				  T in_m30, T in_m31, T in_m32, T in_m33) : 
 									_m00(in_m00), _m01(in_m01), _m02(in_m02), _m03(in_m03),
 									_m10(in_m10), _m11(in_m11), _m12(in_m12), _m13(in_m13),
 									_m20(in_m20), _m21(in_m21), _m22(in_m22), _m23(in_m23),
 									_m30(in_m30), _m31(in_m31), _m32(in_m32), _m33(in_m33) {}
 
 		template <class MatType>
-		Matrix4x4f(MatType const &mat) : _m00(mat.m[0][0]), _m01(mat.m[0][1]), _m02(mat.m[0][2]), _m03(mat.m[0][3]),
-										 _m10(mat.m[1][0]), _m11(mat.m[1][1]), _m12(mat.m[1][2]), _m13(mat.m[1][3]),
-										 _m20(mat.m[2][0]), _m21(mat.m[2][1]), _m22(mat.m[2][2]), _m23(mat.m[2][3]),
-										 _m30(mat.m[3][0]), _m31(mat.m[3][1]), _m22(mat.m[3][2]), _m23(mat.m[3][3]) {}
+		Matrix4x4(MatType const &mat) : _m00((T)mat.m[0][0]), _m01((T)mat.m[0][1]), _m02((T)mat.m[0][2]), _m03((T)mat.m[0][3]),
+										_m10((T)mat.m[1][0]), _m11((T)mat.m[1][1]), _m12((T)mat.m[1][2]), _m13((T)mat.m[1][3]),
+										_m20((T)mat.m[2][0]), _m21((T)mat.m[2][1]), _m22((T)mat.m[2][2]), _m23((T)mat.m[2][3]),
+										_m30((T)mat.m[3][0]), _m31((T)mat.m[3][1]), _m32((T)mat.m[3][2]), _m33((T)mat.m[3][3]) {}
 	 
 
 		// Copy
 
-		inline Matrix4x4f& operator = (const Matrix4x4f &mat)
+		inline Matrix4x4& operator = (const Matrix4x4 &mat)
 		{
 			_m00 = mat._m00;  _m01 = mat._m01;  _m02 = mat._m02; _m03 = mat._m03;
 			_m10 = mat._m10;  _m11 = mat._m11;  _m12 = mat._m12; _m13 = mat._m13;
-			_m20 = mat._m20;  _m21 = mat._m21;  _m22 = mat._m22; _m22 = mat._m22;
+			_m20 = mat._m20;  _m21 = mat._m21;  _m22 = mat._m22; _m23 = mat._m23;
 			_m30 = mat._m30;  _m31 = mat._m31;  _m32 = mat._m32; _m33 = mat._m33;
 
 			return *this;
 		}
 
-		inline Matrix4x4f& operator = (const Matrix3x3f &mat)
+		inline Matrix4x4& operator = (const Matrix3x3<T> &mat)
 		{
 			_m00 = mat._m00;  _m01 = mat._m01;  _m02 = mat._m02;
 			_m10 = mat._m10;  _m11 = mat._m11;  _m12 = mat._m12;
@@ -73,7 +74,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& operator = (const Matrix2x2f &mat)
+		inline Matrix4x4& operator = (const Matrix2x2f &mat)
 		{
 			_m00 = mat._m00;  _m01 = mat._m01;
 			_m10 = mat._m10;  _m11 = mat._m11;
@@ -84,11 +85,11 @@ namespace h2
 
 		// Unary operators
 
-		inline Matrix4x4f operator + () const { return *this; }
+		inline Matrix4x4 operator + () const { return *this; }
 
-		inline Matrix4x4f operator - () const
+		inline Matrix4x4 operator - () const
 		{
-			return Matrix4x4f(-_m00, -_m01, -_m02, -_m03,
+			return Matrix4x4(-_m00, -_m01, -_m02, -_m03,
 							  -_m10, -_m11, -_m12, -_m13,
 							  -_m20, -_m21, -_m22, -_m23,
 							  -_m30, -_m31, -_m32, -_m33);
@@ -97,33 +98,33 @@ namespace h2
 
 		// Binary operators
 
-		inline Matrix4x4f operator + (const Matrix4x4f& mat) const
+		inline Matrix4x4 operator + (const Matrix4x4& mat) const
 		{
-			return Matrix4x4f(_m00 + mat._m00,  _m01 + mat._m01,  _m02 + mat._m02, _m03 + mat._m03,
+			return Matrix4x4(_m00 + mat._m00,  _m01 + mat._m01,  _m02 + mat._m02, _m03 + mat._m03,
 							  _m10 + mat._m10,  _m11 + mat._m11,  _m12 + mat._m12, _m13 + mat._m13,
 							  _m20 + mat._m20,  _m21 + mat._m21,  _m22 + mat._m22, _m23 + mat._m23,
 							  _m30 + mat._m30,  _m31 + mat._m31,  _m32 + mat._m32, _m33 + mat._m33);
 		}
 
-		inline Matrix4x4f operator - (const Matrix4x4f& mat) const
+		inline Matrix4x4 operator - (const Matrix4x4& mat) const
 		{
-			return Matrix4x4f(_m00 - mat._m00,  _m01 - mat._m01,  _m02 - mat._m02, _m03 - mat._m03,
+			return Matrix4x4(_m00 - mat._m00,  _m01 - mat._m01,  _m02 - mat._m02, _m03 - mat._m03,
 							  _m10 - mat._m10,  _m11 - mat._m11,  _m12 - mat._m12, _m13 - mat._m13,
 							  _m20 - mat._m20,  _m21 - mat._m21,  _m22 - mat._m22, _m23 - mat._m23,
 							  _m30 - mat._m30,  _m31 - mat._m31,  _m32 - mat._m32, _m33 - mat._m33);
 		}
 
-		inline Matrix4x4f operator * (float val) const
+		inline Matrix4x4 operator * (T val) const
 		{
-			return Matrix4x4f(_m00*val, _m01*val, _m02*val, _m03*val,
+			return Matrix4x4(_m00*val, _m01*val, _m02*val, _m03*val,
 							  _m10*val, _m11*val, _m12*val, _m13*val,
 							  _m20*val, _m21*val, _m22*val, _m23*val,
 							  _m30*val, _m31*val, _m32*val, _m33*val);
 		}
 
-		friend Matrix4x4f operator * (float val, const Matrix4x4f& mat)
+		friend Matrix4x4 operator * (T val, const Matrix4x4& mat)
 		{
-			return Matrix4x4f(mat._m00*val, mat._m01*val, mat._m02*val, mat._m03*val,
+			return Matrix4x4(mat._m00*val, mat._m01*val, mat._m02*val, mat._m03*val,
 							  mat._m10*val, mat._m11*val, mat._m12*val, mat._m13*val,
 							  mat._m20*val, mat._m21*val, mat._m22*val, mat._m23*val,
 							  mat._m30*val, mat._m31*val, mat._m32*val, mat._m33*val);
@@ -137,7 +138,7 @@ namespace h2
 							_m30*vec.x + _m31*vec.y + _m32*vec.z + _m33*vec.w);
 		}
 
-		friend Vector4f operator * (const Vector4f& vec, const Matrix4x4f& mat)
+		friend Vector4f operator * (const Vector4f& vec, const Matrix4x4& mat)
 		{
 			return Vector4f(vec.x*mat._m00 + vec.y*mat._m10 + vec.z*mat._m20 + vec.w*mat._m30,
 							vec.x*mat._m01 + vec.y*mat._m11 + vec.z*mat._m21 + vec.w*mat._m31,
@@ -145,16 +146,16 @@ namespace h2
 							vec.x*mat._m03 + vec.y*mat._m13 + vec.z*mat._m23 + vec.w*mat._m33);
 		}
 
-		inline Matrix4x4f operator * (const Matrix4x4f& mat) const
+		inline Matrix4x4 operator * (const Matrix4x4& mat) const
 		{
-			Matrix4x4f rMat;
+			Matrix4x4 rMat;
 
 			rMat._m00 = _m00*mat._m00 + _m01*mat._m10 + _m02*mat._m20 + _m03*mat._m30;
 			rMat._m01 = _m00*mat._m01 + _m01*mat._m11 + _m02*mat._m21 + _m03*mat._m31;
 			rMat._m02 = _m00*mat._m02 + _m01*mat._m12 + _m02*mat._m22 + _m03*mat._m32;
 			rMat._m03 = _m00*mat._m03 + _m01*mat._m13 + _m02*mat._m23 + _m03*mat._m33;
 			rMat._m10 = _m10*mat._m00 + _m11*mat._m10 + _m12*mat._m20 + _m13*mat._m30;
-			rMat._m11 = _m10*mat._m01 + _m11*mat._m11 + _m12*mat._m23 + _m13*mat._m31;
+			rMat._m11 = _m10*mat._m01 + _m11*mat._m11 + _m12*mat._m21 + _m13*mat._m31;
 			rMat._m12 = _m10*mat._m02 + _m11*mat._m12 + _m12*mat._m22 + _m13*mat._m32;
 			rMat._m13 = _m10*mat._m03 + _m11*mat._m13 + _m12*mat._m23 + _m13*mat._m33;
 			rMat._m20 = _m20*mat._m00 + _m21*mat._m10 + _m22*mat._m20 + _m23*mat._m30;
@@ -164,15 +165,15 @@ namespace h2
 			rMat._m30 = _m30*mat._m00 + _m31*mat._m10 + _m32*mat._m20 + _m33*mat._m30;
 			rMat._m31 = _m30*mat._m01 + _m31*mat._m11 + _m32*mat._m21 + _m33*mat._m31;
 			rMat._m32 = _m30*mat._m02 + _m31*mat._m12 + _m32*mat._m22 + _m33*mat._m32;
-			rMat._m33 = _m30*mat._m03 + _m31*mat._m13 + _m32*mat._m22 + _m33*mat._m33;
+			rMat._m33 = _m30*mat._m03 + _m31*mat._m13 + _m32*mat._m23 + _m33*mat._m33;
 
 			return rMat;
 		}
 
-		inline Matrix4x4f operator / (float val) const
+		inline Matrix4x4 operator / (T val) const
 		{
-			float invVal = 1.0f/val;
-			return Matrix4x4f(_m00*invVal, _m01*invVal, _m02*invVal, _m03*invVal,
+			T invVal = (T)1/val;
+			return Matrix4x4(_m00*invVal, _m01*invVal, _m02*invVal, _m03*invVal,
 							  _m10*invVal, _m11*invVal, _m12*invVal, _m13*invVal,
 							  _m20*invVal, _m21*invVal, _m22*invVal, _m23*invVal,
 							  _m30*invVal, _m31*invVal, _m32*invVal, _m33*invVal);
@@ -181,7 +182,7 @@ namespace h2
 
 		// Assigment operators
 
-		inline Matrix4x4f& operator += (const Matrix4x4f& mat)
+		inline Matrix4x4& operator += (const Matrix4x4& mat)
 		{
 			_m00 += mat._m00;  _m01 += mat._m01;  _m02 += mat._m02;  _m03 += mat._m03;
 			_m10 += mat._m10;  _m11 += mat._m11;  _m12 += mat._m12;  _m13 += mat._m13;
@@ -191,7 +192,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& operator -= (const Matrix4x4f& mat)
+		inline Matrix4x4& operator -= (const Matrix4x4& mat)
 		{
 			_m00 -= mat._m00;  _m01 -= mat._m01;  _m02 -= mat._m02;  _m03 -= mat._m03;
 			_m10 -= mat._m10;  _m11 -= mat._m11;  _m12 -= mat._m12;  _m13 -= mat._m13;
@@ -201,7 +202,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& operator *= (float val)
+		inline Matrix4x4& operator *= (T val)
 		{
 			_m00 *= val;  _m01 *= val;  _m02 *= val;  _m03 *= val;
 			_m10 *= val;  _m11 *= val;  _m12 *= val;  _m13 *= val;
@@ -211,31 +212,16 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& operator *= (const Matrix4x4f& mat)
-		{
-			_m00 = _m00*mat._m00 + _m01*mat._m10 + _m02*mat._m20 + _m03*mat._m30;
-			_m01 = _m00*mat._m01 + _m01*mat._m11 + _m02*mat._m21 + _m03*mat._m31;
-			_m02 = _m00*mat._m02 + _m01*mat._m12 + _m02*mat._m22 + _m03*mat._m32;
-			_m03 = _m00*mat._m03 + _m01*mat._m13 + _m02*mat._m23 + _m03*mat._m33;
-			_m10 = _m10*mat._m00 + _m11*mat._m10 + _m12*mat._m20 + _m13*mat._m30;
-			_m11 = _m10*mat._m01 + _m11*mat._m11 + _m12*mat._m23 + _m13*mat._m31;
-			_m12 = _m10*mat._m02 + _m11*mat._m12 + _m12*mat._m22 + _m13*mat._m32;
-			_m13 = _m10*mat._m03 + _m11*mat._m13 + _m12*mat._m23 + _m13*mat._m33;
-			_m20 = _m20*mat._m00 + _m21*mat._m10 + _m22*mat._m20 + _m23*mat._m30;
-			_m21 = _m20*mat._m01 + _m21*mat._m11 + _m22*mat._m21 + _m23*mat._m31;
-			_m22 = _m20*mat._m02 + _m21*mat._m12 + _m22*mat._m22 + _m23*mat._m32;
-			_m23 = _m20*mat._m03 + _m21*mat._m13 + _m22*mat._m23 + _m23*mat._m33;
-			_m30 = _m30*mat._m00 + _m31*mat._m10 + _m32*mat._m20 + _m33*mat._m30;
-			_m31 = _m30*mat._m01 + _m31*mat._m11 + _m32*mat._m21 + _m33*mat._m31;
-			_m32 = _m30*mat._m02 + _m31*mat._m12 + _m32*mat._m22 + _m33*mat._m32;
-			_m33 = _m30*mat._m03 + _m31*mat._m13 + _m32*mat._m22 + _m33*mat._m33;
+		inline Matrix4x4& operator *= (const Matrix4x4& mat)
+		{
+			*this = *this * mat;
 
 			return *this;
 		}
 
-		inline Matrix4x4f& operator /= (float val)
+		inline Matrix4x4& operator /= (T val)
 		{
-			float invVal = 1.0f/val;
+			T invVal = (T)1/val;
 
 			_m00 *= invVal;  _m01 *= invVal;  _m02 *= invVal;  _m03 *= invVal;
 			_m10 *= invVal;  _m11 *= invVal;  _m12 *= invVal;  _m13 *= invVal;
@@ -248,7 +234,7 @@ namespace h2
 
 		// Methods
 
-		inline Matrix4x4f& setZero()
+		inline Matrix4x4& setZero()
 		{
 			_m00 = 0;  _m01 = 0;  _m02 = 0;  _m03 = 0;
 			_m10 = 0;  _m11 = 0;  _m12 = 0;  _m13 = 0;
@@ -258,44 +244,44 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setIdentity()
+		inline Matrix4x4& setIdentity()
 		{
-			_m00 = 1.0f;  _m01 = 0;     _m02 = 0;     _m03 = 0;
-			_m10 = 0;     _m11 = 1.0f;  _m12 = 0;     _m13 = 0;
-			_m20 = 0;     _m21 = 0;     _m22 = 1.0f;  _m23 = 0;
-			_m30 = 0;     _m31 = 0;     _m32 = 0;     _m33 = 1.0f;
+			_m00 = 1;  _m01 = 0;  _m02 = 0;  _m03 = 0;
+			_m10 = 0;  _m11 = 1;  _m12 = 0;  _m13 = 0;
+			_m20 = 0;  _m21 = 0;  _m22 = 1;  _m23 = 0;
+			_m30 = 0;  _m31 = 0;  _m32 = 0;  _m33 = 1;
 
 			return *this;
 		}
 
-		inline Matrix4x4f transpose() const
+		inline Matrix4x4 transpose() const
 		{
-			return Matrix4x4f(_m00, _m10, _m20, _m30,
+			return Matrix4x4(_m00, _m10, _m20, _m30,
 							  _m01, _m11, _m21, _m31,
 							  _m02, _m12, _m22, _m32,
 							  _m03, _m13, _m23, _m33);
 		}
 
-		inline float determinant() const
+		inline T determinant() const
 		{
-			return _m00*(Matrix3x3f(_m11, _m21, _m31,
-									_m12, _m22, _m32,
-									_m13, _m23, _m33).determinant()) - 
+			return _m00*(Matrix3x3<T>(_m11, _m12, _m13,
+									  _m21, _m22, _m23,
+									  _m31, _m32, _m33).determinant()) - 
 
-				   _m01*(Matrix3x3f(_m01, _m21, _m31,
-									_m02, _m22, _m32,
-									_m03, _m23, _m33).determinant()) + 
+				   _m01*(Matrix3x3<T>(_m10, _m12, _m13,
+									  _m20, _m22, _m23,
+									  _m30, _m32, _m33).determinant()) + 
 
-				   _m02*(Matrix3x3f(_m01, _m11, _m31,
-									_m02, _m12, _m32,
-									_m03, _m13, _m33).determinant()) -
+				   _m02*(Matrix3x3<T>(_m10, _m11, _m13,
+									  _m20, _m21, _m23,
+									  _m30, _m31, _m33).determinant()) -
 
-				   _m03*(Matrix3x3f(_m01, _m11, _m21,
-									_m02, _m12, _m22,
-									_m03, _m13, _m23).determinant());
+				   _m03*(Matrix3x3<T>(_m10, _m11, _m12,
+									  _m20, _m21, _m22,
+									  _m30, _m31, _m32).determinant());
 		}
 
-		inline Matrix4x4f& setRow(unsigned int row, float valA, float valB, float valC, float valD)
+		inline Matrix4x4& setRow(unsigned int row, T valA, T valB, T valC, T valD)
 		{
 			m[row][0] = valA;
 			m[row][1] = valB;
@@ -305,7 +291,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setRow(unsigned int row, const Vector2f& vec, float valA, float valB)
+		inline Matrix4x4& setRow(unsigned int row, const Vector2f& vec, T valA, T valB)
 		{
 			m[row][0] = vec.x;
 			m[row][1] = vec.y;
@@ -315,7 +301,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setRow(unsigned int row, float valA, const Vector2f& vec, float valB)
+		inline Matrix4x4& setRow(unsigned int row, T valA, const Vector2f& vec, T valB)
 		{
 			m[row][0] = valA;
 			m[row][1] = vec.x;
@@ -325,7 +311,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setRow(unsigned int row, float valA, float valB, const Vector2f& vec)
+		inline Matrix4x4& setRow(unsigned int row, T valA, T valB, const Vector2f& vec)
 		{
 			m[row][0] = valA;
 			m[row][1] = valB;
@@ -335,7 +321,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setRow(unsigned int row, const Vector3f& vec, float val)
+		inline Matrix4x4& setRow(unsigned int row, const Vector3<T>& vec, T val)
 		{
 			m[row][0] = vec.x;
 			m[row][1] = vec.y;
@@ -345,7 +331,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setRow(unsigned int row, float val, const Vector3f& vec)
+		inline Matrix4x4& setRow(unsigned int row, T val, const Vector3<T>& vec)
 		{
 			m[row][0] = val;
 			m[row][1] = vec.x;
@@ -355,7 +341,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setRow(unsigned int row, const Vector4f& vec)
+		inline Matrix4x4& setRow(unsigned int row, const Vector4f& vec)
 		{
 			m[row][0] = vec.x;
 			m[row][1] = vec.y;
@@ -367,7 +353,7 @@ namespace h2
 
 	///////////////
 
-		inline Matrix4x4f& setColumn(unsigned int column, float valA, float valB, float valC, float valD)
+		inline Matrix4x4& setColumn(unsigned int column, T valA, T valB, T valC, T valD)
 		{
 			m[0][column] = valA;
 			m[1][column] = valB;
@@ -377,7 +363,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setColumn(unsigned int column, const Vector2f& vec, float valA, float valB)
+		inline Matrix4x4& setColumn(unsigned int column, const Vector2f& vec, T valA, T valB)
 		{
 			m[0][column] = vec.x;
 			m[1][column] = vec.y;
@@ -387,7 +373,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setColumn(unsigned int column, float valA, const Vector2f& vec, float valB)
+		inline Matrix4x4& setColumn(unsigned int column, T valA, const Vector2f& vec, T valB)
 		{
 			m[0][column] = valA;
 			m[1][column] = vec.x;
@@ -397,7 +383,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setColumn(unsigned int column, float valA, float valB, const Vector2f& vec)
+		inline Matrix4x4& setColumn(unsigned int column, T valA, T valB, const Vector2f& vec)
 		{
 			m[0][column] = valA;
 			m[1][column] = valB;
@@ -407,7 +393,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setColumn(unsigned int column, const Vector3f& vec, float val)
+		inline Matrix4x4& setColumn(unsigned int column, const Vector3<T>& vec, T val)
 		{
 			m[0][column] = vec.x;
 			m[1][column] = vec.y;
@@ -417,7 +403,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setColumn(unsigned int column, float val, const Vector3f& vec)
+		inline Matrix4x4& setColumn(unsigned int column, T val, const Vector3<T>& vec)
 		{
 			m[0][column] = val;
 			m[1][column] = vec.x;
@@ -427,7 +413,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Matrix4x4f& setColumn(unsigned int column, const Vector4f& vec)
+		inline Matrix4x4& setColumn(unsigned int column, const Vector4f& vec)
 		{
 			m[0][column] = vec.x;
 			m[1][column] = vec.y;
@@ -436,5 +422,41 @@ namespace h2
 
 			return *this;
 		}
+
+	///////////////
+
+		inline Matrix4x4& setTranslation(const Vector3<T>& vec)
+		{
+			_m03 = vec.x;
+			_m13 = vec.y;
+			_m23 = vec.z;
+
+			return *this;
+		}
+
+		inline Vector3<T> getTranslation() const
+		{
+			return Vector3<T>(_m03, _m13, _m23);
+		}
+
+		// Transforms point (w = 1), affine matrices only.
+		inline Vector3<T> transformPoint(const Vector3<T>& vec) const
+		{
+			return Vector3<T>(_m00*vec.x + _m01*vec.y + _m02*vec.z + _m03,
+							  _m10*vec.x + _m11*vec.y + _m12*vec.z + _m13,
+							  _m20*vec.x + _m21*vec.y + _m22*vec.z + _m23);
+		}
+
+		// Transforms direction (w = 0), translation is ignored.
+		inline Vector3<T> transformVector(const Vector3<T>& vec) const
+		{
+			return Vector3<T>(_m00*vec.x + _m01*vec.y + _m02*vec.z,
+							  _m10*vec.x + _m11*vec.y + _m12*vec.z,
+							  _m20*vec.x + _m21*vec.y + _m22*vec.z);
+		}
 	};
+
+
+	typedef Matrix4x4<float>  Matrix4x4f;
+	typedef Matrix4x4<double> Matrix4x4d;
 }
\ No newline at end of file
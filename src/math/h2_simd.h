@@ -0,0 +1,21 @@
+#pragma once
+
+
+
+// SSE is used when compiler targets it (always on x64),
+// otherwise batch functions fall back to scalar loops.
+// Define H2_NO_SIMD to force scalar code.
+
+#if !defined(H2_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+	#define H2_SIMD_SSE 1
+	#include <xmmintrin.h>
+#endif
+
+// SSE2 adds integer vectors, used by sample format conversion.
+#if defined(H2_SIMD_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define H2_SIMD_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+
+#define H2_SIMD_WIDTH 4
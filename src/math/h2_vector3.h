@@ -7,7 +7,8 @@
 
 namespace h2
 {
-	class Vector3f
+	template <class T>
+	class Vector3
 	{
 	public:
 
@@ -17,32 +18,33 @@ namespace h2
 		{
 			struct 
 			{
-				float x, y, z;
+				T x, y, z;
 			};
 
-			float v[3];
+			T v[3];
 		};
 
 
 		// Constructors 
 
-		Vector3f() : x(0), y(0), z(0) {}
+		Vector3() : x(0), y(0), z(0) {}
 
-		Vector3f(const float x, const float y, const float z) : x(x), y(y), z(z) {}
+		Vector3(const T x, const T y, const T z) : x(x), y(y), z(z) {}
 
-		Vector3f(const float* arr) : x(arr[0]), y(arr[1]), z(arr[2]) {}
+		Vector3(const T* arr) : x(arr[0]), y(arr[1]), z(arr[2]) {}
 
-		Vector3f(Vector2f const &vec, const float z) : x(vec.x), y(vec.y), z(z) {}
+		Vector3(Vector2f const &vec, const T z) : x(vec.x), y(vec.y), z(z) {}
 
-		Vector3f(const float x, Vector2f const &vec) : x(x), y(vec.x), z(vec.y) {}
+		Vector3(const T x, Vector2f const &vec) : x(x), y(vec.x), z(vec.y) {}
 
+		// Explicit, so float and double vectors never convert silently.
 		template <class VecType>
-		Vector3f(VecType const &vec) : x(vec.v[0]), y(vec.v[1]), z(vec.v[2]) {}
+		explicit Vector3(VecType const &vec) : x((T)vec.v[0]), y((T)vec.v[1]), z((T)vec.v[2]) {}
 
 
 		// Copy
 
-		Vector3f& operator = (const Vector3f &vec)
+		Vector3& operator = (const Vector3 &vec)
 		{
 			x = vec.x;
 			y = vec.y;
@@ -53,48 +55,48 @@ namespace h2
 
 		// Unary operators
 
-		inline Vector3f operator + () const { return *this; }
+		inline Vector3 operator + () const { return *this; }
 
-		inline Vector3f operator - () const { return Vector3f(-x, -y, -z); }
+		inline Vector3 operator - () const { return Vector3(-x, -y, -z); }
 
 
 		// Binary operators
 
-		inline Vector3f operator + (const Vector3f& vec) const
+		inline Vector3 operator + (const Vector3& vec) const
 		{
-			return Vector3f(x + vec.x, y + vec.y, z + vec.z);
+			return Vector3(x + vec.x, y + vec.y, z + vec.z);
 		}
 
-		inline Vector3f operator - (const Vector3f& vec) const
+		inline Vector3 operator - (const Vector3& vec) const
 		{
-			return Vector3f(x - vec.x, y - vec.y, z - vec.z);
+			return Vector3(x - vec.x, y - vec.y, z - vec.z);
 		}
 
-		inline Vector3f operator * (float val) const
+		inline Vector3 operator * (T val) const
 		{
-			return Vector3f(x*val, y*val, z*val);
+			return Vector3(x*val, y*val, z*val);
 		}
 
-		inline Vector3f operator * (const Vector3f& vec) const
+		inline Vector3 operator * (const Vector3& vec) const
 		{
-			return Vector3f(x*vec.x, y*vec.y, z*vec.z);
+			return Vector3(x*vec.x, y*vec.y, z*vec.z);
 		}
 
-		friend Vector3f operator * (float val, const Vector3f& vec)
+		friend Vector3 operator * (T val, const Vector3& vec)
 		{
-			return Vector3f(val * vec.x, val * vec.y, val * vec.z);
+			return Vector3(val * vec.x, val * vec.y, val * vec.z);
 		}
 
-		inline Vector3f operator / (float val) const
+		inline Vector3 operator / (T val) const
 		{
-			float invVal = 1.0f/val;
-			return Vector3f(x*invVal, y*invVal, z*invVal);
+			T invVal = (T)1/val;
+			return Vector3(x*invVal, y*invVal, z*invVal);
 		}
 
 
 		// Assigment operators
 
-		inline Vector3f& operator += (const Vector3f& vec)
+		inline Vector3& operator += (const Vector3& vec)
 		{
 			x += vec.x;
 			y += vec.y;
@@ -102,7 +104,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Vector3f& operator -= (const Vector3f& vec)
+		inline Vector3& operator -= (const Vector3& vec)
 		{
 			x -= vec.x;
 			y -= vec.y;
@@ -110,7 +112,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Vector3f& operator *= (const Vector3f& vec)
+		inline Vector3& operator *= (const Vector3& vec)
 		{
 			x *= vec.x;
 			y *= vec.y;
@@ -118,7 +120,7 @@ namespace h2
 			return *this;
 		}
 
-		inline Vector3f& operator *= (float val)
+		inline Vector3& operator *= (T val)
 		{
 			x *= val;
 			y *= val;
@@ -126,9 +128,9 @@ namespace h2
 			return *this;
 		}
 
-		inline Vector3f& operator /= (float val)
+		inline Vector3& operator /= (T val)
 		{
-			float invVal = 1.0f/val;
+			T invVal = (T)1/val;
 			x *= invVal;
 			y *= invVal;
 			z *= invVal;
@@ -138,32 +140,36 @@ namespace h2
 
 		// Methods
 
-		inline float lenght()
+		inline T lenght()
 		{
 			return sqrt(x*x + y*y + z*z);
 		}
 
-		inline float sqlenght()
+		inline T sqlenght()
 		{
 			return x*x + y*y + z*z;
 		}
 
-		Vector3f normalize()
+		Vector3 normalize()
 		{
-			float lenght = sqrt(x*x + y*y + z*z);
-			float invLenght;
+			T lenght = sqrt(x*x + y*y + z*z);
+			T invLenght;
 			if (lenght != 0) 
 			{
-				invLenght = 1.0f/lenght;
-				return Vector3f(x*invLenght, y*invLenght, z*invLenght);
+				invLenght = (T)1/lenght;
+				return Vector3(x*invLenght, y*invLenght, z*invLenght);
 			} else {
-				return Vector3f(x, y, z);
+				return Vector3(x, y, z);
 			}
 		}
 
-		inline float dot(const Vector3f& vec)
+		inline T dot(const Vector3& vec) const
 		{
 			return x*vec.x + y*vec.y + z*vec.z;
 		}
 	};
+
+
+	typedef Vector3<float>  Vector3f;
+	typedef Vector3<double> Vector3d;
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 
 
 
+#include "../core/h2_memory.h"
+
 #pragma warning (disable:4201) // nonstandard extension used : nameless struct/union
 
 
@@ -19,33 +21,19 @@ namespace h2
 
 		// Constructors
 
-		VectorNf() : dimension(_dimension)
+		VectorNf() : dimension(_dimension), v(storage)
 		{
-			v = (float*)malloc(sizeof(float)*dimension);
-			//v = new float[dimension];
 			memset(v, 0, sizeof(float)*dimension);
 		}
 
-		VectorNf(const VectorNf &copy) : dimension(copy.dimension)
+		VectorNf(const VectorNf &copy) : dimension(copy.dimension), v(storage)
 		{
-			v = (float*)malloc(sizeof(float)*copy.dimension);
-			//v = new float[copy.dimension];
-			memset(v, 0, sizeof(float)*dimension);
 			for(unsigned int i = 0; i < copy.dimension; i++)
 			{
 				v[i] = copy.v[i];
 			}
 		}
 
-
-		// Destructor
-
-		~VectorNf()
-		{
-			//delete[] v;
-			free(v);
-		}
-
 	    
 		// Copy
 
@@ -119,7 +107,7 @@ namespace h2
 		friend VectorNf operator * (float val, const VectorNf& vec)
 		{
 			VectorNf<_dimension> rVec;
-			for(unsigned int i = 0; i < dimension; i++)
+			for(unsigned int i = 0; i < _dimension; i++)
 			{
 				rVec.v[i] = val * vec.v[i];
 			}
@@ -235,9 +223,14 @@ namespace h2
 			float sum = 0;
 			for(unsigned int i = 0; i < dimension; i++)
 			{
-				sum += v[i] * vec.v[i]
+				sum += v[i] * vec.v[i];
 			}
 			return sum;
 		}
+
+	private:
+
+		// in place, temporaries cost no allocation
+		float storage[_dimension];
 	};
 }
\ No newline at end of file
@@ -0,0 +1,653 @@
+// Microbenchmarks for the math library.
+//
+// Linux:
+//   g++ -O2 -I../../../../sdl/include h2_math_bench.cpp -o h2_math_bench
+//
+// Usage:
+//   h2_math_bench [--list] [--filter text] [--samples n] [--min-time ms]
+//                          [--save file.json] [--compare file.json] [--threshold percent]
+//
+// Every benchmark applies one operation to operands cycled from a small
+// pool of random values and stores the result, so the work can neither
+// be hoisted out of the loop nor dropped. Iterations are independent,
+// the numbers are throughput, not latency. A sample runs for at least
+// '--min-time'; ns/op is the median over samples, min ns/op the fastest.
+//
+// '--save' writes the results as a JSON baseline, '--compare' reads one
+// and flags benchmarks whose min ns/op is above the baseline's by more
+// than '--threshold' percent; the exit code is then 1. The minimum is
+// compared because noise from the rest of the system only adds time.
+// Baselines are only comparable on the machine and build that recorded
+// them; the ones in '../baselines' are named after platform and compiler.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+#include "../../../h2_math.h"
+
+
+
+#define H2_BENCH_POOL_SIZE 256   // power of two, operands stay in L1
+#define H2_BENCH_POOL_MASK (H2_BENCH_POOL_SIZE - 1)
+
+#define H2_BENCH_DEFAULT_SAMPLES 5
+#define H2_BENCH_DEFAULT_MIN_TIME 10.0     // ms per sample
+#define H2_BENCH_DEFAULT_THRESHOLD 10.0    // percent
+
+#define H2_BENCH_MAX_ITERATIONS (1u << 30)
+
+
+using namespace h2;
+
+
+// Timer
+
+static double nowNs()
+{
+#if defined(_WIN32)
+	static double nsPerTick = 0;
+	if (nsPerTick == 0)
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		nsPerTick = 1e9/(double)frequency.QuadPart;
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart*nsPerTick;
+#else
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec*1e9 + (double)t.tv_nsec;
+#endif
+}
+
+
+// Operands
+
+static unsigned int randomState = 12345;
+
+// Magnitude in [0.5, 2), either sign, so divisions stay finite.
+static float randomFloat()
+{
+	randomState = randomState*1664525u + 1013904223u;
+	float u = (float)(randomState >> 8)/(float)(1u << 24);
+
+	return (randomState & 0x80u) ? -(0.5f + 1.5f*u) : 0.5f + 1.5f*u;
+}
+
+// Vectors, matrices and quaternions are plain arrays of floats.
+template <class T>
+void randomize(T& val)
+{
+	float* f = (float*)&val;
+	for (unsigned int i = 0; i < sizeof(T)/sizeof(float); i++)
+	{
+		f[i] = randomFloat();
+	}
+}
+
+template <unsigned int _dimension>
+void randomize(VectorNf<_dimension>& vec)
+{
+	for (unsigned int i = 0; i < _dimension; i++)
+	{
+		vec.v[i] = randomFloat();
+	}
+}
+
+
+// Operands 'a', 'b', 'c' and results 'out' of one type.
+template <class T>
+struct BenchPool
+{
+	static T a[H2_BENCH_POOL_SIZE];
+	static T b[H2_BENCH_POOL_SIZE];
+	static T c[H2_BENCH_POOL_SIZE];
+	static T out[H2_BENCH_POOL_SIZE];
+
+	static void init()
+	{
+		for (unsigned int i = 0; i < H2_BENCH_POOL_SIZE; i++)
+		{
+			randomize(a[i]);
+			randomize(b[i]);
+			randomize(c[i]);
+		}
+	}
+};
+
+template <class T> T BenchPool<T>::a[H2_BENCH_POOL_SIZE];
+template <class T> T BenchPool<T>::b[H2_BENCH_POOL_SIZE];
+template <class T> T BenchPool<T>::c[H2_BENCH_POOL_SIZE];
+template <class T> T BenchPool<T>::out[H2_BENCH_POOL_SIZE];
+
+
+typedef VectorNf<16> Vector16f;
+
+static void initPools()
+{
+	BenchPool<float>::init();
+	BenchPool<Vector2f>::init();
+	BenchPool<Vector3f>::init();
+	BenchPool<Vector4f>::init();
+	BenchPool<Vector16f>::init();
+	BenchPool<Matrix2x2f>::init();
+	BenchPool<Matrix3x3f>::init();
+	BenchPool<Matrix4x4f>::init();
+	BenchPool<Quaternion>::init();
+}
+
+
+// Benchmarks
+
+// Defines 'void id(unsigned int n)' running 'statement' n times with
+// operands 'a[j]', 'b[j]' of types A and B, scalar 's[j]' and result
+// 'out[j]' of type R.
+#define H2_BENCH(id, A, B, R, statement) \
+	static void id(unsigned int n) \
+	{ \
+		A* a = BenchPool<A>::a; \
+		B* b = BenchPool<B>::b; \
+		const float* s = BenchPool<float>::c; \
+		R* out = BenchPool<R>::out; \
+		(void)a; (void)b; (void)s; \
+		for (unsigned int i = 0; i < n; i++) \
+		{ \
+			unsigned int j = i & H2_BENCH_POOL_MASK; \
+			statement; \
+		} \
+	}
+
+
+// Operators and methods shared by all vector types.
+#define H2_BENCH_VECTOR(id, V) \
+	H2_BENCH(id##_pos,         V, V, V,     out[j] = +a[j]) \
+	H2_BENCH(id##_neg,         V, V, V,     out[j] = -a[j]) \
+	H2_BENCH(id##_add,         V, V, V,     out[j] = a[j] + b[j]) \
+	H2_BENCH(id##_sub,         V, V, V,     out[j] = a[j] - b[j]) \
+	H2_BENCH(id##_mul_scalar,  V, V, V,     out[j] = a[j]*s[j]) \
+	H2_BENCH(id##_scalar_mul,  V, V, V,     out[j] = s[j]*a[j]) \
+	H2_BENCH(id##_mul,         V, V, V,     out[j] = a[j]*b[j]) \
+	H2_BENCH(id##_div_scalar,  V, V, V,     out[j] = a[j]/s[j]) \
+	H2_BENCH(id##_add_assign,  V, V, V,     out[j] = a[j]; out[j] += b[j]) \
+	H2_BENCH(id##_sub_assign,  V, V, V,     out[j] = a[j]; out[j] -= b[j]) \
+	H2_BENCH(id##_mul_assign,  V, V, V,     out[j] = a[j]; out[j] *= b[j]) \
+	H2_BENCH(id##_mul_assign_scalar, V, V, V, out[j] = a[j]; out[j] *= s[j]) \
+	H2_BENCH(id##_div_assign_scalar, V, V, V, out[j] = a[j]; out[j] /= s[j]) \
+	H2_BENCH(id##_length,      V, V, float, out[j] = a[j].lenght()) \
+	H2_BENCH(id##_sqlength,    V, V, float, out[j] = a[j].sqlenght()) \
+	H2_BENCH(id##_normalize,   V, V, V,     out[j] = a[j].normalize()) \
+	H2_BENCH(id##_dot,         V, V, float, out[j] = a[j].dot(b[j]))
+
+#define H2_BENCH_VECTOR_ENTRIES(id, name) \
+	{ name ".pos", id##_pos }, \
+	{ name ".neg", id##_neg }, \
+	{ name ".add", id##_add }, \
+	{ name ".sub", id##_sub }, \
+	{ name ".mul_scalar", id##_mul_scalar }, \
+	{ name ".scalar_mul", id##_scalar_mul }, \
+	{ name ".mul", id##_mul }, \
+	{ name ".div_scalar", id##_div_scalar }, \
+	{ name ".add_assign", id##_add_assign }, \
+	{ name ".sub_assign", id##_sub_assign }, \
+	{ name ".mul_assign", id##_mul_assign }, \
+	{ name ".mul_assign_scalar", id##_mul_assign_scalar }, \
+	{ name ".div_assign_scalar", id##_div_assign_scalar }, \
+	{ name ".length", id##_length }, \
+	{ name ".sqlength", id##_sqlength }, \
+	{ name ".normalize", id##_normalize }, \
+	{ name ".dot", id##_dot }
+
+
+// Operators and methods shared by all square matrix types, 'V' is the
+// vector type the matrix multiplies.
+#define H2_BENCH_MATRIX(id, M, V) \
+	H2_BENCH(id##_pos,         M, M, M,     out[j] = +a[j]) \
+	H2_BENCH(id##_neg,         M, M, M,     out[j] = -a[j]) \
+	H2_BENCH(id##_add,         M, M, M,     out[j] = a[j] + b[j]) \
+	H2_BENCH(id##_sub,         M, M, M,     out[j] = a[j] - b[j]) \
+	H2_BENCH(id##_mul_scalar,  M, M, M,     out[j] = a[j]*s[j]) \
+	H2_BENCH(id##_scalar_mul,  M, M, M,     out[j] = s[j]*a[j]) \
+	H2_BENCH(id##_mul_vector,  M, V, V,     out[j] = a[j]*b[j]) \
+	H2_BENCH(id##_vector_mul,  V, M, V,     out[j] = a[j]*b[j]) \
+	H2_BENCH(id##_mul,         M, M, M,     out[j] = a[j]*b[j]) \
+	H2_BENCH(id##_div_scalar,  M, M, M,     out[j] = a[j]/s[j]) \
+	H2_BENCH(id##_add_assign,  M, M, M,     out[j] = a[j]; out[j] += b[j]) \
+	H2_BENCH(id##_sub_assign,  M, M, M,     out[j] = a[j]; out[j] -= b[j]) \
+	H2_BENCH(id##_mul_assign,  M, M, M,     out[j] = a[j]; out[j] *= b[j]) \
+	H2_BENCH(id##_mul_assign_scalar, M, M, M, out[j] = a[j]; out[j] *= s[j]) \
+	H2_BENCH(id##_div_assign_scalar, M, M, M, out[j] = a[j]; out[j] /= s[j]) \
+	H2_BENCH(id##_transpose,   M, M, M,     out[j] = a[j].transpose()) \
+	H2_BENCH(id##_determinant, M, M, float, out[j] = a[j].determinant())
+
+#define H2_BENCH_MATRIX_ENTRIES(id, name) \
+	{ name ".pos", id##_pos }, \
+	{ name ".neg", id##_neg }, \
+	{ name ".add", id##_add }, \
+	{ name ".sub", id##_sub }, \
+	{ name ".mul_scalar", id##_mul_scalar }, \
+	{ name ".scalar_mul", id##_scalar_mul }, \
+	{ name ".mul_vector", id##_mul_vector }, \
+	{ name ".vector_mul", id##_vector_mul }, \
+	{ name ".mul", id##_mul }, \
+	{ name ".div_scalar", id##_div_scalar }, \
+	{ name ".add_assign", id##_add_assign }, \
+	{ name ".sub_assign", id##_sub_assign }, \
+	{ name ".mul_assign", id##_mul_assign }, \
+	{ name ".mul_assign_scalar", id##_mul_assign_scalar }, \
+	{ name ".div_assign_scalar", id##_div_assign_scalar }, \
+	{ name ".transpose", id##_transpose }, \
+	{ name ".determinant", id##_determinant }
+
+
+H2_BENCH_VECTOR(vector2f, Vector2f)
+H2_BENCH_VECTOR(vector3f, Vector3f)
+H2_BENCH_VECTOR(vector4f, Vector4f)
+H2_BENCH_VECTOR(vectornf, Vector16f)
+
+H2_BENCH_MATRIX(matrix2x2f, Matrix2x2f, Vector2f)
+H2_BENCH_MATRIX(matrix3x3f, Matrix3x3f, Vector3f)
+H2_BENCH_MATRIX(matrix4x4f, Matrix4x4f, Vector4f)
+
+H2_BENCH(matrix4x4f_transform_point,  Matrix4x4f, Vector3f, Vector3f, out[j] = a[j].transformPoint(b[j]))
+H2_BENCH(matrix4x4f_transform_vector, Matrix4x4f, Vector3f, Vector3f, out[j] = a[j].transformVector(b[j]))
+
+H2_BENCH(quaternion_add,               Quaternion, Quaternion, Quaternion, out[j] = a[j] + b[j])
+H2_BENCH(quaternion_sub,               Quaternion, Quaternion, Quaternion, out[j] = a[j] - b[j])
+H2_BENCH(quaternion_mul_scalar,        Quaternion, Quaternion, Quaternion, out[j] = a[j]*s[j])
+H2_BENCH(quaternion_mul,               Quaternion, Quaternion, Quaternion, out[j] = a[j]*b[j])
+H2_BENCH(quaternion_add_assign,        Quaternion, Quaternion, Quaternion, out[j] = a[j]; out[j] += b[j])
+H2_BENCH(quaternion_sub_assign,        Quaternion, Quaternion, Quaternion, out[j] = a[j]; out[j] -= b[j])
+H2_BENCH(quaternion_mul_assign,        Quaternion, Quaternion, Quaternion, out[j] = a[j]; out[j] *= b[j])
+H2_BENCH(quaternion_mul_assign_scalar, Quaternion, Quaternion, Quaternion, out[j] = a[j]; out[j] *= s[j])
+H2_BENCH(quaternion_div_assign_scalar, Quaternion, Quaternion, Quaternion, out[j] = a[j]; out[j] /= s[j])
+H2_BENCH(quaternion_norm,              Quaternion, Quaternion, float,      out[j] = a[j].norm())
+H2_BENCH(quaternion_length,            Quaternion, Quaternion, float,      out[j] = a[j].lenght())
+H2_BENCH(quaternion_conjugate,         Quaternion, Quaternion, Quaternion, out[j] = a[j].conjugate())
+H2_BENCH(quaternion_inverse,           Quaternion, Quaternion, Quaternion, out[j] = a[j].inverse())
+H2_BENCH(quaternion_dot,               Quaternion, Quaternion, float,      out[j] = a[j].dot(b[j]))
+
+// Random coefficients mix the solvers' branches the way unrelated
+// queries would.
+static inline float solveSecondDegree(float a, float b, float c)
+{
+	float roots[2] = { 0, 0 };
+	int nRoots = solveSecondDegreeEquation(a, b, c, roots);
+	return roots[0] + roots[1] + (float)nRoots;
+}
+
+static inline float solveThirdDegree(float a, float b, float c, float d)
+{
+	float roots[3] = { 0, 0, 0 };
+	int nRoots = solveThirdDegreeEquation(a, b, c, d, roots);
+	return roots[0] + roots[1] + roots[2] + (float)nRoots;
+}
+
+H2_BENCH(solve_second_degree, float, float, float, out[j] = solveSecondDegree(a[j], b[j], s[j]))
+H2_BENCH(solve_third_degree,  float, float, float, out[j] = solveThirdDegree(a[j], b[j], s[j], a[(j + 1) & H2_BENCH_POOL_MASK]))
+
+H2_BENCH(bezier_linear_2f,    Vector2f, Vector2f, Vector2f, out[j] = linearBezier(a[j], b[j], s[j]))
+H2_BENCH(bezier_quadratic_2f, Vector2f, Vector2f, Vector2f, out[j] = quadraticBezier(a[j], b[j], BenchPool<Vector2f>::c[j], s[j]))
+H2_BENCH(bezier_cubic_2f,     Vector2f, Vector2f, Vector2f, out[j] = cubicBezier(a[j], b[j], BenchPool<Vector2f>::c[j], a[(j + 1) & H2_BENCH_POOL_MASK], s[j]))
+H2_BENCH(bezier_linear_3f,    Vector3f, Vector3f, Vector3f, out[j] = linearBezier(a[j], b[j], s[j]))
+H2_BENCH(bezier_quadratic_3f, Vector3f, Vector3f, Vector3f, out[j] = quadraticBezier(a[j], b[j], BenchPool<Vector3f>::c[j], s[j]))
+H2_BENCH(bezier_cubic_3f,     Vector3f, Vector3f, Vector3f, out[j] = cubicBezier(a[j], b[j], BenchPool<Vector3f>::c[j], a[(j + 1) & H2_BENCH_POOL_MASK], s[j]))
+
+
+struct Benchmark
+{
+	const char* name;
+
+	void (*run)(unsigned int n);
+};
+
+static const Benchmark benchmarks[] =
+{
+	H2_BENCH_VECTOR_ENTRIES(vector2f, "vector2f"),
+	H2_BENCH_VECTOR_ENTRIES(vector3f, "vector3f"),
+	H2_BENCH_VECTOR_ENTRIES(vector4f, "vector4f"),
+	H2_BENCH_VECTOR_ENTRIES(vectornf, "vectornf16"),
+
+	H2_BENCH_MATRIX_ENTRIES(matrix2x2f, "matrix2x2f"),
+	H2_BENCH_MATRIX_ENTRIES(matrix3x3f, "matrix3x3f"),
+	H2_BENCH_MATRIX_ENTRIES(matrix4x4f, "matrix4x4f"),
+	{ "matrix4x4f.transform_point", matrix4x4f_transform_point },
+	{ "matrix4x4f.transform_vector", matrix4x4f_transform_vector },
+
+	{ "quaternion.add", quaternion_add },
+	{ "quaternion.sub", quaternion_sub },
+	{ "quaternion.mul_scalar", quaternion_mul_scalar },
+	{ "quaternion.mul", quaternion_mul },
+	{ "quaternion.add_assign", quaternion_add_assign },
+	{ "quaternion.sub_assign", quaternion_sub_assign },
+	{ "quaternion.mul_assign", quaternion_mul_assign },
+	{ "quaternion.mul_assign_scalar", quaternion_mul_assign_scalar },
+	{ "quaternion.div_assign_scalar", quaternion_div_assign_scalar },
+	{ "quaternion.norm", quaternion_norm },
+	{ "quaternion.length", quaternion_length },
+	{ "quaternion.conjugate", quaternion_conjugate },
+	{ "quaternion.inverse", quaternion_inverse },
+	{ "quaternion.dot", quaternion_dot },
+
+	{ "solve.second_degree", solve_second_degree },
+	{ "solve.third_degree", solve_third_degree },
+
+	{ "bezier.linear_2f", bezier_linear_2f },
+	{ "bezier.quadratic_2f", bezier_quadratic_2f },
+	{ "bezier.cubic_2f", bezier_cubic_2f },
+	{ "bezier.linear_3f", bezier_linear_3f },
+	{ "bezier.quadratic_3f", bezier_quadratic_3f },
+	{ "bezier.cubic_3f", bezier_cubic_3f }
+};
+
+static const unsigned int nBenchmarks = sizeof(benchmarks)/sizeof(benchmarks[0]);
+
+
+// Measurement
+
+struct BenchResult
+{
+	const char* name;
+
+	double nsPerOp;         // median over samples
+	double nsPerOpMin;
+	unsigned int iterations;  // per sample
+
+	double baseline;        // min ns/op, 0 when not in the baseline
+};
+
+
+static BenchResult measure(const Benchmark& bench, unsigned int nSamples, double minSampleNs)
+{
+	BenchResult result;
+	result.name = bench.name;
+	result.baseline = 0;
+
+	// warm up, then double the iterations until a run is long enough
+	bench.run(H2_BENCH_POOL_SIZE);
+
+	unsigned int n = H2_BENCH_POOL_SIZE;
+	for (;;)
+	{
+		double begin = nowNs();
+		bench.run(n);
+		double elapsed = nowNs() - begin;
+
+		if (elapsed >= minSampleNs || n >= H2_BENCH_MAX_ITERATIONS)
+		{
+			break;
+		}
+
+		// jump close to the target once the timer resolution is not an issue
+		if (elapsed > minSampleNs/64)
+		{
+			double scale = 1.1*minSampleNs/elapsed;
+			n = scale*n < H2_BENCH_MAX_ITERATIONS ? (unsigned int)(scale*n) : H2_BENCH_MAX_ITERATIONS;
+		} else
+		{
+			n *= 2;
+		}
+	}
+
+	std::vector<double> samples(nSamples);
+	for (unsigned int i = 0; i < nSamples; i++)
+	{
+		double begin = nowNs();
+		bench.run(n);
+		samples[i] = (nowNs() - begin)/(double)n;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	result.nsPerOp = samples[nSamples/2];
+	result.nsPerOpMin = samples[0];
+	result.iterations = n;
+
+	return result;
+}
+
+
+// Baselines
+
+static bool saveBaseline(const char* path, const std::vector<BenchResult>& results)
+{
+	FILE* file = fopen(path, "w");
+	if (file == 0)
+	{
+		return false;
+	}
+
+	fprintf(file, "{\n");
+#if defined(__clang__)
+	fprintf(file, "\t\"compiler\": \"clang %d.%d\",\n", __clang_major__, __clang_minor__);
+#elif defined(__GNUC__)
+	fprintf(file, "\t\"compiler\": \"gcc %d.%d\",\n", __GNUC__, __GNUC_MINOR__);
+#elif defined(_MSC_VER)
+	fprintf(file, "\t\"compiler\": \"msvc %d\",\n", _MSC_VER);
+#else
+	fprintf(file, "\t\"compiler\": \"unknown\",\n");
+#endif
+	fprintf(file, "\t\"benchmarks\": {\n");
+
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		fprintf(file, "\t\t\"%s\": { \"ns_per_op\": %.4f, \"min_ns_per_op\": %.4f, \"mops\": %.2f }%s\n",
+				r.name, r.nsPerOp, r.nsPerOpMin, 1000.0/r.nsPerOp, i + 1 < results.size() ? "," : "");
+	}
+
+	fprintf(file, "\t}\n}\n");
+
+	return fclose(file) == 0;
+}
+
+// Reads back what 'saveBaseline()' wrote, it is not a general JSON parser.
+static bool loadBaseline(const char* path, std::vector<BenchResult>& results)
+{
+	FILE* file = fopen(path, "r");
+	if (file == 0)
+	{
+		return false;
+	}
+
+	std::string text;
+	char buffer[4096];
+	size_t nRead;
+	while ((nRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		text.append(buffer, nRead);
+	}
+	fclose(file);
+
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		std::string key = std::string("\"") + results[i].name + "\"";
+
+		size_t at = text.find(key);
+		if (at == std::string::npos)
+		{
+			continue;
+		}
+
+		size_t value = text.find("\"min_ns_per_op\":", at + key.size());
+		size_t end = text.find('}', at + key.size());
+		if (value == std::string::npos || value > end)
+		{
+			continue;
+		}
+
+		results[i].baseline = strtod(text.c_str() + value + strlen("\"min_ns_per_op\":"), 0);
+	}
+
+	return true;
+}
+
+
+// Main
+
+static void printUsage()
+{
+	printf("usage: h2_math_bench [--list] [--filter text] [--samples n] [--min-time ms]\n"
+		   "                     [--save file.json] [--compare file.json] [--threshold percent]\n");
+}
+
+int main(int argc, char** argv)
+{
+	const char* filter = 0;
+	const char* savePath = 0;
+	const char* comparePath = 0;
+	unsigned int nSamples = H2_BENCH_DEFAULT_SAMPLES;
+	double minTime = H2_BENCH_DEFAULT_MIN_TIME;
+	double threshold = H2_BENCH_DEFAULT_THRESHOLD;
+	bool list = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : 0;
+
+		if (strcmp(arg, "--list") == 0)
+		{
+			list = true;
+			continue;
+		}
+
+		if (value == 0)
+		{
+			printUsage();
+			return 2;
+		}
+
+		if (strcmp(arg, "--filter") == 0)
+		{
+			filter = value;
+		} else if (strcmp(arg, "--samples") == 0)
+		{
+			nSamples = (unsigned int)atoi(value);
+		} else if (strcmp(arg, "--min-time") == 0)
+		{
+			minTime = atof(value);
+		} else if (strcmp(arg, "--save") == 0)
+		{
+			savePath = value;
+		} else if (strcmp(arg, "--compare") == 0)
+		{
+			comparePath = value;
+		} else if (strcmp(arg, "--threshold") == 0)
+		{
+			threshold = atof(value);
+		} else
+		{
+			printUsage();
+			return 2;
+		}
+		i++;
+	}
+
+	if (nSamples == 0 || minTime <= 0)
+	{
+		printUsage();
+		return 2;
+	}
+
+	if (list)
+	{
+		for (unsigned int i = 0; i < nBenchmarks; i++)
+		{
+			printf("%s\n", benchmarks[i].name);
+		}
+		return 0;
+	}
+
+	initPools();
+
+	std::vector<const Benchmark*> selected;
+	for (unsigned int i = 0; i < nBenchmarks; i++)
+	{
+		if (filter == 0 || strstr(benchmarks[i].name, filter) != 0)
+		{
+			selected.push_back(&benchmarks[i]);
+		}
+	}
+
+	std::vector<BenchResult> results(selected.size());
+	for (unsigned int i = 0; i < selected.size(); i++)
+	{
+		results[i].name = selected[i]->name;
+		results[i].baseline = 0;
+	}
+
+	if (comparePath != 0 && !loadBaseline(comparePath, results))
+	{
+		fprintf(stderr, "can't read baseline '%s'\n", comparePath);
+		return 2;
+	}
+
+	printf("%-36s %12s %12s %12s", "benchmark", "ns/op", "min ns/op", "Mop/s");
+	if (comparePath != 0)
+	{
+		printf(" %12s %9s", "baseline min", "change");
+	}
+	printf("\n");
+
+	unsigned int nRegressions = 0;
+
+	for (unsigned int i = 0; i < selected.size(); i++)
+	{
+		double baseline = results[i].baseline;
+		results[i] = measure(*selected[i], nSamples, minTime*1e6);
+		results[i].baseline = baseline;
+
+		const BenchResult& r = results[i];
+		printf("%-36s %12.3f %12.3f %12.1f", r.name, r.nsPerOp, r.nsPerOpMin, 1000.0/r.nsPerOp);
+
+		if (comparePath != 0)
+		{
+			if (r.baseline > 0)
+			{
+				double change = 100.0*(r.nsPerOpMin - r.baseline)/r.baseline;
+				bool regression = change > threshold;
+
+				printf(" %12.3f %+8.1f%%%s", r.baseline, change, regression ? "  REGRESSION" : "");
+				if (regression)
+				{
+					nRegressions++;
+				}
+			} else
+			{
+				printf(" %12s %9s", "-", "new");
+			}
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+
+	if (savePath != 0 && !saveBaseline(savePath, results))
+	{
+		fprintf(stderr, "can't write baseline '%s'\n", savePath);
+		return 2;
+	}
+
+	if (comparePath != 0)
+	{
+		printf("\n%u of %u benchmarks slower than the baseline by more than %.1f%%\n",
+			   nRegressions, (unsigned int)results.size(), threshold);
+	}
+
+	return nRegressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,376 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "../core/h2_profiler.h"
+#include "../math/h2_math.h"
+#include "../math/h2_simd.h"
+#include "../video/h2_camera.h"
+#include "h2_mixer.h"
+
+
+
+#define H2_AUDIO3D_MAX_EMITTERS   H2_MIXER_MAX_VOICES
+#define H2_AUDIO3D_SPEED_OF_SOUND 343.0f   // world units are meters
+#define H2_AUDIO3D_MIN_GAIN       0.001f   // quieter emitters are never mixed
+#define H2_AUDIO3D_MIN_PITCH      0.5f
+#define H2_AUDIO3D_MAX_PITCH      2.0f
+
+
+
+
+namespace h2
+{
+	// 3D positional audio on top of AudioMixer.
+	//
+	// Emitters live in SoA arrays. 'update()' computes distance
+	// attenuation, pan and doppler pitch for all emitters in one pass,
+	// four at a time with SSE, then keeps only the loudest 'maxVoices'
+	// audible emitters mixing. The rest are paused in the mixer
+	// (virtualized) and resume when they become loud enough again.
+	//
+	// The listener is the camera: position, right vector for panning and
+	// a velocity supplied by the caller for doppler. Gains are ramped
+	// over 'rampMs', which should roughly match the update interval.
+	class Audio3D
+	{
+	public:
+
+		// Constructors
+
+		Audio3D() : nEmitters(0), maxVoices(32), nAudible(0), nMixed(0),
+					listenerPosition(0.0, 0.0, 0.0), listenerVelocity(0.0f, 0.0f, 0.0f),
+					listenerRight(1.0f, 0.0f, 0.0f)
+		{
+			for (unsigned int i = 0; i < H2_AUDIO3D_MAX_EMITTERS; i++)
+			{
+				clearEmitter(i);
+				freeIds[i] = H2_AUDIO3D_MAX_EMITTERS - 1 - i;
+			}
+			nFree = H2_AUDIO3D_MAX_EMITTERS;
+		}
+
+
+		// Methods
+
+		// Starts 'source' paused and returns emitter id, or -1 when no
+		// emitter or mixer voice is free.
+		int addEmitter(AudioMixer& mixer, AudioSource* source, const Vector3f& position, float volume = 1.0f,
+					   float minDistance = 1.0f, float maxDistance = 100.0f)
+		{
+			if (nFree == 0)
+			{
+				return -1;
+			}
+
+			Uint32 handle = mixer.play(source, 0.0f, 0.0f);
+			if (handle == 0)
+			{
+				return -1;
+			}
+			mixer.pause(handle, 0.0f);
+
+			unsigned int e = freeIds[--nFree];
+
+			voice[e] = handle;
+			mixing[e] = false;
+			emitterVolume[e] = volume;
+			minDist[e] = minDistance;
+			maxDist[e] = maxDistance > minDistance ? maxDistance : minDistance*1.001f;
+			setPosition(e, position);
+			setVelocity(e, Vector3f(0.0f, 0.0f, 0.0f));
+
+			if (e >= nEmitters)
+			{
+				nEmitters = e + 1;
+			}
+
+			return (int)e;
+		}
+
+		void removeEmitter(AudioMixer& mixer, unsigned int e, float fadeOutMs = 5.0f)
+		{
+			if (e >= H2_AUDIO3D_MAX_EMITTERS || voice[e] == 0)
+			{
+				return;
+			}
+
+			mixer.stop(voice[e], fadeOutMs);
+
+			clearEmitter(e);
+			freeIds[nFree++] = e;
+		}
+
+		// False after a one-shot source ended; the id is freed by
+		// 'update()' once the mixer collected the voice.
+		inline bool isEmitterPlaying(unsigned int e) const
+		{
+			return e < H2_AUDIO3D_MAX_EMITTERS && voice[e] != 0;
+		}
+
+		inline void setPosition(unsigned int e, const Vector3f& position)
+		{
+			px[e] = position.x;
+			py[e] = position.y;
+			pz[e] = position.z;
+		}
+
+		inline void setVelocity(unsigned int e, const Vector3f& velocity)
+		{
+			vx[e] = velocity.x;
+			vy[e] = velocity.y;
+			vz[e] = velocity.z;
+		}
+
+		inline void setVolume(unsigned int e, float volume)
+		{
+			emitterVolume[e] = volume;
+		}
+
+		void setListener(const Camera& camera, const Vector3f& velocity)
+		{
+			listenerPosition = camera.getPosition();
+			listenerRight = camera.getRight();
+			listenerVelocity = velocity;
+		}
+
+		inline void setMaxVoices(unsigned int in_maxVoices)
+		{
+			maxVoices = in_maxVoices;
+		}
+
+		// Spatializes all emitters and sends voice changes to 'mixer'.
+		void update(AudioMixer& mixer, float rampMs = 20.0f)
+		{
+			H2_PROFILE_SCOPE("audio3d update");
+
+			collectFinished(mixer);
+
+			spatialize();
+
+			// loudest audible emitters get real voices
+			nAudible = 0;
+			for (unsigned int e = 0; e < nEmitters; e++)
+			{
+				if (voice[e] != 0 && audibility[e] >= H2_AUDIO3D_MIN_GAIN)
+				{
+					order[nAudible++] = e;
+				}
+			}
+
+			unsigned int nReal = nAudible < maxVoices ? nAudible : maxVoices;
+			if (nReal < nAudible)
+			{
+				std::nth_element(order, order + nReal, order + nAudible, LouderFirst(audibility));
+			}
+
+			for (unsigned int i = 0; i < nAudible; i++)
+			{
+				wanted[order[i]] = (i < nReal);
+			}
+
+			nMixed = 0;
+			for (unsigned int e = 0; e < nEmitters; e++)
+			{
+				if (voice[e] == 0)
+				{
+					continue;
+				}
+
+				bool real = (audibility[e] >= H2_AUDIO3D_MIN_GAIN) && wanted[e];
+				wanted[e] = false;
+
+				if (real)
+				{
+					if (!mixing[e])
+					{
+						mixer.resume(voice[e]);
+						mixing[e] = true;
+					}
+					mixer.setVolume(voice[e], gain[e], pan[e], rampMs);
+					mixer.setPitch(voice[e], pitch[e]);
+					nMixed++;
+				} else if (mixing[e])
+				{
+					mixer.pause(voice[e], rampMs);
+					mixing[e] = false;
+				}
+			}
+		}
+
+		// Emitters above H2_AUDIO3D_MIN_GAIN in the last update.
+		inline unsigned int getAudibleCount() const { return nAudible; }
+
+		// Emitters actually mixed after virtualization.
+		inline unsigned int getMixedCount() const { return nMixed; }
+
+		inline float getGain(unsigned int e) const { return gain[e]; }
+
+		inline float getPan(unsigned int e) const { return pan[e]; }
+
+		inline float getPitch(unsigned int e) const { return pitch[e]; }
+
+	private:
+
+		// inputs, SoA
+		float px[H2_AUDIO3D_MAX_EMITTERS], py[H2_AUDIO3D_MAX_EMITTERS], pz[H2_AUDIO3D_MAX_EMITTERS];
+		float vx[H2_AUDIO3D_MAX_EMITTERS], vy[H2_AUDIO3D_MAX_EMITTERS], vz[H2_AUDIO3D_MAX_EMITTERS];
+		float emitterVolume[H2_AUDIO3D_MAX_EMITTERS];
+		float minDist[H2_AUDIO3D_MAX_EMITTERS], maxDist[H2_AUDIO3D_MAX_EMITTERS];
+
+		// outputs, SoA
+		float gain[H2_AUDIO3D_MAX_EMITTERS];
+		float pan[H2_AUDIO3D_MAX_EMITTERS];
+		float pitch[H2_AUDIO3D_MAX_EMITTERS];
+		float audibility[H2_AUDIO3D_MAX_EMITTERS];
+
+		Uint32 voice[H2_AUDIO3D_MAX_EMITTERS];   // 0 for free emitter
+		bool mixing[H2_AUDIO3D_MAX_EMITTERS];
+		bool wanted[H2_AUDIO3D_MAX_EMITTERS];
+
+		unsigned int order[H2_AUDIO3D_MAX_EMITTERS];
+		unsigned int freeIds[H2_AUDIO3D_MAX_EMITTERS];
+		unsigned int nFree;
+
+		unsigned int nEmitters;   // one past highest used id
+
+		unsigned int maxVoices;
+
+		unsigned int nAudible, nMixed;
+
+		Vector3d listenerPosition;
+		Vector3f listenerVelocity;
+		Vector3f listenerRight;
+
+
+		struct LouderFirst
+		{
+			const float* audibility;
+
+			LouderFirst(const float* in_audibility) : audibility(in_audibility) {}
+
+			bool operator () (unsigned int a, unsigned int b) const
+			{
+				return audibility[a] > audibility[b];
+			}
+		};
+
+		void clearEmitter(unsigned int e)
+		{
+			voice[e] = 0;
+			mixing[e] = false;
+			wanted[e] = false;
+			px[e] = py[e] = pz[e] = 0.0f;
+			vx[e] = vy[e] = vz[e] = 0.0f;
+			emitterVolume[e] = 0.0f;
+			minDist[e] = 1.0f;
+			maxDist[e] = 2.0f;
+			gain[e] = pan[e] = audibility[e] = 0.0f;
+			pitch[e] = 1.0f;
+		}
+
+		// One-shot voices end on their own, free their emitters.
+		void collectFinished(AudioMixer& mixer)
+		{
+			for (unsigned int e = 0; e < nEmitters; e++)
+			{
+				if (voice[e] != 0 && !mixer.isPlaying(voice[e]))
+				{
+					clearEmitter(e);
+					freeIds[nFree++] = e;
+				}
+			}
+
+			while (nEmitters > 0 && voice[nEmitters - 1] == 0)
+			{
+				nEmitters--;
+			}
+		}
+
+		// Gain: inverse distance clamped at 'minDist', faded out over the
+		// last 10% before 'maxDist'. Pan: direction projected on listener
+		// right. Pitch: doppler from velocities along the line of sight.
+		void spatialize()
+		{
+			// listener at origin, emitters relative to it
+			const float lx = (float)listenerPosition.x;
+			const float ly = (float)listenerPosition.y;
+			const float lz = (float)listenerPosition.z;
+
+			unsigned int i = 0;
+
+#ifdef H2_SIMD_SSE
+			const __m128 vlx = _mm_set1_ps(lx), vly = _mm_set1_ps(ly), vlz = _mm_set1_ps(lz);
+			const __m128 rx = _mm_set1_ps(listenerRight.x), ry = _mm_set1_ps(listenerRight.y), rz = _mm_set1_ps(listenerRight.z);
+			const __m128 lvx = _mm_set1_ps(listenerVelocity.x), lvy = _mm_set1_ps(listenerVelocity.y), lvz = _mm_set1_ps(listenerVelocity.z);
+			const __m128 c = _mm_set1_ps(H2_AUDIO3D_SPEED_OF_SOUND);
+			const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f);
+			const __m128 eps = _mm_set1_ps(1e-6f);
+			const __m128 minPitch = _mm_set1_ps(H2_AUDIO3D_MIN_PITCH), maxPitch = _mm_set1_ps(H2_AUDIO3D_MAX_PITCH);
+			const __m128 fadeScale = _mm_set1_ps(10.0f);
+
+			for (; i + H2_SIMD_WIDTH <= nEmitters; i += H2_SIMD_WIDTH)
+			{
+				__m128 dx = _mm_sub_ps(_mm_loadu_ps(px + i), vlx);
+				__m128 dy = _mm_sub_ps(_mm_loadu_ps(py + i), vly);
+				__m128 dz = _mm_sub_ps(_mm_loadu_ps(pz + i), vlz);
+
+				__m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+				__m128 invDist = _mm_div_ps(one, _mm_max_ps(dist, eps));
+
+				__m128 minD = _mm_loadu_ps(minDist + i);
+				__m128 maxD = _mm_loadu_ps(maxDist + i);
+
+				__m128 g = _mm_div_ps(minD, _mm_max_ps(dist, minD));
+				__m128 fade = _mm_mul_ps(_mm_div_ps(_mm_sub_ps(maxD, dist), maxD), fadeScale);
+				fade = _mm_min_ps(_mm_max_ps(fade, zero), one);
+				g = _mm_mul_ps(_mm_mul_ps(g, fade), _mm_loadu_ps(emitterVolume + i));
+
+				__m128 p = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, rx), _mm_mul_ps(dy, ry)), _mm_mul_ps(dz, rz)), invDist);
+				p = _mm_min_ps(_mm_max_ps(p, minusOne), one);
+
+				// velocities projected on listener->emitter direction
+				__m128 vl = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(lvx, dx), _mm_mul_ps(lvy, dy)), _mm_mul_ps(lvz, dz)), invDist);
+				__m128 ve = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(vx + i), dx),
+															 _mm_mul_ps(_mm_loadu_ps(vy + i), dy)),
+												  _mm_mul_ps(_mm_loadu_ps(vz + i), dz)), invDist);
+				__m128 f = _mm_div_ps(_mm_add_ps(c, vl), _mm_max_ps(_mm_add_ps(c, ve), eps));
+				f = _mm_min_ps(_mm_max_ps(f, minPitch), maxPitch);
+
+				_mm_storeu_ps(gain + i, g);
+				_mm_storeu_ps(audibility + i, g);
+				_mm_storeu_ps(pan + i, p);
+				_mm_storeu_ps(pitch + i, f);
+			}
+#endif
+
+			for (; i < nEmitters; i++)
+			{
+				float dx = px[i] - lx, dy = py[i] - ly, dz = pz[i] - lz;
+
+				float dist = std::sqrt(dx*dx + dy*dy + dz*dz);
+				float invDist = 1.0f/(dist > 1e-6f ? dist : 1e-6f);
+
+				float g = minDist[i]/(dist > minDist[i] ? dist : minDist[i]);
+				float fade = (maxDist[i] - dist)/maxDist[i]*10.0f;
+				fade = fade < 0.0f ? 0.0f : (fade > 1.0f ? 1.0f : fade);
+				g *= fade*emitterVolume[i];
+
+				float p = (dx*listenerRight.x + dy*listenerRight.y + dz*listenerRight.z)*invDist;
+				p = p < -1.0f ? -1.0f : (p > 1.0f ? 1.0f : p);
+
+				float vl = (listenerVelocity.x*dx + listenerVelocity.y*dy + listenerVelocity.z*dz)*invDist;
+				float ve = (vx[i]*dx + vy[i]*dy + vz[i]*dz)*invDist;
+				float sourceSpeed = H2_AUDIO3D_SPEED_OF_SOUND + ve;
+				float f = (H2_AUDIO3D_SPEED_OF_SOUND + vl)/(sourceSpeed > 1e-6f ? sourceSpeed : 1e-6f);
+				f = f < H2_AUDIO3D_MIN_PITCH ? H2_AUDIO3D_MIN_PITCH : (f > H2_AUDIO3D_MAX_PITCH ? H2_AUDIO3D_MAX_PITCH : f);
+
+				gain[i] = g;
+				audibility[i] = g;
+				pan[i] = p;
+				pitch[i] = f;
+			}
+		}
+	};
+}
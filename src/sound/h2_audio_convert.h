@@ -0,0 +1,70 @@
+#pragma once
+
+#include "SDL_stdinc.h"
+
+#include "../math/h2_simd.h"
+
+
+
+
+namespace h2
+{
+	// Converts signed 16 bit samples to float [-1, 1).
+	inline void convertS16ToFloat(const Sint16* in, float* out, unsigned int n)
+	{
+		unsigned int i = 0;
+
+#ifdef H2_SIMD_SSE2
+		const __m128 scale = _mm_set1_ps(1.0f/32768.0f);
+
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+
+			// sign extend by unpacking into high halves and shifting back
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+
+			_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+		}
+#endif
+
+		for (; i < n; i++)
+		{
+			out[i] = in[i]*(1.0f/32768.0f);
+		}
+	}
+
+
+	// Converts float samples to signed 16 bit with clipping and rounding.
+	inline void convertFloatToS16(const float* in, Sint16* out, unsigned int n)
+	{
+		unsigned int i = 0;
+
+#ifdef H2_SIMD_SSE2
+		const __m128 scale = _mm_set1_ps(32767.0f);
+		const __m128 lo = _mm_set1_ps(-1.0f);
+		const __m128 hi = _mm_set1_ps(1.0f);
+
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi);
+			__m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), lo), hi);
+
+			// cvtps rounds to nearest, packs saturates
+			__m128i ia = _mm_cvtps_epi32(_mm_mul_ps(a, scale));
+			__m128i ib = _mm_cvtps_epi32(_mm_mul_ps(b, scale));
+
+			_mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(ia, ib));
+		}
+#endif
+
+		for (; i < n; i++)
+		{
+			float v = in[i] < -1.0f ? -1.0f : (in[i] > 1.0f ? 1.0f : in[i]);
+			v *= 32767.0f;
+			out[i] = (Sint16)(v < 0.0f ? v - 0.5f : v + 0.5f);
+		}
+	}
+}
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "SDL_endian.h"
+#include "SDL_rwops.h"
+
+#include "../core/h2_memory.h"
+#include "h2_audio_convert.h"
+
+
+
+#define H2_DECODER_CHUNK_FRAMES 4096   // frames read from disk per call
+
+
+
+
+namespace h2
+{
+	// Decodes compressed or raw audio into interleaved float frames.
+	// Decoders run on the streaming thread, so they may block on I/O and
+	// allocate, but never run inside the audio callback.
+	class AudioDecoder
+	{
+	public:
+
+		// Destructor
+
+		virtual ~AudioDecoder() {}
+
+
+		// Methods
+
+		// Decodes up to 'nFrames' frames, returns 0 at the end of stream.
+		virtual unsigned int decode(float* out, unsigned int nFrames) = 0;
+
+		// Seeks back to the first frame, used for looping.
+		virtual bool rewind() = 0;
+
+		virtual unsigned int getChannels() const = 0;
+
+		virtual int getFrequency() const = 0;
+	};
+
+
+	// RIFF WAVE decoder over SDL_RWops. Handles 8, 16 and 24 bit integer
+	// PCM and 32 bit float, mono or stereo.
+	class WavDecoder : public AudioDecoder
+	{
+	public:
+
+		// Constructors
+
+		WavDecoder() : rw(0), ownsRw(false), nChannels(0), frequency(0), bits(0), isFloat(false),
+					   blockAlign(0), dataStart(0), dataFrames(0), position(0) {}
+
+
+		// Destructor
+
+		virtual ~WavDecoder()
+		{
+			close();
+		}
+
+
+		// Methods
+
+		bool open(const char* path)
+		{
+			SDL_RWops* file = SDL_RWFromFile(path, "rb");
+			return file != 0 && open(file, true);
+		}
+
+		// Parses header and positions stream at the first frame. When
+		// 'in_ownsRw' is true 'in_rw' is closed by the decoder, also on failure.
+		bool open(SDL_RWops* in_rw, bool in_ownsRw)
+		{
+			close();
+
+			rw = in_rw;
+			ownsRw = in_ownsRw;
+
+			if (!parseHeader())
+			{
+				close();
+				return false;
+			}
+
+			raw.resize(H2_DECODER_CHUNK_FRAMES*blockAlign);
+
+			return true;
+		}
+
+		void close()
+		{
+			if (rw != 0 && ownsRw)
+			{
+				SDL_RWclose(rw);
+			}
+			rw = 0;
+			dataFrames = 0;
+			position = 0;
+		}
+
+		virtual unsigned int decode(float* out, unsigned int nFrames)
+		{
+			unsigned int written = 0;
+
+			while (written < nFrames && position < dataFrames)
+			{
+				unsigned int n = nFrames - written;
+				if (n > H2_DECODER_CHUNK_FRAMES)
+				{
+					n = H2_DECODER_CHUNK_FRAMES;
+				}
+				if (n > dataFrames - position)
+				{
+					n = dataFrames - position;
+				}
+
+				n = (unsigned int)SDL_RWread(rw, &raw[0], blockAlign, n);
+				if (n == 0)
+				{
+					// truncated file
+					dataFrames = position;
+					break;
+				}
+
+				convert(out + written*nChannels, &raw[0], n*nChannels);
+
+				written += n;
+				position += n;
+			}
+
+			return written;
+		}
+
+		virtual bool rewind()
+		{
+			if (rw == 0 || SDL_RWseek(rw, dataStart, RW_SEEK_SET) < 0)
+			{
+				return false;
+			}
+
+			position = 0;
+			return true;
+		}
+
+		virtual unsigned int getChannels() const
+		{
+			return nChannels;
+		}
+
+		virtual int getFrequency() const
+		{
+			return frequency;
+		}
+
+		inline unsigned int getLength() const
+		{
+			return dataFrames;
+		}
+
+	private:
+
+		SDL_RWops* rw;
+
+		bool ownsRw;
+
+		unsigned int nChannels;
+
+		int frequency;
+
+		unsigned int bits;
+
+		bool isFloat;
+
+		unsigned int blockAlign;
+
+		Sint64 dataStart;
+
+		unsigned int dataFrames, position;
+
+		TaggedVector<Uint8, MEMORY_TAG_SOUND>::Type raw;
+
+
+		WavDecoder(const WavDecoder&);
+		WavDecoder& operator = (const WavDecoder&);
+
+		bool parseHeader()
+		{
+			if (rw == 0)
+			{
+				return false;
+			}
+
+			char id[4];
+
+			if (SDL_RWread(rw, id, 4, 1) != 1 || memcmp(id, "RIFF", 4) != 0)
+			{
+				return false;
+			}
+			SDL_ReadLE32(rw);
+			if (SDL_RWread(rw, id, 4, 1) != 1 || memcmp(id, "WAVE", 4) != 0)
+			{
+				return false;
+			}
+
+			bool haveFormat = false;
+
+			while (SDL_RWread(rw, id, 4, 1) == 1)
+			{
+				Uint32 size = SDL_ReadLE32(rw);
+				Sint64 next = SDL_RWtell(rw) + size + (size & 1);
+
+				if (memcmp(id, "fmt ", 4) == 0 && size >= 16)
+				{
+					Uint16 tag = SDL_ReadLE16(rw);
+					nChannels = SDL_ReadLE16(rw);
+					frequency = (int)SDL_ReadLE32(rw);
+					SDL_ReadLE32(rw);   // byte rate
+					blockAlign = SDL_ReadLE16(rw);
+					bits = SDL_ReadLE16(rw);
+
+					// WAVE_FORMAT_EXTENSIBLE keeps real tag in sub format
+					if (tag == 0xFFFE && size >= 40)
+					{
+						SDL_ReadLE16(rw);   // extension size
+						SDL_ReadLE16(rw);   // valid bits
+						SDL_ReadLE32(rw);   // channel mask
+						tag = SDL_ReadLE16(rw);
+					}
+
+					isFloat = (tag == 3);
+					haveFormat = (tag == 1 && (bits == 8 || bits == 16 || bits == 24)) || (isFloat && bits == 32);
+					haveFormat = haveFormat && (nChannels == 1 || nChannels == 2) && blockAlign == nChannels*bits/8;
+
+					if (!haveFormat)
+					{
+						return false;
+					}
+				} else if (memcmp(id, "data", 4) == 0)
+				{
+					if (!haveFormat)
+					{
+						return false;
+					}
+
+					dataStart = SDL_RWtell(rw);
+					dataFrames = size/blockAlign;
+					position = 0;
+					return true;
+				}
+
+				if (SDL_RWseek(rw, next, RW_SEEK_SET) < 0)
+				{
+					return false;
+				}
+			}
+
+			return false;
+		}
+
+		void convert(float* out, const Uint8* in, unsigned int nSamples) const
+		{
+			unsigned int i;
+
+			if (isFloat)
+			{
+				memcpy(out, in, nSamples*sizeof(float));
+			} else if (bits == 16)
+			{
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+				convertS16ToFloat((const Sint16*)in, out, nSamples);
+#else
+				for (i = 0; i < nSamples; i++)
+				{
+					out[i] = (Sint16)(in[2*i] | (in[2*i + 1] << 8))*(1.0f/32768.0f);
+				}
+#endif
+			} else if (bits == 24)
+			{
+				for (i = 0; i < nSamples; i++)
+				{
+					Sint32 v = (Sint32)((in[3*i] << 8) | (in[3*i + 1] << 16) | ((Uint32)in[3*i + 2] << 24)) >> 8;
+					out[i] = v*(1.0f/8388608.0f);
+				}
+			} else
+			{
+				for (i = 0; i < nSamples; i++)
+				{
+					out[i] = (in[i] - 128)*(1.0f/128.0f);
+				}
+			}
+		}
+	};
+
+
+	// Opens decoder matching file, or returns 0. Add new formats here.
+	inline AudioDecoder* openAudioDecoder(const char* path)
+	{
+		WavDecoder* wav = new WavDecoder();
+		if (wav->open(path))
+		{
+			return wav;
+		}
+		delete wav;
+
+		return 0;
+	}
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstring>
+
+
+
+namespace h2
+{
+	// Source of float samples for a mixer voice.
+	//
+	// 'read()' is called from the audio callback: implementations must not
+	// block, lock or allocate. Samples are interleaved, 'getChannels()'
+	// floats per frame, at 'getFrequency()'; the mixer resamples sources
+	// that differ from its own frequency.
+	class AudioSource
+	{
+	public:
+
+		// Destructor
+
+		virtual ~AudioSource() {}
+
+
+		// Methods
+
+		// Writes up to 'nFrames' frames to 'out' and returns number of
+		// frames written. Fewer frames than requested ends the voice.
+		virtual unsigned int read(float* out, unsigned int nFrames) = 0;
+
+		// 1 (mono) or 2 (stereo)
+		virtual unsigned int getChannels() const = 0;
+
+		// Sample rate, 0 means mixer frequency.
+		virtual int getFrequency() const
+		{
+			return 0;
+		}
+	};
+
+
+	// Plays sample data owned by the caller. Data must stay valid, and
+	// the source must not be touched, while a voice is playing it.
+	class SampleSource : public AudioSource
+	{
+	public:
+
+		// Constructors
+
+		SampleSource() : samples(0), nFrames(0), nChannels(1), frequency(0), position(0), loop(false) {}
+
+		SampleSource(const float* in_samples, unsigned int in_nFrames, unsigned int in_nChannels, bool in_loop = false) :
+			frequency(0)
+		{
+			set(in_samples, in_nFrames, in_nChannels, in_loop);
+		}
+
+
+		// Methods
+
+		void set(const float* in_samples, unsigned int in_nFrames, unsigned int in_nChannels, bool in_loop = false)
+		{
+			samples = in_samples;
+			nFrames = in_nFrames;
+			nChannels = in_nChannels;
+			loop = in_loop;
+			position = 0;
+		}
+
+		inline void setFrequency(int in_frequency)
+		{
+			frequency = in_frequency;
+		}
+
+		inline void rewind()
+		{
+			position = 0;
+		}
+
+		virtual unsigned int read(float* out, unsigned int count)
+		{
+			unsigned int written = 0;
+
+			while (written < count)
+			{
+				if (position >= nFrames)
+				{
+					if (!loop || nFrames == 0)
+					{
+						break;
+					}
+					position = 0;
+				}
+
+				unsigned int n = nFrames - position;
+				if (n > count - written)
+				{
+					n = count - written;
+				}
+
+				memcpy(out + written*nChannels, samples + position*nChannels, n*nChannels*sizeof(float));
+
+				written += n;
+				position += n;
+			}
+
+			return written;
+		}
+
+		virtual unsigned int getChannels() const
+		{
+			return nChannels;
+		}
+
+		virtual int getFrequency() const
+		{
+			return frequency;
+		}
+
+	private:
+
+		const float* samples;
+
+		unsigned int nFrames, nChannels;
+
+		int frequency;
+
+		unsigned int position;
+
+		bool loop;
+	};
+}
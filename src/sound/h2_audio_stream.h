@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "SDL_atomic.h"
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
+#include "SDL_timer.h"
+
+#include "../core/h2_memory.h"
+#include "../core/h2_profiler.h"
+#include "../core/h2_spsc_ring.h"
+#include "h2_audio_source.h"
+#include "h2_audio_decoder.h"
+
+
+
+#define H2_STREAM_BUFFER_FRAMES  32768   // per stream, power of two (~0.7 s at 48 kHz)
+#define H2_STREAM_POLL_MS            5
+
+
+
+
+namespace h2
+{
+	// Audio source fed by a decoder on the streaming thread.
+	//
+	// Decoded frames go through a single-producer/single-consumer ring:
+	// 'fill()' runs on AudioStreamer's thread, 'read()' in the audio
+	// callback. When the ring runs dry before the decoder ended the voice
+	// gets silence and the underrun is counted, so a slow disk never
+	// stops a voice.
+	class StreamingSource : public AudioSource
+	{
+	public:
+
+		// Constructors
+
+		StreamingSource(unsigned int in_bufferFrames = H2_STREAM_BUFFER_FRAMES) :
+			decoder(0), nChannels(1), bufferFrames(1), loop(false)
+		{
+			// ring indices wrap with a mask
+			while (bufferFrames < in_bufferFrames)
+			{
+				bufferFrames <<= 1;
+			}
+
+			SDL_AtomicSet(&head, 0);
+			SDL_AtomicSet(&tail, 0);
+			SDL_AtomicSet(&ended, 0);
+			SDL_AtomicSet(&underruns, 0);
+		}
+
+
+		// Destructor
+
+		virtual ~StreamingSource()
+		{
+			delete decoder;
+		}
+
+
+		// Methods
+
+		// Takes ownership of 'in_decoder'. Call before the source is added
+		// to a streamer and played.
+		void setDecoder(AudioDecoder* in_decoder, bool in_loop = false)
+		{
+			delete decoder;
+
+			decoder = in_decoder;
+			loop = in_loop;
+			nChannels = (decoder != 0 && decoder->getChannels() == 2) ? 2 : 1;
+
+			samples.assign(bufferFrames*nChannels, 0.0f);
+
+			SDL_AtomicSet(&head, 0);
+			SDL_AtomicSet(&tail, 0);
+			SDL_AtomicSet(&ended, decoder == 0 ? 1 : 0);
+			SDL_AtomicSet(&underruns, 0);
+		}
+
+		inline AudioDecoder* getDecoder() const
+		{
+			return decoder;
+		}
+
+		// Producer side. Decodes until ring is full or stream ended,
+		// returns frames decoded.
+		unsigned int fill()
+		{
+			if (decoder == 0 || SDL_AtomicGet(&ended) != 0)
+			{
+				return 0;
+			}
+
+			unsigned int total = 0;
+			bool rewound = false;
+
+			for (;;)
+			{
+				unsigned int t = (unsigned int)SDL_AtomicGet(&tail);
+				unsigned int h = (unsigned int)SDL_AtomicGet(&head);
+
+				unsigned int space = bufferFrames - (t - h);
+				unsigned int offset = t & (bufferFrames - 1);
+				unsigned int n = space < bufferFrames - offset ? space : bufferFrames - offset;
+
+				if (n == 0)
+				{
+					break;
+				}
+
+				unsigned int got = decoder->decode(&samples[offset*nChannels], n);
+
+				if (got == 0)
+				{
+					// second rewind in a row means stream is empty
+					if (loop && !rewound && decoder->rewind())
+					{
+						rewound = true;
+						continue;
+					}
+
+					SDL_MemoryBarrierRelease();
+					SDL_AtomicSet(&ended, 1);
+					break;
+				}
+
+				rewound = false;
+				total += got;
+
+				SDL_MemoryBarrierRelease();
+				SDL_AtomicSet(&tail, (int)(t + got));
+			}
+
+			return total;
+		}
+
+		// Consumer side, called by the mixer.
+		virtual unsigned int read(float* out, unsigned int count)
+		{
+			// 'ended' is published after the last tail update
+			bool isEnded = SDL_AtomicGet(&ended) != 0;
+			SDL_MemoryBarrierAcquire();
+
+			unsigned int h = (unsigned int)SDL_AtomicGet(&head);
+			unsigned int t = (unsigned int)SDL_AtomicGet(&tail);
+			SDL_MemoryBarrierAcquire();
+
+			unsigned int n = t - h < count ? t - h : count;
+			unsigned int offset = h & (bufferFrames - 1);
+			unsigned int first = n < bufferFrames - offset ? n : bufferFrames - offset;
+
+			memcpy(out, &samples[offset*nChannels], first*nChannels*sizeof(float));
+			memcpy(out + first*nChannels, &samples[0], (n - first)*nChannels*sizeof(float));
+
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&head, (int)(h + n));
+
+			if (n < count && !isEnded)
+			{
+				memset(out + n*nChannels, 0, (count - n)*nChannels*sizeof(float));
+				SDL_AtomicAdd(&underruns, 1);
+				return count;
+			}
+
+			return n;
+		}
+
+		virtual unsigned int getChannels() const
+		{
+			return nChannels;
+		}
+
+		virtual int getFrequency() const
+		{
+			return decoder != 0 ? decoder->getFrequency() : 0;
+		}
+
+		// Frames decoded and not played yet.
+		inline unsigned int getBuffered()
+		{
+			return (unsigned int)SDL_AtomicGet(&tail) - (unsigned int)SDL_AtomicGet(&head);
+		}
+
+		// Reads that had to be padded with silence.
+		inline unsigned int getUnderruns()
+		{
+			return (unsigned int)SDL_AtomicGet(&underruns);
+		}
+
+		// Decoder reached the end and everything was played.
+		inline bool isFinished()
+		{
+			return SDL_AtomicGet(&ended) != 0 && getBuffered() == 0;
+		}
+
+	private:
+
+		AudioDecoder* decoder;
+
+		unsigned int nChannels;
+
+		unsigned int bufferFrames;
+
+		bool loop;
+
+		TaggedVector<float, MEMORY_TAG_SOUND>::Type samples;
+
+		SDL_atomic_t head;
+		char pad0[H2_CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+
+		SDL_atomic_t tail;
+		char pad1[H2_CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+
+		SDL_atomic_t ended;
+
+		SDL_atomic_t underruns;
+
+		StreamingSource(const StreamingSource&);
+		StreamingSource& operator = (const StreamingSource&);
+	};
+
+
+	// Background thread keeping StreamingSources filled.
+	//
+	// 'add()' prefills the source on the calling thread, so playback can
+	// start right away. 'remove()' must be called before a source is
+	// destroyed; it waits until the thread is done with the source.
+	class AudioStreamer
+	{
+	public:
+
+		// Constructors
+
+		AudioStreamer() : thread(0)
+		{
+			lock = SDL_CreateMutex();
+			SDL_AtomicSet(&running, 0);
+		}
+
+
+		// Destructor
+
+		~AudioStreamer()
+		{
+			stop();
+			SDL_DestroyMutex(lock);
+		}
+
+
+		// Methods
+
+		bool start()
+		{
+			if (thread != 0)
+			{
+				return true;
+			}
+
+			SDL_AtomicSet(&running, 1);
+			thread = SDL_CreateThread(threadFunc, "h2_audio_stream", this);
+
+			return thread != 0;
+		}
+
+		void stop()
+		{
+			if (thread == 0)
+			{
+				return;
+			}
+
+			SDL_AtomicSet(&running, 0);
+			SDL_WaitThread(thread, 0);
+			thread = 0;
+		}
+
+		void add(StreamingSource* source)
+		{
+			source->fill();
+
+			SDL_LockMutex(lock);
+			sources.push_back(source);
+			SDL_UnlockMutex(lock);
+		}
+
+		void remove(StreamingSource* source)
+		{
+			SDL_LockMutex(lock);
+			sources.erase(std::remove(sources.begin(), sources.end(), source), sources.end());
+			SDL_UnlockMutex(lock);
+		}
+
+		// Refills all sources once, for use without the thread.
+		void update()
+		{
+			H2_PROFILE_SCOPE("audio stream update");
+
+			SDL_LockMutex(lock);
+			for (unsigned int i = 0; i < sources.size(); i++)
+			{
+				sources[i]->fill();
+			}
+			SDL_UnlockMutex(lock);
+		}
+
+	private:
+
+		SDL_Thread* thread;
+
+		SDL_mutex* lock;
+
+		SDL_atomic_t running;
+
+		TaggedVector<StreamingSource*, MEMORY_TAG_SOUND>::Type sources;
+
+
+		AudioStreamer(const AudioStreamer&);
+		AudioStreamer& operator = (const AudioStreamer&);
+
+		static int SDLCALL threadFunc(void* data)
+		{
+			AudioStreamer* streamer = (AudioStreamer*)data;
+
+			while (SDL_AtomicGet(&streamer->running) != 0)
+			{
+				streamer->update();
+				SDL_Delay(H2_STREAM_POLL_MS);
+			}
+
+			return 0;
+		}
+	};
+}
@@ -0,0 +1,678 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "SDL_audio.h"
+
+#include "../core/h2_memory.h"
+#include "../core/h2_profiler.h"
+#include "../core/h2_spsc_ring.h"
+#include "../math/h2_simd.h"
+#include "h2_audio_source.h"
+#include "h2_audio_convert.h"
+#include "h2_resampler.h"
+
+
+
+#define H2_MIXER_MAX_VOICES      256
+#define H2_MIXER_BLOCK_FRAMES    512    // frames mixed per pass, multiple of 4
+#define H2_MIXER_COMMAND_RING   1024
+#define H2_MIXER_CHANNELS          2    // output is always interleaved stereo float
+
+
+
+
+namespace h2
+{
+	enum MixerCommandType
+	{
+		MIXER_PLAY,
+		MIXER_STOP,
+		MIXER_SET_GAIN,
+		MIXER_SET_PITCH,
+		MIXER_PAUSE,
+		MIXER_RESUME,
+		MIXER_SET_MASTER
+	};
+
+
+	struct MixerCommand
+	{
+		MixerCommandType type;
+		unsigned int slot;
+		AudioSource* source;
+		float volume, pan;   // volume holds pitch for MIXER_SET_PITCH
+		unsigned int rampFrames;
+	};
+
+
+	// Software mixer running in the SDL audio callback.
+	//
+	// The game thread talks to the callback only through two SPSC rings:
+	// commands go in, finished voice slots come back. Nothing in the
+	// callback locks or allocates. Voice state lives in SoA arrays owned
+	// by the callback; volume and pan changes are ramped per frame so
+	// they never click. Sources with a different sample rate, or voices
+	// with pitch other than 1, go through a per-voice polyphase resampler.
+	// Paused voices keep their slot and source position but cost nothing
+	// to mix.
+	//
+	// Voice control methods and 'update()' must be called from one
+	// (game) thread. A source passed
+	// to 'play()' must stay alive until 'isPlaying()' returns false for
+	// its voice, which happens after 'update()' collected it.
+	class AudioMixer
+	{
+	public:
+
+		// Constructors
+
+		AudioMixer() : device(0), frequency(0), deviceFormat(AUDIO_F32SYS), nFree(H2_MIXER_MAX_VOICES), nActive(0),
+					   resamplers(H2_MIXER_MAX_VOICES), nPlaying(0), masterGain(1.0f), masterTarget(1.0f), masterRamp(0)
+		{
+			for (unsigned int i = 0; i < H2_MIXER_MAX_VOICES; i++)
+			{
+				generation[i] = 1;
+				busy[i] = false;
+				freeSlots[i] = H2_MIXER_MAX_VOICES - 1 - i;
+				sources[i] = 0;
+			}
+		}
+
+
+		// Destructor
+
+		~AudioMixer()
+		{
+			close();
+		}
+
+
+		// Methods
+
+		// Opens default output device and starts playback. SDL audio
+		// subsystem must be initialized.
+		bool open(int in_frequency = 48000, Uint16 bufferFrames = 512)
+		{
+			if (device != 0)
+			{
+				return true;
+			}
+
+			SDL_AudioSpec want, have;
+			SDL_zero(want);
+			want.freq = in_frequency;
+			want.format = AUDIO_F32SYS;
+			want.channels = H2_MIXER_CHANNELS;
+			want.samples = bufferFrames;
+			want.callback = audioCallback;
+			want.userdata = this;
+
+			// s16 devices are converted by our kernel, anything else by SDL
+			device = SDL_OpenAudioDevice(0, 0, &want, &have, SDL_AUDIO_ALLOW_FORMAT_CHANGE);
+			if (device != 0 && have.format != AUDIO_F32SYS && have.format != AUDIO_S16SYS)
+			{
+				SDL_CloseAudioDevice(device);
+				device = SDL_OpenAudioDevice(0, 0, &want, &have, 0);
+			}
+
+			if (device == 0)
+			{
+				return false;
+			}
+
+			frequency = have.freq;
+			deviceFormat = have.format;
+			SDL_PauseAudioDevice(device, 0);
+
+			return true;
+		}
+
+		void close()
+		{
+			if (device != 0)
+			{
+				SDL_CloseAudioDevice(device);
+				device = 0;
+			}
+		}
+
+		// Sets frequency for offline mixing without a device.
+		inline void setFrequency(int in_frequency)
+		{
+			frequency = in_frequency;
+		}
+
+		inline int getFrequency() const
+		{
+			return frequency;
+		}
+
+		// Starts voice, returns its handle or 0 when no voice is free.
+		// 'pan' is -1 (left) .. 1 (right).
+		Uint32 play(AudioSource* source, float volume = 1.0f, float pan = 0.0f, float fadeInMs = 0.0f)
+		{
+			if (nFree == 0 || source == 0)
+			{
+				return 0;
+			}
+
+			unsigned int slot = freeSlots[nFree - 1];
+
+			MixerCommand cmd;
+			cmd.type = MIXER_PLAY;
+			cmd.slot = slot;
+			cmd.source = source;
+			cmd.volume = volume;
+			cmd.pan = pan;
+			cmd.rampFrames = msToFrames(fadeInMs);
+
+			if (!commands.push(cmd))
+			{
+				return 0;
+			}
+
+			nFree--;
+			nActive++;
+			busy[slot] = true;
+
+			return makeHandle(slot);
+		}
+
+		// Fades voice out and stops it. Returns false for stale handle
+		// or when command ring is full.
+		bool stop(Uint32 voice, float fadeOutMs = 5.0f)
+		{
+			return sendVoiceCommand(MIXER_STOP, voice, 0.0f, 0.0f, fadeOutMs);
+		}
+
+		bool setVolume(Uint32 voice, float volume, float pan, float rampMs = 5.0f)
+		{
+			return sendVoiceCommand(MIXER_SET_GAIN, voice, volume, pan, rampMs);
+		}
+
+		// Playback rate multiplier, clamped to what the resampler allows.
+		bool setPitch(Uint32 voice, float pitch)
+		{
+			return sendVoiceCommand(MIXER_SET_PITCH, voice, pitch, 0.0f, 0.0f);
+		}
+
+		// Fades voice out and stops reading its source; slot stays taken.
+		bool pause(Uint32 voice, float fadeOutMs = 5.0f)
+		{
+			return sendVoiceCommand(MIXER_PAUSE, voice, 0.0f, 0.0f, fadeOutMs);
+		}
+
+		// Resumes at zero gain, follow with 'setVolume()' to fade in.
+		bool resume(Uint32 voice)
+		{
+			return sendVoiceCommand(MIXER_RESUME, voice, 0.0f, 0.0f, 0.0f);
+		}
+
+		bool setMasterVolume(float volume, float rampMs = 5.0f)
+		{
+			MixerCommand cmd;
+			cmd.type = MIXER_SET_MASTER;
+			cmd.slot = 0;
+			cmd.source = 0;
+			cmd.volume = volume;
+			cmd.pan = 0.0f;
+			cmd.rampFrames = msToFrames(rampMs);
+
+			return commands.push(cmd);
+		}
+
+		// True until finished voice is collected by 'update()'.
+		bool isPlaying(Uint32 voice) const
+		{
+			unsigned int slot = voice & 0xFFFF;
+			return slot < H2_MIXER_MAX_VOICES && busy[slot] && generation[slot] == (voice >> 16);
+		}
+
+		// Collects voices finished by the callback, call once per frame.
+		void update()
+		{
+			H2_PROFILE_SCOPE("mixer update");
+
+			unsigned int slot;
+			while (finished.pop(&slot))
+			{
+				busy[slot] = false;
+				generation[slot] = (generation[slot] + 1) & 0xFFFF;
+				if (generation[slot] == 0)
+				{
+					generation[slot] = 1;
+				}
+
+				freeSlots[nFree++] = slot;
+				nActive--;
+			}
+		}
+
+		// Voices started and not yet collected.
+		inline unsigned int getActiveVoices() const
+		{
+			return nActive;
+		}
+
+		// Mixes 'nFrames' interleaved stereo frames into 'out'. Called by
+		// the audio callback; public for offline rendering and benchmarks.
+		void mix(float* out, unsigned int nFrames)
+		{
+			H2_PROFILE_SCOPE("mixer mix");
+
+			processCommands();
+
+			while (nFrames > 0)
+			{
+				unsigned int n = nFrames < H2_MIXER_BLOCK_FRAMES ? nFrames : H2_MIXER_BLOCK_FRAMES;
+
+				mixBlock(out, n);
+
+				out += n*H2_MIXER_CHANNELS;
+				nFrames -= n;
+			}
+		}
+
+	private:
+
+		SDL_AudioDeviceID device;
+
+		int frequency;
+
+		SDL_AudioFormat deviceFormat;
+
+		SpscRing<MixerCommand, H2_MIXER_COMMAND_RING> commands;
+
+		SpscRing<unsigned int, H2_MIXER_MAX_VOICES> finished;
+
+		// game thread side
+		Uint32 generation[H2_MIXER_MAX_VOICES];
+		bool busy[H2_MIXER_MAX_VOICES];
+		unsigned int freeSlots[H2_MIXER_MAX_VOICES];
+		unsigned int nFree, nActive;
+
+		// callback side, SoA
+		AudioSource* sources[H2_MIXER_MAX_VOICES];
+		unsigned int channels[H2_MIXER_MAX_VOICES];
+		float gainL[H2_MIXER_MAX_VOICES], gainR[H2_MIXER_MAX_VOICES];
+		float targetL[H2_MIXER_MAX_VOICES], targetR[H2_MIXER_MAX_VOICES];
+		unsigned int rampLeft[H2_MIXER_MAX_VOICES];
+		bool stopping[H2_MIXER_MAX_VOICES];
+		bool pausing[H2_MIXER_MAX_VOICES], paused[H2_MIXER_MAX_VOICES];
+		double baseStep[H2_MIXER_MAX_VOICES];   // source frequency/mixer frequency
+		float pitch[H2_MIXER_MAX_VOICES];
+		bool resampling[H2_MIXER_MAX_VOICES];
+
+		TaggedVector<Resampler, MEMORY_TAG_SOUND>::Type resamplers;
+		ResamplerTables resamplerTables;
+
+		unsigned int activeSlots[H2_MIXER_MAX_VOICES];
+		unsigned int nPlaying;
+
+		float masterGain, masterTarget;
+		unsigned int masterRamp;
+
+		float accum[H2_MIXER_BLOCK_FRAMES*H2_MIXER_CHANNELS];
+		float voiceBuffer[H2_MIXER_BLOCK_FRAMES*H2_MIXER_CHANNELS];
+		float sourceBuffer[H2_RESAMPLER_BLOCK*H2_MIXER_CHANNELS];
+		float outBuffer[H2_MIXER_BLOCK_FRAMES*H2_MIXER_CHANNELS];
+
+
+		AudioMixer(const AudioMixer&);
+		AudioMixer& operator = (const AudioMixer&);
+
+		static void SDLCALL audioCallback(void* userdata, Uint8* stream, int len)
+		{
+			AudioMixer* mixer = (AudioMixer*)userdata;
+
+			if (mixer->deviceFormat != AUDIO_S16SYS)
+			{
+				mixer->mix((float*)stream, (unsigned int)len/(sizeof(float)*H2_MIXER_CHANNELS));
+				return;
+			}
+
+			Sint16* out = (Sint16*)stream;
+			unsigned int nFrames = (unsigned int)len/(sizeof(Sint16)*H2_MIXER_CHANNELS);
+
+			while (nFrames > 0)
+			{
+				unsigned int n = nFrames < H2_MIXER_BLOCK_FRAMES ? nFrames : H2_MIXER_BLOCK_FRAMES;
+
+				mixer->mix(mixer->outBuffer, n);
+				convertFloatToS16(mixer->outBuffer, out, n*H2_MIXER_CHANNELS);
+
+				out += n*H2_MIXER_CHANNELS;
+				nFrames -= n;
+			}
+		}
+
+		inline Uint32 makeHandle(unsigned int slot) const
+		{
+			return (generation[slot] << 16) | slot;
+		}
+
+		inline unsigned int msToFrames(float ms) const
+		{
+			return ms > 0.0f ? (unsigned int)(ms*0.001f*frequency) : 0;
+		}
+
+		bool sendVoiceCommand(MixerCommandType type, Uint32 voice, float volume, float pan, float rampMs)
+		{
+			if (!isPlaying(voice))
+			{
+				return false;
+			}
+
+			MixerCommand cmd;
+			cmd.type = type;
+			cmd.slot = voice & 0xFFFF;
+			cmd.source = 0;
+			cmd.volume = volume;
+			cmd.pan = pan;
+			cmd.rampFrames = msToFrames(rampMs);
+
+			return commands.push(cmd);
+		}
+
+		// Constant power pan for mono, balance for stereo, so centered
+		// stereo keeps unity gain.
+		static void panGains(unsigned int nChannels, float volume, float pan, float* outL, float* outR)
+		{
+			pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+
+			if (nChannels == 1)
+			{
+				float angle = (pan + 1.0f)*0.785398163f;
+				*outL = volume*std::cos(angle);
+				*outR = volume*std::sin(angle);
+			} else
+			{
+				*outL = volume*(pan > 0.0f ? 1.0f - pan : 1.0f);
+				*outR = volume*(pan < 0.0f ? 1.0f + pan : 1.0f);
+			}
+		}
+
+		void setTarget(unsigned int slot, float volume, float pan, unsigned int ramp)
+		{
+			panGains(channels[slot], volume, pan, &targetL[slot], &targetR[slot]);
+
+			rampLeft[slot] = ramp;
+			if (ramp == 0)
+			{
+				gainL[slot] = targetL[slot];
+				gainR[slot] = targetR[slot];
+			}
+		}
+
+		void processCommands()
+		{
+			MixerCommand cmd;
+			while (commands.pop(&cmd))
+			{
+				unsigned int s = cmd.slot;
+
+				switch (cmd.type)
+				{
+				case MIXER_PLAY:
+					sources[s] = cmd.source;
+					channels[s] = cmd.source->getChannels() == 1 ? 1 : 2;
+					stopping[s] = pausing[s] = paused[s] = false;
+					gainL[s] = gainR[s] = 0.0f;
+					baseStep[s] = 1.0;
+					if (cmd.source->getFrequency() != 0 && frequency != 0)
+					{
+						baseStep[s] = (double)cmd.source->getFrequency()/frequency;
+					}
+					pitch[s] = 1.0f;
+					resampling[s] = false;
+					setTarget(s, cmd.volume, cmd.pan, cmd.rampFrames);
+					activeSlots[nPlaying++] = s;
+					break;
+
+				case MIXER_STOP:
+					if (sources[s] != 0)
+					{
+						// a paused voice is silent already and finishes in the next block
+						rampLeft[s] = paused[s] ? 0 : cmd.rampFrames;
+						stopping[s] = true;
+						pausing[s] = paused[s] = false;
+						targetL[s] = targetR[s] = 0.0f;
+					}
+					break;
+
+				case MIXER_SET_GAIN:
+					if (sources[s] != 0 && !stopping[s] && !pausing[s] && !paused[s])
+					{
+						setTarget(s, cmd.volume, cmd.pan, cmd.rampFrames);
+					}
+					break;
+
+				case MIXER_SET_PITCH:
+					if (sources[s] != 0)
+					{
+						pitch[s] = cmd.volume;
+					}
+					break;
+
+				case MIXER_PAUSE:
+					if (sources[s] != 0 && !stopping[s] && !paused[s])
+					{
+						pausing[s] = true;
+						targetL[s] = targetR[s] = 0.0f;
+						rampLeft[s] = cmd.rampFrames;
+						if (rampLeft[s] == 0)
+						{
+							gainL[s] = gainR[s] = 0.0f;
+							pausing[s] = false;
+							paused[s] = true;
+						}
+					}
+					break;
+
+				case MIXER_RESUME:
+					if (sources[s] != 0 && !stopping[s])
+					{
+						pausing[s] = paused[s] = false;
+						gainL[s] = gainR[s] = targetL[s] = targetR[s] = 0.0f;
+						rampLeft[s] = 0;
+					}
+					break;
+
+				case MIXER_SET_MASTER:
+					masterTarget = cmd.volume;
+					masterRamp = cmd.rampFrames;
+					if (masterRamp == 0)
+					{
+						masterGain = masterTarget;
+					}
+					break;
+				}
+			}
+		}
+
+		void mixBlock(float* out, unsigned int nFrames)
+		{
+			memset(accum, 0, nFrames*H2_MIXER_CHANNELS*sizeof(float));
+
+			unsigned int i = 0;
+			while (i < nPlaying)
+			{
+				unsigned int s = activeSlots[i];
+
+				if (paused[s])
+				{
+					i++;
+					continue;
+				}
+
+				bool done = (stopping[s] && rampLeft[s] == 0);
+				if (!done)
+				{
+					double voiceStep = baseStep[s]*pitch[s];
+
+					// once resampled, a voice stays on the resampler to keep its history
+					if (!resampling[s] && voiceStep != 1.0)
+					{
+						resampling[s] = true;
+						resamplers[s].reset(channels[s]);
+					}
+
+					unsigned int n = resampling[s] ?
+									 resamplers[s].process(sources[s], voiceBuffer, nFrames, voiceStep, resamplerTables, sourceBuffer) :
+									 sources[s]->read(voiceBuffer, nFrames);
+					mixVoice(s, n);
+					done = (n < nFrames) || (stopping[s] && rampLeft[s] == 0);
+
+					if (!done && pausing[s] && rampLeft[s] == 0)
+					{
+						pausing[s] = false;
+						paused[s] = true;
+					}
+				}
+
+				if (done)
+				{
+					sources[s] = 0;
+					activeSlots[i] = activeSlots[--nPlaying];
+					finished.push(s);   // never full, one entry per started voice
+				} else
+				{
+					i++;
+				}
+			}
+
+			// master gain and clipping
+			unsigned int rampN = masterRamp < nFrames ? masterRamp : nFrames;
+			float masterStep = rampN > 0 ? (masterTarget - masterGain)/masterRamp : 0.0f;
+
+			outputKernel(out, accum, rampN, masterGain, masterStep);
+			masterGain = rampN > 0 ? masterGain + masterStep*rampN : masterGain;
+			masterRamp -= rampN;
+			if (masterRamp == 0)
+			{
+				masterGain = masterTarget;
+			}
+
+			outputKernel(out + rampN*H2_MIXER_CHANNELS, accum + rampN*H2_MIXER_CHANNELS, nFrames - rampN, masterGain, 0.0f);
+		}
+
+		// Accumulates 'n' frames of voice buffer: ramp part first, then
+		// constant gain.
+		void mixVoice(unsigned int s, unsigned int n)
+		{
+			unsigned int rampN = rampLeft[s] < n ? rampLeft[s] : n;
+			float stepL = 0.0f, stepR = 0.0f;
+
+			if (rampN > 0)
+			{
+				stepL = (targetL[s] - gainL[s])/rampLeft[s];
+				stepR = (targetR[s] - gainR[s])/rampLeft[s];
+
+				accumulate(accum, voiceBuffer, channels[s], rampN, gainL[s], gainR[s], stepL, stepR);
+
+				rampLeft[s] -= rampN;
+				if (rampLeft[s] == 0)
+				{
+					gainL[s] = targetL[s];
+					gainR[s] = targetR[s];
+				} else
+				{
+					gainL[s] += stepL*rampN;
+					gainR[s] += stepR*rampN;
+				}
+			}
+
+			if (n > rampN)
+			{
+				accumulate(accum + rampN*H2_MIXER_CHANNELS, voiceBuffer + rampN*channels[s], channels[s],
+						   n - rampN, gainL[s], gainR[s], 0.0f, 0.0f);
+			}
+		}
+
+		// dst[2i] += src*gl, dst[2i + 1] += src*gr with per frame gain steps.
+		static void accumulate(float* dst, const float* src, unsigned int nChannels, unsigned int n,
+							   float gl, float gr, float dl, float dr)
+		{
+			unsigned int i = 0;
+
+#ifdef H2_SIMD_SSE
+			// two stereo frames per vector
+			__m128 g = _mm_setr_ps(gl, gr, gl + dl, gr + dr);
+			__m128 step = _mm_setr_ps(2.0f*dl, 2.0f*dr, 2.0f*dl, 2.0f*dr);
+
+			if (nChannels == 1)
+			{
+				for (; i + 4 <= n; i += 4)
+				{
+					__m128 m = _mm_loadu_ps(src + i);
+					__m128 lo = _mm_unpacklo_ps(m, m);
+					__m128 hi = _mm_unpackhi_ps(m, m);
+
+					_mm_storeu_ps(dst + 2*i, _mm_add_ps(_mm_loadu_ps(dst + 2*i), _mm_mul_ps(lo, g)));
+					g = _mm_add_ps(g, step);
+					_mm_storeu_ps(dst + 2*i + 4, _mm_add_ps(_mm_loadu_ps(dst + 2*i + 4), _mm_mul_ps(hi, g)));
+					g = _mm_add_ps(g, step);
+				}
+			} else
+			{
+				for (; i + 2 <= n; i += 2)
+				{
+					_mm_storeu_ps(dst + 2*i, _mm_add_ps(_mm_loadu_ps(dst + 2*i), _mm_mul_ps(_mm_loadu_ps(src + 2*i), g)));
+					g = _mm_add_ps(g, step);
+				}
+			}
+
+			gl += dl*i;
+			gr += dr*i;
+#endif
+
+			for (; i < n; i++)
+			{
+				float l = (nChannels == 1) ? src[i] : src[2*i];
+				float r = (nChannels == 1) ? src[i] : src[2*i + 1];
+
+				dst[2*i] += l*gl;
+				dst[2*i + 1] += r*gr;
+
+				gl += dl;
+				gr += dr;
+			}
+		}
+
+		// out = clamp(src*gain, -1, 1) for 'n' stereo frames.
+		static void outputKernel(float* out, const float* src, unsigned int n, float gain, float step)
+		{
+			unsigned int i = 0;
+			n *= H2_MIXER_CHANNELS;
+
+#ifdef H2_SIMD_SSE
+			__m128 g = _mm_setr_ps(gain, gain, gain + step, gain + step);
+			__m128 s = _mm_set1_ps(2.0f*step);
+			__m128 lo = _mm_set1_ps(-1.0f);
+			__m128 hi = _mm_set1_ps(1.0f);
+
+			for (; i + 4 <= n; i += 4)
+			{
+				__m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+				_mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(v, lo), hi));
+				g = _mm_add_ps(g, s);
+			}
+
+			gain += step*(i/2);
+#endif
+
+			for (; i < n; i += 2)
+			{
+				float l = src[i]*gain;
+				float r = src[i + 1]*gain;
+
+				out[i] = l < -1.0f ? -1.0f : (l > 1.0f ? 1.0f : l);
+				out[i + 1] = r < -1.0f ? -1.0f : (r > 1.0f ? 1.0f : r);
+
+				gain += step;
+			}
+		}
+	};
+}
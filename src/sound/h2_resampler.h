@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+
+#include "SDL_stdinc.h"
+
+#include "../math/h2_simd.h"
+#include "h2_audio_source.h"
+
+
+
+#define H2_RESAMPLER_TAPS        16     // filter length, multiple of 4
+#define H2_RESAMPLER_PHASES     128     // sub-sample positions in each table
+#define H2_RESAMPLER_TABLES       8     // cutoff levels for downsampling
+#define H2_RESAMPLER_MAX_STEP   4.0     // max input frames per output frame
+#define H2_RESAMPLER_BLOCK      512     // input frames pulled from source at once
+
+
+
+
+namespace h2
+{
+	// Windowed sinc filter banks, one per cutoff. Table 0 has cutoff at
+	// Nyquist and is used when upsampling; table i lowers the cutoff to
+	// (H2_RESAMPLER_TABLES - i)/H2_RESAMPLER_TABLES for downsampling.
+	// Each phase has unity DC gain. One extra phase at the end lets the
+	// resampler interpolate between phases without wrapping.
+	class ResamplerTables
+	{
+	public:
+
+		// Constructors
+
+		ResamplerTables()
+		{
+			for (unsigned int t = 0; t < H2_RESAMPLER_TABLES; t++)
+			{
+				build(t, (float)(H2_RESAMPLER_TABLES - t)/H2_RESAMPLER_TABLES*0.95f);
+			}
+		}
+
+
+		// Methods
+
+		// Table for 'step' input frames per output frame.
+		inline const float* get(double step) const
+		{
+			unsigned int t = 0;
+
+			if (step > 1.0)
+			{
+				// largest table with cutoff at or below 1/step
+				t = H2_RESAMPLER_TABLES - (unsigned int)(H2_RESAMPLER_TABLES/step);
+				t = t < H2_RESAMPLER_TABLES ? t : H2_RESAMPLER_TABLES - 1;
+			}
+
+			return coefs[t][0];
+		}
+
+	private:
+
+		float coefs[H2_RESAMPLER_TABLES][H2_RESAMPLER_PHASES + 1][H2_RESAMPLER_TAPS];
+
+
+		void build(unsigned int table, float cutoff)
+		{
+			const double pi = 3.14159265358979323846;
+			const double half = H2_RESAMPLER_TAPS/2;
+
+			for (unsigned int p = 0; p <= H2_RESAMPLER_PHASES; p++)
+			{
+				// tap H2_RESAMPLER_TAPS/2 - 1 is centered at phase 0
+				double center = half - 1.0 + (double)p/H2_RESAMPLER_PHASES;
+				double sum = 0.0;
+
+				for (unsigned int k = 0; k < H2_RESAMPLER_TAPS; k++)
+				{
+					double x = k - center;
+					double sinc = (x == 0.0) ? 1.0 : std::sin(pi*cutoff*x)/(pi*cutoff*x);
+
+					// Blackman window over [-half, half]
+					double w = x/half;
+					double window = (w <= -1.0 || w >= 1.0) ? 0.0 : 0.42 + 0.5*std::cos(pi*w) + 0.08*std::cos(2.0*pi*w);
+
+					coefs[table][p][k] = (float)(sinc*window);
+					sum += sinc*window;
+				}
+
+				for (unsigned int k = 0; k < H2_RESAMPLER_TAPS; k++)
+				{
+					coefs[table][p][k] = (float)(coefs[table][p][k]/sum);
+				}
+			}
+		}
+	};
+
+
+	// Streaming polyphase resampler for one voice.
+	//
+	// Pulls input from an AudioSource in blocks, keeps H2_RESAMPLER_TAPS
+	// frames of history per channel (planar), and evaluates the filter
+	// at a 32.32 fixed point position, interpolating coefficients between
+	// the two nearest phases. 'step' may change between calls (pitch and
+	// doppler); it is clamped to H2_RESAMPLER_MAX_STEP.
+	class Resampler
+	{
+	public:
+
+		// Constructors
+
+		Resampler()
+		{
+			reset(1);
+		}
+
+
+		// Methods
+
+		void reset(unsigned int in_nChannels)
+		{
+			nChannels = in_nChannels == 2 ? 2 : 1;
+
+			// pre-roll puts the center tap on the first input frame
+			memset(history, 0, sizeof(history));
+			filled = H2_RESAMPLER_TAPS/2 - 1;
+			position = 0;
+			endFrame = 0;
+			ended = false;
+		}
+
+		// Writes up to 'nOut' interleaved frames. Returns fewer frames once
+		// source ended and the filter tail was flushed. 'scratch' must hold
+		// H2_RESAMPLER_BLOCK*2 floats.
+		unsigned int process(AudioSource* source, float* out, unsigned int nOut, double step,
+							 const ResamplerTables& tables, float* scratch)
+		{
+			step = step > H2_RESAMPLER_MAX_STEP ? H2_RESAMPLER_MAX_STEP : (step < 1.0/65536.0 ? 1.0/65536.0 : step);
+
+			const Uint64 fixedStep = (Uint64)(step*4294967296.0);
+			const float* table = tables.get(step);
+
+			unsigned int written = 0;
+
+			while (written < nOut)
+			{
+				// outputs this round are limited by input that fits history
+				unsigned int n = nOut - written;
+				unsigned int maxOut = (unsigned int)((H2_RESAMPLER_BLOCK - 1)/step);
+				n = n < maxOut ? n : (maxOut > 0 ? maxOut : 1);
+
+				unsigned int needed = (unsigned int)((position + (n - 1)*fixedStep) >> 32) + H2_RESAMPLER_TAPS;
+				if (needed > filled)
+				{
+					pull(source, needed - filled, scratch);
+				}
+
+				if (ended)
+				{
+					// only frames whose first tap is before real data end
+					unsigned int valid = 0;
+					Uint64 p = position;
+					while (valid < n && (unsigned int)(p >> 32) < endFrame)
+					{
+						p += fixedStep;
+						valid++;
+					}
+					n = valid;
+				}
+
+				if (n == 0)
+				{
+					break;
+				}
+
+				for (unsigned int c = 0; c < nChannels; c++)
+				{
+					filter(history[c], out + written*nChannels + c, n, table, fixedStep);
+				}
+
+				position += n*fixedStep;
+				written += n;
+
+				discardConsumed();
+			}
+
+			return written;
+		}
+
+	private:
+
+		float history[2][H2_RESAMPLER_BLOCK + H2_RESAMPLER_TAPS];
+
+		unsigned int nChannels;
+
+		unsigned int filled;     // frames in history
+
+		Uint64 position;         // 32.32 index of first tap of next output
+
+		unsigned int endFrame;   // history index where source data ended
+
+		bool ended;
+
+
+		// Appends 'count' frames from source, zero padded past its end.
+		void pull(AudioSource* source, unsigned int count, float* scratch)
+		{
+			while (count > 0)
+			{
+				unsigned int room = H2_RESAMPLER_BLOCK + H2_RESAMPLER_TAPS - filled;
+				unsigned int n = count < room ? count : room;
+				n = n < H2_RESAMPLER_BLOCK ? n : H2_RESAMPLER_BLOCK;
+
+				if (n == 0)
+				{
+					return;
+				}
+
+				unsigned int got = ended ? 0 : source->read(scratch, n);
+
+				if (got < n && !ended)
+				{
+					ended = true;
+					endFrame = filled + got;
+				}
+
+				if (nChannels == 1)
+				{
+					memcpy(history[0] + filled, scratch, got*sizeof(float));
+				} else
+				{
+					for (unsigned int i = 0; i < got; i++)
+					{
+						history[0][filled + i] = scratch[2*i];
+						history[1][filled + i] = scratch[2*i + 1];
+					}
+				}
+
+				for (unsigned int c = 0; c < nChannels; c++)
+				{
+					memset(history[c] + filled + got, 0, (n - got)*sizeof(float));
+				}
+
+				filled += n;
+				count -= n;
+			}
+		}
+
+		void discardConsumed()
+		{
+			unsigned int consumed = (unsigned int)(position >> 32);
+			if (consumed == 0)
+			{
+				return;
+			}
+
+			consumed = consumed < filled ? consumed : filled;
+
+			for (unsigned int c = 0; c < nChannels; c++)
+			{
+				memmove(history[c], history[c] + consumed, (filled - consumed)*sizeof(float));
+			}
+
+			filled -= consumed;
+			position -= (Uint64)consumed << 32;
+			endFrame = endFrame > consumed ? endFrame - consumed : 0;
+		}
+
+		// Filters one channel into interleaved 'out'.
+		void filter(const float* in, float* out, unsigned int n, const float* table, Uint64 fixedStep) const
+		{
+			Uint64 p = position;
+
+			for (unsigned int i = 0; i < n; i++, p += fixedStep)
+			{
+				const float* x = in + (unsigned int)(p >> 32);
+
+				float phase = (float)(Uint32)p*(H2_RESAMPLER_PHASES/4294967296.0f);
+				unsigned int ip = (unsigned int)phase;
+				float frac = phase - ip;
+
+				const float* a = table + ip*H2_RESAMPLER_TAPS;
+				const float* b = a + H2_RESAMPLER_TAPS;
+
+#ifdef H2_SIMD_SSE
+				__m128 f = _mm_set1_ps(frac);
+				__m128 acc = _mm_setzero_ps();
+
+				for (unsigned int k = 0; k < H2_RESAMPLER_TAPS; k += 4)
+				{
+					__m128 ca = _mm_loadu_ps(a + k);
+					__m128 c = _mm_add_ps(ca, _mm_mul_ps(f, _mm_sub_ps(_mm_loadu_ps(b + k), ca)));
+					acc = _mm_add_ps(acc, _mm_mul_ps(c, _mm_loadu_ps(x + k)));
+				}
+
+				acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+				acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+				_mm_store_ss(out + i*nChannels, acc);
+#else
+				float acc = 0.0f;
+
+				for (unsigned int k = 0; k < H2_RESAMPLER_TAPS; k++)
+				{
+					acc += (a[k] + frac*(b[k] - a[k]))*x[k];
+				}
+
+				out[i*nChannels] = acc;
+#endif
+			}
+		}
+	};
+}
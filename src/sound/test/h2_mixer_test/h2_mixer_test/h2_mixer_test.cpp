@@ -0,0 +1,95 @@
+// Offline checks of AudioMixer voice lifetime, no audio device needed.
+//
+// Linux:
+//   g++ -O2 -I../../../../sdl/include h2_mixer_test.cpp -o h2_mixer_test -lSDL2
+
+#include "../../../h2_audio3d.h"
+#include "../../../h2_mixer.h"
+#include "../../../../test/h2_test.h"
+
+
+
+#define TEST_FREQUENCY 48000
+#define TEST_FRAMES 4096
+
+
+using namespace h2;
+
+
+static float samples[TEST_FRAMES];
+static float out[H2_MIXER_BLOCK_FRAMES*H2_MIXER_CHANNELS];
+
+// One block through the callback path, then collection on the game side.
+static void step(AudioMixer& mixer)
+{
+	mixer.mix(out, H2_MIXER_BLOCK_FRAMES);
+	mixer.update();
+}
+
+
+int main(int, char*[])
+{
+	for (unsigned int i = 0; i < TEST_FRAMES; i++)
+	{
+		samples[i] = 0.5f;
+	}
+
+	// a looping source never ends on its own
+	SampleSource source(samples, TEST_FRAMES, 1, true);
+
+	{
+		AudioMixer mixer;
+		mixer.setFrequency(TEST_FREQUENCY);
+
+		Uint32 voice = mixer.play(&source, 1.0f, 0.0f);
+		step(mixer);
+		mixer.stop(voice, 1.0f);
+		step(mixer);
+		step(mixer);
+		check(!mixer.isPlaying(voice) && mixer.getActiveVoices() == 0, "stop while playing frees the voice");
+	}
+
+	{
+		AudioMixer mixer;
+		mixer.setFrequency(TEST_FREQUENCY);
+
+		Uint32 voice = mixer.play(&source, 1.0f, 0.0f);
+		mixer.pause(voice, 0.0f);
+		step(mixer);
+		check(mixer.isPlaying(voice), "paused voice keeps its slot");
+
+		mixer.stop(voice, 5.0f);
+		step(mixer);
+		step(mixer);
+		check(!mixer.isPlaying(voice) && mixer.getActiveVoices() == 0, "stop while paused frees the voice");
+	}
+
+	{
+		AudioMixer mixer;
+		mixer.setFrequency(TEST_FREQUENCY);
+
+		Uint32 voice = mixer.play(&source, 1.0f, 0.0f);
+		step(mixer);
+		mixer.pause(voice, 5.0f);
+		mixer.stop(voice, 5.0f);
+		step(mixer);
+		step(mixer);
+		check(!mixer.isPlaying(voice) && mixer.getActiveVoices() == 0, "stop while pausing frees the voice");
+	}
+
+	{
+		// emitters start virtualized, i.e. paused in the mixer
+		AudioMixer mixer;
+		mixer.setFrequency(TEST_FREQUENCY);
+
+		Audio3D audio;
+		int e = audio.addEmitter(mixer, &source, Vector3f(0.0f, 0.0f, 0.0f));
+		step(mixer);
+		audio.removeEmitter(mixer, (unsigned int)e);
+		step(mixer);
+		step(mixer);
+		check(e >= 0 && mixer.getActiveVoices() == 0, "removing a virtualized emitter frees its voice");
+	}
+
+	return endChecks();
+}
@@ -2,6 +2,12 @@
 #include "windows.h"
 
 #include "..\..\..\HydrogenFramework.h"
+#include "..\..\..\video\h2_batch2d.h"
+#include "..\..\..\video\h2_bitmap_font.h"
+#include "..\..\..\video\h2_debug_draw.h"
+#include "..\..\..\video\h2_lod.h"
+#include "..\..\..\input\wrapper_sdl\h2_input_sdl.h"
+#include "..\..\..\input\h2_input_latency.h"
 
 #include "SDL.h"
 
@@ -13,101 +19,31 @@
 #pragma once
 
 
-void DrawQBezier2D(SDL_Renderer* sdl_renderer, h2::Vector2f p0, h2::Vector2f p1, h2::Vector2f p2)
+void DrawQBezier2D(h2::Batch2D& batch, h2::Vector2f p0, h2::Vector2f p1, h2::Vector2f p2)
 {
-	
-	int bez_div = 16;
+	// segments follow on-screen size, half a pixel chord error
+	unsigned int bez_div = h2::quadraticBezierSegments(p0, p1, p2, 0.5f);
 
-	float bez_step = 1.0f/bez_div;
-
-	h2::Vector2f pointMin, pointMax;
-
-	float t;
-
-	for (int i = 0; i < bez_div; i++)
-	{
-		t = bez_step*i;;
-
-		pointMin = (1.0f-t)*(1.0f-t)*p0 + 2.0f*t*(1.0f-t)*p1 + t*t*p2;
-
-		t = bez_step*(i+1);
-
-		pointMax = (1.0f-t)*(1.0f-t)*p0 + 2.0f*t*(1.0f-t)*p1 + t*t*p2; 
-		
-		SDL_RenderDrawLine(sdl_renderer, (int)pointMin.x, (int)pointMin.y, (int)pointMax.x, (int)pointMax.y);
-	}
+	batch.drawQuadraticBezier(p0, p1, p2, bez_div);
 }
 
-template <class T>
-int projectPointToQuadraticBezier(const T& p0, const T& p1, const T& p2, const T& inPoint, T* outPoint, int flag)
+int main(int argc, char* argv[])
 {
-	T A, B;
+	// -record <file> logs input of the session, -replay <file> plays it
+	// back frame by frame and exits when the log ends
+	const char* recordPath = 0;
+	const char* replayPath = 0;
 
-	A = p1 - p0;
-	B = p2 - 2.0f*p1 + p0;
-
-	float a, b, c, d;
-
-	a = h2::dot(B, B);
-	b = 3.0f*h2::dot(A, B);
-
-	T _M = p0 - inPoint;
-
-	c = 2.0f*h2::dot(A, A) + h2::dot(_M, B);
-	d = h2::dot(_M, A);
-
-	float roots[3];
-
-	int nRoots = h2::solveThirdDegreeEquation(a, b, c, d, roots);
-
-	if (nRoots == 0)
-	{
-		return 0;
-	}
-	else
+	for (int i = 1; i + 1 < argc; i++)
 	{
-
-		float curr_t, colsest_t;
-		float currDistance, minDistance;
-		int nProj = 0;
-
-		for (int i = 0; i < nRoots; i++)
+		if (strcmp(argv[i], "-record") == 0)
+		{
+			recordPath = argv[++i];
+		} else if (strcmp(argv[i], "-replay") == 0)
 		{
-			curr_t = roots[i];
-
-			if (curr_t >= 0 && curr_t <= 1.0f)
-			{
-				if ( nProj == 0)
-				{
-					minDistance = h2::distanance(inPoint, h2::quadraticBezier(p0, p1, p2, curr_t));
-					colsest_t = curr_t;
-					nProj++;
-				} 
-				else
-				{
-					currDistance = h2::distanance(inPoint, h2::quadraticBezier(p0, p1, p2, curr_t));
-
-					if (currDistance < minDistance)
-					{
-						minDistance = currDistance;
-						colsest_t = curr_t;
-					}
-					nProj++;
-				}
-			}
+			replayPath = argv[++i];
 		}
-		
-		*outPoint = h2::quadraticBezier(p0, p1, p2, colsest_t);
-
-		return 1;
 	}
-}
-
-
-int main(int argc, char* argv[])
-{
-	UNREFERENCED_PARAMETER(argc);
-	UNREFERENCED_PARAMETER(argv);
 
     SDL_Init(SDL_INIT_EVERYTHING);
 
@@ -126,32 +62,92 @@ int main(int argc, char* argv[])
 
 	int done = 0;
 
-	SDL_Event ievent;
-
 	int mouseX, mouseY;
 
+	h2::Batch2D batch;
+
+	static h2::InputSDL input;
+	input.start();
+
+	h2::InputRecorder recorder;
+	h2::InputPlayer player;
+
+	if (replayPath != 0)
+	{
+		if (player.load(replayPath))
+		{
+			input.setPlayer(&player);
+		} else
+		{
+			std::cout << "can't load input log " << replayPath << std::endl;
+		}
+	}
+
+	if (recordPath != 0)
+	{
+		recorder.begin(input.getSnapshot().frameIndex + 1);
+		input.setRecorder(&recorder);
+	}
+
+	h2::InputLatencyTracker latency;
+
+	// F1 toggles frame time overlay
+	h2::BitmapFontRasterizer debugFont;
+	h2::TextCache debugText;
+	debugText.create(renderer, &debugFont, 256, 256);
+
+	h2::DebugDraw debug;
+	debug.setTextCache(&debugText);
+	debug.setEnabled(false);
+
+	float frameTimes[120] = {0.0f};
+	Uint64 lastCounter = SDL_GetPerformanceCounter();
+
 	while (done == 0)
 	{
-		SDL_GetMouseState(&mouseX, &mouseY);
+		input.pump();
 
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-		SDL_RenderClear(renderer);
+		// window events are left in SDL's queue, the demo has no use for them
+		SDL_Event windowEvent;
+		while (SDL_PollEvent(&windowEvent))
+		{
+		}
+
+		const h2::InputSnapshot& frameInput = input.update();
 
-		while (SDL_PollEvent(&ievent))
+		latency.beginFrame(frameInput);
+
+		if (frameInput.quit || frameInput.keyboard.isPressed(SDL_SCANCODE_ESCAPE))
 		{
-			if (ievent.type == SDL_QUIT) {done = 1;}
-
-			if (ievent.type == SDL_KEYDOWN)
-			{
-				if (ievent.key.keysym.sym == SDLK_ESCAPE)
-				{ 
-					done = 1; 
-				} 
-			}
+			done = 1;
 		}
 
-		SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-		DrawQBezier2D(renderer, bezP0, bezP1, bezP2);
+		if (input.getPlayer() != 0 && player.isFinished())
+		{
+			done = 1;
+		}
+
+		if (frameInput.keyboard.isPressed(SDL_SCANCODE_F1))
+		{
+			debug.setEnabled(!debug.isEnabled());
+		}
+
+		Uint64 counter = SDL_GetPerformanceCounter();
+		memmove(frameTimes, frameTimes + 1, sizeof(frameTimes) - sizeof(float));
+		frameTimes[119] = (float)(counter - lastCounter)*1000.0f/(float)SDL_GetPerformanceFrequency();
+		lastCounter = counter;
+
+		debugText.newFrame();
+		debug.newFrame();
+
+		mouseX = frameInput.mouse.x;
+		mouseY = frameInput.mouse.y;
+
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		SDL_RenderClear(renderer);
+
+		batch.setColor(255, 0, 0);
+		DrawQBezier2D(batch, bezP0, bezP1, bezP2);
 
 		h2::Vector2f proj;
 
@@ -160,28 +156,48 @@ int main(int argc, char* argv[])
 		mPos.x = (float)mouseX;
 		mPos.y = (float)mouseY;
 
-		if (projectPointToQuadraticBezier(bezP0, bezP1, bezP2, mPos, &proj, 1) == 0)
+		if (h2::projectPointToQuadraticBezier(bezP0, bezP1, bezP2, mPos, &proj) == 0)
 		{
 			proj.x = 50.0f;
 			proj.y = 50.0f;
 		}
 
-		SDL_Rect proj_rect = {(int)proj.x - 2, (int)proj.y - 2, 4, 4};
+		batch.setColor(255, 255, 255);
+		batch.drawRect(proj.x - 2.0f, proj.y - 2.0f, 4.0f, 4.0f);
 
-		SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-		SDL_RenderDrawRect(renderer, &proj_rect);
+		batch.setColor(255, 0, 0);
+		batch.drawRect((float)(mouseX - 2), (float)(mouseY - 2), 4.0f, 4.0f);
 
+		batch.flush(renderer);
 
+		debug.beginPanel(8, 8, "frame");
+		debug.panelText(0xFFFFFFFF, "%.2f ms", frameTimes[119]);
+		debug.panelGraph(frameTimes, 120, 0.0f, 33.3f, 0x40FF40FF, 240, 40);
+		debug.panelText(0xFFFFFFFF, "distance %.1f", (mPos - proj).lenght());
+		debug.endPanel();
+		debug.render(renderer);
 
-		SDL_Rect cursor_rect = {mouseX - 2, mouseY - 2, 4, 4};
+		SDL_RenderPresent(renderer);
 
-		SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-		SDL_RenderDrawRect(renderer, &cursor_rect);
+		latency.present();
+	}
 
+	input.stop();
 
-		SDL_RenderPresent(renderer);
+	if (recordPath != 0)
+	{
+		recorder.end(input.getSnapshot().frameIndex);
+		if (!recorder.save(recordPath))
+		{
+			std::cout << "can't save input log " << recordPath << std::endl;
+		}
 	}
 
+	h2::LatencyStats stats = latency.getStats();
+
+	std::cout << "input to present latency, ms: p50 " << stats.p50 << ", p99 " << stats.p99
+			  << ", max " << stats.max << " (" << stats.nFrames << " frames)" << std::endl;
+
     SDL_Quit();
     
     return 0;    
@@ -0,0 +1,358 @@
+// Headless benchmark of 'h2::projectPointToQuadraticBezier()', the
+// query behind the 2nd_degree_bezier_closest_point demo.
+//
+// Linux:
+//   g++ -O2 -I../../../sdl/include main.cpp -o bezier_closest_point_bench
+//
+// Usage:
+//   bezier_closest_point_bench [-queries n] [-pool n] [-runs n]
+//                              [-check n] [-samples n] [-seed n]
+//
+// '-pool' random curves and points, in a 640x480 window like the demo's,
+// are queried round robin '-queries' times per run; the best of '-runs'
+// gives queries/sec. Branch statistics are then collected over the pool
+// in a separate, untimed pass. The first '-check' queries are compared
+// against brute force: the curve is sampled '-samples' times, ends
+// included, and the best sample is refined by golden section search.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+#include "../../../math/h2_bezier.h"
+
+
+
+#define BENCH_DEFAULT_QUERIES 4000000
+#define BENCH_DEFAULT_POOL 65536
+#define BENCH_DEFAULT_RUNS 3
+#define BENCH_DEFAULT_CHECK 20000
+#define BENCH_DEFAULT_SAMPLES 4096
+
+#define BENCH_WIDTH 640.0f
+#define BENCH_HEIGHT 480.0f
+
+#define BENCH_TOLERANCE 0.01f      // px, a result further than this from brute force is a miss
+#define BENCH_END_EPS 1e-4f        // 't' this close to 0 or 1 is a curve end
+
+
+using namespace h2;
+
+
+struct Query
+{
+	Vector2f p0, p1, p2;
+
+	Vector2f point;
+};
+
+
+static double nowNs()
+{
+#if defined(_WIN32)
+	static double nsPerTick = 0;
+	if (nsPerTick == 0)
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		nsPerTick = 1e9/(double)frequency.QuadPart;
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart*nsPerTick;
+#else
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec*1e9 + (double)t.tv_nsec;
+#endif
+}
+
+
+static unsigned int randomState = 1;
+
+// Uniform in [0, 1).
+static float randomFloat()
+{
+	randomState = randomState*1664525u + 1013904223u;
+	return (float)(randomState >> 8)/(float)(1u << 24);
+}
+
+static Vector2f randomPoint()
+{
+	float x = randomFloat()*BENCH_WIDTH;
+	float y = randomFloat()*BENCH_HEIGHT;
+
+	return Vector2f(x, y);
+}
+
+
+// Squared distance from 'point' to the curve at 't'.
+static inline float sqDistance(const Query& q, float t)
+{
+	Vector2f d = quadraticBezier(q.p0, q.p1, q.p2, t) - q.point;
+	return d.sqlenght();
+}
+
+// Closest point of the whole curve, ends included. Returns its 't'.
+static float bruteForce(const Query& q, unsigned int nSamples, float* outDistance)
+{
+	float best_t = 0;
+	float best = sqDistance(q, 0);
+
+	for (unsigned int i = 1; i <= nSamples; i++)
+	{
+		float t = (float)i/(float)nSamples;
+		float d = sqDistance(q, t);
+		if (d < best)
+		{
+			best = d;
+			best_t = t;
+		}
+	}
+
+	// the distance is unimodal between the neighbouring samples
+	const float ratio = 0.618034f;
+
+	float lo = best_t - 1.0f/(float)nSamples;
+	float hi = best_t + 1.0f/(float)nSamples;
+	lo = lo < 0 ? 0 : lo;
+	hi = hi > 1.0f ? 1.0f : hi;
+
+	for (int i = 0; i < 40; i++)
+	{
+		float t0 = hi - ratio*(hi - lo);
+		float t1 = lo + ratio*(hi - lo);
+
+		if (sqDistance(q, t0) < sqDistance(q, t1))
+		{
+			hi = t1;
+		} else
+		{
+			lo = t0;
+		}
+	}
+
+	float t = 0.5f*(lo + hi);
+	float d = sqDistance(q, t);
+	if (d < best)
+	{
+		best = d;
+		best_t = t;
+	}
+
+	*outDistance = sqrt(best);
+
+	return best_t;
+}
+
+
+static void printPercent(const char* label, unsigned int count, unsigned int total)
+{
+	printf("  %-26s %10u  %6.2f %%\n", label, count, total > 0 ? 100.0*count/total : 0.0);
+}
+
+
+int main(int argc, char* argv[])
+{
+	unsigned int nQueries = BENCH_DEFAULT_QUERIES;
+	unsigned int poolSize = BENCH_DEFAULT_POOL;
+	unsigned int nRuns = BENCH_DEFAULT_RUNS;
+	unsigned int nCheck = BENCH_DEFAULT_CHECK;
+	unsigned int nSamples = BENCH_DEFAULT_SAMPLES;
+
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		unsigned int value = (unsigned int)strtoul(argv[i + 1], 0, 10);
+
+		if (strcmp(argv[i], "-queries") == 0)
+		{
+			nQueries = value;
+		} else if (strcmp(argv[i], "-pool") == 0)
+		{
+			poolSize = value;
+		} else if (strcmp(argv[i], "-runs") == 0)
+		{
+			nRuns = value;
+		} else if (strcmp(argv[i], "-check") == 0)
+		{
+			nCheck = value;
+		} else if (strcmp(argv[i], "-samples") == 0)
+		{
+			nSamples = value;
+		} else if (strcmp(argv[i], "-seed") == 0)
+		{
+			randomState = value;
+		} else
+		{
+			fprintf(stderr, "unknown option '%s'\n", argv[i]);
+			return 2;
+		}
+		i++;
+	}
+
+	if (poolSize == 0 || nRuns == 0 || nSamples == 0)
+	{
+		fprintf(stderr, "-pool, -runs and -samples must be positive\n");
+		return 2;
+	}
+
+	std::vector<Query> pool(poolSize);
+	for (unsigned int i = 0; i < poolSize; i++)
+	{
+		pool[i].p0 = randomPoint();
+		pool[i].p1 = randomPoint();
+		pool[i].p2 = randomPoint();
+		pool[i].point = randomPoint();
+	}
+
+
+	// Throughput
+
+	double bestNs = 0;
+	unsigned int nProjected = 0;
+	float sink = 0;
+
+	for (unsigned int run = 0; run < nRuns; run++)
+	{
+		nProjected = 0;
+
+		double begin = nowNs();
+
+		for (unsigned int i = 0, j = 0; i < nQueries; i++)
+		{
+			const Query& q = pool[j];
+			Vector2f proj;
+
+			if (projectPointToQuadraticBezier(q.p0, q.p1, q.p2, q.point, &proj) != 0)
+			{
+				sink += proj.x + proj.y;
+				nProjected++;
+			}
+
+			j = j + 1 < poolSize ? j + 1 : 0;
+		}
+
+		double elapsed = nowNs() - begin;
+		if (run == 0 || elapsed < bestNs)
+		{
+			bestNs = elapsed;
+		}
+	}
+
+	printf("queries                      %10u  (%u distinct)\n", nQueries, poolSize);
+	printf("time                         %10.2f ms, best of %u\n", bestNs*1e-6, nRuns);
+	if (nQueries > 0)
+	{
+		printf("throughput                   %10.2f M queries/s, %.2f ns/query\n",
+			   1e3*nQueries/bestNs, bestNs/nQueries);
+	}
+	printf("projected                    %10.2f %%\n", nQueries > 0 ? 100.0*nProjected/nQueries : 0.0);
+
+
+	// Branches
+
+	BezierProjectionStats stats;
+	for (unsigned int i = 0; i < poolSize; i++)
+	{
+		const Query& q = pool[i];
+		Vector2f proj;
+
+		projectPointToQuadraticBezier(q.p0, q.p1, q.p2, q.point, &proj, &stats);
+	}
+
+	static const char* caseNames[CUBIC_CASE_COUNT] =
+	{
+		"quadratic (a = 0)",
+		"triple root",
+		"single + double root",
+		"three real roots",
+		"one real root"
+	};
+
+	printf("\ncubic solver branch\n");
+	for (unsigned int i = 0; i < CUBIC_CASE_COUNT; i++)
+	{
+		printPercent(caseNames[i], stats.nCubicCases[i], stats.nQueries);
+	}
+
+	printf("\nreal roots\n");
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		char label[32];
+		sprintf(label, "%u", i);
+		printPercent(label, stats.nRoots[i], stats.nQueries);
+	}
+
+	printf("\nroots with t in [0, 1]\n");
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		char label[32];
+		sprintf(label, "%u", i);
+		printPercent(label, stats.nRootsInRange[i], stats.nQueries);
+	}
+
+
+	// Accuracy
+
+	nCheck = nCheck < poolSize ? nCheck : poolSize;
+	if (nCheck == 0)
+	{
+		return sink == 12345.0f ? 1 : 0;
+	}
+
+	unsigned int nChecked = 0, nMissed = 0, nMissedAtEnd = 0, nUnprojected = 0, nUnprojectedAtEnd = 0;
+	double sumError = 0, maxError = 0;
+
+	for (unsigned int i = 0; i < nCheck; i++)
+	{
+		const Query& q = pool[i];
+
+		float refDistance;
+		float ref_t = bruteForce(q, nSamples, &refDistance);
+		bool atEnd = ref_t <= BENCH_END_EPS || ref_t >= 1.0f - BENCH_END_EPS;
+
+		Vector2f proj;
+		if (projectPointToQuadraticBezier(q.p0, q.p1, q.p2, q.point, &proj) == 0)
+		{
+			nUnprojected++;
+			nUnprojectedAtEnd += atEnd ? 1 : 0;
+			continue;
+		}
+
+		double error = (double)(proj - q.point).lenght() - refDistance;
+		error = error < 0 ? 0 : error;
+
+		sumError += error;
+		maxError = error > maxError ? error : maxError;
+		nChecked++;
+
+		if (error > BENCH_TOLERANCE)
+		{
+			nMissed++;
+			nMissedAtEnd += atEnd ? 1 : 0;
+		}
+	}
+
+	printf("\naccuracy against brute force, %u queries, %u samples per curve\n", nCheck, nSamples);
+	printf("  mean error                 %10.5f px\n", nChecked > 0 ? sumError/nChecked : 0.0);
+	printf("  max error                  %10.5f px\n", maxError);
+	printPercent("error above tolerance", nMissed, nCheck);
+	printPercent("  of them curve end closest", nMissedAtEnd, nCheck);
+	printPercent("no projection", nUnprojected, nCheck);
+	printPercent("  of them curve end closest", nUnprojectedAtEnd, nCheck);
+
+	// keeps the timed results alive
+	return sink == 12345.0f ? 1 : 0;
+}
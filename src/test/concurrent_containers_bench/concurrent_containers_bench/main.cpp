@@ -0,0 +1,798 @@
+// Contention benchmark of the lock-free containers in core/: MpmcQueue,
+// SpscRing, ConcurrentVector and a stack reclaimed by EpochReclaimer,
+// each against the same container behind an SDL_mutex.
+//
+// Linux:
+//   g++ -O2 -I../../../sdl/include main.cpp -o concurrent_containers_bench -lSDL2
+//
+// Usage:
+//   concurrent_containers_bench [-items n] [-runs n] [-threads n]
+//
+// Every thread pushes '-items' items. Queue cases run 1+1, 2+2, ... up
+// to '-threads' producers and consumers, the other cases 1, 2, ... up
+// to '-threads' threads. The best of '-runs' gives the throughput, and
+// every run checks that nothing was lost or duplicated. With fewer
+// cores than threads the numbers measure preemption more than
+// contention.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "SDL_atomic.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
+#include "SDL_timer.h"
+
+#include "../../../core/h2_concurrent_vector.h"
+#include "../../../core/h2_epoch.h"
+#include "../../../core/h2_mpmc_queue.h"
+#include "../../../core/h2_spsc_ring.h"
+
+
+
+#define BENCH_DEFAULT_ITEMS 1000000
+#define BENCH_DEFAULT_RUNS 3
+#define BENCH_DEFAULT_THREADS 4
+#define BENCH_MAX_THREADS 32
+
+#define BENCH_QUEUE_CAPACITY 1024
+#define BENCH_SPIN_COUNT 64        // failed attempts before a thread yields
+
+
+using namespace h2;
+
+
+// Spins a little, then gives the core away, so that waiting threads do
+// not starve the ones they wait for when cores are oversubscribed.
+static inline void backoff(unsigned int& nFailed)
+{
+	if (++nFailed >= BENCH_SPIN_COUNT)
+	{
+		SDL_Delay(0);
+		nFailed = 0;
+	}
+}
+
+static inline void waitFor(SDL_atomic_t* flag)
+{
+	unsigned int nFailed = 0;
+	while (SDL_AtomicGet(flag) == 0)
+	{
+		backoff(nFailed);
+	}
+}
+
+
+// Bounded queue behind a mutex, the baseline of the queue cases.
+template <class T>
+class LockedQueue
+{
+public:
+
+	LockedQueue(unsigned int in_capacity) : mutex(SDL_CreateMutex()), capacity(in_capacity)
+	{
+	}
+
+	~LockedQueue()
+	{
+		SDL_DestroyMutex(mutex);
+	}
+
+	bool push(const T& item)
+	{
+		SDL_LockMutex(mutex);
+		bool pushed = items.size() < capacity;
+		if (pushed)
+		{
+			items.push_back(item);
+		}
+		SDL_UnlockMutex(mutex);
+
+		return pushed;
+	}
+
+	bool pop(T* outItem)
+	{
+		SDL_LockMutex(mutex);
+		bool popped = !items.empty();
+		if (popped)
+		{
+			*outItem = items.front();
+			items.pop_front();
+		}
+		SDL_UnlockMutex(mutex);
+
+		return popped;
+	}
+
+private:
+
+	SDL_mutex* mutex;
+
+	std::deque<T> items;
+
+	unsigned int capacity;
+};
+
+
+// Growing array behind a mutex, the baseline of ConcurrentVector.
+template <class T>
+class LockedVector
+{
+public:
+
+	LockedVector() : mutex(SDL_CreateMutex())
+	{
+	}
+
+	~LockedVector()
+	{
+		SDL_DestroyMutex(mutex);
+	}
+
+	unsigned int push(const T& item)
+	{
+		SDL_LockMutex(mutex);
+		unsigned int index = (unsigned int)items.size();
+		items.push_back(item);
+		SDL_UnlockMutex(mutex);
+
+		return index;
+	}
+
+	inline unsigned int size()
+	{
+		return (unsigned int)items.size();
+	}
+
+	inline T& operator [] (unsigned int index)
+	{
+		return items[index];
+	}
+
+private:
+
+	SDL_mutex* mutex;
+
+	std::vector<T> items;
+};
+
+
+// Nodes of the stacks below, counted to check that reclamation frees
+// every one of them.
+struct Node
+{
+	Node* next;
+	Uint32 value;
+
+	static SDL_atomic_t nLive;
+
+	Node(Uint32 in_value) : next(0), value(in_value)
+	{
+		SDL_AtomicAdd(&nLive, 1);
+	}
+
+	~Node()
+	{
+		SDL_AtomicAdd(&nLive, -1);
+	}
+};
+
+SDL_atomic_t Node::nLive;
+
+
+// Treiber stack. Popped nodes are retired, so a thread still reading
+// 'top->next' never touches freed memory and a node cannot come back
+// to the top while it is read, which also rules out ABA.
+class EpochStack
+{
+public:
+
+	EpochStack() : top(0)
+	{
+	}
+
+	~EpochStack()
+	{
+		while (top != 0)
+		{
+			Node* node = (Node*)top;
+			top = node->next;
+			H2_DELETE(node);
+		}
+	}
+
+	void push(Uint32 value)
+	{
+		Node* node = H2_NEW(MEMORY_TAG_CORE) Node(value);
+
+		for (;;)
+		{
+			void* old = SDL_AtomicGetPtr(&top);
+			node->next = (Node*)old;
+			if (SDL_AtomicCASPtr(&top, old, (void*)node))
+			{
+				return;
+			}
+		}
+	}
+
+	bool pop(int participant, Uint32* outValue)
+	{
+		EpochGuard guard(reclaimer, participant);
+
+		for (;;)
+		{
+			Node* node = (Node*)SDL_AtomicGetPtr(&top);
+			if (node == 0)
+			{
+				return false;
+			}
+
+			if (SDL_AtomicCASPtr(&top, (void*)node, (void*)node->next))
+			{
+				*outValue = node->value;
+				reclaimer.retireObject(participant, node);
+				return true;
+			}
+		}
+	}
+
+	EpochReclaimer reclaimer;
+
+private:
+
+	void* top;
+};
+
+
+// Same stack behind a mutex, nodes deleted right away.
+class LockedStack
+{
+public:
+
+	LockedStack() : mutex(SDL_CreateMutex()), top(0)
+	{
+	}
+
+	~LockedStack()
+	{
+		while (top != 0)
+		{
+			Node* node = top;
+			top = node->next;
+			H2_DELETE(node);
+		}
+
+		SDL_DestroyMutex(mutex);
+	}
+
+	void push(Uint32 value)
+	{
+		Node* node = H2_NEW(MEMORY_TAG_CORE) Node(value);
+
+		SDL_LockMutex(mutex);
+		node->next = top;
+		top = node;
+		SDL_UnlockMutex(mutex);
+	}
+
+	bool pop(int, Uint32* outValue)
+	{
+		SDL_LockMutex(mutex);
+		Node* node = top;
+		if (node != 0)
+		{
+			top = node->next;
+		}
+		SDL_UnlockMutex(mutex);
+
+		if (node == 0)
+		{
+			return false;
+		}
+
+		*outValue = node->value;
+		H2_DELETE(node);
+		return true;
+	}
+
+private:
+
+	SDL_mutex* mutex;
+
+	Node* top;
+};
+
+
+// State shared by the threads of one run.
+template <class Container>
+struct Run
+{
+	Container* container;
+
+	SDL_atomic_t go;
+	SDL_atomic_t producersLeft;
+
+	unsigned int nItems;       // per producer
+	unsigned int nConsumers;
+};
+
+template <class Container>
+struct Worker
+{
+	Run<Container>* run;
+
+	unsigned int index;
+
+	Uint64 sum;                // values consumed
+	unsigned int nConsumed;
+
+	int participant;
+};
+
+
+static double toMs(Uint64 ticks)
+{
+	return (double)ticks*1000.0/(double)SDL_GetPerformanceFrequency();
+}
+
+// Sum of the values 1 to n.
+static inline Uint64 triangle(Uint64 n)
+{
+	return n*(n + 1)/2;
+}
+
+
+// Queues
+
+// Values 1 to nProducers*nItems, 0 tells a consumer to stop. The last
+// producer to finish sends one 0 per consumer, so an SPSC ring still has
+// a single producer.
+template <class Queue>
+static int SDLCALL queueProducer(void* data)
+{
+	Worker<Queue>* w = (Worker<Queue>*)data;
+	Run<Queue>* run = w->run;
+
+	waitFor(&run->go);
+
+	Uint32 first = w->index*run->nItems + 1;
+	unsigned int nFailed = 0;
+
+	for (Uint32 i = 0; i < run->nItems; i++)
+	{
+		while (!run->container->push(first + i))
+		{
+			backoff(nFailed);
+		}
+	}
+
+	if (SDL_AtomicAdd(&run->producersLeft, -1) == 1)
+	{
+		for (unsigned int i = 0; i < run->nConsumers; i++)
+		{
+			while (!run->container->push(0))
+			{
+				backoff(nFailed);
+			}
+		}
+	}
+
+	return 0;
+}
+
+template <class Queue>
+static int SDLCALL queueConsumer(void* data)
+{
+	Worker<Queue>* w = (Worker<Queue>*)data;
+	Run<Queue>* run = w->run;
+
+	waitFor(&run->go);
+
+	unsigned int nFailed = 0;
+
+	for (;;)
+	{
+		Uint32 value;
+		if (!run->container->pop(&value))
+		{
+			backoff(nFailed);
+			continue;
+		}
+
+		if (value == 0)
+		{
+			break;
+		}
+
+		w->sum += value;
+		w->nConsumed++;
+	}
+
+	return 0;
+}
+
+// Returns milliseconds, or a negative value if items were lost.
+template <class Queue>
+static double runQueue(Queue* queue, unsigned int nProducers, unsigned int nConsumers, unsigned int nItems)
+{
+	Run<Queue> run;
+	run.container = queue;
+	run.nItems = nItems;
+	run.nConsumers = nConsumers;
+	SDL_AtomicSet(&run.go, 0);
+	SDL_AtomicSet(&run.producersLeft, (int)nProducers);
+
+	Worker<Queue> workers[2*BENCH_MAX_THREADS];
+	SDL_Thread* threads[2*BENCH_MAX_THREADS];
+
+	unsigned int nThreads = nProducers + nConsumers;
+
+	for (unsigned int i = 0; i < nThreads; i++)
+	{
+		Worker<Queue>& w = workers[i];
+		w.run = &run;
+		w.index = i < nProducers ? i : i - nProducers;
+		w.sum = 0;
+		w.nConsumed = 0;
+
+		threads[i] = SDL_CreateThread(i < nProducers ? queueProducer<Queue> : queueConsumer<Queue>, "h2 bench", &w);
+	}
+
+	Uint64 begin = SDL_GetPerformanceCounter();
+	SDL_AtomicSet(&run.go, 1);
+
+	for (unsigned int i = 0; i < nThreads; i++)
+	{
+		SDL_WaitThread(threads[i], 0);
+	}
+
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	Uint64 sum = 0, nConsumed = 0;
+	for (unsigned int i = nProducers; i < nThreads; i++)
+	{
+		sum += workers[i].sum;
+		nConsumed += workers[i].nConsumed;
+	}
+
+	Uint64 nTotal = (Uint64)nProducers*nItems;
+	if (nConsumed != nTotal || sum != triangle(nTotal))
+	{
+		return -1.0;
+	}
+
+	return toMs(end - begin);
+}
+
+
+// Vectors
+
+template <class Vector>
+static int SDLCALL vectorPusher(void* data)
+{
+	Worker<Vector>* w = (Worker<Vector>*)data;
+	Run<Vector>* run = w->run;
+
+	waitFor(&run->go);
+
+	Uint32 first = w->index*run->nItems + 1;
+
+	for (Uint32 i = 0; i < run->nItems; i++)
+	{
+		run->container->push(first + i);
+	}
+
+	return 0;
+}
+
+template <class Vector>
+static double runVector(unsigned int nThreads, unsigned int nItems)
+{
+	Vector vector;
+
+	Run<Vector> run;
+	run.container = &vector;
+	run.nItems = nItems;
+	run.nConsumers = 0;
+	SDL_AtomicSet(&run.go, 0);
+
+	Worker<Vector> workers[BENCH_MAX_THREADS];
+	SDL_Thread* threads[BENCH_MAX_THREADS];
+
+	for (unsigned int i = 0; i < nThreads; i++)
+	{
+		workers[i].run = &run;
+		workers[i].index = i;
+
+		threads[i] = SDL_CreateThread(vectorPusher<Vector>, "h2 bench", &workers[i]);
+	}
+
+	Uint64 begin = SDL_GetPerformanceCounter();
+	SDL_AtomicSet(&run.go, 1);
+
+	for (unsigned int i = 0; i < nThreads; i++)
+	{
+		SDL_WaitThread(threads[i], 0);
+	}
+
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	Uint64 nTotal = (Uint64)nThreads*nItems;
+	if (vector.size() != nTotal)
+	{
+		return -1.0;
+	}
+
+	Uint64 sum = 0;
+	for (unsigned int i = 0; i < vector.size(); i++)
+	{
+		sum += vector[i];
+	}
+
+	if (sum != triangle(nTotal))
+	{
+		return -1.0;
+	}
+
+	return toMs(end - begin);
+}
+
+
+// Stacks
+
+// Pushes and pops one node at a time, so the stack stays short and
+// every pop contends with the other threads.
+template <class Stack>
+static int SDLCALL stackWorker(void* data)
+{
+	Worker<Stack>* w = (Worker<Stack>*)data;
+	Run<Stack>* run = w->run;
+
+	waitFor(&run->go);
+
+	Uint32 first = w->index*run->nItems + 1;
+
+	for (Uint32 i = 0; i < run->nItems; i++)
+	{
+		run->container->push(first + i);
+
+		Uint32 value;
+		if (run->container->pop(w->participant, &value))
+		{
+			w->sum += value;
+			w->nConsumed++;
+		}
+	}
+
+	return 0;
+}
+
+template <class Stack>
+static int joinStack(Stack&)
+{
+	return 0;
+}
+
+static int joinStack(EpochStack& stack)
+{
+	return stack.reclaimer.join();
+}
+
+// Returns milliseconds, or a negative value if values were lost or
+// nodes leaked.
+template <class Stack>
+static double runStack(unsigned int nThreads, unsigned int nItems)
+{
+	Uint64 begin, end;
+	Uint64 sum = 0, nPopped = 0;
+
+	{
+		Stack stack;
+
+		Run<Stack> run;
+		run.container = &stack;
+		run.nItems = nItems;
+		run.nConsumers = 0;
+		SDL_AtomicSet(&run.go, 0);
+
+		Worker<Stack> workers[BENCH_MAX_THREADS];
+		SDL_Thread* threads[BENCH_MAX_THREADS];
+
+		for (unsigned int i = 0; i < nThreads; i++)
+		{
+			Worker<Stack>& w = workers[i];
+			w.run = &run;
+			w.index = i;
+			w.sum = 0;
+			w.nConsumed = 0;
+			w.participant = joinStack(stack);
+
+			threads[i] = SDL_CreateThread(stackWorker<Stack>, "h2 bench", &w);
+		}
+
+		begin = SDL_GetPerformanceCounter();
+		SDL_AtomicSet(&run.go, 1);
+
+		for (unsigned int i = 0; i < nThreads; i++)
+		{
+			SDL_WaitThread(threads[i], 0);
+		}
+
+		end = SDL_GetPerformanceCounter();
+
+		// values still on the stack count as popped
+		for (unsigned int i = 0; i < nThreads; i++)
+		{
+			sum += workers[i].sum;
+			nPopped += workers[i].nConsumed;
+		}
+
+		Uint32 value;
+		while (stack.pop(workers[0].participant, &value))
+		{
+			sum += value;
+			nPopped++;
+		}
+	}
+
+	Uint64 nTotal = (Uint64)nThreads*nItems;
+	if (nPopped != nTotal || sum != triangle(nTotal) || SDL_AtomicGet(&Node::nLive) != 0)
+	{
+		return -1.0;
+	}
+
+	return toMs(end - begin);
+}
+
+
+// Reporting
+
+struct Result
+{
+	double lockFreeMs;
+	double lockedMs;
+};
+
+static void printHeader(const char* title)
+{
+	printf("\n%s\n", title);
+	printf("  %-10s %14s %14s %10s\n", "threads", "lock-free", "mutex", "speedup");
+}
+
+static bool printResult(const char* threads, double nOps, const Result& r)
+{
+	if (r.lockFreeMs < 0 || r.lockedMs < 0)
+	{
+		printf("  %-10s FAILED, items lost or leaked\n", threads);
+		return false;
+	}
+
+	printf("  %-10s %9.2f M/s %9.2f M/s %9.2f x\n", threads,
+		   1e-3*nOps/r.lockFreeMs, 1e-3*nOps/r.lockedMs, r.lockedMs/r.lockFreeMs);
+
+	return true;
+}
+
+// Keeps the best of 'nRuns', any failed run fails the case.
+static void keepBest(double ms, double* best, unsigned int run)
+{
+	if (*best < 0 && run > 0)
+	{
+		return;
+	}
+
+	if (ms < 0 || run == 0 || ms < *best)
+	{
+		*best = ms;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	unsigned int nItems = BENCH_DEFAULT_ITEMS;
+	unsigned int nRuns = BENCH_DEFAULT_RUNS;
+	unsigned int maxThreads = BENCH_DEFAULT_THREADS;
+
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		unsigned int value = (unsigned int)strtoul(argv[i + 1], 0, 10);
+
+		if (strcmp(argv[i], "-items") == 0)
+		{
+			nItems = value;
+		} else if (strcmp(argv[i], "-runs") == 0)
+		{
+			nRuns = value;
+		} else if (strcmp(argv[i], "-threads") == 0)
+		{
+			maxThreads = value;
+		} else
+		{
+			fprintf(stderr, "unknown option '%s'\n", argv[i]);
+			return 2;
+		}
+		i++;
+	}
+
+	if (nItems == 0 || nRuns == 0 || maxThreads == 0 || maxThreads > BENCH_MAX_THREADS)
+	{
+		fprintf(stderr, "-items and -runs must be positive, -threads in [1, %d]\n", BENCH_MAX_THREADS);
+		return 2;
+	}
+
+	SDL_AtomicSet(&Node::nLive, 0);
+
+	printf("%u items per thread, best of %u runs, %d cores\n", nItems, nRuns, SDL_GetCPUCount());
+
+	bool ok = true;
+	char threads[32];
+
+	MpmcQueue<Uint32, BENCH_QUEUE_CAPACITY>* mpmc = new MpmcQueue<Uint32, BENCH_QUEUE_CAPACITY>;
+	SpscRing<Uint32, BENCH_QUEUE_CAPACITY>* spsc = new SpscRing<Uint32, BENCH_QUEUE_CAPACITY>;
+	LockedQueue<Uint32> locked(BENCH_QUEUE_CAPACITY);
+
+	printHeader("SpscRing, producer + consumer");
+	{
+		Result r = {0, 0};
+		for (unsigned int run = 0; run < nRuns; run++)
+		{
+			keepBest(runQueue(spsc, 1, 1, nItems), &r.lockFreeMs, run);
+			keepBest(runQueue(&locked, 1, 1, nItems), &r.lockedMs, run);
+		}
+		ok = printResult("1 + 1", nItems, r) && ok;
+	}
+
+	printHeader("MpmcQueue, producers + consumers");
+	for (unsigned int n = 1; n <= maxThreads; n *= 2)
+	{
+		Result r = {0, 0};
+		for (unsigned int run = 0; run < nRuns; run++)
+		{
+			keepBest(runQueue(mpmc, n, n, nItems), &r.lockFreeMs, run);
+			keepBest(runQueue(&locked, n, n, nItems), &r.lockedMs, run);
+		}
+
+		sprintf(threads, "%u + %u", n, n);
+		ok = printResult(threads, (double)n*nItems, r) && ok;
+	}
+
+	delete mpmc;
+	delete spsc;
+
+	printHeader("ConcurrentVector, pushers");
+	for (unsigned int n = 1; n <= maxThreads; n *= 2)
+	{
+		Result r = {0, 0};
+		for (unsigned int run = 0; run < nRuns; run++)
+		{
+			keepBest(runVector<ConcurrentVector<Uint32> >(n, nItems), &r.lockFreeMs, run);
+			keepBest(runVector<LockedVector<Uint32> >(n, nItems), &r.lockedMs, run);
+		}
+
+		sprintf(threads, "%u", n);
+		ok = printResult(threads, (double)n*nItems, r) && ok;
+	}
+
+	printHeader("EpochReclaimer stack, push + pop per item");
+	for (unsigned int n = 1; n <= maxThreads; n *= 2)
+	{
+		Result r = {0, 0};
+		for (unsigned int run = 0; run < nRuns; run++)
+		{
+			keepBest(runStack<EpochStack>(n, nItems), &r.lockFreeMs, run);
+			keepBest(runStack<LockedStack>(n, nItems), &r.lockedMs, run);
+		}
+
+		sprintf(threads, "%u", n);
+		ok = printResult(threads, 2.0*n*nItems, r) && ok;
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+
+
+
+
+namespace h2
+{
+	// Minimal harness shared by the check programs under '<module>/test'.
+	// Each 'check()' prints one line; 'endChecks()' prints the total and
+	// returns the exit code for 'main()'.
+	inline unsigned int& checkFailures()
+	{
+		static unsigned int nFailed = 0;
+		return nFailed;
+	}
+
+	inline void check(bool condition, const char* what)
+	{
+		printf("%-50s %s\n", what, condition ? "ok" : "FAILED");
+		checkFailures() += condition ? 0 : 1;
+	}
+
+	inline int endChecks()
+	{
+		printf("%u failed\n", checkFailures());
+		return checkFailures() == 0 ? 0 : 1;
+	}
+}
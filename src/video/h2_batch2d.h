@@ -0,0 +1,454 @@
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "SDL_render.h"
+
+#include "../core/h2_memory.h"
+#include "../core/h2_profiler.h"
+#include "../math/h2_math.h"
+#include "h2_render_queue.h"
+
+
+
+#define H2_BATCH2D_MAX_COORD 16777216.0f   // default clip, beyond it float to int loses pixels
+
+
+
+
+namespace h2
+{
+	// Immediate-mode 2D batcher. Primitives are appended to one vertex
+	// array and one rect array per frame; consecutive primitives with the
+	// same color and type form a run, and 'flush()' issues a single bulk
+	// SDL call per run. Storage keeps its capacity between frames.
+	//
+	// Lines and polylines are clipped to the clip rect before they are
+	// stored; set it to the viewport so segments far off screen (e.g.
+	// projected from behind the camera) cost nothing.
+	class Batch2D
+	{
+	public:
+
+		// Constructors
+
+		Batch2D() : color(packRenderColor(255, 255, 255, 255)), nDrawCalls(0)
+		{
+			clearClipRect();
+		}
+
+
+		// Methods
+
+		inline void setClipRect(float x, float y, float w, float h)
+		{
+			clipMinX = x;
+			clipMinY = y;
+			clipMaxX = x + w;
+			clipMaxY = y + h;
+		}
+
+		inline void clearClipRect()
+		{
+			setClipRect(-H2_BATCH2D_MAX_COORD, -H2_BATCH2D_MAX_COORD, 2.0f*H2_BATCH2D_MAX_COORD, 2.0f*H2_BATCH2D_MAX_COORD);
+		}
+
+		inline void setColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a = 255)
+		{
+			color = packRenderColor(r, g, b, a);
+		}
+
+		inline unsigned int vertexCount() const
+		{
+			return (unsigned int)vertices.size();
+		}
+
+		// Number of SDL draw calls issued by the last 'flush()'.
+		inline int lastDrawCalls() const
+		{
+			return nDrawCalls;
+		}
+
+		void drawPoint(float x, float y)
+		{
+			Run& run = openRun(RENDER_POINTS, (Uint32)vertices.size());
+			pushVertex(x, y);
+			run.count++;
+		}
+
+		void drawLine(float x0, float y0, float x1, float y1)
+		{
+			if (!clipLine(x0, y0, x1, y1))
+			{
+				return;
+			}
+
+			SDL_Point p0 = {(int)x0, (int)y0};
+
+			if (!continuesStrip(p0))
+			{
+				Run& run = openRun(RENDER_LINE_STRIP, (Uint32)vertices.size(), true);
+				vertices.push_back(p0);
+				run.count++;
+			}
+
+			pushVertex(x1, y1);
+			runs.back().count++;
+		}
+
+		inline void drawLine(const Vector2f& p0, const Vector2f& p1)
+		{
+			drawLine(p0.x, p0.y, p1.x, p1.y);
+		}
+
+		void drawPolyline(const Vector2f* points, unsigned int nPoints)
+		{
+			if (nPoints < 2)
+			{
+				return;
+			}
+
+			for (unsigned int i = 0; i < nPoints; i++)
+			{
+				if (!isInsideClip(points[i]))
+				{
+					// clipped pieces chain up again where the polyline comes back
+					for (unsigned int k = 1; k < nPoints; k++)
+					{
+						drawLine(points[k - 1], points[k]);
+					}
+					return;
+				}
+			}
+
+			SDL_Point p0 = {(int)points[0].x, (int)points[0].y};
+
+			if (!continuesStrip(p0))
+			{
+				Run& run = openRun(RENDER_LINE_STRIP, (Uint32)vertices.size(), true);
+				vertices.push_back(p0);
+				run.count++;
+			}
+
+			for (unsigned int i = 1; i < nPoints; i++)
+			{
+				pushVertex(points[i].x, points[i].y);
+			}
+			runs.back().count += nPoints - 1;
+		}
+
+		void drawRect(float x, float y, float w, float h)
+		{
+			Run& run = openRun(RENDER_RECTS, (Uint32)rects.size());
+			pushRect(x, y, w, h);
+			run.count++;
+		}
+
+		void fillRect(float x, float y, float w, float h)
+		{
+			Run& run = openRun(RENDER_FILLED_RECTS, (Uint32)rects.size());
+			pushRect(x, y, w, h);
+			run.count++;
+		}
+
+		// Square marker of size 'size' centered at 'p'.
+		inline void drawMarker(const Vector2f& p, float size)
+		{
+			drawRect(p.x - 0.5f*size, p.y - 0.5f*size, size, size);
+		}
+
+		// Quadratic bezier tessellated into 'nSegments' lines using forward differencing.
+		void drawQuadraticBezier(const Vector2f& p0, const Vector2f& p1, const Vector2f& p2, unsigned int nSegments)
+		{
+			if (nSegments == 0)
+			{
+				return;
+			}
+
+			// B(t) = A*t^2 + B*t + p0
+			float h = 1.0f/nSegments;
+
+			Vector2f A = p0 - 2.0f*p1 + p2;
+			Vector2f B = 2.0f*(p1 - p0);
+
+			Vector2f point = p0;
+			Vector2f d1 = A*(h*h) + B*h;
+			Vector2f d2 = A*(2.0f*h*h);
+
+			beginStrip(point);
+
+			for (unsigned int i = 1; i < nSegments; i++)
+			{
+				point += d1;
+				d1 += d2;
+				pushVertex(point.x, point.y);
+			}
+
+			// end exactly on 'p2' regardless of accumulated error
+			pushVertex(p2.x, p2.y);
+			runs.back().count += nSegments;
+		}
+
+		// Cubic bezier tessellated into 'nSegments' lines using forward differencing.
+		void drawCubicBezier(const Vector2f& p0, const Vector2f& p1, const Vector2f& p2, const Vector2f& p3, unsigned int nSegments)
+		{
+			if (nSegments == 0)
+			{
+				return;
+			}
+
+			// B(t) = A*t^3 + B*t^2 + C*t + p0
+			float h = 1.0f/nSegments;
+			float hh = h*h;
+			float hhh = hh*h;
+
+			Vector2f A = 3.0f*(p1 - p2) + p3 - p0;
+			Vector2f B = 3.0f*(p0 - 2.0f*p1 + p2);
+			Vector2f C = 3.0f*(p1 - p0);
+
+			Vector2f point = p0;
+			Vector2f d1 = A*hhh + B*hh + C*h;
+			Vector2f d2 = A*(6.0f*hhh) + B*(2.0f*hh);
+			Vector2f d3 = A*(6.0f*hhh);
+
+			beginStrip(point);
+
+			for (unsigned int i = 1; i < nSegments; i++)
+			{
+				point += d1;
+				d1 += d2;
+				d2 += d3;
+				pushVertex(point.x, point.y);
+			}
+
+			pushVertex(p3.x, p3.y);
+			runs.back().count += nSegments;
+		}
+
+		// Submits all accumulated primitives and clears the batch.
+		// Returns number of SDL draw calls issued.
+		int flush(SDL_Renderer* renderer)
+		{
+			H2_PROFILE_SCOPE("batch2d flush");
+
+			nDrawCalls = 0;
+
+			for (unsigned int i = 0; i < runs.size(); i++)
+			{
+				const Run& run = runs[i];
+
+				if (i == 0 || run.color != runs[i - 1].color)
+				{
+					SDL_SetRenderDrawColor(renderer, (Uint8)(run.color >> 24), (Uint8)(run.color >> 16),
+											(Uint8)(run.color >> 8), (Uint8)run.color);
+				}
+
+				switch (run.primitive)
+				{
+				case RENDER_POINTS:
+					SDL_RenderDrawPoints(renderer, &vertices[run.first], (int)run.count);
+					break;
+
+				case RENDER_LINE_STRIP:
+					SDL_RenderDrawLines(renderer, &vertices[run.first], (int)run.count);
+					break;
+
+				case RENDER_RECTS:
+					SDL_RenderDrawRects(renderer, &rects[run.first], (int)run.count);
+					break;
+
+				case RENDER_FILLED_RECTS:
+					SDL_RenderFillRects(renderer, &rects[run.first], (int)run.count);
+					break;
+				}
+
+				nDrawCalls++;
+			}
+
+			clear();
+
+			return nDrawCalls;
+		}
+
+		void clear()
+		{
+			runs.clear();
+			vertices.clear();
+			rects.clear();
+		}
+
+	private:
+
+		struct Run
+		{
+			Uint32 color;
+			Uint32 primitive;
+			Uint32 first;
+			Uint32 count;
+		};
+
+		Uint32 color;
+
+		float clipMinX, clipMinY, clipMaxX, clipMaxY;
+
+		int nDrawCalls;
+
+		TaggedVector<Run, MEMORY_TAG_VIDEO>::Type runs;
+
+		TaggedVector<SDL_Point, MEMORY_TAG_VIDEO>::Type vertices;
+
+		TaggedVector<SDL_Rect, MEMORY_TAG_VIDEO>::Type rects;
+
+
+		inline void pushVertex(float x, float y)
+		{
+			SDL_Point p = {(int)x, (int)y};
+			vertices.push_back(p);
+		}
+
+		inline void pushRect(float x, float y, float w, float h)
+		{
+			SDL_Rect r = {(int)x, (int)y, (int)w, (int)h};
+			rects.push_back(r);
+		}
+
+		inline bool isInsideClip(const Vector2f& p) const
+		{
+			return p.x >= clipMinX && p.x <= clipMaxX && p.y >= clipMinY && p.y <= clipMaxY;
+		}
+
+		// Liang-Barsky in double. False when nothing of the segment is
+		// inside the clip rect, or when it is not finite. A clipped end is
+		// put exactly on the edge that clipped it, only the other
+		// coordinate is interpolated.
+		bool clipLine(float& x0, float& y0, float& x1, float& y1) const
+		{
+			if (!(fabs(x0) <= FLT_MAX && fabs(y0) <= FLT_MAX && fabs(x1) <= FLT_MAX && fabs(y1) <= FLT_MAX))
+			{
+				return false;
+			}
+
+			double dx = (double)x1 - x0;
+			double dy = (double)y1 - y0;
+
+			double p[4] = {-dx, dx, -dy, dy};
+			double q[4] = {(double)x0 - clipMinX, (double)clipMaxX - x0, (double)y0 - clipMinY, (double)clipMaxY - y0};
+			float edge[4] = {clipMinX, clipMaxX, clipMinY, clipMaxY};
+
+			double t0 = 0.0;
+			double t1 = 1.0;
+			int edge0 = -1;
+			int edge1 = -1;
+
+			for (int i = 0; i < 4; i++)
+			{
+				if (p[i] == 0.0)
+				{
+					if (q[i] < 0.0)
+					{
+						return false;
+					}
+					continue;
+				}
+
+				double t = q[i]/p[i];
+
+				if (p[i] < 0.0)
+				{
+					if (t > t1)
+					{
+						return false;
+					}
+					if (t > t0)
+					{
+						t0 = t;
+						edge0 = i;
+					}
+				} else
+				{
+					if (t < t0)
+					{
+						return false;
+					}
+					if (t < t1)
+					{
+						t1 = t;
+						edge1 = i;
+					}
+				}
+			}
+
+			float cx0 = (float)(x0 + t0*dx), cy0 = (float)(y0 + t0*dy);
+			float cx1 = (float)(x0 + t1*dx), cy1 = (float)(y0 + t1*dy);
+
+			if (edge0 >= 0)
+			{
+				(edge0 < 2 ? cx0 : cy0) = edge[edge0];
+			}
+			if (edge1 >= 0)
+			{
+				(edge1 < 2 ? cx1 : cy1) = edge[edge1];
+			}
+
+			x0 = cx0;
+			y0 = cy0;
+			x1 = cx1;
+			y1 = cy1;
+
+			return true;
+		}
+
+		// Returns true if last run is a strip of current color ending at 'p'.
+		bool continuesStrip(const SDL_Point& p) const
+		{
+			if (runs.empty())
+			{
+				return false;
+			}
+
+			const Run& last = runs.back();
+
+			return last.primitive == RENDER_LINE_STRIP &&
+				   last.color == color &&
+				   vertices.back().x == p.x &&
+				   vertices.back().y == p.y;
+		}
+
+		void beginStrip(const Vector2f& point)
+		{
+			SDL_Point p = {(int)point.x, (int)point.y};
+
+			if (!continuesStrip(p))
+			{
+				Run& run = openRun(RENDER_LINE_STRIP, (Uint32)vertices.size(), true);
+				vertices.push_back(p);
+				run.count++;
+			}
+		}
+
+		// Returns last run if it can be extended, otherwise starts new one.
+		// Strips are never extended here, disconnected strips need own run.
+		Run& openRun(Uint32 primitive, Uint32 first, bool forceNew = false)
+		{
+			if (!forceNew && !runs.empty())
+			{
+				Run& last = runs.back();
+				if (last.color == color && last.primitive == primitive)
+				{
+					return last;
+				}
+			}
+
+			Run run;
+			run.color = color;
+			run.primitive = primitive;
+			run.first = first;
+			run.count = 0;
+			runs.push_back(run);
+
+			return runs.back();
+		}
+	};
+}
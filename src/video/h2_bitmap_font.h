@@ -0,0 +1,179 @@
+#pragma once
+
+#include "h2_glyph_cache.h"
+
+
+
+#define H2_BITMAP_FONT_WIDTH 5    // glyph cell, pixels at scale 1
+#define H2_BITMAP_FONT_HEIGHT 9   // 7 above baseline, 2 for descenders
+
+
+
+
+namespace h2
+{
+	// 5x9 pixel glyphs for printable ASCII, one byte per row, bit 4 is
+	// the leftmost pixel.
+	static const Uint8 h2BitmapFontData[95][H2_BITMAP_FONT_HEIGHT] =
+	{
+		{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // space
+		{0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00},   // '!'
+		{0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // '"'
+		{0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A, 0x00, 0x00},   // '#'
+		{0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04, 0x00, 0x00},   // '$'
+		{0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03, 0x00, 0x00},   // '%'
+		{0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D, 0x00, 0x00},   // '&'
+		{0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // '''
+		{0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02, 0x00, 0x00},   // '('
+		{0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08, 0x00, 0x00},   // ')'
+		{0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00, 0x00, 0x00},   // '*'
+		{0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00, 0x00, 0x00},   // '+'
+		{0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08, 0x00},   // ','
+		{0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00},   // '-'
+		{0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00, 0x00},   // '.'
+		{0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00, 0x00, 0x00},   // '/'
+		{0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E, 0x00, 0x00},   // '0'
+		{0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00, 0x00},   // '1'
+		{0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F, 0x00, 0x00},   // '2'
+		{0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E, 0x00, 0x00},   // '3'
+		{0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02, 0x00, 0x00},   // '4'
+		{0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E, 0x00, 0x00},   // '5'
+		{0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E, 0x00, 0x00},   // '6'
+		{0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08, 0x00, 0x00},   // '7'
+		{0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E, 0x00, 0x00},   // '8'
+		{0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C, 0x00, 0x00},   // '9'
+		{0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x00},   // ':'
+		{0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08, 0x00, 0x00},   // ';'
+		{0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02, 0x00, 0x00},   // '<'
+		{0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00, 0x00, 0x00},   // '='
+		{0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08, 0x00, 0x00},   // '>'
+		{0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04, 0x00, 0x00},   // '?'
+		{0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E, 0x00, 0x00},   // '@'
+		{0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11, 0x00, 0x00},   // 'A'
+		{0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E, 0x00, 0x00},   // 'B'
+		{0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E, 0x00, 0x00},   // 'C'
+		{0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C, 0x00, 0x00},   // 'D'
+		{0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F, 0x00, 0x00},   // 'E'
+		{0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10, 0x00, 0x00},   // 'F'
+		{0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F, 0x00, 0x00},   // 'G'
+		{0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11, 0x00, 0x00},   // 'H'
+		{0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00, 0x00},   // 'I'
+		{0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C, 0x00, 0x00},   // 'J'
+		{0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11, 0x00, 0x00},   // 'K'
+		{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F, 0x00, 0x00},   // 'L'
+		{0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11, 0x00, 0x00},   // 'M'
+		{0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11, 0x00, 0x00},   // 'N'
+		{0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00, 0x00},   // 'O'
+		{0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10, 0x00, 0x00},   // 'P'
+		{0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D, 0x00, 0x00},   // 'Q'
+		{0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11, 0x00, 0x00},   // 'R'
+		{0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E, 0x00, 0x00},   // 'S'
+		{0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x00},   // 'T'
+		{0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00, 0x00},   // 'U'
+		{0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x00, 0x00},   // 'V'
+		{0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A, 0x00, 0x00},   // 'W'
+		{0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11, 0x00, 0x00},   // 'X'
+		{0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x00, 0x00},   // 'Y'
+		{0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F, 0x00, 0x00},   // 'Z'
+		{0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E, 0x00, 0x00},   // '['
+		{0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00, 0x00, 0x00},   // backslash
+		{0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E, 0x00, 0x00},   // ']'
+		{0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // '^'
+		{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00},   // '_'
+		{0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // '`'
+		{0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00, 0x00},   // 'a'
+		{0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E, 0x00, 0x00},   // 'b'
+		{0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E, 0x00, 0x00},   // 'c'
+		{0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F, 0x00, 0x00},   // 'd'
+		{0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00, 0x00},   // 'e'
+		{0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08, 0x00, 0x00},   // 'f'
+		{0x00, 0x00, 0x0F, 0x11, 0x11, 0x11, 0x0F, 0x01, 0x0E},   // 'g'
+		{0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00, 0x00},   // 'h'
+		{0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E, 0x00, 0x00},   // 'i'
+		{0x02, 0x00, 0x06, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C},   // 'j'
+		{0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12, 0x00, 0x00},   // 'k'
+		{0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00, 0x00},   // 'l'
+		{0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11, 0x00, 0x00},   // 'm'
+		{0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00, 0x00},   // 'n'
+		{0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00, 0x00},   // 'o'
+		{0x00, 0x00, 0x1E, 0x11, 0x11, 0x11, 0x1E, 0x10, 0x10},   // 'p'
+		{0x00, 0x00, 0x0F, 0x11, 0x11, 0x11, 0x0F, 0x01, 0x01},   // 'q'
+		{0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10, 0x00, 0x00},   // 'r'
+		{0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E, 0x00, 0x00},   // 's'
+		{0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06, 0x00, 0x00},   // 't'
+		{0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00, 0x00},   // 'u'
+		{0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x00, 0x00},   // 'v'
+		{0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A, 0x00, 0x00},   // 'w'
+		{0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x00, 0x00},   // 'x'
+		{0x00, 0x00, 0x11, 0x11, 0x11, 0x11, 0x0F, 0x01, 0x0E},   // 'y'
+		{0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F, 0x00, 0x00},   // 'z'
+		{0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02, 0x00, 0x00},   // '{'
+		{0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x00},   // '|'
+		{0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08, 0x00, 0x00},   // '}'
+		{0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00, 0x00, 0x00},   // '~'
+	};
+
+
+	// Built-in font for debug text, needs no font files. Sizes are whole
+	// multiples of the 9 pixel cell; glyphs are scaled with pixel
+	// replication, characters outside ASCII are drawn as '?'.
+	class BitmapFontRasterizer : public GlyphRasterizer
+	{
+	public:
+
+		// Methods
+
+		static inline int getScale(int size)
+		{
+			return size >= 2*H2_BITMAP_FONT_HEIGHT ? size/H2_BITMAP_FONT_HEIGHT : 1;
+		}
+
+		virtual bool getMetrics(Uint32 codepoint, int size, GlyphMetrics* out)
+		{
+			int scale = getScale(size);
+			bool blank = (codepoint == ' ');
+
+			out->width = blank ? 0 : H2_BITMAP_FONT_WIDTH*scale;
+			out->height = blank ? 0 : H2_BITMAP_FONT_HEIGHT*scale;
+			out->offsetX = 0;
+			out->offsetY = -7*scale;
+			out->advance = (H2_BITMAP_FONT_WIDTH + 1)*scale;
+
+			return true;
+		}
+
+		virtual void rasterize(Uint32 codepoint, int size, Uint8* coverage, int pitch)
+		{
+			int scale = getScale(size);
+			const Uint8* rows = h2BitmapFontData[glyphIndex(codepoint)];
+
+			for (int y = 0; y < H2_BITMAP_FONT_HEIGHT*scale; y++)
+			{
+				Uint8 bits = rows[y/scale];
+				Uint8* out = coverage + y*pitch;
+
+				for (int x = 0; x < H2_BITMAP_FONT_WIDTH*scale; x++)
+				{
+					out[x] = (bits & (0x10 >> (x/scale))) ? 0xFF : 0x00;
+				}
+			}
+		}
+
+		virtual int getAscent(int size)
+		{
+			return 7*getScale(size);
+		}
+
+		virtual int getLineHeight(int size)
+		{
+			return (H2_BITMAP_FONT_HEIGHT + 2)*getScale(size);
+		}
+
+	private:
+
+		static inline int glyphIndex(Uint32 codepoint)
+		{
+			return (codepoint >= 32 && codepoint < 127) ? (int)codepoint - 32 : '?' - 32;
+		}
+	};
+}
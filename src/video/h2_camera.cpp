@@ -0,0 +1,112 @@
+#include "h2_camera.h"
+
+
+
+
+namespace h2
+{
+	Camera::Camera() : position(0, 0, 0),
+					   forward(0, 0, -1.0f), up(0, 1.0f, 0), right(1.0f, 0, 0),
+					   fovY(H2_PI/3.0f), aspect(4.0f/3.0f), zNear(0.1f), zFar(1000.0f),
+					   viewportWidth(640), viewportHeight(480)
+	{
+		updateProjection();
+		updateRotation();
+	}
+
+
+	void Camera::setPerspective(float in_fovY, float in_aspect, float in_zNear, float in_zFar)
+	{
+		fovY = in_fovY;
+		aspect = in_aspect;
+		zNear = in_zNear;
+		zFar = in_zFar;
+
+		updateProjection();
+	}
+
+
+	void Camera::setViewport(int width, int height)
+	{
+		viewportWidth = width;
+		viewportHeight = height;
+
+		if (height > 0)
+		{
+			aspect = (float)width/(float)height;
+		}
+
+		updateProjection();
+	}
+
+
+	void Camera::setPosition(const Vector3d& in_position)
+	{
+		position = in_position;
+	}
+
+
+	void Camera::move(const Vector3d& offset)
+	{
+		position += offset;
+	}
+
+
+	void Camera::lookAt(const Vector3d& target, const Vector3f& in_up)
+	{
+		// direction is computed in double and converted after subtraction
+		forward = toRelative(target).normalize();
+		right = cross(forward, in_up).normalize();
+		up = cross(right, forward);
+
+		updateRotation();
+	}
+
+
+	Matrix4x4f Camera::getViewMatrix() const
+	{
+		Vector3f pos((float)position.x, (float)position.y, (float)position.z);
+
+		Matrix4x4f view = rotation;
+		view.setTranslation(-rotation.transformVector(pos));
+
+		return view;
+	}
+
+
+	Matrix4x4f Camera::toRelative(const Matrix4x4d& world) const
+	{
+		Matrix4x4d rel = world;
+		rel.setTranslation(world.getTranslation() - position);
+
+		return Matrix4x4f(rel);
+	}
+
+
+	void Camera::updateProjection()
+	{
+		float f = 1.0f/tan(0.5f*fovY);
+
+		projection.setZero();
+		projection._m00 = f/aspect;
+		projection._m11 = f;
+		projection._m22 = (zFar + zNear)/(zNear - zFar);
+		projection._m23 = 2.0f*zFar*zNear/(zNear - zFar);
+		projection._m32 = -1.0f;
+
+		projectionScale = 0.5f*viewportHeight*f;
+
+		relViewProjection = projection*rotation;
+	}
+
+
+	void Camera::updateRotation()
+	{
+		rotation.setIdentity();
+		rotation.setRow(0, right, 0);
+		rotation.setRow(1, up, 0);
+		rotation.setRow(2, -forward, 0);
+
+		relViewProjection = projection*rotation;
+	}
+}
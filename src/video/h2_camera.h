@@ -0,0 +1,106 @@
+#pragma once
+
+#include "../math/h2_math.h"
+
+
+
+
+namespace h2
+{
+	// Perspective camera for large worlds.
+	//
+	// Camera position is kept in double precision. Rendering is done
+	// camera-relative: world positions are rebased against camera position
+	// in double and only the small difference is converted to float, so
+	// the float view matrix never contains a large translation and
+	// vertices far from the world origin do not jitter.
+	class Camera
+	{
+	public:
+
+		// Constructors
+
+		Camera();
+
+
+		// Methods
+
+		void setPerspective(float fovY, float aspect, float zNear, float zFar);
+
+		void setViewport(int width, int height);
+
+		void setPosition(const Vector3d& position);
+
+		void move(const Vector3d& offset);
+
+		// Orients camera towards 'target', 'up' must not be parallel to view direction.
+		void lookAt(const Vector3d& target, const Vector3f& up);
+
+		inline const Vector3d& getPosition() const { return position; }
+
+		inline const Vector3f& getForward() const { return forward; }
+
+		inline const Vector3f& getUp() const { return up; }
+
+		inline const Vector3f& getRight() const { return right; }
+
+		inline float getFovY() const { return fovY; }
+
+		inline float getAspect() const { return aspect; }
+
+		inline float getNear() const { return zNear; }
+
+		inline float getFar() const { return zFar; }
+
+		inline int getViewportWidth() const { return viewportWidth; }
+
+		inline int getViewportHeight() const { return viewportHeight; }
+
+		// Pixels per world unit at distance 1 along view direction:
+		// projected size = worldSize*getProjectionScale()/distance.
+		inline float getProjectionScale() const { return projectionScale; }
+
+		const Matrix4x4f& getProjectionMatrix() const { return projection; }
+
+		// View matrix without translation, used by camera-relative path.
+		const Matrix4x4f& getRotationMatrix() const { return rotation; }
+
+		// projection*rotation, multiply by camera-relative positions.
+		const Matrix4x4f& getRelativeViewProjection() const { return relViewProjection; }
+
+		// Full view matrix with translation in float. Loses precision
+		// far from the origin, use camera-relative path for large worlds.
+		Matrix4x4f getViewMatrix() const;
+
+		// World position relative to camera, subtraction is done in double.
+		inline Vector3f toRelative(const Vector3d& world) const
+		{
+			return Vector3f((float)(world.x - position.x),
+							(float)(world.y - position.y),
+							(float)(world.z - position.z));
+		}
+
+		// Model matrix with translation rebased to camera position,
+		// ready for float rendering path.
+		Matrix4x4f toRelative(const Matrix4x4d& world) const;
+
+	private:
+
+		Vector3d position;
+
+		Vector3f forward, up, right;
+
+		float fovY, aspect, zNear, zFar;
+
+		int viewportWidth, viewportHeight;
+
+		float projectionScale;
+
+		Matrix4x4f projection, rotation, relViewProjection;
+
+
+		void updateProjection();
+
+		void updateRotation();
+	};
+}
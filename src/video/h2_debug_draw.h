@@ -0,0 +1,590 @@
+#pragma once
+
+#include <cmath>
+#include <cstdarg>
+
+#include "SDL_render.h"
+#include "SDL_stdinc.h"
+
+#include "../core/h2_allocator.h"
+#include "../core/h2_profiler.h"
+#include "../math/h2_math.h"
+#include "h2_batch2d.h"
+#include "h2_camera.h"
+#include "h2_text.h"
+
+
+
+#define H2_DEBUG_DRAW_ARENA_SIZE (1 << 20)   // bytes of commands per frame
+#define H2_DEBUG_DRAW_TEXT_MAX 512           // longest formatted string
+#define H2_DEBUG_PANEL_PADDING 4
+
+
+
+
+namespace h2
+{
+	// Immediate-mode debug drawing: lines, boxes, text, graphs and text
+	// panels in screen space, plus lines and boxes in world space through
+	// a camera. Calls are recorded into a per-frame arena and drawn by
+	// 'render()', so instrumented code never allocates once the batch
+	// and glyph caches are warm, and disabled drawing costs one branch.
+	//
+	// Geometry is drawn in call order, text after all geometry.
+	class DebugDraw
+	{
+	public:
+
+		// Constructors
+
+		DebugDraw(unsigned int arenaSize = H2_DEBUG_DRAW_ARENA_SIZE) :
+			arena(arenaSize, "debug draw", MEMORY_TAG_VIDEO), first(0), last(0), panel(0), panelWidth(0), camera(0), textCache(0), enabled(true),
+			nCommands(0), nDrawCalls(0)
+		{
+			panelCursor.x = panelCursor.y = 0;
+		}
+
+
+		// Methods
+
+		inline void setEnabled(bool in_enabled) { enabled = in_enabled; }
+
+		inline bool isEnabled() const { return enabled; }
+
+		inline void setTextCache(TextCache* cache) { textCache = cache; }
+
+		// Camera for world space calls of the frame.
+		inline void setCamera(const Camera* in_camera) { camera = in_camera; }
+
+		inline const LinearAllocator& getArena() const { return arena; }
+
+		inline unsigned int getCommandCount() const { return nCommands; }
+
+		inline int lastDrawCalls() const { return nDrawCalls; }
+
+		// Drops everything recorded for the previous frame.
+		void newFrame()
+		{
+			arena.reset();
+			first = last = 0;
+			panel = 0;
+			nCommands = 0;
+		}
+
+		void line(float x0, float y0, float x1, float y1, Uint32 color)
+		{
+			Command* c = push(COMMAND_LINE, color);
+			if (c != 0)
+			{
+				c->x = x0;
+				c->y = y0;
+				c->w = x1;
+				c->h = y1;
+			}
+		}
+
+		void rect(float x, float y, float w, float h, Uint32 color)
+		{
+			Command* c = push(COMMAND_RECT, color);
+			if (c != 0)
+			{
+				c->x = x;
+				c->y = y;
+				c->w = w;
+				c->h = h;
+			}
+		}
+
+		void fillRect(float x, float y, float w, float h, Uint32 color)
+		{
+			Command* c = push(COMMAND_FILL_RECT, color);
+			if (c != 0)
+			{
+				c->x = x;
+				c->y = y;
+				c->w = w;
+				c->h = h;
+			}
+		}
+
+		// printf-style text, top-left at 'x', 'y'.
+		void text(float x, float y, Uint32 color, const char* format, ...)
+		{
+			if (!enabled)
+			{
+				return;
+			}
+
+			va_list args;
+			va_start(args, format);
+			pushText(x, y, color, format, args);
+			va_end(args);
+		}
+
+		// Values over index, 'minVal' at the bottom of 'area', 'maxVal' at the top.
+		void graph(const float* values, unsigned int n, const SDL_Rect& area, float minVal, float maxVal, Uint32 color)
+		{
+			Vector2f* points = pushPolyline(n, color);
+			if (points == 0)
+			{
+				return;
+			}
+
+			float sx = n > 1 ? (float)area.w/(n - 1) : 0.0f;
+			float sy = (maxVal != minVal) ? (float)area.h/(maxVal - minVal) : 0.0f;
+
+			for (unsigned int i = 0; i < n; i++)
+			{
+				float v = values[i] < minVal ? minVal : (values[i] > maxVal ? maxVal : values[i]);
+				points[i].x = area.x + i*sx;
+				points[i].y = area.y + area.h - (v - minVal)*sy;
+			}
+		}
+
+		// Polyline through 'points', scaled to fit 'area'.
+		void graph(const Vector2f* values, unsigned int n, const SDL_Rect& area, Uint32 color)
+		{
+			Vector2f* points = pushPolyline(n, color);
+			if (points == 0)
+			{
+				return;
+			}
+
+			Vector2f lo = values[0], hi = values[0];
+			for (unsigned int i = 1; i < n; i++)
+			{
+				lo.x = values[i].x < lo.x ? values[i].x : lo.x;
+				lo.y = values[i].y < lo.y ? values[i].y : lo.y;
+				hi.x = values[i].x > hi.x ? values[i].x : hi.x;
+				hi.y = values[i].y > hi.y ? values[i].y : hi.y;
+			}
+
+			float sx = (hi.x > lo.x) ? area.w/(hi.x - lo.x) : 0.0f;
+			float sy = (hi.y > lo.y) ? area.h/(hi.y - lo.y) : 0.0f;
+
+			for (unsigned int i = 0; i < n; i++)
+			{
+				points[i].x = area.x + (values[i].x - lo.x)*sx;
+				points[i].y = area.y + area.h - (values[i].y - lo.y)*sy;
+			}
+		}
+
+		// Components over index, x red, y green, z blue, shared scale.
+		void graph(const Vector3f* values, unsigned int n, const SDL_Rect& area, float minVal, float maxVal)
+		{
+			static const Uint32 colors[3] = {0xFF4040FF, 0x40FF40FF, 0x4080FFFF};
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				Vector2f* points = pushPolyline(n, colors[k]);
+				if (points == 0)
+				{
+					return;
+				}
+
+				float sx = n > 1 ? (float)area.w/(n - 1) : 0.0f;
+				float sy = (maxVal != minVal) ? (float)area.h/(maxVal - minVal) : 0.0f;
+
+				for (unsigned int i = 0; i < n; i++)
+				{
+					float v = (k == 0) ? values[i].x : ((k == 1) ? values[i].y : values[i].z);
+					v = v < minVal ? minVal : (v > maxVal ? maxVal : v);
+					points[i].x = area.x + i*sx;
+					points[i].y = area.y + area.h - (v - minVal)*sy;
+				}
+			}
+		}
+
+		// World space line, clipped at the camera near plane.
+		void line3D(const Vector3d& a, const Vector3d& b, Uint32 color)
+		{
+			if (!enabled || camera == 0)
+			{
+				return;
+			}
+
+			Vector3f p0 = camera->toRelative(a);
+			Vector3f p1 = camera->toRelative(b);
+
+			float zNear = camera->getNear();
+			float d0 = p0.dot(camera->getForward());
+			float d1 = p1.dot(camera->getForward());
+
+			if (d0 < zNear && d1 < zNear)
+			{
+				return;
+			}
+
+			if (d0 < zNear)
+			{
+				p0 = p0 + (p1 - p0)*((zNear - d0)/(d1 - d0));
+				d0 = zNear;
+			} else if (d1 < zNear)
+			{
+				p1 = p0 + (p1 - p0)*((zNear - d0)/(d1 - d0));
+				d1 = zNear;
+			}
+
+			Vector2f s0 = project(p0, d0);
+			Vector2f s1 = project(p1, d1);
+
+			line(s0.x, s0.y, s1.x, s1.y, color);
+		}
+
+		// Axis aligned box, e.g. a broadphase bound.
+		void box3D(const Vector3d& lo, const Vector3d& hi, Uint32 color)
+		{
+			Vector3d c[8];
+			for (int i = 0; i < 8; i++)
+			{
+				c[i] = Vector3d((i & 1) ? hi.x : lo.x, (i & 2) ? hi.y : lo.y, (i & 4) ? hi.z : lo.z);
+			}
+
+			drawBoxEdges(c, color);
+		}
+
+		// Frustum of 'view', with the far plane pulled in to 'maxDistance'
+		// so distant far planes stay readable.
+		void frustum(const Camera& view, float maxDistance, Uint32 color)
+		{
+			float tanY = tan(0.5f*view.getFovY());
+			float dists[2] = {view.getNear(), view.getFar() < maxDistance ? view.getFar() : maxDistance};
+
+			Vector3d c[8];
+			for (int i = 0; i < 8; i++)
+			{
+				float d = dists[(i >> 2) & 1];
+				float sx = ((i & 1) ? 1.0f : -1.0f)*d*tanY*view.getAspect();
+				float sy = ((i & 2) ? 1.0f : -1.0f)*d*tanY;
+
+				Vector3f offset = view.getForward()*d + view.getRight()*sx + view.getUp()*sy;
+				c[i] = view.getPosition() + Vector3d(offset.x, offset.y, offset.z);
+			}
+
+			drawBoxEdges(c, color);
+		}
+
+		// Starts a panel of stacked text lines and graphs at 'x', 'y'.
+		// Its background is sized to the content by 'endPanel()'.
+		void beginPanel(int x, int y, const char* title, Uint32 background = 0x000000C0)
+		{
+			panel = push(COMMAND_FILL_RECT, background);
+			if (panel == 0)
+			{
+				return;
+			}
+
+			panel->x = (float)x;
+			panel->y = (float)y;
+			panel->w = panel->h = 0.0f;
+
+			panelCursor.x = x + H2_DEBUG_PANEL_PADDING;
+			panelCursor.y = y + H2_DEBUG_PANEL_PADDING;
+			panelWidth = 0;
+
+			if (title != 0)
+			{
+				panelText(0xFFFF80FF, "%s", title);
+			}
+		}
+
+		void panelText(Uint32 color, const char* format, ...)
+		{
+			if (!enabled || panel == 0)
+			{
+				return;
+			}
+
+			va_list args;
+			va_start(args, format);
+			Command* c = pushText((float)panelCursor.x, (float)panelCursor.y, color, format, args);
+			va_end(args);
+
+			if (c != 0)
+			{
+				SDL_Point size = measureText(c->text);
+				panelCursor.y += size.y;
+				panelWidth = size.x > panelWidth ? size.x : panelWidth;
+			}
+		}
+
+		void panelGraph(const float* values, unsigned int n, float minVal, float maxVal, Uint32 color, int width = 200, int height = 40)
+		{
+			if (!enabled || panel == 0)
+			{
+				return;
+			}
+
+			SDL_Rect area = {panelCursor.x, panelCursor.y, width, height};
+			rect((float)area.x, (float)area.y, (float)area.w, (float)area.h, 0x808080FF);
+			graph(values, n, area, minVal, maxVal, color);
+
+			panelCursor.y += height + 2;
+			panelWidth = width > panelWidth ? width : panelWidth;
+		}
+
+		void endPanel()
+		{
+			if (panel != 0)
+			{
+				panel->w = panelWidth + 2.0f*H2_DEBUG_PANEL_PADDING;
+				panel->h = panelCursor.y + H2_DEBUG_PANEL_PADDING - panel->y;
+				panel = 0;
+			}
+		}
+
+		// Draws the frame's commands. Recorded data stays until 'newFrame()'.
+		int render(SDL_Renderer* renderer)
+		{
+			H2_PROFILE_SCOPE("debug draw render");
+
+			nDrawCalls = 0;
+
+			if (!enabled || first == 0)
+			{
+				return 0;
+			}
+
+			TextStyle style;
+
+			// lines projected from near the camera plane can end far off
+			// screen; draw coordinates are relative to the viewport
+			SDL_Rect viewport;
+			SDL_RenderGetViewport(renderer, &viewport);
+			batch.setClipRect(0.0f, 0.0f, (float)viewport.w, (float)viewport.h);
+
+			SDL_BlendMode blendMode;
+			SDL_GetRenderDrawBlendMode(renderer, &blendMode);
+			SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+			for (Command* c = first; c != 0; c = c->next)
+			{
+				batch.setColor((Uint8)(c->color >> 24), (Uint8)(c->color >> 16), (Uint8)(c->color >> 8), (Uint8)c->color);
+
+				switch (c->type)
+				{
+				case COMMAND_LINE:
+					batch.drawLine(c->x, c->y, c->w, c->h);
+					break;
+
+				case COMMAND_RECT:
+					batch.drawRect(c->x, c->y, c->w, c->h);
+					break;
+
+				case COMMAND_FILL_RECT:
+					batch.fillRect(c->x, c->y, c->w, c->h);
+					break;
+
+				case COMMAND_POLYLINE:
+					batch.drawPolyline(c->points, c->nPoints);
+					break;
+
+				case COMMAND_TEXT:
+					if (textCache != 0)
+					{
+						textBatch.drawImmediate(*textCache, c->text, (int)c->x, (int)c->y, style, c->color);
+					}
+					break;
+				}
+			}
+
+			nDrawCalls = batch.flush(renderer) + textBatch.flush(renderer);
+
+			SDL_SetRenderDrawBlendMode(renderer, blendMode);
+
+			return nDrawCalls;
+		}
+
+	private:
+
+		enum CommandType
+		{
+			COMMAND_LINE,
+			COMMAND_RECT,
+			COMMAND_FILL_RECT,
+			COMMAND_POLYLINE,
+			COMMAND_TEXT
+		};
+
+		struct Command
+		{
+			Command* next;
+			CommandType type;
+			Uint32 color;
+			float x, y, w, h;     // line end in 'w', 'h'
+			Vector2f* points;
+			unsigned int nPoints;
+			const char* text;
+		};
+
+		LinearAllocator arena;
+
+		Command* first;
+		Command* last;
+
+		Command* panel;   // background of the open panel
+
+		SDL_Point panelCursor;
+
+		int panelWidth;
+
+		const Camera* camera;
+
+		TextCache* textCache;
+
+		Batch2D batch;
+
+		TextBatch textBatch;
+
+		bool enabled;
+
+		unsigned int nCommands;
+
+		int nDrawCalls;
+
+
+		DebugDraw(const DebugDraw&);
+		DebugDraw& operator = (const DebugDraw&);
+
+		Command* push(CommandType type, Uint32 color)
+		{
+			if (!enabled)
+			{
+				return 0;
+			}
+
+			Command* c = (Command*)arena.allocate(sizeof(Command));
+			if (c == 0)
+			{
+				return 0;
+			}
+
+			c->next = 0;
+			c->type = type;
+			c->color = color;
+			c->points = 0;
+			c->nPoints = 0;
+			c->text = 0;
+
+			if (last != 0)
+			{
+				last->next = c;
+			} else
+			{
+				first = c;
+			}
+			last = c;
+			nCommands++;
+
+			return c;
+		}
+
+		Vector2f* pushPolyline(unsigned int n, Uint32 color)
+		{
+			if (!enabled || n < 2)
+			{
+				return 0;
+			}
+
+			Vector2f* points = (Vector2f*)arena.allocate(n*sizeof(Vector2f));
+			if (points == 0)
+			{
+				return 0;
+			}
+
+			Command* c = push(COMMAND_POLYLINE, color);
+			if (c == 0)
+			{
+				return 0;
+			}
+
+			c->points = points;
+			c->nPoints = n;
+
+			return points;
+		}
+
+		Command* pushText(float x, float y, Uint32 color, const char* format, va_list args)
+		{
+			char buffer[H2_DEBUG_DRAW_TEXT_MAX];
+			SDL_vsnprintf(buffer, sizeof(buffer), format, args);
+
+			unsigned int length = (unsigned int)SDL_strlen(buffer);
+			char* copy = (char*)arena.allocate(length + 1, 1);
+			if (copy == 0)
+			{
+				return 0;
+			}
+			memcpy(copy, buffer, length + 1);
+
+			Command* c = push(COMMAND_TEXT, color);
+			if (c != 0)
+			{
+				c->x = x;
+				c->y = y;
+				c->text = copy;
+			}
+
+			return c;
+		}
+
+		// Advance-based box of immediate text, no layout cache.
+		SDL_Point measureText(const char* text) const
+		{
+			SDL_Point size = {0, 0};
+
+			GlyphRasterizer* rasterizer = textCache != 0 ? textCache->getGlyphCache().getRasterizer() : 0;
+			if (rasterizer == 0)
+			{
+				return size;
+			}
+
+			TextStyle style;
+			int lineWidth = 0;
+			int nLines = 1;
+
+			const char* p = text;
+			while (*p != 0)
+			{
+				Uint32 c = decodeUtf8(p);
+
+				GlyphMetrics m;
+				if (c == '\n')
+				{
+					nLines++;
+					lineWidth = 0;
+				} else if (rasterizer->getMetrics(c, style.size, &m))
+				{
+					lineWidth += m.advance;
+					size.x = lineWidth > size.x ? lineWidth : size.x;
+				}
+			}
+
+			size.y = nLines*rasterizer->getLineHeight(style.size);
+
+			return size;
+		}
+
+		inline Vector2f project(const Vector3f& p, float depth) const
+		{
+			float s = camera->getProjectionScale()/depth;
+			return Vector2f(0.5f*camera->getViewportWidth() + p.dot(camera->getRight())*s,
+							0.5f*camera->getViewportHeight() - p.dot(camera->getUp())*s);
+		}
+
+		// Corners indexed by bits: 1 for x (right), 2 for y (up), 4 for z (far).
+		void drawBoxEdges(const Vector3d* c, Uint32 color)
+		{
+			for (int i = 0; i < 8; i++)
+			{
+				for (int bit = 1; bit < 8; bit <<= 1)
+				{
+					if ((i & bit) == 0)
+					{
+						line3D(c[i], c[i | bit], color);
+					}
+				}
+			}
+		}
+	};
+}
@@ -0,0 +1,416 @@
+#pragma once
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "SDL_render.h"
+
+#include "../core/h2_memory.h"
+
+
+
+
+namespace h2
+{
+	// Placement of one glyph bitmap relative to the pen position, y down.
+	struct GlyphMetrics
+	{
+		int width, height;   // bitmap size, 0 for blank glyphs
+		int offsetX;         // left edge from pen position
+		int offsetY;         // top edge from baseline, negative above it
+		int advance;         // pen movement
+	};
+
+
+	// Source of glyph shapes for GlyphCache, e.g. a font file parser or
+	// the built-in BitmapFontRasterizer.
+	class GlyphRasterizer
+	{
+	public:
+
+		// Destructor
+
+		virtual ~GlyphRasterizer() {}
+
+
+		// Methods
+
+		// Cheap, used by text layout. False when 'codepoint' is missing.
+		virtual bool getMetrics(Uint32 codepoint, int size, GlyphMetrics* out) = 0;
+
+		// Writes 8 bit coverage of 'width' x 'height' from getMetrics().
+		virtual void rasterize(Uint32 codepoint, int size, Uint8* coverage, int pitch) = 0;
+
+		virtual int getAscent(int size) = 0;
+
+		virtual int getLineHeight(int size) = 0;
+	};
+
+
+	inline Uint32 makeGlyphKey(Uint32 codepoint, int size)
+	{
+		return (codepoint << 8) | (Uint32)(size & 0xFF);
+	}
+
+
+	// Statistics of GlyphCache since creation.
+	struct GlyphCacheStats
+	{
+		unsigned int hits;
+		unsigned int misses;
+		unsigned int evictions;
+		unsigned int failures;   // glyphs that did not fit even after eviction
+	};
+
+
+	// Glyphs of all sizes rasterized on demand into one RGBA8888 atlas
+	// texture, white with coverage in alpha, so text color is texture
+	// color modulation.
+	//
+	// The atlas is split into shelves of equal cells, one cell size per
+	// shelf, so an evicted glyph leaves a hole the next glyph of that size
+	// class fits exactly. When the atlas is full the least recently used
+	// glyph of the class is replaced; if the class has no shelf yet, the
+	// least recently used shelf tall enough is emptied and reused. Glyphs
+	// used during the current frame are never evicted, quads referencing
+	// them may still be waiting for a flush.
+	class GlyphCache
+	{
+	public:
+
+		// Constructors
+
+		GlyphCache() : texture(0), rasterizer(0), width(0), height(0), nextY(0), frame(1)
+		{
+			memset(&stats, 0, sizeof(stats));
+		}
+
+
+		// Destructor
+
+		~GlyphCache()
+		{
+			destroy();
+		}
+
+
+		// Methods
+
+		bool create(SDL_Renderer* renderer, GlyphRasterizer* in_rasterizer, int in_width = 512, int in_height = 512)
+		{
+			destroy();
+
+			texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, in_width, in_height);
+			if (texture == 0)
+			{
+				return false;
+			}
+
+			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+			rasterizer = in_rasterizer;
+			width = in_width;
+			height = in_height;
+
+			return true;
+		}
+
+		void destroy()
+		{
+			if (texture != 0)
+			{
+				SDL_DestroyTexture(texture);
+				texture = 0;
+			}
+
+			shelves.clear();
+			lookup.clear();
+			nextY = 0;
+		}
+
+		inline SDL_Texture* getTexture() const { return texture; }
+
+		inline GlyphRasterizer* getRasterizer() const { return rasterizer; }
+
+		inline const GlyphCacheStats& getStats() const { return stats; }
+
+		inline unsigned int getGlyphCount() const { return (unsigned int)lookup.size(); }
+
+		// Starts a frame, glyphs of older frames become evictable.
+		inline void newFrame()
+		{
+			frame++;
+		}
+
+		// Returns glyph id, rasterizing it on a miss, or -1.
+		int find(Uint32 codepoint, int size)
+		{
+			Uint32 key = makeGlyphKey(codepoint, size);
+
+			LookupMap::iterator it = lookup.find(key);
+			if (it != lookup.end())
+			{
+				stats.hits++;
+				slotOf(it->second).lastFrame = frame;
+				return it->second;
+			}
+
+			stats.misses++;
+
+			GlyphMetrics m;
+			if (texture == 0 || !rasterizer->getMetrics(codepoint, size, &m) || m.width <= 0 || m.height <= 0)
+			{
+				return -1;
+			}
+
+			int id = allocate(classOf(m.width), classOf(m.height));
+			if (id < 0)
+			{
+				stats.failures++;
+				return -1;
+			}
+
+			Slot& slot = slotOf(id);
+			upload(codepoint, size, m, slot.rect);
+
+			slot.key = key;
+			slot.rect.w = m.width;
+			slot.rect.h = m.height;
+			slot.lastFrame = frame;
+			lookup[key] = id;
+
+			return id;
+		}
+
+		// Fast path for ids kept by text layouts: true and touched when
+		// 'id' still holds glyph 'key'.
+		inline bool isCached(int id, Uint32 key)
+		{
+			if (id < 0 || (unsigned int)(id >> 16) >= shelves.size())
+			{
+				return false;
+			}
+
+			Shelf& shelf = shelves[id >> 16];
+			if ((unsigned int)(id & 0xFFFF) >= shelf.slots.size())
+			{
+				return false;
+			}
+
+			Slot& slot = shelf.slots[id & 0xFFFF];
+			if (slot.key != key)
+			{
+				return false;
+			}
+
+			stats.hits++;
+			slot.lastFrame = frame;
+			return true;
+		}
+
+		// Atlas rect of glyph 'id'.
+		inline const SDL_Rect& getRect(int id) const
+		{
+			return shelves[id >> 16].slots[id & 0xFFFF].rect;
+		}
+
+	private:
+
+		typedef TaggedMap<Uint32, int, MEMORY_TAG_VIDEO>::Type LookupMap;
+
+		enum { EMPTY_KEY = 0xFFFFFFFF };
+
+		struct Slot
+		{
+			Uint32 key;
+			Uint32 lastFrame;
+			SDL_Rect rect;   // position of the cell, size of the glyph
+		};
+
+		struct Shelf
+		{
+			int y, height;
+			int cellW, cellH;
+			TaggedVector<Slot, MEMORY_TAG_VIDEO>::Type slots;
+		};
+
+		SDL_Texture* texture;
+
+		GlyphRasterizer* rasterizer;
+
+		int width, height;
+
+		int nextY;
+
+		Uint32 frame;
+
+		TaggedVector<Shelf, MEMORY_TAG_VIDEO>::Type shelves;
+
+		LookupMap lookup;
+
+		TaggedVector<Uint8, MEMORY_TAG_VIDEO>::Type coverage;
+
+		TaggedVector<Uint32, MEMORY_TAG_VIDEO>::Type pixels;
+
+		GlyphCacheStats stats;
+
+
+		GlyphCache(const GlyphCache&);
+		GlyphCache& operator = (const GlyphCache&);
+
+		static inline int classOf(int size)
+		{
+			return (size + 3) & ~3;
+		}
+
+		inline Slot& slotOf(int id)
+		{
+			return shelves[id >> 16].slots[id & 0xFFFF];
+		}
+
+		// Cells keep one pixel gutter right and below.
+		void setupShelf(Shelf& shelf, int cellW, int cellH)
+		{
+			shelf.cellW = cellW;
+			shelf.cellH = cellH;
+
+			int n = width/(cellW + 1);
+			shelf.slots.resize(n);
+
+			for (int i = 0; i < n; i++)
+			{
+				Slot& slot = shelf.slots[i];
+				slot.key = EMPTY_KEY;
+				slot.lastFrame = 0;
+				slot.rect.x = i*(cellW + 1);
+				slot.rect.y = shelf.y;
+				slot.rect.w = slot.rect.h = 0;
+			}
+		}
+
+		int allocate(int cellW, int cellH)
+		{
+			if (cellW + 1 > width || cellH + 1 > height)
+			{
+				return -1;
+			}
+
+			// free cell, or least recently used one, of the size class
+			int lru = -1;
+			Uint32 lruFrame = frame;
+
+			for (unsigned int s = 0; s < shelves.size(); s++)
+			{
+				Shelf& shelf = shelves[s];
+				if (shelf.cellW != cellW || shelf.cellH != cellH)
+				{
+					continue;
+				}
+
+				for (unsigned int i = 0; i < shelf.slots.size(); i++)
+				{
+					if (shelf.slots[i].key == EMPTY_KEY)
+					{
+						return (int)(s << 16 | i);
+					}
+					if (shelf.slots[i].lastFrame < lruFrame)
+					{
+						lruFrame = shelf.slots[i].lastFrame;
+						lru = (int)(s << 16 | i);
+					}
+				}
+			}
+
+			if (nextY + cellH + 1 <= height)
+			{
+				Shelf shelf;
+				shelf.y = nextY;
+				shelf.height = cellH + 1;
+				shelf.cellW = shelf.cellH = 0;
+				shelves.push_back(shelf);
+				setupShelf(shelves.back(), cellW, cellH);
+
+				nextY += cellH + 1;
+
+				return (int)((shelves.size() - 1) << 16);
+			}
+
+			if (lru >= 0)
+			{
+				evict(slotOf(lru));
+				return lru;
+			}
+
+			// reuse the stalest shelf tall enough for the new class
+			int best = -1;
+			Uint32 bestFrame = frame;
+
+			for (unsigned int s = 0; s < shelves.size(); s++)
+			{
+				if (shelves[s].height < cellH + 1)
+				{
+					continue;
+				}
+
+				Uint32 newest = 0;
+				for (unsigned int i = 0; i < shelves[s].slots.size(); i++)
+				{
+					if (shelves[s].slots[i].lastFrame > newest)
+					{
+						newest = shelves[s].slots[i].lastFrame;
+					}
+				}
+
+				if (newest < bestFrame)
+				{
+					bestFrame = newest;
+					best = (int)s;
+				}
+			}
+
+			if (best < 0)
+			{
+				return -1;
+			}
+
+			Shelf& shelf = shelves[best];
+			for (unsigned int i = 0; i < shelf.slots.size(); i++)
+			{
+				if (shelf.slots[i].key != EMPTY_KEY)
+				{
+					evict(shelf.slots[i]);
+				}
+			}
+			setupShelf(shelf, cellW, cellH);
+
+			return best << 16;
+		}
+
+		void evict(Slot& slot)
+		{
+			lookup.erase(slot.key);
+			slot.key = EMPTY_KEY;
+			stats.evictions++;
+		}
+
+		// Uploads the whole cell, clearing what an evicted glyph left.
+		void upload(Uint32 codepoint, int size, const GlyphMetrics& m, const SDL_Rect& cell)
+		{
+			int cellW = classOf(m.width);
+			int cellH = classOf(m.height);
+
+			coverage.assign(cellW*cellH, 0);
+			rasterizer->rasterize(codepoint, size, &coverage[0], cellW);
+
+			pixels.resize(cellW*cellH);
+			for (int i = 0; i < cellW*cellH; i++)
+			{
+				pixels[i] = 0xFFFFFF00 | coverage[i];
+			}
+
+			SDL_Rect r = {cell.x, cell.y, cellW, cellH};
+			SDL_UpdateTexture(texture, &r, &pixels[0], cellW*(int)sizeof(Uint32));
+		}
+	};
+}
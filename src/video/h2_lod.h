@@ -0,0 +1,333 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "SDL_assert.h"
+
+#include "../core/h2_memory.h"
+#include "../core/h2_profiler.h"
+#include "../math/h2_math.h"
+#include "../math/h2_simd.h"
+#include "h2_camera.h"
+
+
+
+#define H2_LOD_MAX_LEVELS 8
+#define H2_LOD_INVALID_ID 0xFFFFFFFF        // returned by 'LodManager::add()' for a bad chain
+#define H2_BEZIER_MIN_TOLERANCE 0.001f      // pixels, smaller tolerances are clamped
+
+
+
+
+namespace h2
+{
+	// Levels of one mesh, level 0 is the most detailed.
+	// 'geometricError' is world-space error of a level relative to level 0
+	// and must grow with level index.
+	struct LodChain
+	{
+		unsigned int nLevels;
+		float geometricError[H2_LOD_MAX_LEVELS];
+		unsigned int triangles[H2_LOD_MAX_LEVELS];
+	};
+
+
+	// Selects LOD levels by projected screen-space error.
+	//
+	// Object data is kept in SoA arrays, projected sizes and errors are
+	// computed 4 objects at a time. Switching to a coarser level needs the
+	// error to drop 'hysteresis' below tolerance, which prevents popping
+	// for objects sitting on a threshold. When a triangle budget is set,
+	// objects with the smallest screen size are degraded first.
+	class LodManager
+	{
+	public:
+
+		// Constructors
+
+		LodManager() : tolerance(1.0f), hysteresis(0.1f), triangleBudget(0), nTriangles(0) {}
+
+
+		// Methods
+
+		// Returns id of the new object, or H2_LOD_INVALID_ID when the chain
+		// has no levels or more than H2_LOD_MAX_LEVELS.
+		unsigned int add(const LodChain* chain, const Vector3d& center, float radius)
+		{
+			SDL_assert(chain->nLevels > 0 && chain->nLevels <= H2_LOD_MAX_LEVELS);
+
+			if (chain->nLevels == 0 || chain->nLevels > H2_LOD_MAX_LEVELS)
+			{
+				return H2_LOD_INVALID_ID;
+			}
+
+			chains.push_back(chain);
+			px.push_back(center.x);
+			py.push_back(center.y);
+			pz.push_back(center.z);
+			radii.push_back(radius);
+			levels.push_back(chain->nLevels - 1);
+
+			resizeScratch();
+
+			return (unsigned int)(chains.size() - 1);
+		}
+
+		inline void setPosition(unsigned int id, const Vector3d& center)
+		{
+			px[id] = center.x;
+			py[id] = center.y;
+			pz[id] = center.z;
+		}
+
+		inline void setRadius(unsigned int id, float radius) { radii[id] = radius; }
+
+		// Maximum allowed screen-space error in pixels.
+		inline void setTolerance(float pixels) { tolerance = pixels; }
+
+		// Fraction of tolerance, 0 disables hysteresis.
+		inline void setHysteresis(float fraction) { hysteresis = fraction; }
+
+		// 0 means unlimited.
+		inline void setTriangleBudget(unsigned int budget) { triangleBudget = budget; }
+
+		inline unsigned int count() const { return (unsigned int)chains.size(); }
+
+		inline unsigned int getLevel(unsigned int id) const { return levels[id]; }
+
+		// Projected radius in pixels from the last update.
+		inline float getScreenSize(unsigned int id) const { return screenSize[id]; }
+
+		// Total triangles of selected levels from the last update.
+		inline unsigned int getTriangleCount() const { return nTriangles; }
+
+		void update(const Camera& camera)
+		{
+			H2_PROFILE_SCOPE("lod update");
+
+			unsigned int n = count();
+
+			if (n == 0)
+			{
+				nTriangles = 0;
+				return;
+			}
+
+			// rebase to camera in double, everything after is float
+			const Vector3d& cam = camera.getPosition();
+			for (unsigned int i = 0; i < n; i++)
+			{
+				rx[i] = (float)(px[i] - cam.x);
+				ry[i] = (float)(py[i] - cam.y);
+				rz[i] = (float)(pz[i] - cam.z);
+			}
+
+			computeScale(camera.getProjectionScale(), camera.getNear(), n);
+
+			selectLevels(n);
+
+			if (triangleBudget > 0 && nTriangles > triangleBudget)
+			{
+				applyBudget(n);
+			}
+		}
+
+	private:
+
+		typedef TaggedVector<float, MEMORY_TAG_VIDEO>::Type FloatList;
+
+		TaggedVector<const LodChain*, MEMORY_TAG_VIDEO>::Type chains;
+
+		TaggedVector<double, MEMORY_TAG_VIDEO>::Type px, py, pz;
+
+		FloatList radii;
+
+		TaggedVector<unsigned int, MEMORY_TAG_VIDEO>::Type levels;
+
+		// per-update scratch
+		FloatList rx, ry, rz, pixelsPerUnit, screenSize;
+
+		TaggedVector<unsigned int, MEMORY_TAG_VIDEO>::Type order;
+
+		float tolerance, hysteresis;
+
+		unsigned int triangleBudget, nTriangles;
+
+
+		void resizeScratch()
+		{
+			rx.resize(count(), 0);
+			ry.resize(count(), 0);
+			rz.resize(count(), 0);
+			pixelsPerUnit.resize(count(), 0);
+			screenSize.resize(count(), 0);
+		}
+
+		// pixelsPerUnit = projScale/max(distance - radius, near)
+		// screenSize    = radius*pixelsPerUnit
+		void computeScale(float projScale, float zNear, unsigned int n)
+		{
+			unsigned int i = 0;
+
+#ifdef H2_SIMD_SSE
+			__m128 vScale = _mm_set1_ps(projScale);
+			__m128 vNear = _mm_set1_ps(zNear);
+
+			for (; i + H2_SIMD_WIDTH <= n; i += H2_SIMD_WIDTH)
+			{
+				__m128 x = _mm_loadu_ps(&rx[i]);
+				__m128 y = _mm_loadu_ps(&ry[i]);
+				__m128 z = _mm_loadu_ps(&rz[i]);
+				__m128 r = _mm_loadu_ps(&radii[i]);
+
+				__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+				__m128 d = _mm_max_ps(_mm_sub_ps(_mm_sqrt_ps(d2), r), vNear);
+				__m128 ppu = _mm_div_ps(vScale, d);
+
+				_mm_storeu_ps(&pixelsPerUnit[i], ppu);
+				_mm_storeu_ps(&screenSize[i], _mm_mul_ps(r, ppu));
+			}
+#endif
+
+			for (; i < n; i++)
+			{
+				float d = sqrt(rx[i]*rx[i] + ry[i]*ry[i] + rz[i]*rz[i]) - radii[i];
+				if (d < zNear)
+				{
+					d = zNear;
+				}
+
+				pixelsPerUnit[i] = projScale/d;
+				screenSize[i] = radii[i]*pixelsPerUnit[i];
+			}
+		}
+
+		void selectLevels(unsigned int n)
+		{
+			float coarsenTolerance = tolerance*(1.0f - hysteresis);
+
+			nTriangles = 0;
+
+			for (unsigned int i = 0; i < n; i++)
+			{
+				const LodChain* chain = chains[i];
+				float ppu = pixelsPerUnit[i];
+				unsigned int level = levels[i];
+
+				// refine while current level is visibly wrong
+				while (level > 0 && chain->geometricError[level]*ppu > tolerance)
+				{
+					level--;
+				}
+
+				// coarsen only when next level is clearly good enough
+				while (level + 1 < chain->nLevels && chain->geometricError[level + 1]*ppu <= coarsenTolerance)
+				{
+					level++;
+				}
+
+				levels[i] = level;
+				nTriangles += chain->triangles[level];
+			}
+		}
+
+		void applyBudget(unsigned int n)
+		{
+			order.resize(n);
+			for (unsigned int i = 0; i < n; i++)
+			{
+				order[i] = i;
+			}
+
+			std::sort(order.begin(), order.end(), CompareSize(screenSize));
+
+			bool degraded = true;
+
+			while (nTriangles > triangleBudget && degraded)
+			{
+				degraded = false;
+
+				for (unsigned int k = 0; k < n && nTriangles > triangleBudget; k++)
+				{
+					unsigned int i = order[k];
+					const LodChain* chain = chains[i];
+
+					if (levels[i] + 1 < chain->nLevels)
+					{
+						nTriangles -= chain->triangles[levels[i]];
+						levels[i]++;
+						nTriangles += chain->triangles[levels[i]];
+						degraded = true;
+					}
+				}
+			}
+		}
+
+		struct CompareSize
+		{
+			const FloatList& size;
+
+			CompareSize(const FloatList& size) : size(size) {}
+
+			bool operator () (unsigned int a, unsigned int b) const
+			{
+				return size[a] < size[b];
+			}
+		};
+	};
+
+
+	// Number of line segments needed to draw quadratic bezier with chord
+	// error below 'tolerance'. Points should be in pixels, so the count
+	// follows on-screen size of the curve. 'tolerance' is clamped to
+	// H2_BEZIER_MIN_TOLERANCE, degenerate input gets 'maxSegments'.
+	inline unsigned int quadraticBezierSegments(const Vector2f& p0, const Vector2f& p1, const Vector2f& p2,
+												float tolerance, unsigned int maxSegments = 256)
+	{
+		// chord error of a segment of parameter length h is |B''|*h^2/8,
+		// where B'' = 2*(p0 - 2*p1 + p2)
+		Vector2f dd = p0 - 2.0f*p1 + p2;
+
+		tolerance = tolerance > H2_BEZIER_MIN_TOLERANCE ? tolerance : H2_BEZIER_MIN_TOLERANCE;
+
+		float n = sqrt(sqrt(dd.x*dd.x + dd.y*dd.y)/(4.0f*tolerance));
+
+		// also catches infinite and NaN 'n' before the conversion
+		if (!(n < (float)maxSegments))
+		{
+			return maxSegments;
+		}
+
+		unsigned int nSegments = (unsigned int)std::ceil(n);
+
+		return nSegments < 1 ? 1 : nSegments;
+	}
+
+
+	// Same for cubic bezier, uses bound of |B''| over the whole curve.
+	inline unsigned int cubicBezierSegments(const Vector2f& p0, const Vector2f& p1, const Vector2f& p2, const Vector2f& p3,
+											float tolerance, unsigned int maxSegments = 256)
+	{
+		Vector2f dd0 = p0 - 2.0f*p1 + p2;
+		Vector2f dd1 = p1 - 2.0f*p2 + p3;
+
+		float l0 = dd0.x*dd0.x + dd0.y*dd0.y;
+		float l1 = dd1.x*dd1.x + dd1.y*dd1.y;
+
+		tolerance = tolerance > H2_BEZIER_MIN_TOLERANCE ? tolerance : H2_BEZIER_MIN_TOLERANCE;
+
+		// |B''| <= 6*max(|dd0|, |dd1|)
+		float n = sqrt(6.0f*sqrt(l0 > l1 ? l0 : l1)/(8.0f*tolerance));
+
+		// also catches infinite and NaN 'n' before the conversion
+		if (!(n < (float)maxSegments))
+		{
+			return maxSegments;
+		}
+
+		unsigned int nSegments = (unsigned int)std::ceil(n);
+
+		return nSegments < 1 ? 1 : nSegments;
+	}
+}
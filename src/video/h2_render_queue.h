@@ -0,0 +1,483 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "SDL_render.h"
+
+#include "../core/h2_allocator.h"
+#include "../core/h2_memory.h"
+#include "../core/h2_profiler.h"
+
+
+
+// Sort key layout (most significant bits first):
+//
+//   [63..56] layer      - drawn in ascending order
+//   [55..24] material   - packed RGBA draw color, groups state changes
+//   [23..0]  depth      - quantized, back to front inside a material
+//
+#define H2_RENDER_KEY_LAYER_SHIFT     56
+#define H2_RENDER_KEY_MATERIAL_SHIFT  24
+#define H2_RENDER_KEY_DEPTH_BITS      24
+#define H2_RENDER_KEY_DEPTH_MASK      0xFFFFFF
+
+
+
+
+namespace h2
+{
+	enum RenderPrimitive
+	{
+		RENDER_POINTS,
+		RENDER_LINES,        // pairs of points, one segment per pair
+		RENDER_LINE_STRIP,   // connected points
+		RENDER_RECTS,
+		RENDER_FILLED_RECTS
+	};
+
+
+	inline Uint32 packRenderColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+	{
+		return ((Uint32)r << 24) | ((Uint32)g << 16) | ((Uint32)b << 8) | (Uint32)a;
+	}
+
+
+	// Function builds 64-bit sort key from layer, material and depth.
+	// 'depth' is clamped to [0, 1] and quantized to 24 bits.
+	inline Uint64 makeRenderKey(Uint8 layer, Uint32 material, float depth)
+	{
+		if (depth < 0.0f) depth = 0.0f;
+		if (depth > 1.0f) depth = 1.0f;
+
+		Uint64 qDepth = (Uint64)(depth * (float)H2_RENDER_KEY_DEPTH_MASK);
+
+		return ((Uint64)layer << H2_RENDER_KEY_LAYER_SHIFT) |
+			   ((Uint64)material << H2_RENDER_KEY_MATERIAL_SHIFT) |
+			   (qDepth & H2_RENDER_KEY_DEPTH_MASK);
+	}
+
+
+	inline Uint32 renderKeyMaterial(Uint64 key)
+	{
+		return (Uint32)(key >> H2_RENDER_KEY_MATERIAL_SHIFT);
+	}
+
+
+	// Commands are sorted by 'key' and merged into batches
+	// when material and primitive match.
+	struct RenderCommand
+	{
+		Uint64 key;
+		Uint32 primitive;
+		Uint32 first;   // first element in point or rect storage of owning list
+		Uint32 count;
+	};
+
+
+	// Per-thread recording buffer. Every worker records into its own list,
+	// so no synchronization is needed while recording. Storage keeps its
+	// capacity between frames.
+	class RenderCommandList
+	{
+	public:
+
+		TaggedVector<RenderCommand, MEMORY_TAG_VIDEO>::Type commands;
+
+		TaggedVector<SDL_Point, MEMORY_TAG_VIDEO>::Type points;
+
+		TaggedVector<SDL_Rect, MEMORY_TAG_VIDEO>::Type rects;
+
+
+		// Methods
+
+		void clear()
+		{
+			commands.clear();
+			points.clear();
+			rects.clear();
+		}
+
+		void drawPoint(Uint64 key, int x, int y)
+		{
+			SDL_Point p = {x, y};
+			pushCommand(key, RENDER_POINTS, (Uint32)points.size(), 1);
+			points.push_back(p);
+		}
+
+		void drawLine(Uint64 key, int x0, int y0, int x1, int y1)
+		{
+			SDL_Point p0 = {x0, y0};
+			SDL_Point p1 = {x1, y1};
+			pushCommand(key, RENDER_LINES, (Uint32)points.size(), 2);
+			points.push_back(p0);
+			points.push_back(p1);
+		}
+
+		void drawLineStrip(Uint64 key, const SDL_Point* inPoints, unsigned int nPoints)
+		{
+			if (nPoints < 2)
+			{
+				return;
+			}
+
+			pushCommand(key, RENDER_LINE_STRIP, (Uint32)points.size(), nPoints);
+			points.insert(points.end(), inPoints, inPoints + nPoints);
+		}
+
+		void drawRect(Uint64 key, const SDL_Rect& rect)
+		{
+			pushCommand(key, RENDER_RECTS, (Uint32)rects.size(), 1);
+			rects.push_back(rect);
+		}
+
+		void fillRect(Uint64 key, const SDL_Rect& rect)
+		{
+			pushCommand(key, RENDER_FILLED_RECTS, (Uint32)rects.size(), 1);
+			rects.push_back(rect);
+		}
+
+	private:
+
+		void pushCommand(Uint64 key, Uint32 primitive, Uint32 first, Uint32 count)
+		{
+			RenderCommand cmd;
+			cmd.key = key;
+			cmd.primitive = primitive;
+			cmd.first = first;
+			cmd.count = count;
+			commands.push_back(cmd);
+		}
+	};
+
+
+	// Run of sorted commands sharing material and primitive,
+	// submitted with a single bulk SDL call.
+	struct RenderBatch
+	{
+		Uint32 material;
+		Uint32 primitive;
+		Uint32 first;   // first vertex or rect in merged storage
+		Uint32 count;
+	};
+
+	typedef TaggedVector<RenderBatch, MEMORY_TAG_VIDEO>::Type RenderBatchList;
+
+
+	// Per-frame command buffer. Workers record into 'list(threadIndex)',
+	// then the owning thread calls 'submit()' which radix-sorts all commands
+	// by key, merges them into batches and issues one SDL call per batch.
+	class RenderQueue
+	{
+	public:
+
+		// Constructors
+
+		RenderQueue(unsigned int nThreads = 1) : lists(nThreads > 0 ? nThreads : 1), scratchAllocator(0) {}
+
+
+		// Methods
+
+		inline unsigned int threadCount() const
+		{
+			return (unsigned int)lists.size();
+		}
+
+		inline RenderCommandList& list(unsigned int threadIndex)
+		{
+			return lists[threadIndex];
+		}
+
+		inline const RenderBatchList& getBatches() const
+		{
+			return batches;
+		}
+
+		// Sort entries are taken from 'allocator', typically a frame
+		// LinearAllocator of the sorting thread, and released back to its
+		// marker before 'sort()' returns. When not set, or when the frame
+		// does not fit, the queue's own storage is used.
+		inline void setScratchAllocator(LinearAllocator* allocator)
+		{
+			scratchAllocator = allocator;
+		}
+
+		void clear()
+		{
+			for (unsigned int i = 0; i < lists.size(); i++)
+			{
+				lists[i].clear();
+			}
+			batches.clear();
+			mergedPoints.clear();
+			mergedRects.clear();
+		}
+
+		// Sorts recorded commands and builds batches. Must not be called
+		// while any worker is still recording.
+		void sort()
+		{
+			H2_PROFILE_SCOPE("render queue sort");
+
+			unsigned int n = 0;
+			for (unsigned int l = 0; l < lists.size(); l++)
+			{
+				n += (unsigned int)lists[l].commands.size();
+			}
+
+			LinearAllocator::Marker marker = scratchAllocator != 0 ? scratchAllocator->getMarker() : 0;
+
+			// entries and the radix sort's second buffer
+			SortEntry* buffer = scratchAllocator != 0 ? scratchAllocator->allocateArray<SortEntry>(2*n) : 0;
+
+			if (buffer == 0)
+			{
+				entries.resize(2*n > 1 ? 2*n : 1);
+				buffer = &entries[0];
+			}
+
+			gatherEntries(buffer);
+			buildBatches(radixSort(buffer, buffer + n, n), n);
+
+			if (scratchAllocator != 0)
+			{
+				scratchAllocator->freeToMarker(marker);
+			}
+		}
+
+		// Sorts (if needed), submits batches and returns number of SDL draw calls issued.
+		int submit(SDL_Renderer* renderer)
+		{
+			H2_PROFILE_SCOPE("render queue submit");
+
+			sort();
+
+			int nCalls = 0;
+			Uint32 currMaterial = 0;
+			bool hasMaterial = false;
+
+			for (unsigned int i = 0; i < batches.size(); i++)
+			{
+				const RenderBatch& batch = batches[i];
+
+				if (!hasMaterial || batch.material != currMaterial)
+				{
+					SDL_SetRenderDrawColor(renderer, (Uint8)(batch.material >> 24), (Uint8)(batch.material >> 16),
+											(Uint8)(batch.material >> 8), (Uint8)batch.material);
+					currMaterial = batch.material;
+					hasMaterial = true;
+				}
+
+				switch (batch.primitive)
+				{
+				case RENDER_POINTS:
+					SDL_RenderDrawPoints(renderer, &mergedPoints[batch.first], (int)batch.count);
+					break;
+
+				case RENDER_LINE_STRIP:
+					SDL_RenderDrawLines(renderer, &mergedPoints[batch.first], (int)batch.count);
+					break;
+
+				case RENDER_RECTS:
+					SDL_RenderDrawRects(renderer, &mergedRects[batch.first], (int)batch.count);
+					break;
+
+				case RENDER_FILLED_RECTS:
+					SDL_RenderFillRects(renderer, &mergedRects[batch.first], (int)batch.count);
+					break;
+				}
+
+				nCalls++;
+			}
+
+			return nCalls;
+		}
+
+	private:
+
+		struct SortEntry
+		{
+			Uint64 key;
+			Uint32 list;
+			Uint32 command;
+		};
+
+		TaggedVector<RenderCommandList, MEMORY_TAG_VIDEO>::Type lists;
+
+		TaggedVector<SortEntry, MEMORY_TAG_VIDEO>::Type entries;
+
+		LinearAllocator* scratchAllocator;
+
+		RenderBatchList batches;
+
+		TaggedVector<SDL_Point, MEMORY_TAG_VIDEO>::Type mergedPoints;
+
+		TaggedVector<SDL_Rect, MEMORY_TAG_VIDEO>::Type mergedRects;
+
+
+		void gatherEntries(SortEntry* out)
+		{
+			for (unsigned int l = 0; l < lists.size(); l++)
+			{
+				const TaggedVector<RenderCommand, MEMORY_TAG_VIDEO>::Type& cmds = lists[l].commands;
+
+				for (unsigned int c = 0; c < cmds.size(); c++)
+				{
+					SortEntry e;
+					e.key = cmds[c].key;
+					e.list = l;
+					e.command = c;
+					*out++ = e;
+				}
+			}
+		}
+
+		// LSD radix sort, 8 bits per pass. Passes where every key has
+		// the same byte are skipped, so typical frames with few layers
+		// and materials cost 3-4 passes instead of 8. Returns whichever of
+		// 'src' and 'dst' holds the sorted entries.
+		SortEntry* radixSort(SortEntry* src, SortEntry* dst, unsigned int n)
+		{
+			if (n < 2)
+			{
+				return src;
+			}
+
+			unsigned int histogram[8][256];
+			memset(histogram, 0, sizeof(histogram));
+
+			for (unsigned int i = 0; i < n; i++)
+			{
+				Uint64 key = src[i].key;
+				for (unsigned int pass = 0; pass < 8; pass++)
+				{
+					histogram[pass][(key >> (pass*8)) & 0xFF]++;
+				}
+			}
+
+			for (unsigned int pass = 0; pass < 8; pass++)
+			{
+				unsigned int* hist = histogram[pass];
+				unsigned int shift = pass*8;
+
+				if (hist[(src[0].key >> shift) & 0xFF] == n)
+				{
+					continue;
+				}
+
+				unsigned int offset = 0;
+				for (unsigned int b = 0; b < 256; b++)
+				{
+					unsigned int count = hist[b];
+					hist[b] = offset;
+					offset += count;
+				}
+
+				for (unsigned int i = 0; i < n; i++)
+				{
+					dst[hist[(src[i].key >> shift) & 0xFF]++] = src[i];
+				}
+
+				SortEntry* tmp = src;
+				src = dst;
+				dst = tmp;
+			}
+
+			return src;
+		}
+
+		void buildBatches(const SortEntry* sorted, unsigned int n)
+		{
+			batches.clear();
+			mergedPoints.clear();
+			mergedRects.clear();
+
+			for (unsigned int i = 0; i < n; i++)
+			{
+				const RenderCommandList& cmdList = lists[sorted[i].list];
+				const RenderCommand& cmd = cmdList.commands[sorted[i].command];
+
+				Uint32 material = renderKeyMaterial(cmd.key);
+
+				// Independent segments are merged into strips. A new strip
+				// starts whenever segment does not continue the previous one.
+				Uint32 primitive = (cmd.primitive == RENDER_LINES) ? (Uint32)RENDER_LINE_STRIP : cmd.primitive;
+
+				bool isRect = (primitive == RENDER_RECTS || primitive == RENDER_FILLED_RECTS);
+
+				for (Uint32 e = 0; e < cmd.count; )
+				{
+					if (isRect)
+					{
+						RenderBatch& batch = openBatch(material, primitive, (Uint32)mergedRects.size());
+						mergedRects.push_back(cmdList.rects[cmd.first + e]);
+						batch.count++;
+						e++;
+						continue;
+					}
+
+					if (primitive == RENDER_POINTS)
+					{
+						RenderBatch& batch = openBatch(material, primitive, (Uint32)mergedPoints.size());
+						mergedPoints.push_back(cmdList.points[cmd.first + e]);
+						batch.count++;
+						e++;
+						continue;
+					}
+
+					// line strips; for RENDER_LINES every pair is its own strip
+					Uint32 stripLen = (cmd.primitive == RENDER_LINES) ? 2 : cmd.count;
+					const SDL_Point* strip = &cmdList.points[cmd.first + e];
+
+					RenderBatch* last = batches.empty() ? 0 : &batches.back();
+
+					bool continues = last != 0 &&
+									 last->material == material &&
+									 last->primitive == RENDER_LINE_STRIP &&
+									 mergedPoints.back().x == strip[0].x &&
+									 mergedPoints.back().y == strip[0].y;
+
+					if (continues)
+					{
+						mergedPoints.insert(mergedPoints.end(), strip + 1, strip + stripLen);
+						last->count += stripLen - 1;
+					}
+					else
+					{
+						RenderBatch batch;
+						batch.material = material;
+						batch.primitive = RENDER_LINE_STRIP;
+						batch.first = (Uint32)mergedPoints.size();
+						batch.count = stripLen;
+						batches.push_back(batch);
+						mergedPoints.insert(mergedPoints.end(), strip, strip + stripLen);
+					}
+
+					e += stripLen;
+				}
+			}
+		}
+
+		// Returns last batch if it can be extended, otherwise starts new one.
+		RenderBatch& openBatch(Uint32 material, Uint32 primitive, Uint32 first)
+		{
+			if (!batches.empty())
+			{
+				RenderBatch& last = batches.back();
+				if (last.material == material && last.primitive == primitive)
+				{
+					return last;
+				}
+			}
+
+			RenderBatch batch;
+			batch.material = material;
+			batch.primitive = primitive;
+			batch.first = first;
+			batch.count = 0;
+			batches.push_back(batch);
+
+			return batches.back();
+		}
+	};
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "SDL_render.h"
+
+#include "../core/h2_memory.h"
+#include "../core/h2_profiler.h"
+#include "h2_texture_atlas.h"
+
+
+
+
+namespace h2
+{
+	struct Sprite
+	{
+		SDL_Texture* texture;
+		SDL_Rect src;
+		SDL_Rect dst;
+		Uint32 color;   // RGBA modulation
+		Uint8 layer;
+	};
+
+
+	// Collects sprites for a frame and draws them grouped by layer and
+	// texture. With sprites packed into a TextureAtlas the whole layer
+	// binds a single texture and only color modulation changes between
+	// draws.
+	class SpriteBatch
+	{
+	public:
+
+		// Constructors
+
+		SpriteBatch() : nTextureSwitches(0), nDrawCalls(0) {}
+
+
+		// Methods
+
+		void draw(const AtlasRegion& region, float x, float y, Uint8 layer = 0, Uint32 color = 0xFFFFFFFF)
+		{
+			draw(region.texture, region.rect, x, y, (float)region.rect.w, (float)region.rect.h, layer, color);
+		}
+
+		void draw(SDL_Texture* texture, const SDL_Rect& src, float x, float y, float w, float h, Uint8 layer = 0, Uint32 color = 0xFFFFFFFF)
+		{
+			Sprite sprite;
+			sprite.texture = texture;
+			sprite.src = src;
+			sprite.dst.x = (int)x;
+			sprite.dst.y = (int)y;
+			sprite.dst.w = (int)w;
+			sprite.dst.h = (int)h;
+			sprite.color = color;
+			sprite.layer = layer;
+			sprites.push_back(sprite);
+		}
+
+		inline unsigned int spriteCount() const
+		{
+			return (unsigned int)sprites.size();
+		}
+
+		// Statistics of the last 'flush()'.
+		inline int lastTextureSwitches() const { return nTextureSwitches; }
+
+		inline int lastDrawCalls() const { return nDrawCalls; }
+
+		// Draws and clears all sprites. Order inside a layer is preserved
+		// for sprites sharing a texture.
+		void flush(SDL_Renderer* renderer)
+		{
+			H2_PROFILE_SCOPE("sprite batch flush");
+
+			order.resize(sprites.size());
+			for (unsigned int i = 0; i < sprites.size(); i++)
+			{
+				order[i] = i;
+			}
+
+			// the submission index breaks ties, std::stable_sort would
+			// allocate a merge buffer on every flush
+			std::sort(order.begin(), order.end(), CompareSprites(sprites));
+
+			nTextureSwitches = 0;
+			nDrawCalls = 0;
+
+			SDL_Texture* currTexture = 0;
+			Uint32 currColor = 0;
+
+			for (unsigned int i = 0; i < order.size(); i++)
+			{
+				const Sprite& sprite = sprites[order[i]];
+
+				if (sprite.texture != currTexture)
+				{
+					currTexture = sprite.texture;
+					nTextureSwitches++;
+
+					// force color reset, modulation is per texture
+					currColor = ~sprite.color;
+				}
+
+				if (sprite.color != currColor)
+				{
+					SDL_SetTextureColorMod(currTexture, (Uint8)(sprite.color >> 24), (Uint8)(sprite.color >> 16), (Uint8)(sprite.color >> 8));
+					SDL_SetTextureAlphaMod(currTexture, (Uint8)sprite.color);
+					currColor = sprite.color;
+				}
+
+				SDL_RenderCopy(renderer, currTexture, &sprite.src, &sprite.dst);
+				nDrawCalls++;
+			}
+
+			sprites.clear();
+		}
+
+	private:
+
+		typedef TaggedVector<Sprite, MEMORY_TAG_VIDEO>::Type SpriteList;
+
+		struct CompareSprites
+		{
+			const SpriteList& sprites;
+
+			CompareSprites(const SpriteList& sprites) : sprites(sprites) {}
+
+			bool operator () (unsigned int a, unsigned int b) const
+			{
+				const Sprite& sa = sprites[a];
+				const Sprite& sb = sprites[b];
+
+				if (sa.layer != sb.layer)
+				{
+					return sa.layer < sb.layer;
+				}
+				if (sa.texture != sb.texture)
+				{
+					return sa.texture < sb.texture;
+				}
+				return a < b;
+			}
+		};
+
+		SpriteList sprites;
+
+		TaggedVector<unsigned int, MEMORY_TAG_VIDEO>::Type order;
+
+		int nTextureSwitches, nDrawCalls;
+	};
+}
@@ -0,0 +1,535 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SDL_render.h"
+
+#include "../core/h2_memory.h"
+#include "../core/h2_profiler.h"
+#include "h2_glyph_cache.h"
+
+
+
+#define H2_TEXT_LAYOUT_MAX_AGE 30         // frames an unused layout stays cached
+#define H2_TEXT_LAYOUT_MAX_ENTRIES 1024   // more drop everything not used this frame
+
+
+
+
+namespace h2
+{
+	struct TextStyle
+	{
+		int size;        // pixels, 1 to 255
+		int wrapWidth;   // 0 means no wrapping
+
+		TextStyle(int in_size = 9, int in_wrapWidth = 0) : size(in_size), wrapWidth(in_wrapWidth) {}
+	};
+
+
+	// Glyph of a laid out text, bitmap top-left relative to the text box.
+	struct TextGlyph
+	{
+		Uint32 key;
+		int x, y;
+		int id;   // last known GlyphCache id, checked before use
+	};
+
+
+	// Result of shaping a string; blank glyphs are not stored.
+	struct TextLayout
+	{
+		TaggedVector<TextGlyph, MEMORY_TAG_VIDEO>::Type glyphs;
+		int width, height;
+	};
+
+
+	// Next codepoint of UTF-8 string, advances 'p'. Malformed bytes
+	// decode as U+FFFD.
+	inline Uint32 decodeUtf8(const char*& p)
+	{
+		Uint32 c = (Uint8)*p++;
+		if (c < 0x80)
+		{
+			return c;
+		}
+
+		int n = (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC0) ? 1 : 0;
+		if (n == 0)
+		{
+			return 0xFFFD;
+		}
+
+		c &= 0x3F >> n;
+		for (int i = 0; i < n; i++)
+		{
+			if (((Uint8)*p & 0xC0) != 0x80)
+			{
+				return 0xFFFD;
+			}
+			c = (c << 6) | ((Uint8)*p++ & 0x3F);
+		}
+
+		return c;
+	}
+
+
+	// Lays out 'text' with line breaks at '\n' and, with 'wrapWidth',
+	// word wrapping at spaces. Words longer than a line are split.
+	inline void layoutText(GlyphRasterizer& rasterizer, const char* text, const TextStyle& style, TextLayout* out)
+	{
+		int size = style.size < 1 ? 1 : (style.size > 255 ? 255 : style.size);
+		int lineHeight = rasterizer.getLineHeight(size);
+		int baseline = rasterizer.getAscent(size);
+
+		out->glyphs.clear();
+		out->width = 0;
+
+		int penX = 0;
+		int nLines = 1;
+
+		unsigned int breakGlyph = 0;  // first glyph after the last space
+		int breakX = 0;
+		bool hasBreak = false;        // a space was seen on this line
+
+		const char* p = text;
+		while (*p != 0)
+		{
+			Uint32 c = decodeUtf8(p);
+
+			if (c == '\n')
+			{
+				penX = 0;
+				baseline += lineHeight;
+				nLines++;
+				hasBreak = false;
+				continue;
+			}
+
+			GlyphMetrics m;
+			if (!rasterizer.getMetrics(c, size, &m))
+			{
+				continue;
+			}
+
+			if (c == ' ')
+			{
+				penX += m.advance;
+				breakGlyph = (unsigned int)out->glyphs.size();
+				breakX = penX;
+				hasBreak = true;
+				continue;
+			}
+
+			if (style.wrapWidth > 0 && penX + m.offsetX + m.width > style.wrapWidth && penX > 0)
+			{
+				// without a space the word is split at the current glyph
+				unsigned int from = hasBreak ? breakGlyph : (unsigned int)out->glyphs.size();
+				int shift = hasBreak ? breakX : penX;
+
+				// move the current word to a new line
+				for (unsigned int i = from; i < out->glyphs.size(); i++)
+				{
+					out->glyphs[i].x -= shift;
+					out->glyphs[i].y += lineHeight;
+				}
+
+				penX -= shift;
+				baseline += lineHeight;
+				nLines++;
+				hasBreak = false;
+			}
+
+			if (m.width > 0 && m.height > 0)
+			{
+				TextGlyph g;
+				g.key = makeGlyphKey(c, size);
+				g.x = penX + m.offsetX;
+				g.y = baseline + m.offsetY;
+				g.id = -1;
+				out->glyphs.push_back(g);
+			}
+
+			penX += m.advance;
+		}
+
+		// width from ink, so trailing spaces do not count
+		for (unsigned int i = 0; i < out->glyphs.size(); i++)
+		{
+			GlyphMetrics m;
+			const TextGlyph& g = out->glyphs[i];
+			rasterizer.getMetrics(g.key >> 8, size, &m);
+			out->width = (g.x + m.width > out->width) ? g.x + m.width : out->width;
+		}
+
+		out->height = nLines*lineHeight;
+	}
+
+
+	struct TextCacheStats
+	{
+		unsigned int layoutHits;
+		unsigned int layoutMisses;
+		unsigned int nLayouts;
+	};
+
+
+	// Glyph atlas plus layouts of recently drawn strings, keyed by string
+	// and style. Drawing a string seen in the last frames costs one hash,
+	// one string compare and a check per glyph that its atlas cell is
+	// still valid.
+	class TextCache
+	{
+	public:
+
+		// Constructors
+
+		TextCache() : frame(1)
+		{
+			memset(&stats, 0, sizeof(stats));
+		}
+
+
+		// Methods
+
+		inline bool create(SDL_Renderer* renderer, GlyphRasterizer* rasterizer, int atlasWidth = 512, int atlasHeight = 512)
+		{
+			layouts.clear();
+			return glyphs.create(renderer, rasterizer, atlasWidth, atlasHeight);
+		}
+
+		inline GlyphCache& getGlyphCache() { return glyphs; }
+
+		inline const TextCacheStats& getStats() const { return stats; }
+
+		// Call once per frame, ages cached glyphs and layouts.
+		void newFrame()
+		{
+			glyphs.newFrame();
+			frame++;
+
+			Uint32 maxAge = (layouts.size() > H2_TEXT_LAYOUT_MAX_ENTRIES) ? 1 : H2_TEXT_LAYOUT_MAX_AGE;
+
+			for (LayoutMap::iterator it = layouts.begin(); it != layouts.end(); )
+			{
+				if (frame - it->second.lastFrame > maxAge)
+				{
+					layouts.erase(it++);
+				} else
+				{
+					++it;
+				}
+			}
+
+			stats.nLayouts = (unsigned int)layouts.size();
+		}
+
+		// Cached layout of 'text', 0 without a rasterizer.
+		TextLayout* getLayout(const char* text, const TextStyle& style)
+		{
+			GlyphRasterizer* rasterizer = glyphs.getRasterizer();
+			if (rasterizer == 0)
+			{
+				return 0;
+			}
+
+			Uint32 hash = hashText(text, style);
+
+			std::pair<LayoutMap::iterator, LayoutMap::iterator> range = layouts.equal_range(hash);
+			for (LayoutMap::iterator it = range.first; it != range.second; ++it)
+			{
+				Entry& e = it->second;
+				if (e.size == style.size && e.wrapWidth == style.wrapWidth && e.text == text)
+				{
+					stats.layoutHits++;
+					e.lastFrame = frame;
+					return &e.layout;
+				}
+			}
+
+			stats.layoutMisses++;
+
+			LayoutMap::iterator it = layouts.insert(std::make_pair(hash, Entry()));
+			Entry& e = it->second;
+			e.text = text;
+			e.size = style.size;
+			e.wrapWidth = style.wrapWidth;
+			e.lastFrame = frame;
+			layoutText(*rasterizer, text, style, &e.layout);
+
+			return &e.layout;
+		}
+
+		SDL_Point measure(const char* text, const TextStyle& style)
+		{
+			TextLayout* layout = getLayout(text, style);
+
+			SDL_Point size = {0, 0};
+			if (layout != 0)
+			{
+				size.x = layout->width;
+				size.y = layout->height;
+			}
+			return size;
+		}
+
+	private:
+
+		struct Entry
+		{
+			std::string text;
+			int size, wrapWidth;
+			Uint32 lastFrame;
+			TextLayout layout;
+		};
+
+		typedef TaggedMultimap<Uint32, Entry, MEMORY_TAG_VIDEO>::Type LayoutMap;
+
+		GlyphCache glyphs;
+
+		LayoutMap layouts;
+
+		Uint32 frame;
+
+		TextCacheStats stats;
+
+
+		// FNV-1a over text and style
+		static Uint32 hashText(const char* text, const TextStyle& style)
+		{
+			Uint32 h = 2166136261u;
+			for (const char* p = text; *p != 0; p++)
+			{
+				h = (h ^ (Uint8)*p)*16777619u;
+			}
+			h = (h ^ (Uint32)style.size)*16777619u;
+			h = (h ^ (Uint32)style.wrapWidth)*16777619u;
+			return h;
+		}
+	};
+
+
+	// Glyph quads of a frame. All glyphs share the TextCache atlas, so
+	// 'flush()' binds one texture and changes color modulation once per
+	// distinct color.
+	class TextBatch
+	{
+	public:
+
+		// Constructors
+
+		TextBatch() : texture(0), nColorChanges(0) {}
+
+
+		// Methods
+
+		// Queues 'text' with its box at 'x', 'y'. With 'clip' quads are
+		// cut to it in software.
+		void draw(TextCache& cache, const char* text, int x, int y, const TextStyle& style, Uint32 color = 0xFFFFFFFF, const SDL_Rect* clip = 0)
+		{
+			TextLayout* layout = cache.getLayout(text, style);
+			if (layout == 0)
+			{
+				return;
+			}
+
+			GlyphCache& glyphs = cache.getGlyphCache();
+			texture = glyphs.getTexture();
+
+			for (unsigned int i = 0; i < layout->glyphs.size(); i++)
+			{
+				TextGlyph& g = layout->glyphs[i];
+
+				if (!glyphs.isCached(g.id, g.key))
+				{
+					g.id = glyphs.find(g.key >> 8, (int)(g.key & 0xFF));
+					if (g.id < 0)
+					{
+						continue;
+					}
+				}
+
+				Quad q;
+				q.src = glyphs.getRect(g.id);
+				q.dst.x = x + g.x;
+				q.dst.y = y + g.y;
+				q.dst.w = q.src.w;
+				q.dst.h = q.src.h;
+				q.color = color;
+
+				if (clip != 0 && !clipQuad(q, *clip))
+				{
+					continue;
+				}
+
+				q.order = (Uint32)quads.size();
+				quads.push_back(q);
+			}
+		}
+
+		// Like 'draw()' but without the layout cache, for text that
+		// changes every frame: no wrapping, glyphs are looked up one by
+		// one and nothing is allocated once they are in the atlas.
+		void drawImmediate(TextCache& cache, const char* text, int x, int y, const TextStyle& style, Uint32 color = 0xFFFFFFFF, const SDL_Rect* clip = 0)
+		{
+			GlyphCache& glyphs = cache.getGlyphCache();
+			GlyphRasterizer* rasterizer = glyphs.getRasterizer();
+			if (rasterizer == 0)
+			{
+				return;
+			}
+
+			texture = glyphs.getTexture();
+
+			int size = style.size < 1 ? 1 : (style.size > 255 ? 255 : style.size);
+			int lineHeight = rasterizer->getLineHeight(size);
+			int penX = x;
+			int baseline = y + rasterizer->getAscent(size);
+
+			const char* p = text;
+			while (*p != 0)
+			{
+				Uint32 c = decodeUtf8(p);
+
+				if (c == '\n')
+				{
+					penX = x;
+					baseline += lineHeight;
+					continue;
+				}
+
+				GlyphMetrics m;
+				if (!rasterizer->getMetrics(c, size, &m))
+				{
+					continue;
+				}
+
+				int id = (m.width > 0 && m.height > 0) ? glyphs.find(c, size) : -1;
+				if (id >= 0)
+				{
+					Quad q;
+					q.src = glyphs.getRect(id);
+					q.dst.x = penX + m.offsetX;
+					q.dst.y = baseline + m.offsetY;
+					q.dst.w = q.src.w;
+					q.dst.h = q.src.h;
+					q.color = color;
+
+					if (clip == 0 || clipQuad(q, *clip))
+					{
+						q.order = (Uint32)quads.size();
+						quads.push_back(q);
+					}
+				}
+
+				penX += m.advance;
+			}
+		}
+
+		inline unsigned int getQuadCount() const
+		{
+			return (unsigned int)quads.size();
+		}
+
+		// Color modulation changes of the last 'flush()'.
+		inline int lastColorChanges() const { return nColorChanges; }
+
+		// Draws and clears queued quads, returns number of draw calls.
+		int flush(SDL_Renderer* renderer)
+		{
+			H2_PROFILE_SCOPE("text flush");
+
+			nColorChanges = 0;
+
+			if (quads.empty())
+			{
+				return 0;
+			}
+
+			// glyphs never overlap, order only matters for grouping;
+			// sorting in place keeps flush free of allocations
+			std::sort(quads.begin(), quads.end(), CompareQuads());
+
+			Uint32 currColor = ~quads[0].color;
+			int nDrawCalls = 0;
+
+			for (unsigned int i = 0; i < quads.size(); i++)
+			{
+				const Quad& q = quads[i];
+
+				if (q.color != currColor)
+				{
+					SDL_SetTextureColorMod(texture, (Uint8)(q.color >> 24), (Uint8)(q.color >> 16), (Uint8)(q.color >> 8));
+					SDL_SetTextureAlphaMod(texture, (Uint8)q.color);
+					currColor = q.color;
+					nColorChanges++;
+				}
+
+				SDL_RenderCopy(renderer, texture, &q.src, &q.dst);
+				nDrawCalls++;
+			}
+
+			quads.clear();
+
+			return nDrawCalls;
+		}
+
+		inline void clear()
+		{
+			quads.clear();
+		}
+
+	private:
+
+		struct Quad
+		{
+			SDL_Rect src, dst;
+			Uint32 color;
+			Uint32 order;
+		};
+
+		struct CompareQuads
+		{
+			bool operator () (const Quad& a, const Quad& b) const
+			{
+				return a.color != b.color ? a.color < b.color : a.order < b.order;
+			}
+		};
+
+		TaggedVector<Quad, MEMORY_TAG_VIDEO>::Type quads;
+
+		SDL_Texture* texture;
+
+		int nColorChanges;
+
+
+		// Glyphs are drawn 1:1, so src is cut by the same amounts as dst.
+		static bool clipQuad(Quad& q, const SDL_Rect& clip)
+		{
+			int x0 = q.dst.x > clip.x ? q.dst.x : clip.x;
+			int y0 = q.dst.y > clip.y ? q.dst.y : clip.y;
+			int x1 = (q.dst.x + q.dst.w < clip.x + clip.w) ? q.dst.x + q.dst.w : clip.x + clip.w;
+			int y1 = (q.dst.y + q.dst.h < clip.y + clip.h) ? q.dst.y + q.dst.h : clip.y + clip.h;
+
+			if (x1 <= x0 || y1 <= y0)
+			{
+				return false;
+			}
+
+			q.src.x += x0 - q.dst.x;
+			q.src.y += y0 - q.dst.y;
+			q.src.w = x1 - x0;
+			q.src.h = y1 - y0;
+			q.dst.x = x0;
+			q.dst.y = y0;
+			q.dst.w = x1 - x0;
+			q.dst.h = y1 - y0;
+
+			return true;
+		}
+	};
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <vector>
+
+#include "SDL_render.h"
+
+#include "../core/h2_memory.h"
+
+
+
+
+namespace h2
+{
+	// Skyline bottom-left rectangle packer. Rectangles are inserted one by
+	// one, so the atlas can be filled incrementally while the game runs.
+	// 'padding' pixels are reserved around each rectangle and positions are
+	// aligned to 'alignment', so mip levels down to log2(alignment) never
+	// mix texels of neighbouring rectangles.
+	class SkylinePacker
+	{
+	public:
+
+		// Constructors
+
+		SkylinePacker(int width = 0, int height = 0, int padding = 1, int alignment = 1)
+		{
+			reset(width, height, padding, alignment);
+		}
+
+
+		// Methods
+
+		void reset(int in_width, int in_height, int in_padding = 1, int in_alignment = 1)
+		{
+			width = in_width;
+			height = in_height;
+			padding = in_padding;
+			alignment = in_alignment > 0 ? in_alignment : 1;
+			usedArea = 0;
+
+			skyline.clear();
+			Node node = {0, 0, width};
+			skyline.push_back(node);
+		}
+
+		inline int getWidth() const { return width; }
+
+		inline int getHeight() const { return height; }
+
+		// Fraction of atlas area covered by inserted rectangles (with padding).
+		inline float occupancy() const
+		{
+			return (width > 0 && height > 0) ? (float)usedArea/((float)width*height) : 0.0f;
+		}
+
+		// Finds place for 'w' x 'h' rectangle. On success returns true and
+		// writes position of the rectangle itself (inside padding) to 'outRect'.
+		bool insert(int w, int h, SDL_Rect* outRect)
+		{
+			int paddedW = alignUp(w + 2*padding);
+			int paddedH = alignUp(h + 2*padding);
+
+			int bestIndex = -1;
+			int bestY = height;
+			int bestWidth = width;
+
+			for (unsigned int i = 0; i < skyline.size(); i++)
+			{
+				int y;
+				if (fits(i, paddedW, paddedH, &y))
+				{
+					if (y < bestY || (y == bestY && skyline[i].width < bestWidth))
+					{
+						bestIndex = (int)i;
+						bestY = y;
+						bestWidth = skyline[i].width;
+					}
+				}
+			}
+
+			if (bestIndex < 0)
+			{
+				return false;
+			}
+
+			int x = skyline[bestIndex].x;
+
+			addNode(bestIndex, x, bestY, paddedW, paddedH);
+
+			usedArea += paddedW*paddedH;
+
+			outRect->x = x + padding;
+			outRect->y = bestY + padding;
+			outRect->w = w;
+			outRect->h = h;
+
+			return true;
+		}
+
+	private:
+
+		struct Node
+		{
+			int x, y, width;
+		};
+
+		TaggedVector<Node, MEMORY_TAG_VIDEO>::Type skyline;
+
+		int width, height, padding, alignment;
+
+		int usedArea;
+
+
+		inline int alignUp(int val) const
+		{
+			return (val + alignment - 1)/alignment*alignment;
+		}
+
+		// Checks if rectangle fits with left edge at node 'index'
+		// and returns lowest 'y' it can be placed at.
+		bool fits(unsigned int index, int w, int h, int* outY) const
+		{
+			int x = skyline[index].x;
+
+			if (x + w > width)
+			{
+				return false;
+			}
+
+			int y = 0;
+			int widthLeft = w;
+
+			while (widthLeft > 0)
+			{
+				if (skyline[index].y > y)
+				{
+					y = skyline[index].y;
+				}
+
+				if (y + h > height)
+				{
+					return false;
+				}
+
+				widthLeft -= skyline[index].width;
+				index++;
+			}
+
+			*outY = y;
+			return true;
+		}
+
+		void addNode(int index, int x, int y, int w, int h)
+		{
+			Node node = {x, y + h, w};
+			skyline.insert(skyline.begin() + index, node);
+
+			// shrink or remove nodes now covered by the new one
+			for (unsigned int i = index + 1; i < skyline.size(); )
+			{
+				Node& prev = skyline[i - 1];
+				Node& curr = skyline[i];
+
+				if (curr.x < prev.x + prev.width)
+				{
+					int shrink = prev.x + prev.width - curr.x;
+
+					curr.x += shrink;
+					curr.width -= shrink;
+
+					if (curr.width <= 0)
+					{
+						skyline.erase(skyline.begin() + i);
+						continue;
+					}
+				}
+				break;
+			}
+
+			// merge neighbours at the same height
+			for (unsigned int i = 0; i + 1 < skyline.size(); )
+			{
+				if (skyline[i].y == skyline[i + 1].y)
+				{
+					skyline[i].width += skyline[i + 1].width;
+					skyline.erase(skyline.begin() + i + 1);
+				}
+				else
+				{
+					i++;
+				}
+			}
+		}
+	};
+
+
+	// Region of atlas texture assigned to one image.
+	struct AtlasRegion
+	{
+		SDL_Texture* texture;
+		SDL_Rect rect;
+	};
+
+
+	// RGBA8888 texture atlas. Images are packed with SkylinePacker and
+	// uploaded with their border texels extruded into the padding, so
+	// linear filtering does not bleed neighbouring images.
+	class TextureAtlas
+	{
+	public:
+
+		// Constructors
+
+		TextureAtlas() : texture(0) {}
+
+
+		// Destructor
+
+		~TextureAtlas()
+		{
+			destroy();
+		}
+
+
+		// Methods
+
+		bool create(SDL_Renderer* renderer, int width, int height, int padding = 1, int alignment = 4)
+		{
+			destroy();
+
+			texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, width, height);
+
+			if (texture == 0)
+			{
+				return false;
+			}
+
+			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+			packer.reset(width, height, padding, alignment);
+			extrude = padding;
+
+			return true;
+		}
+
+		void destroy()
+		{
+			if (texture != 0)
+			{
+				SDL_DestroyTexture(texture);
+				texture = 0;
+			}
+		}
+
+		inline SDL_Texture* getTexture() const { return texture; }
+
+		inline const SkylinePacker& getPacker() const { return packer; }
+
+		// Packs and uploads 'w' x 'h' RGBA8888 image. 'pitch' is in bytes.
+		// Returns false when atlas is full.
+		bool insert(const Uint32* pixels, int w, int h, int pitch, AtlasRegion* outRegion)
+		{
+			SDL_Rect rect;
+
+			if (texture == 0 || !packer.insert(w, h, &rect))
+			{
+				return false;
+			}
+
+			int e = extrude;
+			int paddedW = w + 2*e;
+			int paddedH = h + 2*e;
+
+			scratch.resize(paddedW*paddedH);
+
+			for (int y = 0; y < paddedH; y++)
+			{
+				int srcY = clamp(y - e, h);
+				const Uint32* srcRow = (const Uint32*)((const Uint8*)pixels + srcY*pitch);
+				Uint32* dstRow = &scratch[y*paddedW];
+
+				for (int x = 0; x < paddedW; x++)
+				{
+					dstRow[x] = srcRow[clamp(x - e, w)];
+				}
+			}
+
+			SDL_Rect padded = {rect.x - e, rect.y - e, paddedW, paddedH};
+			SDL_UpdateTexture(texture, &padded, &scratch[0], paddedW*(int)sizeof(Uint32));
+
+			outRegion->texture = texture;
+			outRegion->rect = rect;
+
+			return true;
+		}
+
+	private:
+
+		SDL_Texture* texture;
+
+		SkylinePacker packer;
+
+		int extrude;
+
+		TaggedVector<Uint32, MEMORY_TAG_VIDEO>::Type scratch;
+
+
+		TextureAtlas(const TextureAtlas&);
+		TextureAtlas& operator = (const TextureAtlas&);
+
+		static inline int clamp(int val, int size)
+		{
+			return val < 0 ? 0 : (val >= size ? size - 1 : val);
+		}
+	};
+}